@@ -32,7 +32,7 @@ LOCAL_CFLAGS += -DBUILDOS_ANDROID -DDCE_DEBUG_ENABLE=1 -DDCE_DEBUG_LEVEL=1
 LOCAL_MODULE_TAGS:= optional
 LOCAL_VENDOR_MODULE := true
 
-LOCAL_SRC_FILES:= libdce.c libdce_android.c memplugin_android.c
+LOCAL_SRC_FILES:= libdce.c libdce_android.c memplugin_android.c dce_trace.c dce_parser.c
 
 
 LOCAL_MODULE:= libdce
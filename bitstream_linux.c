@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2013, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "memplugin.h"
+#include "dce_priv.h"
+#include "libdce.h"
+
+/* Ring of bitstream the producer appends into while the decoder reads it. A guard */
+/* mirroring the start of the ring follows its end, so that the access unit at the */
+/* read offset is contiguous even when it wraps: the bytes of the first guard bytes */
+/* of the ring are always written in the guard, and copied to the start of the     */
+/* ring when committed. The ring is imported once, dce_bitstream_prepare() moves   */
+/* the window of the import (dce_buf_import_seek()) to the read offset.            */
+struct dce_bitstream {
+    MemHeader           mem;        /* size + guard bytes */
+    void                *import;
+    char                *base;
+    int                 size;
+    int                 guard;
+    pthread_mutex_t     mutex;
+    int                 rd;         /* read offset, [0, size) */
+    int                 wr;         /* write offset, [0, size) */
+    int                 fill;       /* bytes committed and not consumed yet */
+    int                 window;     /* bytes given to the codec by the last prepare */
+};
+
+/* Contiguous bytes writable at the write offset. bs->mutex must be held. */
+static int ring_avail(dce_bitstream *bs)
+{
+    int     end = (bs->wr < bs->guard) ? bs->guard : bs->size + bs->guard;
+    int     avail = bs->size - bs->fill;
+
+    return (avail < end - bs->wr ? avail : end - bs->wr);
+}
+
+dce_bitstream *dce_bitstream_create(int size, int guard)
+{
+    dce_bitstream       *bs = NULL;
+    dce_plane           plane;
+    XDM2_SingleBufDesc  desc;
+    dce_error_status    eError = DCE_EOK;
+
+    guard = guard ? guard : size / 4;
+    _ASSERT(size > 0 && guard > 0 && guard <= size, DCE_EINVALID_INPUT);
+
+    bs = calloc(1, sizeof(dce_bitstream));
+    _ASSERT(bs != NULL, DCE_EOUT_OF_MEMORY);
+    pthread_mutex_init(&bs->mutex, NULL);
+    bs->size = size;
+    bs->guard = guard;
+
+    bs->base = memplugin_alloc_noheader(&(bs->mem), size + guard, 0, MEM_TILER_1D, 0, IPU);
+    _ASSERT(bs->base != NULL, DCE_EOUT_OF_MEMORY);
+
+    plane.offset = 0;
+    plane.stride = size + guard;
+    plane.height = 1;
+    bs->import = dce_buf_import(bs->mem.dma_buf_fd, 1, &plane, &desc);
+    _ASSERT(bs->import != NULL, DCE_EOUT_OF_MEMORY);
+    DEBUG("bitstream %p: %d bytes, %d bytes guard", bs, size, guard);
+
+EXIT:
+    if( eError != DCE_EOK && bs ) {
+        dce_bitstream_delete(bs);
+        bs = NULL;
+    }
+    return (bs);
+}
+
+void dce_bitstream_delete(dce_bitstream *bs)
+{
+    if( bs == NULL ) {
+        return;
+    }
+    if( bs->import ) {
+        dce_buf_unimport(bs->import);
+    }
+    if( bs->base ) {
+        memplugin_free_noheader(&(bs->mem));
+    }
+    pthread_mutex_destroy(&bs->mutex);
+    free(bs);
+}
+
+void *dce_bitstream_write_ptr(dce_bitstream *bs, int *avail)
+{
+    int     wr;
+
+    pthread_mutex_lock(&bs->mutex);
+    wr = bs->wr;
+    *avail = ring_avail(bs);
+    pthread_mutex_unlock(&bs->mutex);
+
+    /* The first guard bytes of the ring are written in the guard */
+    return (bs->base + (wr < bs->guard ? bs->size + wr : wr));
+}
+
+int dce_bitstream_commit(dce_bitstream *bs, int bytes)
+{
+    int                 wr, start, end, avail;
+    dce_error_status    eError = DCE_EOK;
+
+    pthread_mutex_lock(&bs->mutex);
+    wr = bs->wr;
+    avail = ring_avail(bs);
+    pthread_mutex_unlock(&bs->mutex);
+    _ASSERT(bytes >= 0 && bytes <= avail, DCE_EINVALID_INPUT);
+
+    /* Copy what was written in the guard to the start of the ring, the decoder */
+    /* does not read these bytes before they are committed.                     */
+    start = (wr < bs->guard) ? wr : 0;
+    end = (wr < bs->guard) ? wr + bytes : wr + bytes - bs->size;
+    if( end > start ) {
+        memcpy(bs->base + start, bs->base + bs->size + start, end - start);
+    }
+
+    pthread_mutex_lock(&bs->mutex);
+    bs->wr = (wr + bytes) % bs->size;
+    bs->fill += bytes;
+    pthread_mutex_unlock(&bs->mutex);
+
+EXIT:
+    return (eError);
+}
+
+int dce_bitstream_prepare(dce_bitstream *bs, XDM2_BufDesc *inBufs, VIDDEC3_InArgs *inArgs)
+{
+    int                 len = 0;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(bs != NULL && inBufs != NULL && inArgs != NULL, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&bs->mutex);
+    len = bs->size + bs->guard - bs->rd;
+    len = (bs->fill < len) ? bs->fill : len;
+    bs->window = len;
+    if( len > 0 ) {
+        dce_buf_import_seek(bs->import, 0, bs->rd, len, &(inBufs->descs[0]));
+    }
+    pthread_mutex_unlock(&bs->mutex);
+
+    if( len > 0 ) {
+        inBufs->numBufs = 1;
+        inBufs->descs[0].memType = XDM_MEMTYPE_RAW;
+    }
+    inArgs->numBytes = len;
+
+EXIT:
+    return (eError == DCE_EOK ? len : eError);
+}
+
+int dce_bitstream_complete(dce_bitstream *bs, VIDDEC3_OutArgs *outArgs)
+{
+    int                 consumed = 0;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(bs != NULL && outArgs != NULL, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&bs->mutex);
+    consumed = (outArgs->bytesConsumed > 0) ? outArgs->bytesConsumed : 0;
+    consumed = (consumed < bs->window) ? consumed : bs->window;
+    bs->rd = (bs->rd + consumed) % bs->size;
+    bs->fill -= consumed;
+    bs->window = 0;
+    pthread_mutex_unlock(&bs->mutex);
+
+EXIT:
+    return (eError == DCE_EOK ? consumed : eError);
+}
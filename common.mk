@@ -34,7 +34,7 @@ EXTRA_INCVPATH += $(IPCHEADERS)/usr/include/
 LIBS += memmgr mmrpc sharedmemallocatorS
 
 # Exclude Linux & Android files for compile
-EXCLUDE_OBJS=memplugin_linux.o memplugin_android.o libdce_linux.o libdce_android.o
+EXCLUDE_OBJS=memplugin_linux.o memplugin_android.o libdce_linux.o libdce_android.o framepool_linux.o bitstream_linux.o
 
 # Include qmacros.mk
 include $(MKFILES_ROOT)/qmacros.mk
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2013, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DCE_CAPTURE_H__
+#define __DCE_CAPTURE_H__
+
+#include <stdint.h>
+
+/* File format of the RPC capture (dce_capture_start()) read by dce_replay.   */
+/* The file starts with a dce_capture_header, followed by one record per      */
+/* remote call in completion order:                                           */
+/*   dce_capture_call                                                         */
+/*   dce_capture_param  x num_params                                          */
+/*   dce_capture_xlt    x num_xlts                                            */
+/*   dce_capture_buf    x num_bufs, each followed by length bytes of contents */
+/* Shared buffers are identified by the inode of their dma-buf, so a buffer   */
+/* keeps its id across calls. Contents are taken before the call: the whole  */
+/* buffer for a data buffer, the MemHeader and data of a parameter buffer as  */
+/* they share buffer objects.                                                 */
+
+#define DCE_CAPTURE_MAGIC       0x50414344  /* "DCAP" */
+#define DCE_CAPTURE_VERSION     2
+
+/* core of the calls to the row mode callback service (dce-callback) */
+#define DCE_CAPTURE_CALLBACK    (-1)
+
+typedef struct dce_capture_header {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    ptr_size;       /* sizeof(void *) of the capturing process */
+    uint32_t    reserved;
+} dce_capture_header;
+
+typedef struct dce_capture_call {
+    uint64_t    start_us;       /* CLOCK_MONOTONIC time the call was issued */
+    uint64_t    thread;         /* calling thread */
+    uint32_t    duration_us;
+    int32_t     core;           /* remote core, DCE_CAPTURE_CALLBACK for callbacks */
+    int32_t     conn;           /* connection of the pool, callback id for callbacks */
+    uint32_t    fxn_id;
+    uint32_t    num_params;
+    uint32_t    num_xlts;
+    uint32_t    num_bufs;
+    int32_t     status;         /* result of MmRpc_call() */
+    int32_t     ret;            /* return value of the remote function */
+    uint32_t    reserved;
+} dce_capture_call;
+
+typedef struct dce_capture_param {
+    uint32_t    type;           /* MmRpc_ParamType */
+    uint32_t    size;
+    uint64_t    data;           /* value of a scalar */
+    uint64_t    buf_id;         /* buffer holding a Ptr or OffPtr parameter */
+    uint32_t    offset;         /* OffPtr offset of the parameter in its buffer */
+    uint32_t    reserved;
+} dce_capture_param;
+
+typedef struct dce_capture_xlt {
+    uint32_t    index;          /* parameter holding the pointer */
+    int32_t     offset;         /* offset of the pointer in the parameter */
+    uint64_t    buf_id;         /* buffer pointed to */
+    int64_t     delta;          /* pointer value - translation base */
+} dce_capture_xlt;
+
+typedef struct dce_capture_buf {
+    uint64_t    buf_id;
+    uint32_t    size;           /* size of the buffer */
+    uint32_t    offset;         /* of the contents in the buffer */
+    uint32_t    length;         /* bytes of contents following, 0 if not captured */
+    uint32_t    reserved;
+} dce_capture_buf;
+
+#endif /* __DCE_CAPTURE_H__ */
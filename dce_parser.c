@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2013, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ ********************************************************************************
+ * Access unit parser                                                           *
+ * Splits H.264 Annex-B, MPEG-2, MPEG-4 Part 2 and VC-1 advanced profile        *
+ * elementary streams into the access units given to VIDDEC3_process(), in the  *
+ * buffer the stream was read into. Only the start codes are looked at: an      *
+ * access unit ends before the first start code of the next picture, or of the  *
+ * headers preceding it, once the access unit holds a picture.                  *
+ ********************************************************************************
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include "dce_priv.h"
+#include "libdce.h"
+
+struct dce_au_parser {
+    dce_stream_format   format;
+    int                 scanned;    /* bytes of the access unit already scanned */
+    int                 picture;    /* the access unit holds a picture */
+};
+
+/* Position of the next 00 00 01 start code prefix in data[pos..len), -1 if none */
+static int find_start_code(const uint8_t *data, int pos, int len)
+{
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    /* 16 candidate positions at a time: data[i] == 0, data[i + 1] == 0, data[i + 2] == 1 */
+    while( pos + 18 <= len ) {
+        uint8x16_t  m = vandq_u8(vandq_u8(vceqq_u8(vld1q_u8(data + pos), vdupq_n_u8(0)),
+                                          vceqq_u8(vld1q_u8(data + pos + 1), vdupq_n_u8(0))),
+                                 vceqq_u8(vld1q_u8(data + pos + 2), vdupq_n_u8(1)));
+        uint64x2_t  w = vreinterpretq_u64_u8(m);
+
+        if((vgetq_lane_u64(w, 0) | vgetq_lane_u64(w, 1)) != 0 ) {
+            break;
+        }
+        pos += 16;
+    }
+#endif
+    /* Skip ahead by the number of bytes which cannot start a prefix */
+    while( pos + 3 <= len ) {
+        if( data[pos + 2] > 1 ) {
+            pos += 3;
+        } else if( data[pos + 2] == 1 ) {
+            if( data[pos + 1] == 0 && data[pos] == 0 ) {
+                return (pos);
+            }
+            pos += 3;
+        } else {
+            pos++;
+        }
+    }
+    return (-1);
+}
+
+/* Classify the unit following a start code prefix at data[sc]: 1 if it starts */
+/* a new access unit when the current one holds a picture, 0 if not. picture   */
+/* is set when the unit is a picture. -1 when more bytes are needed.           */
+static int unit_starts_au(dce_au_parser *p, const uint8_t *data, int sc, int len, int *picture)
+{
+    uint8_t     code, type;
+
+    *picture = 0;
+    if( sc + 4 > len ) {
+        return (-1);
+    }
+    code = data[sc + 3];
+
+    switch( p->format ) {
+        case DCE_STREAM_H264 :
+            type = code & 0x1F;
+            if( type == 1 || type == 5 ) {
+                /* first_mb_in_slice is 0 when the first bit of the slice header is set */
+                if( sc + 5 > len ) {
+                    return (-1);
+                }
+                *picture = 1;
+                return ((data[sc + 4] & 0x80) != 0);
+            }
+            return (type == 6 || type == 7 || type == 8 || type == 9 || (type >= 14 && type <= 18));
+
+        case DCE_STREAM_MPEG2 :
+            /* picture, sequence header, group of pictures */
+            *picture = (code == 0x00);
+            return (code == 0x00 || code == 0xB3 || code == 0xB8);
+
+        case DCE_STREAM_MPEG4 :
+            /* VOP, visual object sequence, visual object, VO and VOL headers, GOV */
+            *picture = (code == 0xB6);
+            return (code == 0xB6 || code == 0xB0 || code == 0xB5 || code <= 0x2F || code == 0xB3);
+
+        case DCE_STREAM_VC1 :
+            /* frame, sequence header, entry point and their user data */
+            *picture = (code == 0x0D);
+            return (code == 0x0D || code == 0x0F || code == 0x0E || (code >= 0x1D && code <= 0x1F));
+    }
+    return (0);
+}
+
+dce_au_parser *dce_au_parser_create(dce_stream_format format)
+{
+    dce_au_parser   *p;
+
+    if( format < DCE_STREAM_H264 || format > DCE_STREAM_VC1 ) {
+        ERROR("Invalid stream format %d", format);
+        return (NULL);
+    }
+    p = calloc(1, sizeof(dce_au_parser));
+    if( p != NULL ) {
+        p->format = format;
+    }
+    return (p);
+}
+
+void dce_au_parser_delete(dce_au_parser *p)
+{
+    free(p);
+}
+
+void dce_au_parser_reset(dce_au_parser *p)
+{
+    p->scanned = 0;
+    p->picture = 0;
+}
+
+int dce_au_parser_next(dce_au_parser *p, const void *data, int len, int eos)
+{
+    const uint8_t   *d = data;
+    int             sc, starts, picture, size;
+
+    /* Resume after the start codes scanned by the previous calls */
+    for( sc = find_start_code(d, p->scanned, len); sc >= 0; sc = find_start_code(d, sc + 3, len)) {
+        starts = unit_starts_au(p, d, sc, len, &picture);
+        if( starts < 0 ) {
+            break;
+        }
+        if( starts && p->picture && sc > 0 ) {
+            /* The zero_byte of a 4 byte start code belongs to the next access unit */
+            size = (d[sc - 1] == 0) ? sc - 1 : sc;
+            dce_au_parser_reset(p);
+            return (size);
+        }
+        p->picture |= picture;
+        p->scanned = sc + 3;
+    }
+
+    if( eos ) {
+        dce_au_parser_reset(p);
+        return (len);
+    }
+    /* Rescan the last bytes, they may be the beginning of a start code */
+    if( sc < 0 && len - 2 > p->scanned ) {
+        p->scanned = len - 2;
+    }
+    return (0);
+}
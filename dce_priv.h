@@ -43,11 +43,15 @@ extern int dce_debug;
  *   1 - error
  *   2 - error, debug
  *   3 - error, debug, info  (very verbose)
+ * Traces are printed at once. Debug and info traces are also recorded in the
+ * binary trace ring of the calling thread and formatted by dce_trace_dump().
  */
 #ifdef DCE_DEBUG_ENABLE
 #define ERROR(FMT,...)   TRACE(1, "ERROR: " FMT, ##__VA_ARGS__)
-#define DEBUG(FMT,...)   TRACE(2, "DEBUG: " FMT, ##__VA_ARGS__)
-#define INFO(FMT,...)    TRACE(3, "INFO: " FMT, ##__VA_ARGS__)
+#define DEBUG(FMT,...)   do { TRACE(2, "DEBUG: " FMT, ##__VA_ARGS__); \
+                              TRACE_EVENT(2, "DEBUG: " FMT, ##__VA_ARGS__); } while( 0 )
+#define INFO(FMT,...)    do { TRACE(3, "INFO: " FMT, ##__VA_ARGS__); \
+                              TRACE_EVENT(3, "INFO: " FMT, ##__VA_ARGS__); } while( 0 )
 #else
 #define ERROR(FMT,...)
 #define DEBUG(FMT,...)
@@ -61,8 +65,10 @@ extern int dce_debug;
 } while( 0 )
 
 #elif defined BUILDOS_LINUX
+/* Each trace is printed on its own line, whether FMT ends with one or not */
+#define TRACE_EOL(FMT)  ((FMT)[sizeof(FMT) - 2] == '\n' ? "" : "\n")
 #define TRACE(lvl,FMT, ...)  do if ((lvl) <= dce_debug) { \
-        printf("%s:%d:\t%s\t" FMT,__FILE__, __LINE__,__FUNCTION__ ,##__VA_ARGS__); \
+        printf("%s:%d:\t%s\t" FMT "%s",__FILE__, __LINE__,__FUNCTION__ ,##__VA_ARGS__, TRACE_EOL(FMT)); \
 }while( 0 )
 
 #elif defined BUILDOS_ANDROID
@@ -73,6 +79,26 @@ extern int dce_debug;
 }while( 0 )
 #endif
 
+/* Arguments kept per binary trace event, the following ones are dropped */
+#define DCE_TRACE_MAX_ARGS 6
+
+/* Static description of a TRACE_EVENT() call site */
+typedef struct dce_trace_point {
+    const char      *fmt;
+    const char      *file;
+    const char      *func;
+    int             line;
+    int             nargs;  /* -1 until the format is parsed on first use */
+    unsigned char   kind[DCE_TRACE_MAX_ARGS];
+} dce_trace_point;
+
+void dce_trace_record(dce_trace_point *point, ...);
+
+#define TRACE_EVENT(lvl,FMT, ...)  do if ((lvl) <= dce_debug) { \
+        static dce_trace_point __point = { FMT, __FILE__, __FUNCTION__, __LINE__, -1, { 0 } }; \
+        dce_trace_record(&__point, ##__VA_ARGS__); \
+} while( 0 )
+
 /***************** ASSERT MACROS *********************/
 #define _ASSERT_AND_EXECUTE(_COND_, _ERRORCODE_, _EXPR_) do { \
         if( !(_COND_)) { eError = _ERRORCODE_; \
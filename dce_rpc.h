@@ -49,7 +49,9 @@
 #define MAX_OUTPUT_BUFPTRS 2//To take care bufs and bufSizes in viddec2 case
 #define MAX_TOTAL_BUF (MAX_INPUT_BUF + MAX_OUTPUT_BUF + MAX_OUTPUT_BUFPTRS)
 
-#define MAX_INSTANCES 6 // aligned with IPUMM definitions for MAX instances i.e.,5,  + 1 for persistent system
+#define MAX_CONTROL_BATCH 8 // commands in one DCE_RPC_CODEC_CONTROL_BATCH message, must equal DCE_MAX_CONTROL_BATCH, checked in libdce.c
+
+#define MAX_INSTANCES 6 // default per core quota, aligned with IPUMM definitions for MAX instances i.e.,5,  + 1 for persistent system
 /* Message-Ids:
  */
 //#define DCE_RPC_CONNECT         (0x80000000 | 00) Connect not needed anymore.
@@ -61,7 +63,8 @@ typedef enum dce_rpc_call {
     DCE_RPC_CODEC_GET_VERSION,
     DCE_RPC_CODEC_PROCESS,
     DCE_RPC_CODEC_DELETE,
-    DCE_RPC_GET_INFO
+    DCE_RPC_GET_INFO,
+    DCE_RPC_CODEC_CONTROL_BATCH
 } dce_rpc_call;
 
 //Enumeration for dce function callback
@@ -90,5 +93,20 @@ typedef struct dce_engine_open {
     Engine_Error  error_code;    /* error code (out) */
 } dce_engine_open;
 
+/* Payload of DCE_RPC_CODEC_CONTROL_BATCH. The server runs the commands in
+ * order on the codec, each with its own dynParams and status buffers which
+ * are translated like the control() ones, and stores the return value of
+ * each command in ret.
+ */
+typedef struct dce_control_batch {
+    int32_t count;
+    struct {
+        int32_t  cmd_id;
+        int32_t  ret;           /* (out) */
+        void    *dynParams;
+        void    *status;
+    } cmd[MAX_CONTROL_BATCH];
+} dce_control_batch;
+
 #endif /* __DCE_RPC_H__ */
 
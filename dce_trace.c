@@ -0,0 +1,418 @@
+/*
+ * Copyright (c) 2013, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ ********************************************************************************
+ * Binary trace                                                                 *
+ * DEBUG() and INFO() record events in a ring buffer of the calling thread      *
+ * instead of formatting them: a timestamp, the static trace point (format,     *
+ * file, line, function) and the raw arguments. dce_trace_dump() formats the    *
+ * events of all threads later, so tracing can stay enabled on the hot paths.   *
+ ********************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "libdce.h"
+#include "dce_priv.h"
+
+/* Slots of the ring of a thread, power of 2. The last DCE_TRACE_RING_SIZE - 1 events are dumped. */
+#define DCE_TRACE_RING_SIZE 256
+/* Bytes kept of the first %s argument of an event */
+#define DCE_TRACE_STR_LEN   24
+
+typedef enum {
+    TRACE_ARG_INT = 0,
+    TRACE_ARG_LONG,
+    TRACE_ARG_LLONG,
+    TRACE_ARG_PTR,
+    TRACE_ARG_STR,
+    TRACE_ARG_DOUBLE
+} trace_arg_kind;
+
+typedef struct {
+    uint64_t            time_ns;    /* CLOCK_MONOTONIC */
+    dce_trace_point     *point;
+    uint64_t            arg[DCE_TRACE_MAX_ARGS];
+    char                str[DCE_TRACE_STR_LEN];
+} trace_event;
+
+/* Ring of one thread. Only its thread writes it, head is published with release */
+/* order. A ring is reused by a new thread once its thread exited.              */
+typedef struct trace_ring {
+    struct trace_ring   *next;
+    unsigned long       thread;
+    int                 in_use;
+    uint32_t            head;       /* number of events written */
+    trace_event         event[DCE_TRACE_RING_SIZE];
+} trace_ring;
+
+static trace_ring       *trace_rings = NULL;
+static pthread_mutex_t  trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t    trace_key;
+static pthread_once_t   trace_once = PTHREAD_ONCE_INIT;
+
+static void trace_ring_retire(void *arg)
+{
+    trace_ring  *ring = arg;
+
+    pthread_mutex_lock(&trace_mutex);
+    ring->in_use = 0;
+    pthread_mutex_unlock(&trace_mutex);
+}
+
+static void trace_key_create(void)
+{
+    pthread_key_create(&trace_key, trace_ring_retire);
+}
+
+/* Ring of the calling thread, NULL if it can't be allocated */
+static trace_ring *trace_ring_get(void)
+{
+    trace_ring  *ring;
+
+    pthread_once(&trace_once, trace_key_create);
+    ring = pthread_getspecific(trace_key);
+    if( ring ) {
+        return (ring);
+    }
+
+    pthread_mutex_lock(&trace_mutex);
+    for( ring = trace_rings; ring != NULL && ring->in_use; ring = ring->next ) {
+        ;
+    }
+    if( ring == NULL ) {
+        ring = calloc(1, sizeof(trace_ring));
+        if( ring ) {
+            ring->next = trace_rings;
+            trace_rings = ring;
+        }
+    }
+    if( ring ) {
+        ring->in_use = 1;
+        ring->thread = (unsigned long)pthread_self();
+        __atomic_store_n(&ring->head, 0, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&trace_mutex);
+
+    if( ring ) {
+        pthread_setspecific(trace_key, ring);
+    }
+    return (ring);
+}
+
+/* Parse the next conversion of a format. Returns the character following it, */
+/* NULL at the end of the format. The conversion is copied to spec, which is  */
+/* left empty if it does not fit, and its position is returned in conv.       */
+static const char *trace_next_conv(const char *fmt, const char **conv, char *spec, size_t len,
+                                   trace_arg_kind *kind)
+{
+    const char  *start;
+    int         longs = 0;
+    size_t      n;
+
+    while( (fmt = strchr(fmt, '%')) != NULL ) {
+        if( fmt[1] == '%' ) {
+            fmt += 2;
+            continue;
+        }
+        start = fmt++;
+        fmt += strspn(fmt, "-+ #0123456789.");
+        for( ; *fmt == 'h' || *fmt == 'l' || *fmt == 'z' || *fmt == 'j' || *fmt == 't'; fmt++ ) {
+            longs += (*fmt == 'l' || *fmt == 'z' || *fmt == 'j' || *fmt == 't');
+        }
+        if( *fmt == '\0' ) {
+            return (NULL);
+        }
+        switch( *fmt ) {
+            case 'p' :
+                *kind = TRACE_ARG_PTR;
+                break;
+            case 's' :
+                *kind = TRACE_ARG_STR;
+                break;
+            case 'f' : case 'F' : case 'e' : case 'E' : case 'g' : case 'G' :
+                *kind = TRACE_ARG_DOUBLE;
+                break;
+            default :
+                *kind = longs > 1 ? TRACE_ARG_LLONG : (longs ? TRACE_ARG_LONG : TRACE_ARG_INT);
+                break;
+        }
+        fmt++;
+        if( conv ) {
+            *conv = start;
+        }
+        if( spec ) {
+            n = fmt - start < (int)len ? (size_t)(fmt - start) : 0;
+            memcpy(spec, start, n);
+            spec[n] = '\0';
+        }
+        return (fmt);
+    }
+
+    return (NULL);
+}
+
+/* Find the kinds of the arguments of a trace point, on its first use */
+static void trace_point_parse(dce_trace_point *point)
+{
+    const char      *fmt = point->fmt;
+    trace_arg_kind  kind;
+    int             n = 0;
+
+    while( n < DCE_TRACE_MAX_ARGS && (fmt = trace_next_conv(fmt, NULL, NULL, 0, &kind)) != NULL ) {
+        point->kind[n++] = kind;
+    }
+    /* Concurrent first uses write the same kinds */
+    __atomic_store_n(&point->nargs, n, __ATOMIC_RELEASE);
+}
+
+/*===============================================================*/
+/** dce_trace_record : Record an event in the ring of the calling thread. Called by
+ *                     the DEBUG() and INFO() macros.
+ */
+void dce_trace_record(dce_trace_point *point, ...)
+{
+    trace_ring      *ring;
+    trace_event     *ev;
+    struct timespec t;
+    va_list         ap;
+    uint32_t        head;
+    int             i, nargs, str = 0;
+    double          d;
+    const char      *s;
+
+    ring = trace_ring_get();
+    if( ring == NULL ) {
+        return;
+    }
+    nargs = __atomic_load_n(&point->nargs, __ATOMIC_ACQUIRE);
+    if( nargs < 0 ) {
+        trace_point_parse(point);
+        nargs = point->nargs;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    head = ring->head;
+    ev = &ring->event[head & (DCE_TRACE_RING_SIZE - 1)];
+    ev->time_ns = (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+    ev->point = point;
+    ev->str[0] = '\0';
+
+    va_start(ap, point);
+    for( i = 0; i < nargs; i++ ) {
+        switch( point->kind[i] ) {
+            case TRACE_ARG_LONG :
+                ev->arg[i] = (uint64_t)va_arg(ap, long);
+                break;
+            case TRACE_ARG_LLONG :
+                ev->arg[i] = (uint64_t)va_arg(ap, long long);
+                break;
+            case TRACE_ARG_PTR :
+                ev->arg[i] = (uintptr_t)va_arg(ap, void *);
+                break;
+            case TRACE_ARG_STR :
+                /* The string may be gone when dumping: keep the start of the first one */
+                s = va_arg(ap, const char *);
+                ev->arg[i] = (uintptr_t)s;
+                if( !str++ && s ) {
+                    strncpy(ev->str, s, DCE_TRACE_STR_LEN - 1);
+                    ev->str[DCE_TRACE_STR_LEN - 1] = '\0';
+                }
+                break;
+            case TRACE_ARG_DOUBLE :
+                d = va_arg(ap, double);
+                memcpy(&ev->arg[i], &d, sizeof(d));
+                break;
+            default :
+                ev->arg[i] = (uint64_t)va_arg(ap, int);
+                break;
+        }
+    }
+    va_end(ap);
+
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/* An event copied out of a ring for the dump */
+typedef struct {
+    trace_event     ev;
+    unsigned long   thread;
+} trace_entry;
+
+static int trace_entry_cmp(const void *a, const void *b)
+{
+    const trace_entry   *x = a, *y = b;
+
+    return ((x->ev.time_ns > y->ev.time_ns) - (x->ev.time_ns < y->ev.time_ns));
+}
+
+/* Copy the literal text of a format, %% being a single % */
+static size_t trace_put_text(char *out, size_t len, size_t pos, const char *from, const char *to)
+{
+    for( ; from < to && pos < len - 1; from++ ) {
+        out[pos++] = *from;
+        if( from[0] == '%' && from + 1 < to && from[1] == '%' ) {
+            from++;
+        }
+    }
+    out[pos] = '\0';
+
+    return (pos);
+}
+
+/* Format an event as the printf() of its trace point would have */
+static int trace_format(char *out, size_t len, trace_event *ev)
+{
+    dce_trace_point *point = ev->point;
+    const char      *fmt = point->fmt, *next, *conv;
+    char            spec[32];
+    trace_arg_kind  kind;
+    size_t          pos = 0;
+    int             i = 0, str = 0, n;
+    double          d;
+
+#define TRACE_PUT(...) do { \
+        n = snprintf(out + pos, len - pos, __VA_ARGS__); \
+        pos = (n < 0 || pos + n >= len) ? len - 1 : pos + n; \
+} while( 0 )
+
+    TRACE_PUT("[%llu.%09llu] %s:%d:\t%s\t",
+              (unsigned long long)(ev->time_ns / 1000000000), (unsigned long long)(ev->time_ns % 1000000000),
+              point->file, point->line, point->func);
+
+    while( (next = trace_next_conv(fmt, &conv, spec, sizeof(spec), &kind)) != NULL && i < point->nargs ) {
+        pos = trace_put_text(out, len, pos, fmt, conv);
+        if( spec[0] == '\0' ) {
+            /* Too long to be a valid conversion, written as is */
+            pos = trace_put_text(out, len, pos, conv, next);
+            str += (kind == TRACE_ARG_STR);
+        } else {
+            switch( kind ) {
+                case TRACE_ARG_LONG :
+                    TRACE_PUT(spec, (long)ev->arg[i]);
+                    break;
+                case TRACE_ARG_LLONG :
+                    TRACE_PUT(spec, (long long)ev->arg[i]);
+                    break;
+                case TRACE_ARG_PTR :
+                    TRACE_PUT(spec, (void *)(uintptr_t)ev->arg[i]);
+                    break;
+                case TRACE_ARG_STR :
+                    if( !str++ ) {
+                        TRACE_PUT(spec, ev->str);
+                    } else {
+                        TRACE_PUT("<%p>", (void *)(uintptr_t)ev->arg[i]);
+                    }
+                    break;
+                case TRACE_ARG_DOUBLE :
+                    memcpy(&d, &ev->arg[i], sizeof(d));
+                    TRACE_PUT(spec, d);
+                    break;
+                default :
+                    TRACE_PUT(spec, (int)ev->arg[i]);
+                    break;
+            }
+        }
+        fmt = next;
+        i++;
+    }
+    pos = trace_put_text(out, len, pos, fmt, fmt + strlen(fmt));
+#undef TRACE_PUT
+
+    return ((int)pos);
+}
+
+/*===============================================================*/
+/** dce_trace_dump : Format the events recorded by all threads, oldest first.
+ *
+ * @ param fd [in] : File descriptor the events are written to.
+ * @ return : Number of events written, -1 on error.
+ */
+int dce_trace_dump(int fd)
+{
+    trace_ring      *ring;
+    trace_entry     *entry;
+    char            line[512];
+    uint32_t        head, i, first;
+    int             count = 0, total = 0, n;
+
+    pthread_mutex_lock(&trace_mutex);
+    for( ring = trace_rings; ring != NULL; ring = ring->next ) {
+        total += DCE_TRACE_RING_SIZE;
+    }
+    entry = total ? malloc(total * sizeof(trace_entry)) : NULL;
+    if( total && entry == NULL ) {
+        pthread_mutex_unlock(&trace_mutex);
+        return (-1);
+    }
+    for( ring = trace_rings; ring != NULL; ring = ring->next ) {
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        /* The slot of the oldest event is the next one written */
+        first = head >= DCE_TRACE_RING_SIZE ? head - DCE_TRACE_RING_SIZE + 1 : 0;
+        for( i = first; i < head; i++ ) {
+            entry[count].ev = ring->event[i & (DCE_TRACE_RING_SIZE - 1)];
+            entry[count].thread = ring->thread;
+            /* Skip the event if the thread wrote over it while it was copied */
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if( __atomic_load_n(&ring->head, __ATOMIC_RELAXED) - i < DCE_TRACE_RING_SIZE ) {
+                count++;
+            }
+        }
+    }
+    pthread_mutex_unlock(&trace_mutex);
+
+    qsort(entry, count, sizeof(trace_entry), trace_entry_cmp);
+    for( i = 0; i < (uint32_t)count; i++ ) {
+        n = snprintf(line, sizeof(line), "%08lx ", entry[i].thread);
+        n += trace_format(line + n, sizeof(line) - n, &entry[i].ev);
+        if( line[n - 1] != '\n' ) {
+            /* A truncated line gives its last character to the newline */
+            n -= (n == (int)sizeof(line) - 1);
+            line[n++] = '\n';
+        }
+        if( write(fd, line, n) != n ) {
+            count = -1;
+            break;
+        }
+    }
+    free(entry);
+
+    return (count);
+}
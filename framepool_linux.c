@@ -0,0 +1,426 @@
+/*
+ * Copyright (c) 2013, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "memplugin.h"
+#include "dce_priv.h"
+#include "libdce.h"
+
+/* Output frames of a VIDDEC3 decoder, registered with MmRpc when they are added */
+/* to the pool. A linear frame is one buffer holding the luma and chroma planes  */
+/* (single planar, see process()), a tiled one a TILER 8 bit luma buffer and a   */
+/* 16 bit chroma buffer. The frame id is the inputID given to the codec and is   */
+/* reference counted: one reference while the codec holds the frame, released by */
+/* freeBufID, and one for each outputID until the application has displayed it. */
+/* A frame with no reference goes back to the free list.                         */
+#define FRAME_POOL_SLACK    2   /* frames held by the application for display */
+#define FRAME_POOL_DEFAULT  8   /* when the codec does not report maxNumDisplayBufs */
+
+typedef struct pool_frame {
+    dce_frame           frame;
+    MemHeader           luma;
+    MemHeader           chroma;     /* tiled frames only */
+    XDM2_BufSize        size[2];    /* requirements the frame was allocated for */
+    int                 tiled;
+    struct pool_frame   *next;      /* free list */
+    int                 refs;
+    int                 retired;    /* too small for the current resolution */
+} pool_frame;
+
+struct dce_frame_pool {
+    void                    *codec;
+    pthread_mutex_t         mutex;
+    VIDDEC3_DynamicParams   *dynParams;
+    VIDDEC3_Status          *status;
+    pool_frame              **frames;   /* indexed by id - 1 */
+    int                     num_slots;
+    pool_frame              *free;
+    pool_frame              *pending;   /* given as inputID, outBufsInUseFlag set */
+    int                     requested;  /* count given to dce_frame_pool_create() */
+    int                     count;      /* frames wanted */
+    int                     live;       /* frames not retired */
+    int                     planes;     /* outBufs->numBufs */
+    int                     tiled;      /* XDM_MEMTYPE_TILED8 luma, TILED16 chroma */
+    XDM2_BufSize            size[2];    /* minOutBufSize */
+};
+
+/* Read the output buffer requirements of the codec */
+static int pool_query(dce_frame_pool *pool)
+{
+    XDM1_AlgBufInfo     *info = &(pool->status->bufInfo);
+    dce_error_status    eError = DCE_EOK;
+    XDAS_Int32          ret;
+    int                 i;
+
+    ret = VIDDEC3_control(pool->codec, XDM_GETBUFINFO, pool->dynParams, pool->status);
+    _ASSERT(ret == VIDDEC3_EOK, DCE_EXDM_FAIL);
+    _ASSERT(info->minNumOutBufs >= 1 && info->minNumOutBufs <= 2, DCE_EXDM_UNSUPPORTED);
+
+    pool->tiled = info->outBufMemoryType[0] == XDM_MEMTYPE_TILED8;
+    if( pool->tiled ) {
+        _ASSERT(info->minNumOutBufs == 2 &&
+                info->outBufMemoryType[1] == XDM_MEMTYPE_TILED16, DCE_EXDM_UNSUPPORTED);
+    } else {
+        for( i = 0; i < info->minNumOutBufs; i++ ) {
+            _ASSERT(info->outBufMemoryType[i] == XDM_MEMTYPE_RAW ||
+                    info->outBufMemoryType[i] == XDM_MEMTYPE_TILEDPAGE, DCE_EXDM_UNSUPPORTED);
+        }
+    }
+
+    pool->planes = info->minNumOutBufs;
+    pool->size[0] = info->minOutBufSize[0];
+    pool->size[1] = info->minOutBufSize[1];
+    if( pool->planes == 1 ) {
+        memset(&(pool->size[1]), 0, sizeof(XDM2_BufSize));
+    }
+    pool->count = pool->requested;
+    if( pool->count == 0 ) {
+        pool->count = pool->status->maxNumDisplayBufs > 0 ?
+                      pool->status->maxNumDisplayBufs + FRAME_POOL_SLACK : FRAME_POOL_DEFAULT;
+    }
+
+EXIT:
+    return (eError);
+}
+
+/* Whether a frame meets the current requirements of the pool */
+static int frame_fits(dce_frame_pool *pool, pool_frame *f)
+{
+    if( f->tiled != pool->tiled ) {
+        return (0);
+    }
+    if( f->tiled ) {
+        return (f->size[0].tileMem.width >= pool->size[0].tileMem.width &&
+                f->size[0].tileMem.height >= pool->size[0].tileMem.height &&
+                f->size[1].tileMem.width >= pool->size[1].tileMem.width &&
+                f->size[1].tileMem.height >= pool->size[1].tileMem.height);
+    }
+    return (f->frame.size >= pool->size[0].bytes + pool->size[1].bytes);
+}
+
+static pool_frame *frame_new(dce_frame_pool *pool)
+{
+    pool_frame      *f = NULL;
+    pool_frame      **frames;
+    int             slot;
+
+    for( slot = 0; slot < pool->num_slots && pool->frames[slot]; slot++ ) {
+        ;
+    }
+    if( slot == pool->num_slots ) {
+        frames = realloc(pool->frames, (pool->num_slots + 8) * sizeof(pool_frame *));
+        if( frames == NULL ) {
+            return (NULL);
+        }
+        memset(frames + pool->num_slots, 0, 8 * sizeof(pool_frame *));
+        pool->frames = frames;
+        pool->num_slots += 8;
+    }
+
+    f = calloc(1, sizeof(pool_frame));
+    if( f == NULL ) {
+        return (NULL);
+    }
+    f->tiled = pool->tiled;
+    f->size[0] = pool->size[0];
+    f->size[1] = pool->size[1];
+    if( f->tiled ) {
+        /* The interleaved chroma has half as many 16 bit pixels per row as luma bytes */
+        f->frame.ptr = memplugin_alloc_noheader(&(f->luma), f->size[0].tileMem.width,
+                                                f->size[0].tileMem.height, MEM_TILER8_2D, 0, IPU);
+        f->frame.chroma_ptr = memplugin_alloc_noheader(&(f->chroma), (f->size[1].tileMem.width + 1) / 2,
+                                                       f->size[1].tileMem.height, MEM_TILER16_2D, 0, IPU);
+        f->frame.size = f->luma.size + f->chroma.size;
+        f->frame.fd = f->luma.dma_buf_fd;
+        f->frame.chroma_fd = f->chroma.dma_buf_fd;
+        f->frame.chroma_offset = 0;
+    } else {
+        f->frame.size = f->size[0].bytes + f->size[1].bytes;
+        f->frame.ptr = memplugin_alloc_noheader(&(f->luma), f->frame.size, 0, MEM_TILER_1D, 0, IPU);
+        f->frame.chroma_ptr = f->frame.ptr ? (char *)f->frame.ptr + f->size[0].bytes : NULL;
+        f->frame.fd = f->luma.dma_buf_fd;
+        f->frame.chroma_fd = f->frame.fd;
+        f->frame.chroma_offset = f->size[0].bytes;
+    }
+    if( f->frame.ptr == NULL || f->frame.chroma_ptr == NULL ) {
+        ERROR("Failed to allocate a frame of %d bytes", f->frame.size);
+        memplugin_free_noheader(&(f->luma));
+        memplugin_free_noheader(&(f->chroma));
+        free(f);
+        return (NULL);
+    }
+    f->frame.id = slot + 1;
+
+    pool->frames[slot] = f;
+    pool->live++;
+    return (f);
+}
+
+static void frame_del(dce_frame_pool *pool, pool_frame *f)
+{
+    memplugin_free_noheader(&(f->luma));
+    memplugin_free_noheader(&(f->chroma));
+    pool->frames[f->frame.id - 1] = NULL;
+    if( !f->retired ) {
+        pool->live--;
+    }
+    free(f);
+}
+
+/* Drop a reference, the last one recycles the frame */
+static void frame_put(dce_frame_pool *pool, pool_frame *f)
+{
+    if( f->refs <= 0 || --f->refs > 0 ) {
+        return;
+    }
+    if( f->retired ) {
+        frame_del(pool, f);
+    } else {
+        f->next = pool->free;
+        pool->free = f;
+    }
+}
+
+static pool_frame *frame_get(dce_frame_pool *pool, XDAS_Int32 id)
+{
+    if( id <= 0 || id > pool->num_slots ) {
+        return (NULL);
+    }
+    return (pool->frames[id - 1]);
+}
+
+/* Add frames until the pool holds the number wanted */
+static int pool_fill(dce_frame_pool *pool)
+{
+    pool_frame  *f;
+
+    while( pool->live < pool->count ) {
+        if((f = frame_new(pool)) == NULL ) {
+            return (DCE_EOUT_OF_MEMORY);
+        }
+        f->next = pool->free;
+        pool->free = f;
+    }
+    return (DCE_EOK);
+}
+
+/* New buffer requirements: retire the frames which became too small */
+static int pool_resize(dce_frame_pool *pool)
+{
+    pool_frame          **prev, *f;
+    dce_error_status    eError = DCE_EOK;
+    int                 i;
+
+    eError = pool_query(pool);
+    _ASSERT(eError == DCE_EOK, eError);
+
+    for( i = 0; i < pool->num_slots; i++ ) {
+        f = pool->frames[i];
+        if( f && !f->retired && !frame_fits(pool, f)) {
+            f->retired = 1;
+            pool->live--;
+        }
+    }
+    for( prev = &(pool->free); (f = *prev) != NULL; ) {
+        if( f->retired ) {
+            *prev = f->next;
+            frame_del(pool, f);
+        } else {
+            prev = &(f->next);
+        }
+    }
+    DEBUG("frame pool %p: %s, %d frames", pool, pool->tiled ? "tiled" : "linear", pool->count);
+
+    eError = pool_fill(pool);
+
+EXIT:
+    return (eError);
+}
+
+dce_frame_pool *dce_frame_pool_create(void *codec, int count)
+{
+    dce_frame_pool      *pool = NULL;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(codec != NULL && count >= 0, DCE_EINVALID_INPUT);
+
+    pool = calloc(1, sizeof(dce_frame_pool));
+    _ASSERT(pool != NULL, DCE_EOUT_OF_MEMORY);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pool->codec = codec;
+    pool->requested = count;
+
+    pool->dynParams = dce_alloc(sizeof(VIDDEC3_DynamicParams));
+    pool->status = dce_alloc(sizeof(VIDDEC3_Status));
+    _ASSERT(pool->dynParams != NULL && pool->status != NULL, DCE_EOUT_OF_MEMORY);
+    pool->dynParams->size = sizeof(VIDDEC3_DynamicParams);
+    pool->status->size = sizeof(VIDDEC3_Status);
+
+    eError = pool_resize(pool);
+    _ASSERT(eError == DCE_EOK, eError);
+
+EXIT:
+    if( eError != DCE_EOK && pool ) {
+        dce_frame_pool_delete(pool);
+        pool = NULL;
+    }
+    return (pool);
+}
+
+void dce_frame_pool_delete(dce_frame_pool *pool)
+{
+    int     i;
+
+    if( pool == NULL ) {
+        return;
+    }
+    for( i = 0; i < pool->num_slots; i++ ) {
+        if( pool->frames[i] ) {
+            frame_del(pool, pool->frames[i]);
+        }
+    }
+    free(pool->frames);
+    if( pool->dynParams ) {
+        dce_free(pool->dynParams);
+    }
+    if( pool->status ) {
+        dce_free(pool->status);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+int dce_frame_pool_prepare(dce_frame_pool *pool, XDM2_BufDesc *outBufs, VIDDEC3_InArgs *inArgs)
+{
+    pool_frame          *f;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(pool != NULL && outBufs != NULL && inArgs != NULL, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&pool->mutex);
+    /* The codec asked for the same buffers again with outBufsInUseFlag */
+    if((f = pool->pending) == NULL ) {
+        if((f = pool->free) != NULL ) {
+            pool->free = f->next;
+        } else {
+            /* More frames held than expected, grow rather than fail the call */
+            DEBUG("frame pool %p exhausted, adding a frame", pool);
+            f = frame_new(pool);
+            _ASSERT_AND_EXECUTE(f != NULL, DCE_EOUT_OF_MEMORY, pthread_mutex_unlock(&pool->mutex));
+            pool->count++;
+        }
+        f->refs = 1;
+        pool->pending = f;
+    }
+    if( !f->tiled ) {
+        /* process() places the chroma plane right after the luma size given */
+        f->frame.chroma_offset = pool->size[0].bytes;
+        f->frame.chroma_ptr = (char *)f->frame.ptr + pool->size[0].bytes;
+    }
+
+    outBufs->numBufs = pool->planes;
+    outBufs->descs[0].buf = (XDAS_Int8 *)(intptr_t)f->frame.fd;
+    outBufs->descs[0].memType = pool->tiled ? XDM_MEMTYPE_TILED8 : XDM_MEMTYPE_RAW;
+    outBufs->descs[0].bufSize = pool->size[0];
+    if( pool->planes > 1 ) {
+        outBufs->descs[1].buf = (XDAS_Int8 *)(intptr_t)f->frame.chroma_fd;
+        outBufs->descs[1].memType = pool->tiled ? XDM_MEMTYPE_TILED16 : XDM_MEMTYPE_RAW;
+        outBufs->descs[1].bufSize = pool->size[1];
+    }
+    inArgs->inputID = f->frame.id;
+    pthread_mutex_unlock(&pool->mutex);
+
+EXIT:
+    return (eError);
+}
+
+int dce_frame_pool_complete(dce_frame_pool *pool, XDAS_Int32 ret, VIDDEC3_OutArgs *outArgs)
+{
+    pool_frame          *f;
+    dce_error_status    eError = DCE_EOK;
+    int                 i, display = 0;
+
+    _ASSERT(pool != NULL && outArgs != NULL, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&pool->mutex);
+    if( !outArgs->outBufsInUseFlag ) {
+        pool->pending = NULL;
+    }
+    for( i = 0; i < IVIDEO2_MAX_IO_BUFFERS && outArgs->outputID[i]; i++ ) {
+        if((f = frame_get(pool, outArgs->outputID[i])) != NULL ) {
+            f->refs++;
+            display++;
+        }
+    }
+    for( i = 0; i < IVIDEO2_MAX_IO_BUFFERS && outArgs->freeBufID[i]; i++ ) {
+        if((f = frame_get(pool, outArgs->freeBufID[i])) != NULL ) {
+            frame_put(pool, f);
+        }
+    }
+    /* Same condition as the invalidation of the control cache in process() */
+    if( ret != XDM_EOK || ((outArgs->extendedError >> XDM_PARAMSCHANGE) & 0x1)) {
+        eError = pool_resize(pool);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+EXIT:
+    return (eError == DCE_EOK ? display : eError);
+}
+
+dce_frame *dce_frame_pool_get(dce_frame_pool *pool, XDAS_Int32 id)
+{
+    pool_frame  *f = NULL;
+
+    if( pool ) {
+        pthread_mutex_lock(&pool->mutex);
+        f = frame_get(pool, id);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    return (f ? &(f->frame) : NULL);
+}
+
+void dce_frame_pool_release(dce_frame_pool *pool, dce_frame *frame)
+{
+    pool_frame  *f;
+
+    if( pool == NULL || frame == NULL ) {
+        return;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    if((f = frame_get(pool, frame->id)) != NULL && &(f->frame) == frame ) {
+        frame_put(pool, f);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
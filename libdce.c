@@ -30,12 +30,26 @@
  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#if defined(BUILDOS_LINUX) || defined(BUILDOS_ANDROID)
+#define _GNU_SOURCE     /* CPU_SET() and sched_setaffinity() */
+#endif
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <pthread.h>
+#include <sched.h>
 #include <errno.h>
-#include <semaphore.h>
+#include <time.h>
+#if defined(BUILDOS_QNX)
+#include <sys/neutrino.h>
+#endif
+#if defined(BUILDOS_LINUX)
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
 
 /* IPC Headers */
 #include <ti/ipc/mm/MmRpc.h>
@@ -44,72 +58,304 @@
 #include "libdce.h"
 #include "dce_rpc.h"
 #include "dce_priv.h"
+#include "dce_capture.h"
 #include "memplugin.h"
 
+/* The batch message carries as many commands as the controlBatch APIs accept */
+#if MAX_CONTROL_BATCH != DCE_MAX_CONTROL_BATCH
+#error "MAX_CONTROL_BATCH of dce_rpc.h differs from DCE_MAX_CONTROL_BATCH of libdce.h"
+#endif
+
 /***************** GLOBALS ***************************/
-/* Handle used for Remote Communication              */
-MmRpc_Handle    MmRpcHandle[MAX_REMOTEDEVICES] = { NULL};
-Engine_Handle   gEngineHandle[MAX_INSTANCES][MAX_REMOTEDEVICES] = { {NULL, NULL}};
+/* Handles used for Remote Communication. Every core has a pool of connections, */
+/* each engine (and the codecs created on it) is bound to one of them.          */
+typedef struct {
+    MmRpc_Handle    handle;
+    int             inflight;   /* remote calls in flight, the handle is not deleted before 0, */
+                                /* guarded by __RpcIdleMutex                                   */
+    int             abandoned;  /* calls of inflight cancelled by rpc_call_cancel(), same guard */
+    int             bound;      /* engines and codecs bound to the connection */
+} dce_conn;
+
+/* A connection closed by dce_ipc_deinit() while cancelled calls were still in */
+/* flight on it. The last of them to return deletes the handle.               */
+typedef struct dce_orphan {
+    struct dce_orphan   *next;
+    MmRpc_Handle        handle;
+    int                 inflight;
+} dce_orphan;
+
+static dce_conn         __Conn[MAX_REMOTEDEVICES][DCE_MAX_CONNECTIONS];
+static int              __PoolSize[MAX_REMOTEDEVICES] = {1, 1};
+static dce_pool_policy  __PoolPolicy[MAX_REMOTEDEVICES] = {DCE_POOL_ROUND_ROBIN, DCE_POOL_ROUND_ROBIN};
+static int              __PoolActive[MAX_REMOTEDEVICES] = {0}; /* connections currently open */
+static int              __PoolNext[MAX_REMOTEDEVICES] = {0};   /* round robin cursor */
+static int              __PoolEpoch[MAX_REMOTEDEVICES] = {0};  /* pools closed so far */
 MmRpc_Handle    MmRpcCallbackHandle = NULL;
 static int MmRpcCallback_count = 0;
 
+/* Row mode callbacks of every instance are serviced by one pool of worker threads, */
+/* see callback_worker(). The pool lives as long as MmRpcCallbackHandle.            */
+struct CallbackFlag;
+static pthread_t        __CbWorker[DCE_MAX_CALLBACK_WORKERS];
+static int              __CbWorkerCount = 0;
+static int              __CbPoolSize = DCE_DEFAULT_CALLBACK_WORKERS;
+static int              __CbPriority = 0;   /* SCHED_FIFO priority, 0 for the default policy */
+static unsigned long    __CbCpuMask = 0;    /* CPU affinity of the workers, 0 for any CPU */
+static int              __CbPoolExit = 0;
+static struct CallbackFlag  *__CbQueueHead = NULL;  /* instances waiting for a worker */
+static struct CallbackFlag  *__CbQueueTail = NULL;
+static struct CallbackFlag  *__CbParked = NULL;     /* instances waiting for client data */
+static pthread_mutex_t  __CbPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   __CbPoolCond = PTHREAD_COND_INITIALIZER;
+
+/* ipc_mutex only guards the shared tables (engine_map, codec_map, __ClientCount,      */
+/* connection pools). It is never held across a blocking MmRpc call.                    */
 #ifdef BUILDOS_LINUX
 pthread_mutex_t    ipc_mutex;
-pthread_mutex_t    dce_callback_mutex;
+/* Plane of a dma-buf imported with dce_buf_import(), NULL for any other buffer */
+extern MemHeader   *dce_buf_imported(void *buf);
+/* Registration cache of the data buffers, see libdce_linux.c */
+extern int         dce_buf_cache_use(int core, int num, size_t *handle, uint64_t *ref);
+extern void        dce_buf_cache_touch(int core, int num, size_t *handle, uint64_t *ref);
+extern void        dce_buf_cache_hold(int core, int num, uint64_t *ref, int hold);
 #else
 pthread_mutex_t    ipc_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_mutex_t    dce_callback_mutex  = PTHREAD_MUTEX_INITIALIZER;
 #endif
 
 static int      __ClientCount[MAX_REMOTEDEVICES] = {0};
+/* In flight accounting of the connections. Not ipc_mutex: it is recursive on Linux, */
+/* and waiting on it while a caller holds it more than once would never wake up.    */
+static pthread_mutex_t  __RpcIdleMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   __RpcIdleCond = PTHREAD_COND_INITIALIZER;
+static dce_orphan       *__Orphans = NULL;  /* guarded by __RpcIdleMutex */
 int             dce_debug = DCE_DEBUG_LEVEL;
 const String DCE_DEVICE_NAME[MAX_REMOTEDEVICES]= {"rpmsg-dce","rpmsg-dce-dsp"};
 const String DCE_CALLBACK_NAME = "dce-callback";
 
-typedef struct {
+/* States of the row mode callback of an instance, see callback_worker() */
+typedef enum cb_state {
+    CB_IDLE = 0,
+    CB_ARMED,
+    CB_STREAMING,
+    CB_DRAINING,
+    CB_EXIT
+} cb_state;
+
+typedef struct CallbackFlag {
+    int id;     /* sequence number used to identify the instance in traces */
     XDAS_UInt32 codec_handle;
     XDM_DataSyncHandle local_dataSyncHandle;
     XDM_DataSyncDesc *local_dataSyncDesc;
-    XDAS_Int32 getDataFlag;
     XDM_DataSyncGetFxn (*local_get_DataFxn) (XDM_DataSyncHandle, XDM_DataSyncDesc*);
-    XDAS_Int32 putDataFlag;
     XDM_DataSyncGetFxn (*local_put_DataFxn) (XDM_DataSyncHandle, XDM_DataSyncDesc*);
-    XDAS_Int32 getBufferFlag;
-    pthread_t getDataFxn_thread;
-    pthread_t putDataFxn_thread;
-    sem_t sem_dec_row_mode;
-    sem_t sem_enc_row_mode;
+    /* One data exchange between codec and client: dce_callback_getDataFxn or dce_callback_putDataFxn */
+    void (*exchange)(struct CallbackFlag *cb);
+    struct CallbackFlag *next;  /* link in the worker queue or the parked list */
+    int scheduled;        /* queued, parked or being serviced by a worker */
+    int parked;           /* getDataFxn had no data, see callback_park() */
+    struct timespec retry;  /* when a parked instance is queued again */
+    pthread_mutex_t lock; /* serializes the row mode state of this instance */
+    pthread_cond_t cond;  /* signals every state change */
+    cb_state state;
     int row_mode;
     int first_control;
     int receive_numBlocks;
     int total_numBlocks;
+    /* Latency from the putDataFxn MmRpc return to the client putDataFxn call */
+    dce_histogram latency;
 } CallbackFlag;
 
-static CallbackFlag callbackmsg[MAX_INSTANCES];
+/***************** INSTANCE TABLES *******************/
+/* Engine and codec handles are mapped to their bookkeeping through hash    */
+/* tables which grow on demand. They are guarded by ipc_mutex.              */
+typedef struct dce_map_entry {
+    struct dce_map_entry    *next;
+    void                    *key;
+    void                    *value;
+} dce_map_entry;
 
-/***************** INLINE FUNCTIONS ******************/
-static inline int get_callback(Uint32 codec)
+typedef struct {
+    dce_map_entry   **bucket;
+    unsigned int    size;       /* number of buckets, power of 2 */
+    unsigned int    count;
+} dce_map;
+
+#define DCE_MAP_MIN_SIZE 16
+
+/* Bookkeeping of an engine */
+typedef struct {
+    int                 core;
+    int                 conn;       /* pool connection the engine is bound to */
+} dce_engine;
+
+/* Bookkeeping of a codec instance */
+typedef struct {
+    void                *codec;
+    dce_codec_type      codec_id;
+    int                 core;
+    int                 conn;       /* connection of the engine it was created on */
+    CallbackFlag        *callback;  /* row mode state, NULL in full frame mode */
+    struct process_ctx  *pctx;      /* cached process() marshalling */
+    struct control_cache *ccache;   /* cached control() queries, NULL when disabled */
+    dce_priority        priority;   /* class of its remote calls, see sched_acquire() */
+    uint32_t            budget_us;  /* process() duration flagged by the watchdog, 0 for none */
+    XDAS_UInt32         overruns;   /* process() calls flagged by the watchdog */
+    int                 failed;     /* a timed call was cancelled, remote calls fail */
+    struct timed_worker *timed;     /* worker of *_processTimed(), NULL until first used */
+    int                 placed;     /* created by dce_placement_create_decoder() */
+    struct dce_stats    *stats;     /* latency histograms of its remote calls, may be NULL */
+} dce_instance;
+
+static dce_map  engine_map;     /* Engine_Handle -> dce_engine */
+static dce_map  codec_map;      /* codec handle -> dce_instance */
+
+static int      __CodecCount[MAX_REMOTEDEVICES] = {0};
+/* Maximum number of engines and of codec instances per core, 0 for no limit */
+static int      __InstanceQuota[MAX_REMOTEDEVICES] = {MAX_INSTANCES, MAX_INSTANCES};
+static int      __CallbackSeq = 0;
+static int      __BudgetCount = 0;  /* instances with a call budget */
+
+static inline unsigned int dce_map_hash(void *key, unsigned int size)
 {
-    int i;
-    for (i = 0; i < MAX_INSTANCES; i++) {
-        if( callbackmsg[i].codec_handle == codec ) {
-            return i;
+    uint32_t    h = (uint32_t)(size_t)key;
+
+    /* Handles are aligned addresses: mix the high bits into the bucket index */
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+    return (h & (size - 1));
+}
+
+static dce_map_entry *dce_map_find(dce_map *map, void *key)
+{
+    dce_map_entry   *e;
+
+    if( map->bucket == NULL ) {
+        return (NULL);
+    }
+    for( e = map->bucket[dce_map_hash(key, map->size)]; e != NULL; e = e->next ) {
+        if( e->key == key ) {
+            return (e);
+        }
+    }
+    return (NULL);
+}
+
+/* Double the number of buckets. On allocation failure the map keeps */
+/* working with longer chains.                                        */
+static void dce_map_grow(dce_map *map)
+{
+    dce_map_entry   **bucket, *e, *next;
+    unsigned int    size = map->size ? map->size * 2 : DCE_MAP_MIN_SIZE;
+    unsigned int    i, h;
+
+    bucket = calloc(size, sizeof(dce_map_entry *));
+    if( bucket == NULL ) {
+        return;
+    }
+    for( i = 0; i < map->size; i++ ) {
+        for( e = map->bucket[i]; e != NULL; e = next ) {
+            next = e->next;
+            h = dce_map_hash(e->key, size);
+            e->next = bucket[h];
+            bucket[h] = e;
         }
     }
-    return -1;
+    free(map->bucket);
+    map->bucket = bucket;
+    map->size = size;
+}
+
+static int dce_map_put(dce_map *map, void *key, void *value)
+{
+    dce_map_entry   *e;
+    unsigned int    h;
+
+    if( map->count >= map->size ) {
+        dce_map_grow(map);
+    }
+    e = malloc(sizeof(dce_map_entry));
+    if( map->bucket == NULL || e == NULL ) {
+        free(e);
+        return (DCE_EOUT_OF_MEMORY);
+    }
+    e->key = key;
+    e->value = value;
+    h = dce_map_hash(key, map->size);
+    e->next = map->bucket[h];
+    map->bucket[h] = e;
+    map->count++;
+
+    return (DCE_EOK);
 }
 
-static inline int update_clients_table(Engine_Handle engine, int core)
+static void *dce_map_remove(dce_map *map, void *key)
 {
-    int i;
-    for(i = 0; i < MAX_INSTANCES; i++)
-    {
-        if( gEngineHandle[i][core] == 0 ) {
-            gEngineHandle[i][core] = engine;
-            return i;
+    dce_map_entry   **pe, *e;
+    void            *value;
+
+    if( map->bucket == NULL ) {
+        return (NULL);
+    }
+    for( pe = &map->bucket[dce_map_hash(key, map->size)]; *pe != NULL; pe = &((*pe)->next) ) {
+        if( (*pe)->key == key ) {
+            e = *pe;
+            *pe = e->next;
+            value = e->value;
+            free(e);
+            if( --map->count == 0 ) {
+                free(map->bucket);
+                map->bucket = NULL;
+                map->size = 0;
+            }
+            return (value);
         }
     }
-    return -1;
+    return (NULL);
+}
+
+/***************** INLINE FUNCTIONS ******************/
+/* Row mode state of a codec, NULL in full frame mode. Must be called with ipc_mutex held. */
+static inline CallbackFlag *get_callback(void *codec)
+{
+    dce_map_entry   *e = dce_map_find(&codec_map, codec);
+
+    return (e ? ((dce_instance *)e->value)->callback : NULL);
+}
+
+/* Allocate the row mode state of a codec. Must be called with ipc_mutex held. */
+static inline CallbackFlag *reserve_callback(void)
+{
+    CallbackFlag    *cb = calloc(1, sizeof(CallbackFlag));
+
+    if( cb ) {
+        cb->id = __CallbackSeq++;
+    }
+    return (cb);
+}
+
+/* Attach the row mode state to a created codec. Must be called with ipc_mutex held. */
+static inline void attach_callback(void *codec, CallbackFlag *cb)
+{
+    dce_map_entry   *e = dce_map_find(&codec_map, codec);
+
+    if( e ) {
+        ((dce_instance *)e->value)->callback = cb;
+    }
+}
+
+/* Must be called with ipc_mutex held */
+static inline dce_instance *get_instance(void *codec)
+{
+    dce_map_entry   *e = dce_map_find(&codec_map, codec);
+
+    return (e ? (dce_instance *)e->value : NULL);
+}
+
+static inline int update_clients_table(Engine_Handle engine, dce_engine *rec)
+{
+    return (dce_map_put(&engine_map, engine, rec));
 }
 
 static inline void Fill_MmRpc_fxnCtx(MmRpc_FxnCtx *fxnCtx, int fxn_id, int num_params, int num_xlts, MmRpc_Xlt *xltAry)
@@ -177,26 +423,13 @@ static int __inline getCoreIndexFromCodec(int codec_id)
          return INVALID_CORE;
 }
 
-static int __inline getCoreIndexFromEngine(Engine_Handle engine, int *tabIdx)
+/* Must be called with ipc_mutex held */
+static int __inline getCoreIndexFromEngine(Engine_Handle engine, int *conn)
 {
-    int i;
-    int core = INVALID_CORE;
-
-    *tabIdx = -1;
+    dce_map_entry   *e = dce_map_find(&engine_map, engine);
 
-    for(i = 0; i < MAX_INSTANCES ; i++) {
-        if( engine == gEngineHandle[i][IPU] ) {
-            core = IPU;
-            *tabIdx = i;
-            break;
-        }
-        else if( engine == gEngineHandle[i][DSP] ) {
-            *tabIdx = i;
-            core = DSP;
-            break;
-        }
-     }
-     return core;
+    *conn = e ? ((dce_engine *)e->value)->conn : 0;
+    return (e ? ((dce_engine *)e->value)->core : INVALID_CORE);
 }
 
 /***************** FUNCTIONS ********************************************/
@@ -216,173 +449,489 @@ void dce_free(void *ptr)
     memplugin_free(ptr);
 }
 
-/* dce_callback_putDataFxn is a callback function that runs on different Thread id. */
-/* It is an infinite loop notifying client when partial output data is available when outputDataMode = IVIDEO_ROWMODE. */
-int dce_callback_putDataFxn(void *codec)
+/*=====================================================================================*/
+/** dce_set_instance_quota  : Set the maximum number of engines and of codec instances
+ *                            accepted on a remote core.
+ *
+ * @ param core  [in]       : Remote core index (IPU or DSP).
+ * @ param quota [in]       : New quota, 0 removes the limit.
+ * @ return                 : Error Status.
+ */
+int dce_set_instance_quota(int core, int quota)
 {
-    MmRpc_FxnCtx        fxnCtx;
-    int32_t             fxnRet;
-    int32_t             return_callback;
     dce_error_status    eError = DCE_EOK;
-    XDM_DataSyncHandle  *codec_handle = (XDM_DataSyncHandle *) codec;
-    int                 id;
 
-    DEBUG("======================START======================== codec_handle 0x%x", (unsigned int) *codec_handle);
+    _ASSERT(core >= 0 && core < MAX_REMOTEDEVICES, DCE_EINVALID_INPUT);
+    _ASSERT(quota >= 0, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&ipc_mutex);
+    __InstanceQuota[core] = quota;
+    pthread_mutex_unlock(&ipc_mutex);
+
+EXIT:
+    return (eError);
+}
+
+/* Row mode callback state machine. Each low latency instance goes through:    */
+/*   CB_IDLE      : no frame in progress.                                      */
+/*   CB_ARMED     : *_process() started a frame and queued the instance.       */
+/*   CB_STREAMING : a worker exchanges row data between codec and client.      */
+/*   CB_DRAINING  : *_process() returned, the exchange in progress completes   */
+/*                  and the instance goes back to CB_IDLE.                     */
+/*   CB_EXIT      : *_delete() retired the instance.                           */
+/* All transitions are done with cb->lock held and signalled on cb->cond.      */
+/* While ARMED or STREAMING the instance is in the worker queue or serviced by */
+/* one worker (cb->scheduled), so its exchanges never run concurrently and     */
+/* keep their order. A worker requeues the instance after every exchange so   */
+/* the instances streaming at the same time take turns.                        */
+
+static inline uint32_t time_us(struct timespec *from, struct timespec *to)
+{
+    return ((to->tv_sec - from->tv_sec) * 1000000 + (to->tv_nsec - from->tv_nsec) / 1000);
+}
+
+static inline uint64_t now_us(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000);
+}
+
+/* CLOCK_REALTIME deadline for pthread_cond_timedwait(), timeout microseconds from now */
+static void deadline_us(struct timespec *abstime, UInt timeout)
+{
+    clock_gettime(CLOCK_REALTIME, abstime);
+    abstime->tv_sec += timeout / 1000000;
+    abstime->tv_nsec += (timeout % 1000000) * 1000;
+    if( abstime->tv_nsec >= 1000000000 ) {
+        abstime->tv_sec++;
+        abstime->tv_nsec -= 1000000000;
+    }
+}
+
+/* Move to a new state and wake up the other side. cb->lock must be held. */
+static inline void callback_set_state(CallbackFlag *cb, cb_state state)
+{
+    cb->state = state;
+    pthread_cond_broadcast(&cb->cond);
+}
 
-    id = get_callback((Uint32) *codec_handle);
-    if( id < 0 ) {
-        ERROR("Cannot find the entry in callbackmsg");
+/* Append the instance to the worker queue. __CbPoolMutex must be held. */
+static void callback_enqueue(CallbackFlag *cb)
+{
+    cb->next = NULL;
+    if( __CbQueueTail ) {
+        __CbQueueTail->next = cb;
     } else {
-        (callbackmsg[id]).local_dataSyncHandle = *codec_handle;
-        /* This is called from VIDDEC3_process, so we can start telling client to get the output data and provide the numBlocks info. */
-        /* Call the callback function specified in the dynParams->putDataFxn */
-        while (1) {
-            if( (callbackmsg[id]).putDataFlag == 1 ) {
-                DEBUG("lock (callbackmsg[%d]).putDataFxn_thread 0x%x (callbackmsg[%d]).local_dataSyncHandle 0x%x",
-                    id, (callbackmsg[id]).putDataFxn_thread, id, (unsigned int) (callbackmsg[id]).local_dataSyncHandle);
-                pthread_mutex_lock(&dce_callback_mutex);
-                if( (callbackmsg[id]).row_mode ) {
-                    /* Marshall function arguments into the send callback information to codec for put_DataFxn */
-                    Fill_MmRpc_fxnCtx(&fxnCtx, DCE_CALLBACK_RPC_PUT_DATAFXN, 2, 0, NULL);
-                    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[0]), sizeof(int32_t), (int32_t) (callbackmsg[id]).local_dataSyncHandle);
-                    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[1]), GetSz((callbackmsg[id]).local_dataSyncDesc), (void *) P2H((callbackmsg[id]).local_dataSyncDesc),
-                                                    sizeof(MemHeader), memplugin_share((callbackmsg[id]).local_dataSyncDesc));
-
-                    DEBUG("Calling MmRpc_call on MmRpcCallbackHandle %p", MmRpcCallbackHandle);
-                    eError = MmRpc_call(MmRpcCallbackHandle, &fxnCtx, &fxnRet);
-                    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
-
-                    /* When this return it means that Codec has called DCE Server with putDataFxn callback that has the numBlock information. */
-                    /* At this point, codec should have filled the outputBuffer pointer that is passed in VIDDEC3_process. */
-                    DEBUG("From codec (callbackmsg[%d]).local_dataSyncHandle %p (callbackmsg[%d]).local_dataSyncDesc->numBlocks %d ",
-                        id, (callbackmsg[id]).local_dataSyncHandle, id, (int32_t) (callbackmsg[id]).local_dataSyncDesc->numBlocks);
-
-                    if( (callbackmsg[id]).local_dataSyncDesc->numBlocks ) {
-                        (callbackmsg[id]).receive_numBlocks += (callbackmsg[id]).local_dataSyncDesc->numBlocks;
-                        return_callback = (int32_t) ((callbackmsg[id]).local_put_DataFxn)((callbackmsg[id]).local_dataSyncHandle, (callbackmsg[id]).local_dataSyncDesc);
-                        if( return_callback < 0 ) {
-                            /* dce_callback_putDataFxn getting no output data saved when calling the callback. Ignore and continue. */
-                            ERROR("Received return_callback %d when asking client to save the output Data of (callbackmsg[%d]).numBlock %d",
-                                return_callback, id, (callbackmsg[id]).local_dataSyncDesc->numBlocks);
-                        }
+        __CbQueueHead = cb;
+    }
+    __CbQueueTail = cb;
+    pthread_cond_signal(&__CbPoolCond);
+}
 
-                        DEBUG("(callbackmsg[%d]).local_dataSyncHandle %p (callbackmsg[%d]).receive_numBlocks %d >= (callbackmsg[%d]).total_numBlocks %d (callbackmsg[%d]).putDataFlag %d",
-                            id, (callbackmsg[id]).local_dataSyncHandle, id, (callbackmsg[id]).receive_numBlocks, id, (callbackmsg[id]).total_numBlocks, id, (callbackmsg[id]).putDataFlag);
-                    } else {
-                        /* dce_callback_putDataFxn getting 0 numBlocks from DCE server. Need to stop the loop as it indicates VIDDEC3_process will be returned*/
-                        DEBUG("dce_callback_putDataFxn is getting (callbackmsg[%d]).numBlock %d when calling putDataFxn callback",
-                            id, (callbackmsg[id]).local_dataSyncDesc->numBlocks);
-                        (callbackmsg[id]).putDataFlag = 0;
-                    }
-
-                    DEBUG("unlock (callbackmsg[%d]).putDataFxn_thread 0x%x (callbackmsg[%d]).local_dataSyncHandle %p",
-                        id, (callbackmsg[id]).putDataFxn_thread, id, (callbackmsg[id]).local_dataSyncHandle);
-                    pthread_mutex_unlock(&dce_callback_mutex);
-                }
-            } else if( (callbackmsg[id]).putDataFlag == 2 ) {
-                /* Receive an indication to clean up and exit the thread. */
-                DEBUG("CLEAN UP indication due to (callbackmsg[%d]).putDataFlag %d is set.", id, (callbackmsg[id]).putDataFlag);
-                pthread_exit(0);
-            } else {
-                DEBUG("Do nothing (callbackmsg[%d]).local_dataSyncHandle 0x%x because (callbackmsg[%d]).putDataFlag %d is not 1.",
-                    id, (unsigned int)(callbackmsg[id]).local_dataSyncHandle, id, (callbackmsg[id]).putDataFlag);
-                if ((callbackmsg[id]).receive_numBlocks) {
-                    (callbackmsg[id]).receive_numBlocks = 0;
-                    DEBUG("Signal sem_dec_row_mode as VIDDEC3_process might wait before returning to client.");
-                    sem_post(&((callbackmsg[id]).sem_dec_row_mode));
-                }
-                sem_wait(&((callbackmsg[id]).sem_dec_row_mode));
-            }
+/* Append the instance to the worker queue. cb->lock must be held. */
+static void callback_schedule(CallbackFlag *cb)
+{
+    cb->scheduled = 1;
+
+    pthread_mutex_lock(&__CbPoolMutex);
+    callback_enqueue(cb);
+    pthread_mutex_unlock(&__CbPoolMutex);
+}
+
+/* The client had no data for the instance: keep it out of the worker queue until */
+/* dce_callback_data_ready() or DCE_CALLBACK_RETRY_US. cb->lock must be held.      */
+static void callback_park(CallbackFlag *cb)
+{
+    deadline_us(&cb->retry, DCE_CALLBACK_RETRY_US);
+
+    pthread_mutex_lock(&__CbPoolMutex);
+    cb->next = __CbParked;
+    __CbParked = cb;
+    /* A waiting worker has to take the new deadline into account */
+    pthread_cond_signal(&__CbPoolCond);
+    pthread_mutex_unlock(&__CbPoolMutex);
+}
+
+/* Queue a parked instance at once. An instance about to be parked by its worker */
+/* is queued again by the worker instead. cb->lock must be held.                 */
+static void callback_wake(CallbackFlag *cb)
+{
+    CallbackFlag    **link;
+
+    if( !cb->parked ) {
+        return;
+    }
+    cb->parked = 0;
+    pthread_mutex_lock(&__CbPoolMutex);
+    /* Not found when its deadline has already queued it */
+    for( link = &__CbParked; *link != NULL; link = &((*link)->next)) {
+        if( *link == cb ) {
+            *link = cb->next;
+            callback_enqueue(cb);
+            break;
         }
     }
+    pthread_mutex_unlock(&__CbPoolMutex);
+}
 
-EXIT:
+/* Queue the parked instances whose deadline passed. Returns 1 with the next */
+/* deadline in retry when instances stay parked. __CbPoolMutex must be held. */
+static int callback_unpark(struct timespec *retry)
+{
+    CallbackFlag    **link, *cb;
+    struct timespec now;
+    int             parked = 0;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    for( link = &__CbParked; (cb = *link) != NULL; ) {
+        if( cb->retry.tv_sec < now.tv_sec ||
+            (cb->retry.tv_sec == now.tv_sec && cb->retry.tv_nsec <= now.tv_nsec)) {
+            *link = cb->next;
+            callback_enqueue(cb);
+            continue;
+        }
+        if( !parked || cb->retry.tv_sec < retry->tv_sec ||
+            (cb->retry.tv_sec == retry->tv_sec && cb->retry.tv_nsec < retry->tv_nsec)) {
+            *retry = cb->retry;
+        }
+        parked = 1;
+        link = &(cb->next);
+    }
+    return (parked);
+}
 
-    DEBUG("======================END======================== codec_handle 0x%x", (unsigned int) *codec_handle);
-    return (0);
+/* Called by *_process() before the remote call: hand the frame to the workers */
+static void callback_arm(CallbackFlag *cb)
+{
+    pthread_mutex_lock(&cb->lock);
+    /* The previous frame has to be drained before the counters are reset */
+    while( cb->state == CB_DRAINING ) {
+        pthread_cond_wait(&cb->cond, &cb->lock);
+    }
+    if( cb->state == CB_IDLE ) {
+        /* The DCE server identifies the instance with its remote codec handle */
+        cb->local_dataSyncHandle = (XDM_DataSyncHandle) cb->codec_handle;
+        cb->receive_numBlocks = 0;
+        callback_set_state(cb, CB_ARMED);
+        if( !cb->scheduled ) {
+            callback_schedule(cb);
+        }
+    }
+    pthread_mutex_unlock(&cb->lock);
+}
+
+/* Called by *_process() after the remote call: wait for the worker to complete */
+/* the exchange in progress.                                                    */
+static void callback_drain(CallbackFlag *cb)
+{
+    pthread_mutex_lock(&cb->lock);
+    if( cb->state == CB_ARMED || cb->state == CB_STREAMING ) {
+        callback_set_state(cb, CB_DRAINING);
+        callback_wake(cb);
+    }
+    while( cb->state == CB_DRAINING ) {
+        pthread_cond_wait(&cb->cond, &cb->lock);
+    }
+    pthread_mutex_unlock(&cb->lock);
+}
+
+/* Called by *_delete(): retire the instance and wait until no worker refers to it. */
+static void callback_retire(CallbackFlag *cb)
+{
+    pthread_mutex_lock(&cb->lock);
+    callback_set_state(cb, CB_EXIT);
+    callback_wake(cb);
+    while( cb->scheduled ) {
+        pthread_cond_wait(&cb->cond, &cb->lock);
+    }
+    pthread_mutex_unlock(&cb->lock);
 }
 
+/* Call statistics, see dce_get_stats() */
+static void stats_add(dce_histogram *h, uint32_t value);
+
+/* RPC capture, see dce_mmrpc_call() */
+static pthread_once_t   capture_env_once = PTHREAD_ONCE_INIT;
+static void capture_env_start(void);
+static int dce_mmrpc_call(int core, int conn, MmRpc_Handle handle, MmRpc_FxnCtx *fxnCtx, int32_t *fxnRet);
 
-/* dce_callback_getDataFxn is running on different Thread id. */
-/* It is an infinite loop request to client for more input data when inputDataMode = IVIDEO_ROWMODE. */
-int dce_callback_getDataFxn(void *codec)
+/* dce_callback_putDataFxn notifies the client when partial output data is available */
+/* when outputDataMode = IVIDEO_NUMROWS. It runs on a callback worker.              */
+static void dce_callback_putDataFxn(CallbackFlag *cb)
 {
     MmRpc_FxnCtx        fxnCtx;
     int32_t             fxnRet;
     int32_t             return_callback;
+    int32_t             numBlocks;
     dce_error_status    eError = DCE_EOK;
-    XDM_DataSyncHandle  *codec_handle = (XDM_DataSyncHandle *) codec;
-    int                 id;
+    struct timespec     t_rpc, t_client;
+
+    /* Marshall function arguments into the send callback information to codec for put_DataFxn */
+    Fill_MmRpc_fxnCtx(&fxnCtx, DCE_CALLBACK_RPC_PUT_DATAFXN, 2, 0, NULL);
+    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[0]), sizeof(int32_t), (int32_t) cb->local_dataSyncHandle);
+    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[1]), GetSz(cb->local_dataSyncDesc), GetBase(cb->local_dataSyncDesc),
+                                    GetOffset(cb->local_dataSyncDesc), memplugin_share(cb->local_dataSyncDesc));
+
+    /* Returns once the codec has called DCE Server with putDataFxn callback that has the numBlock information. */
+    eError = dce_mmrpc_call(DCE_CAPTURE_CALLBACK, cb->id, MmRpcCallbackHandle, &fxnCtx, &fxnRet);
+    clock_gettime(CLOCK_MONOTONIC, &t_rpc);
+    numBlocks = (eError == DCE_EOK) ? cb->local_dataSyncDesc->numBlocks : 0;
+    if( eError != DCE_EOK ) {
+        ERROR("callback[%d] putDataFxn MmRpc_call failed %d", cb->id, eError);
+    }
+
+    if( numBlocks ) {
+        /* Codec has filled the outputBuffer pointer that is passed in VIDDEC3_process: hand the rows to the client. */
+        clock_gettime(CLOCK_MONOTONIC, &t_client);
+        return_callback = (int32_t) (cb->local_put_DataFxn)(cb->local_dataSyncHandle, cb->local_dataSyncDesc);
+        if( return_callback < 0 ) {
+            /* Client could not save the output data. Ignore and continue. */
+            ERROR("Received return_callback %d when asking client to save the output Data of callback[%d] numBlock %d",
+                return_callback, cb->id, numBlocks);
+        }
+        stats_add(&cb->latency, time_us(&t_rpc, &t_client));
+    }
 
-    DEBUG("======================START========================");
-    DEBUG(" >> dce_callback_getDataFxn codec_handle 0x%x", (unsigned int) *codec_handle);
+    pthread_mutex_lock(&cb->lock);
+    cb->receive_numBlocks += numBlocks;
+    DEBUG("callback[%d] numBlocks %d receive_numBlocks %d total_numBlocks %d state %d",
+        cb->id, numBlocks, cb->receive_numBlocks, cb->total_numBlocks, cb->state);
+    /* 0 numBlocks from the DCE server means VIDDEC3_process is about to return */
+    if( numBlocks == 0 && cb->state == CB_STREAMING ) {
+        callback_set_state(cb, CB_IDLE);
+    }
+    pthread_mutex_unlock(&cb->lock);
+}
+
+/* dce_callback_getDataFxn requests more input data to the client when */
+/* inputDataMode = IVIDEO_NUMROWS. It runs on a callback worker.      */
+static void dce_callback_getDataFxn(CallbackFlag *cb)
+{
+    MmRpc_FxnCtx        fxnCtx;
+    int32_t             fxnRet;
+    int32_t             return_callback;
+    int32_t             numBlocks = 0;
+    dce_error_status    eError = DCE_EOK;
 
-    id = get_callback((Uint32) *codec_handle);
-    if( id < 0 ) {
-        ERROR("Cannot find the entry in callbackmsg");
+    /* Calling client callback function to get the next rows for the IVA-HD codec */
+    return_callback = (int32_t) (cb->local_get_DataFxn)(cb->local_dataSyncHandle, cb->local_dataSyncDesc);
+    if( return_callback < 0 ) {
+        /* Client getting error when calling the callback. Ignore and re-try later. */
+        ERROR("dce_callback_getDataFxn is getting return_callback %d when calling getDataFxn callback. Retry callback for more data.", return_callback);
+    } else if( cb->local_dataSyncDesc->numBlocks ) {
+        numBlocks = cb->local_dataSyncDesc->numBlocks;
+
+        /* Marshall function arguments into the send callback information to codec for get_dataFxn */
+        Fill_MmRpc_fxnCtx(&fxnCtx, DCE_CALLBACK_RPC_GET_DATAFXN, 2, 0, NULL);
+        Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[0]), sizeof(int32_t), (int32_t) cb->local_dataSyncHandle);
+        Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[1]), GetSz(cb->local_dataSyncDesc), GetBase(cb->local_dataSyncDesc),
+                                        GetOffset(cb->local_dataSyncDesc), memplugin_share(cb->local_dataSyncDesc));
+
+        eError = dce_mmrpc_call(DCE_CAPTURE_CALLBACK, cb->id, MmRpcCallbackHandle, &fxnCtx, &fxnRet);
+        if( eError != DCE_EOK ) {
+            ERROR("callback[%d] getDataFxn MmRpc_call failed %d", cb->id, eError);
+            numBlocks = 0;
+        }
     } else {
-        (callbackmsg[id]).local_dataSyncHandle = *codec_handle;
-        /* This is called from VIDENC2_process, so we can start request client to fill in input and provide the row information written. */
-        /* Call the callback function specified in the dynParams->getDataFxn */
-        while( 1 ) {
-            if( (callbackmsg[id]).getDataFlag == 1 ) {
-                DEBUG("lock (callbackmsg[%d]).getDataFxn_thread 0x%x (callbackmsg[%d]).local_dataSyncHandle %p",
-                    id, (callbackmsg[id]).getDataFxn_thread, id, (callbackmsg[id]).local_dataSyncHandle);
-                pthread_mutex_lock(&dce_callback_mutex);
-                if( (callbackmsg[id]).row_mode ) {
-                    /* Calling client callback function to pass data received from IVA-HD codec */
-                    return_callback = (int32_t) ((callbackmsg[id]).local_get_DataFxn)((callbackmsg[id]).local_dataSyncHandle, (callbackmsg[id]).local_dataSyncDesc);
-                    if( return_callback < 0 ) {
-                        /* dce_callback_getDataFxn getting error when calling the callback. Ignore and re-try. */
-                        ERROR("dce_callback_getDataFxn is getting return_callback %d when calling getDataFxn callback. Retry callback for more data.", return_callback);
-                    } else {
-                        (callbackmsg[id]).receive_numBlocks += (callbackmsg[id]).local_dataSyncDesc->numBlocks;
-
-                        if( (callbackmsg[id]).local_dataSyncDesc->numBlocks ) {
-                            /* Marshall function arguments into the send callback information to codec for get_dataFxn */
-                            Fill_MmRpc_fxnCtx(&fxnCtx, DCE_CALLBACK_RPC_GET_DATAFXN, 2, 0, NULL);
-                            Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[0]), sizeof(int32_t), (int32_t) (callbackmsg[id]).local_dataSyncHandle);
-                            Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[1]), GetSz((callbackmsg[id]).local_dataSyncDesc), (void *) P2H((callbackmsg[id]).local_dataSyncDesc),
-                                                            sizeof(MemHeader), memplugin_share((callbackmsg[id]).local_dataSyncDesc));
-
-                            eError = MmRpc_call(MmRpcCallbackHandle, &fxnCtx, &fxnRet);
-                            _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
-
-                            DEBUG("(callbackmsg[%d]).local_dataSyncHandle %p (callbackmsg[%d]).receive_numBlocks %d >= (callbackmsg[%d]).total_numBlocks %d",
-                                id, (callbackmsg[id]).local_dataSyncHandle, id, (callbackmsg[id]).receive_numBlocks, id, (callbackmsg[id]).total_numBlocks);
-
-                            if( (callbackmsg[id]).receive_numBlocks >= (callbackmsg[id]).total_numBlocks ) {
-                                /* one full frame has been sent to codec. Need to stop the callback call to client. */
-                                /* it will be resumed once VIDENC2_process for the next one. */
-                                (callbackmsg[id]).receive_numBlocks = 0;
-                                (callbackmsg[id]).getDataFlag = 0;
-                                DEBUG("Setting the (callbackmsg[%d]).getDataFlag to 0 to stop calling client to fill", id);
-                            }
-                        } else {
-                            /* dce_callback_getDataFxn getting 0 numBlocks when calling the callback. Ignore and re-try. */
-                            DEBUG("Received dataSyncDesc->numBlocks == 0 meaning the callback thread has no data -ignore.");
-                        }
-                    }
-                    DEBUG("unlock (callbackmsg[%d]).getDataFxn_thread 0x%x (callbackmsg[%d]).local_dataSyncHandle %p",
-                        id, (callbackmsg[id]).getDataFxn_thread, id, (callbackmsg[id]).local_dataSyncHandle);
-                    pthread_mutex_unlock(&dce_callback_mutex);
-                }
-            } else if( (callbackmsg[id]).getDataFlag == 2 ) {
-                /* Receive an indication to clean up and exit the thread. */
-                DEBUG("CLEAN UP indication due to (callbackmsg[%d]).getDataFlag %d is set.", id, (callbackmsg[id]).getDataFlag);
-                pthread_exit(0);
-            } else {
-                DEBUG("Do nothing (callbackmsg[%d]).local_dataSyncHandle 0x%x because msg-getDataFlag %d is not 1.",
-                    id, (unsigned int)(callbackmsg[id]).local_dataSyncHandle, (callbackmsg[id]).getDataFlag);
-                sem_wait(&((callbackmsg[id]).sem_enc_row_mode));
+        /* Client has no data yet - ignore and re-try later. */
+        DEBUG("Received dataSyncDesc->numBlocks == 0 meaning the callback thread has no data -ignore.");
+    }
+
+    pthread_mutex_lock(&cb->lock);
+    cb->receive_numBlocks += numBlocks;
+    DEBUG("callback[%d] receive_numBlocks %d total_numBlocks %d state %d",
+        cb->id, cb->receive_numBlocks, cb->total_numBlocks, cb->state);
+    /* Stop requesting data once one full frame has been sent to codec. */
+    if( cb->receive_numBlocks >= cb->total_numBlocks && cb->state == CB_STREAMING ) {
+        callback_set_state(cb, CB_IDLE);
+    }
+    /* No rows: wait for the client instead of asking it again at once */
+    cb->parked = (numBlocks == 0 && cb->state == CB_STREAMING);
+    pthread_mutex_unlock(&cb->lock);
+}
+
+/* Restrict the calling worker to __CbCpuMask */
+static void callback_worker_affinity(void)
+{
+#if defined(BUILDOS_LINUX) || defined(BUILDOS_ANDROID)
+    cpu_set_t    set;
+    unsigned int cpu;
+
+    CPU_ZERO(&set);
+    for( cpu = 0; cpu < sizeof(__CbCpuMask) * 8; cpu++ ) {
+        if( __CbCpuMask & (1UL << cpu)) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if( sched_setaffinity(0, sizeof(set), &set)) {
+        ERROR("Failed to set the callback worker affinity 0x%lx errno %d", __CbCpuMask, errno);
+    }
+#elif defined(BUILDOS_QNX)
+    if( ThreadCtl(_NTO_TCTL_RUNMASK, (void *) __CbCpuMask) == -1 ) {
+        ERROR("Failed to set the callback worker affinity 0x%lx errno %d", __CbCpuMask, errno);
+    }
+#endif
+}
+
+/* callback_worker takes the instances out of the worker queue and runs one */
+/* data exchange for each of them.                                          */
+static void *callback_worker(void *arg)
+{
+    CallbackFlag    *cb;
+    struct timespec retry;
+
+    if( __CbCpuMask ) {
+        callback_worker_affinity();
+    }
+    DEBUG("======================START======================== callback worker %d", (int)(intptr_t) arg);
+
+    pthread_mutex_lock(&__CbPoolMutex);
+    while( 1 ) {
+        while( !callback_unpark(&retry) ) {
+            if( __CbQueueHead != NULL || __CbPoolExit ) {
+                break;
             }
+            pthread_cond_wait(&__CbPoolCond, &__CbPoolMutex);
+        }
+        if( __CbQueueHead == NULL && !__CbPoolExit ) {
+            /* Only parked instances: sleep until the first one is due */
+            pthread_cond_timedwait(&__CbPoolCond, &__CbPoolMutex, &retry);
+            continue;
+        }
+        if( __CbQueueHead == NULL ) {
+            break;
+        }
+        cb = __CbQueueHead;
+        __CbQueueHead = cb->next;
+        if( __CbQueueHead == NULL ) {
+            __CbQueueTail = NULL;
+        }
+        pthread_mutex_unlock(&__CbPoolMutex);
+
+        pthread_mutex_lock(&cb->lock);
+        cb->parked = 0;
+        if( cb->state == CB_ARMED ) {
+            callback_set_state(cb, CB_STREAMING);
+        }
+        if( cb->state == CB_STREAMING ) {
+            pthread_mutex_unlock(&cb->lock);
+            cb->exchange(cb);
+            pthread_mutex_lock(&cb->lock);
+        }
+        if( cb->state == CB_DRAINING ) {
+            /* Nothing in progress anymore */
+            callback_set_state(cb, CB_IDLE);
+        }
+        if( cb->parked && cb->state == CB_STREAMING ) {
+            callback_park(cb);
+        } else if( cb->state == CB_ARMED || cb->state == CB_STREAMING ) {
+            /* More rows to exchange: give the other instances a turn first */
+            callback_schedule(cb);
+        } else {
+            cb->scheduled = 0;
+            pthread_cond_broadcast(&cb->cond);
+        }
+        pthread_mutex_unlock(&cb->lock);
+
+        pthread_mutex_lock(&__CbPoolMutex);
+    }
+    pthread_mutex_unlock(&__CbPoolMutex);
+
+    DEBUG("======================END======================== callback worker exit");
+    return (NULL);
+}
+
+/*===============================================================*/
+/** callback_pool_start : Start callback workers until count of them run. ipc_mutex must be held.
+ *
+ * @ param count [in]      : Workers wanted.
+ * @ param needed [in]     : Workers without which the call fails.
+ * @ return : Error Status.
+ */
+static int callback_pool_start(int count, int needed)
+{
+    pthread_attr_t      attr;
+    struct sched_param  param;
+    dce_error_status    eError = DCE_EOK;
+    int                 rt = (__CbPriority > 0);
+
+    __CbPoolExit = 0;
+    while( __CbWorkerCount < count ) {
+        pthread_attr_init(&attr);
+        if( rt ) {
+            pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+            pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+            param.sched_priority = __CbPriority;
+            pthread_attr_setschedparam(&attr, &param);
+        }
+        eError = pthread_create(&__CbWorker[__CbWorkerCount], &attr, callback_worker,
+                                (void *)(intptr_t) __CbWorkerCount);
+        pthread_attr_destroy(&attr);
+        if( eError == EPERM && rt ) {
+            /* Not allowed to use SCHED_FIFO, keep the default policy, also for later workers */
+            ERROR("No permission for SCHED_FIFO priority %d, callback workers use the default policy", __CbPriority);
+            __CbPriority = 0;
+            rt = 0;
+            continue;
+        }
+        if( eError ) {
+            break;
         }
+        __CbWorkerCount++;
     }
+    DEBUG("Running %d callback workers", __CbWorkerCount);
+    /* Run with the workers that could be created */
+    _ASSERT(__CbWorkerCount >= needed, DCE_EXDM_FAIL);
+    eError = DCE_EOK;
 
 EXIT:
-    DEBUG(" << dce_callback_getDataFxn COMPLETE");
-    DEBUG("======================END========================");
-    return (0);
+    return (eError);
+}
+
+/*===============================================================*/
+/** callback_pool_stop  : Stop the callback workers once the worker queue is empty.
+ *                        ipc_mutex must be held.
+ */
+static void callback_pool_stop(void)
+{
+    int    i;
+
+    pthread_mutex_lock(&__CbPoolMutex);
+    __CbPoolExit = 1;
+    pthread_cond_broadcast(&__CbPoolCond);
+    pthread_mutex_unlock(&__CbPoolMutex);
+
+    for( i = 0; i < __CbWorkerCount; i++ ) {
+        pthread_join(__CbWorker[i], NULL);
+    }
+    __CbWorkerCount = 0;
+}
+
+/*===============================================================*/
+/** dce_set_callback_pool : Configure the callback worker pool.
+ *
+ * @ return : Error Status.
+ */
+int dce_set_callback_pool(int threads, int priority, unsigned long cpumask)
+{
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(threads > 0 && threads <= DCE_MAX_CALLBACK_WORKERS, DCE_EINVALID_INPUT);
+    _ASSERT(priority >= 0 && (priority == 0 || (priority >= sched_get_priority_min(SCHED_FIFO) &&
+                                                 priority <= sched_get_priority_max(SCHED_FIFO))), DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&ipc_mutex);
+    /* The workers are started with the first low latency instance */
+    _ASSERT_AND_EXECUTE(__CbWorkerCount == 0, DCE_EXDM_UNSUPPORTED, pthread_mutex_unlock(&ipc_mutex));
+    __CbPoolSize = threads;
+    __CbPriority = priority;
+    __CbCpuMask = cpumask;
+    pthread_mutex_unlock(&ipc_mutex);
+
+EXIT:
+    return (eError);
 }
 
 /*=====================================================================================*/
@@ -394,11 +943,15 @@ int dce_ipc_init(int core)
 {
     MmRpc_Params        args;
     dce_error_status    eError = DCE_EOK;
+    int                 i;
 
     DEBUG(" >> dce_ipc_init\n");
 
+    pthread_once(&capture_env_once, capture_env_start);
+
     /*First check if maximum clients are already using ipc*/
-    if( __ClientCount[core] >= MAX_INSTANCES ) {
+    if( __InstanceQuota[core] && __ClientCount[core] >= __InstanceQuota[core] ) {
+        ERROR("Too many clients on core %d, quota is %d", core, __InstanceQuota[core]);
         eError = DCE_EXDM_UNSUPPORTED;
         return (eError);
     }
@@ -412,9 +965,27 @@ int dce_ipc_init(int core)
 
     MmRpc_Params_init(&args);
 
-    eError = MmRpc_create(DCE_DEVICE_NAME[core], &args, &MmRpcHandle[core]);
+    /* Each connection of the pool is an independent rpmsg-dce endpoint */
+    for( i = 0; i < __PoolSize[core]; i++ ) {
+        eError = MmRpc_create(DCE_DEVICE_NAME[core], &args, &(__Conn[core][i].handle));
+        if( eError != DCE_EOK ) {
+            __Conn[core][i].handle = NULL;
+            break;
+        }
+        __Conn[core][i].inflight = 0;
+        __Conn[core][i].abandoned = 0;
+        __Conn[core][i].bound = 0;
+        DEBUG("open(/dev/%s]) -> 0x%x\n", DCE_DEVICE_NAME[core], (int)__Conn[core][i].handle);
+    }
+    __PoolActive[core] = i;
+    __PoolNext[core] = 0;
+
+    /* A partially created pool is still usable, only fail without any connection */
+    if( i > 0 && i < __PoolSize[core] ) {
+        ERROR("Only %d of %d MmRpc connections created on core %d", i, __PoolSize[core], core);
+        eError = DCE_EOK;
+    }
     _ASSERT_AND_EXECUTE(eError == DCE_EOK, DCE_EIPC_CREATE_FAIL, __ClientCount[core]--);
-    DEBUG("open(/dev/%s]) -> 0x%x\n", DCE_DEVICE_NAME[core], (int)MmRpcHandle[core]);
 
 EXIT:
     return (eError);
@@ -422,186 +993,2217 @@ EXIT:
 
 /*=====================================================================================*/
 /** dce_ipc_deinit            : DeInitialize MmRpc. This function is called within
- *                              Engine_close().
+ *                              Engine_close() with ipc_mutex held. The engine entry
+ *                              is removed by Engine_close(), tableIdx is unused.
  */
 void dce_ipc_deinit(int core, int tableIdx)
 {
+    MmRpc_Handle    handle;
+    dce_orphan      *orphan;
+    int             i;
+
     if( __ClientCount[core] == 0 ) {
         DEBUG("Nothing to be done: a spurious call\n");
         return;
     }
     __ClientCount[core]--;
 
-    if ( tableIdx >= 0 )
-        gEngineHandle[tableIdx][core] = 0;
-
     if( __ClientCount[core] > 0 ) {
          goto EXIT;
     }
 
-    if( MmRpcHandle[core] != NULL ) {
-         MmRpc_delete(&MmRpcHandle[core]);
-         MmRpcHandle[core] = NULL;
+    for( i = 0; i < __PoolActive[core]; i++ ) {
+        /* Wait for the calls still running on this connection before deleting it. */
+        /* A cancelled call may never return: the handle is left to the last one.  */
+        /* dce_ipc_put() does not take ipc_mutex, which is held here.              */
+        handle = __Conn[core][i].handle;
+        pthread_mutex_lock(&__RpcIdleMutex);
+        while( __Conn[core][i].inflight > __Conn[core][i].abandoned ) {
+            pthread_cond_wait(&__RpcIdleCond, &__RpcIdleMutex);
+        }
+        if( __Conn[core][i].inflight > 0 && handle != NULL ) {
+            orphan = malloc(sizeof(dce_orphan));
+            if( orphan ) {
+                orphan->handle = handle;
+                orphan->inflight = __Conn[core][i].inflight;
+                orphan->next = __Orphans;
+                __Orphans = orphan;
+            } else {
+                ERROR("MmRpc connection %d of core %d leaked with cancelled calls in flight", i, core);
+            }
+            handle = NULL;
+        }
+        __Conn[core][i].inflight = 0;
+        __Conn[core][i].abandoned = 0;
+        __Conn[core][i].handle = NULL;
+        pthread_mutex_unlock(&__RpcIdleMutex);
+
+        if( handle != NULL ) {
+             MmRpc_delete(&handle);
+        }
+        __Conn[core][i].bound = 0;
     }
+    __PoolActive[core] = 0;
+    /* Buffer registrations went away with the connections */
+    __atomic_add_fetch(&__PoolEpoch[core], 1, __ATOMIC_RELEASE);
 
 EXIT:
     return;
 }
 
-/*===============================================================*/
-/** Engine_open        : Open Codec Engine.
+/*=====================================================================================*/
+/** dce_ipc_bind            : Select the pool connection a new engine or codec instance
+ *                            is bound to. Must be called with ipc_mutex held.
  *
- * @ param attrs  [in]      : Engine Attributes. This param is not passed to Remote core.
- * @ param name [in]        : Name of Encoder or Decoder codec.
- * @ param ec [out]         : Error returned by Codec Engine.
- * @ return : Codec Engine Handle is returned to be used to create codec.
- *                 In case of error, NULL is returned as Engine Handle.
+ * @ param core  [in]       : Remote core index.
+ * @ return                 : Connection index.
  */
-Engine_Handle Engine_open(String name, Engine_Attrs *attrs, Engine_Error *ec)
+static int dce_ipc_bind(int core)
 {
-    MmRpc_FxnCtx        fxnCtx;
-    dce_error_status    eError = DCE_EOK;
-    dce_engine_open     *engine_open_msg = NULL;
-    Engine_Attrs        *engine_attrs = NULL;
-    Engine_Handle       engine_handle = NULL;
-    int                 coreIdx   = INVALID_CORE;
-    int                 tabIdx      = -1;
-
-    DEBUG("START Engine_open ipc_mutex 0x%x", (unsigned int) &ipc_mutex);
-    /*Acquire permission to use IPC*/
-    pthread_mutex_lock(&ipc_mutex);
+    int     i, conn = 0;
+
+    if( __PoolActive[core] <= 1 ) {
+        conn = 0;
+    } else if( __PoolPolicy[core] == DCE_POOL_LEAST_LOADED ) {
+        for( i = 1; i < __PoolActive[core]; i++ ) {
+            if( __Conn[core][i].bound < __Conn[core][conn].bound ||
+                (__Conn[core][i].bound == __Conn[core][conn].bound &&
+                 __atomic_load_n(&__Conn[core][i].inflight, __ATOMIC_RELAXED) <
+                 __atomic_load_n(&__Conn[core][conn].inflight, __ATOMIC_RELAXED)) ) {
+                conn = i;
+            }
+        }
+    } else {
+        conn = __PoolNext[core];
+        __PoolNext[core] = (conn + 1) % __PoolActive[core];
+    }
+    __Conn[core][conn].bound++;
 
-    _ASSERT(name != '\0', DCE_EINVALID_INPUT);
+    return (conn);
+}
 
-    coreIdx = getCoreIndexFromName(name);
+/* Release the binding taken by dce_ipc_bind(). Must be called with ipc_mutex held. */
+static void dce_ipc_unbind(int core, int conn)
+{
+    if( conn < __PoolActive[core] && __Conn[core][conn].bound > 0 ) {
+        __Conn[core][conn].bound--;
+    }
+}
+
+/*=====================================================================================*/
+/** dce_ipc_get             : Take a reference on a MmRpc connection of a core so that
+ *                            a remote call can be issued without holding ipc_mutex.
+ *                            The connection is not deleted before dce_ipc_put().
+ *
+ * @ param core  [in]       : Remote core index.
+ * @ param conn  [in]       : Connection index in the pool of the core.
+ * @ return                 : MmRpc handle, NULL if the connection is not open.
+ */
+MmRpc_Handle dce_ipc_get(int core, int conn)
+{
+    MmRpc_Handle    handle = NULL;
+
+    pthread_mutex_lock(&ipc_mutex);
+    if( conn >= 0 && conn < __PoolActive[core] ) {
+        handle = __Conn[core][conn].handle;
+    }
+    if( handle != NULL ) {
+        pthread_mutex_lock(&__RpcIdleMutex);
+        __Conn[core][conn].inflight++;
+        pthread_mutex_unlock(&__RpcIdleMutex);
+    }
+    pthread_mutex_unlock(&ipc_mutex);
+
+    return (handle);
+}
+
+/*=====================================================================================*/
+/** dce_ipc_put             : Drop the reference taken by dce_ipc_get().
+ *
+ * @ param core  [in]       : Remote core index.
+ * @ param conn  [in]       : Connection index in the pool of the core.
+ */
+void dce_ipc_put(int core, int conn)
+{
+    pthread_mutex_lock(&__RpcIdleMutex);
+    if( --__Conn[core][conn].inflight == 0 ) {
+        pthread_cond_broadcast(&__RpcIdleCond);
+    }
+    pthread_mutex_unlock(&__RpcIdleMutex);
+}
+
+/* Drop the reference of a call cancelled by rpc_call_cancel() once it returned. The */
+/* last such call on a connection closed meanwhile deletes its handle.               */
+static void dce_ipc_put_abandoned(int core, int conn, MmRpc_Handle handle)
+{
+    dce_orphan  **po, *orphan = NULL;
+
+    pthread_mutex_lock(&__RpcIdleMutex);
+    for( po = &__Orphans; *po != NULL && (*po)->handle != handle; po = &((*po)->next) ) {
+        ;
+    }
+    if( *po != NULL ) {
+        if( --(*po)->inflight == 0 ) {
+            orphan = *po;
+            *po = orphan->next;
+        }
+    } else {
+        __Conn[core][conn].abandoned--;
+        if( --__Conn[core][conn].inflight == 0 ) {
+            pthread_cond_broadcast(&__RpcIdleCond);
+        }
+    }
+    pthread_mutex_unlock(&__RpcIdleMutex);
+
+    if( orphan ) {
+        MmRpc_delete(&(orphan->handle));
+        free(orphan);
+    }
+}
+
+/*=====================================================================================*/
+/** dce_ipc_epoch           : Number of times the connection pool of a core was closed,
+ *                            buffers registered in an earlier epoch are not any more.
+ *
+ * @ param core  [in]       : Remote core index.
+ * @ return                 : Epoch of the connection pool.
+ */
+int dce_ipc_epoch(int core)
+{
+    return (__atomic_load_n(&__PoolEpoch[core], __ATOMIC_ACQUIRE));
+}
+
+/***************** Remote call scheduler ****************/
+/* When dce_set_scheduler() limits the number of remote calls in flight on a core, */
+/* the calls waiting for a slot are granted by the priority class of their        */
+/* instance, in arrival order within a class. A lower class call which waited for  */
+/* longer than the starvation limit is granted first, so batch instances progress  */
+/* under a sustained realtime load. Without a limit calls are never delayed.       */
+struct sched_waiter;
+
+/* Scheduling state of a call which can be cancelled, guarded by sched_mutex */
+typedef struct sched_ticket {
+    struct sched_waiter *waiter;    /* waiting for a slot */
+    int                 slot;       /* holds a slot */
+    int                 cancelled;  /* see sched_cancel() */
+} sched_ticket;
+
+typedef struct sched_waiter {
+    struct sched_waiter *next;
+    struct timespec     since;
+    dce_priority        prio;
+    int                 granted;
+    int                 cancelled;
+    sched_ticket        *ticket;    /* NULL for a call which can't be cancelled */
+} sched_waiter;
+
+typedef struct {
+    int             max_inflight;   /* 0 for no limit */
+    uint32_t        starvation_us;
+    int             inflight;
+    sched_waiter    *head[DCE_PRIORITY_MAX];
+    sched_waiter    *tail[DCE_PRIORITY_MAX];
+} dce_sched;
+
+static dce_sched        __Sched[MAX_REMOTEDEVICES] = {
+    { 0, DCE_DEFAULT_STARVATION_US, 0, { NULL }, { NULL } },
+    { 0, DCE_DEFAULT_STARVATION_US, 0, { NULL }, { NULL } }
+};
+static pthread_mutex_t  sched_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   sched_cond = PTHREAD_COND_INITIALIZER;
+
+/* Pick the next waiter to grant: the oldest starving one of a lower class, else */
+/* the first one of the highest class. sched_mutex must be held.                */
+static sched_waiter *sched_next(dce_sched *s)
+{
+    struct timespec now;
+    sched_waiter    *w;
+    int             i, cls = -1;
+    uint32_t        waited, oldest = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for( i = DCE_PRIORITY_REALTIME + 1; i < DCE_PRIORITY_MAX; i++ ) {
+        if( s->head[i] == NULL ) {
+            continue;
+        }
+        waited = time_us(&(s->head[i]->since), &now);
+        if( waited >= s->starvation_us && (cls < 0 || waited > oldest) ) {
+            cls = i;
+            oldest = waited;
+        }
+    }
+    for( i = DCE_PRIORITY_REALTIME; cls < 0 && i < DCE_PRIORITY_MAX; i++ ) {
+        if( s->head[i] != NULL ) {
+            cls = i;
+        }
+    }
+    if( cls < 0 ) {
+        return (NULL);
+    }
+
+    w = s->head[cls];
+    s->head[cls] = w->next;
+    if( s->head[cls] == NULL ) {
+        s->tail[cls] = NULL;
+    }
+    return (w);
+}
+
+/* Hand the free slots to the waiters. sched_mutex must be held. */
+static void sched_grant(dce_sched *s)
+{
+    sched_waiter    *w;
+    int             granted = 0;
+
+    while( s->max_inflight == 0 || s->inflight < s->max_inflight ) {
+        w = sched_next(s);
+        if( w == NULL ) {
+            break;
+        }
+        w->granted = 1;
+        if( w->ticket ) {
+            w->ticket->slot = 1;
+        }
+        s->inflight++;
+        granted = 1;
+    }
+    if( granted ) {
+        pthread_cond_broadcast(&sched_cond);
+    }
+}
+
+/* Wait for a remote call slot on a core. Returns -1 without a slot if the call */
+/* was cancelled with sched_cancel() before it was granted one.                */
+static int sched_acquire(int core, dce_priority prio, sched_ticket *ticket)
+{
+    dce_sched       *s = &__Sched[core];
+    sched_waiter    w;
+    int             i, waiting = 0;
+
+    pthread_mutex_lock(&sched_mutex);
+    if( ticket && ticket->cancelled ) {
+        pthread_mutex_unlock(&sched_mutex);
+        return (-1);
+    }
+    for( i = 0; i < DCE_PRIORITY_MAX; i++ ) {
+        waiting |= (s->head[i] != NULL);
+    }
+    if( s->max_inflight == 0 || (s->inflight < s->max_inflight && !waiting) ) {
+        s->inflight++;
+        if( ticket ) {
+            ticket->slot = 1;
+        }
+        pthread_mutex_unlock(&sched_mutex);
+        return (0);
+    }
+
+    w.next = NULL;
+    w.prio = prio;
+    w.granted = 0;
+    w.cancelled = 0;
+    w.ticket = ticket;
+    clock_gettime(CLOCK_MONOTONIC, &w.since);
+    if( s->tail[prio] ) {
+        s->tail[prio]->next = &w;
+    } else {
+        s->head[prio] = &w;
+    }
+    s->tail[prio] = &w;
+    if( ticket ) {
+        ticket->waiter = &w;
+    }
+
+    while( !w.granted && !w.cancelled ) {
+        pthread_cond_wait(&sched_cond, &sched_mutex);
+    }
+    if( ticket ) {
+        ticket->waiter = NULL;
+    }
+    pthread_mutex_unlock(&sched_mutex);
+
+    return (w.granted ? 0 : -1);
+}
+
+/* Cancel the call of a ticket: a waiting call is dropped from its queue, a call */
+/* holding a slot gives it back. Returns 1 if the call held a slot.              */
+static int sched_cancel(int core, sched_ticket *ticket)
+{
+    dce_sched       *s = &__Sched[core];
+    sched_waiter    **pw, *w, *prev = NULL;
+    int             slot;
+
+    pthread_mutex_lock(&sched_mutex);
+    ticket->cancelled = 1;
+    slot = ticket->slot;
+    if( slot ) {
+        ticket->slot = 0;
+        s->inflight--;
+        sched_grant(s);
+    } else if( (w = ticket->waiter) != NULL ) {
+        for( pw = &s->head[w->prio]; *pw != w; pw = &((*pw)->next) ) {
+            prev = *pw;
+        }
+        *pw = w->next;
+        if( s->tail[w->prio] == w ) {
+            s->tail[w->prio] = prev;
+        }
+        w->cancelled = 1;
+        pthread_cond_broadcast(&sched_cond);
+    }
+    pthread_mutex_unlock(&sched_mutex);
+
+    return (slot);
+}
+
+/* Release the slot taken by sched_acquire() */
+static void sched_release(int core)
+{
+    dce_sched   *s = &__Sched[core];
+
+    pthread_mutex_lock(&sched_mutex);
+    s->inflight--;
+    sched_grant(s);
+    pthread_mutex_unlock(&sched_mutex);
+}
+
+/*=====================================================================================*/
+/** dce_set_scheduler       : Limit the remote calls in flight on a core so that the
+ *                            waiting calls are issued by priority class.
+ *
+ * @ param core          [in] : Remote core index (IPU or DSP).
+ * @ param max_inflight  [in] : Maximum number of calls in flight, 0 for no limit.
+ * @ param starvation_us [in] : Wait after which a lower class call goes first.
+ * @ return                   : Error Status.
+ */
+int dce_set_scheduler(int core, int max_inflight, unsigned int starvation_us)
+{
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(core >= 0 && core < MAX_REMOTEDEVICES, DCE_EINVALID_INPUT);
+    _ASSERT(max_inflight >= 0, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&sched_mutex);
+    __Sched[core].max_inflight = max_inflight;
+    __Sched[core].starvation_us = starvation_us;
+    /* A higher limit frees slots for the calls already waiting */
+    sched_grant(&__Sched[core]);
+    pthread_mutex_unlock(&sched_mutex);
+
+EXIT:
+    return (eError);
+}
+
+/***************** Call statistics ****************/
+/* Every remote call records the time spent waiting for its connection and     */
+/* scheduler slot, marshalling its arguments and in the MmRpc round trip. The   */
+/* durations go to log-linear histograms per call type, globally and per codec  */
+/* instance. Buckets are updated with relaxed atomics so recording takes no     */
+/* lock and readers only get a consistent snapshot of each single counter.     */
+typedef struct dce_stats {
+    dce_histogram   hist[DCE_STATS_CALLS][DCE_STATS_PHASES];
+} dce_stats;
+
+static dce_stats    __Stats;
+static int          __StatsEnabled = 1;
+
+/* Bucket of a duration: exact below 4 us, then 4 buckets per power of two */
+static inline int stats_bucket(uint32_t value)
+{
+    int     msb;
+
+    if( value < (1 << DCE_STATS_SUB_BITS) ) {
+        return (value);
+    }
+    msb = 31 - __builtin_clz(value);
+    return (((msb - DCE_STATS_SUB_BITS + 1) << DCE_STATS_SUB_BITS) +
+            ((value >> (msb - DCE_STATS_SUB_BITS)) & ((1 << DCE_STATS_SUB_BITS) - 1)));
+}
+
+/* Smallest duration of a bucket */
+static inline uint32_t stats_bucket_floor(int bucket)
+{
+    int     shift = (bucket >> DCE_STATS_SUB_BITS) - 1;
+
+    if( shift < 0 ) {
+        return (bucket);
+    }
+    return ((uint32_t)((1 << DCE_STATS_SUB_BITS) | (bucket & ((1 << DCE_STATS_SUB_BITS) - 1))) << shift);
+}
+
+static void stats_add(dce_histogram *h, uint32_t value)
+{
+    uint32_t    max = __atomic_load_n(&h->max_us, __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(&h->bucket[stats_bucket(value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->total_us, value, __ATOMIC_RELAXED);
+    while( value > max &&
+           !__atomic_compare_exchange_n(&h->max_us, &max, value, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED) ) {
+        ;
+    }
+}
+
+/* Record one phase of a call globally and for its instance (stats may be NULL) */
+static inline void stats_record(dce_stats *stats, int fxn, dce_stats_phase phase, uint32_t value)
+{
+    if( fxn < 0 || fxn >= DCE_STATS_CALLS ) {
+        return;
+    }
+    stats_add(&__Stats.hist[fxn][phase], value);
+    if( stats ) {
+        stats_add(&stats->hist[fxn][phase], value);
+    }
+}
+
+/* Start of the marshalling of a call, 0 when statistics are disabled */
+static inline uint64_t stats_start(void)
+{
+    return (__StatsEnabled ? now_us() : 0);
+}
+
+static void stats_copy(dce_histogram *to, dce_histogram *from)
+{
+    int     i;
+
+    to->count = __atomic_load_n(&from->count, __ATOMIC_RELAXED);
+    to->total_us = __atomic_load_n(&from->total_us, __ATOMIC_RELAXED);
+    to->max_us = __atomic_load_n(&from->max_us, __ATOMIC_RELAXED);
+    for( i = 0; i < DCE_STATS_BUCKETS; i++ ) {
+        to->bucket[i] = __atomic_load_n(&from->bucket[i], __ATOMIC_RELAXED);
+    }
+}
+
+/***************** RPC capture ****************/
+/* While a capture is running every MmRpc call is written to a file with the    */
+/* contents of the buffers it references, see dce_capture.h for the format and */
+/* tools/dce_replay.c to play it back. A record is built in memory before the  */
+/* call, so buffers are saved as the remote core gets them, and written once   */
+/* the call returned.                                                          */
+#define CAPTURE_INLINE_MAX  (64 * 1024) /* larger data buffers need DCE_CAPTURE_BUFFERS */
+
+typedef struct capture_rec {
+    char        *data;
+    size_t      len;
+    size_t      cap;
+    int         failed;
+} capture_rec;
+
+static FILE             *__CaptureFile = NULL;
+static int              __CaptureFlags = 0;
+static int              __CaptureEnabled = 0;
+static pthread_mutex_t  capture_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Append len bytes of src (zeroes for NULL) to the record */
+static void capture_put(capture_rec *rec, const void *src, size_t len)
+{
+    char    *data;
+    size_t  cap;
+
+    if( rec->failed ) {
+        return;
+    }
+    if( rec->len + len > rec->cap ) {
+        for( cap = rec->cap ? rec->cap : 1024; cap < rec->len + len; cap *= 2 ) {
+            ;
+        }
+        data = realloc(rec->data, cap);
+        if( data == NULL ) {
+            rec->failed = 1;
+            return;
+        }
+        rec->data = data;
+        rec->cap = cap;
+    }
+    if( src ) {
+        memcpy(rec->data + rec->len, src, len);
+    } else {
+        memset(rec->data + rec->len, 0, len);
+    }
+    rec->len += len;
+}
+
+/* Buffers are identified by the inode of their dma-buf, the handle elsewhere */
+static uint64_t capture_buf_id(size_t handle)
+{
+#if defined(BUILDOS_LINUX)
+    struct stat     st;
+
+    if( fstat((int)handle, &st) == 0 ) {
+        return ((uint64_t)st.st_ino);
+    }
+#endif
+    return ((uint64_t)handle);
+}
+
+/* Part of a buffer object referenced by a call. Small parameter buffers share */
+/* a buffer object (see memplugin_alloc()), so only the MemHeader and data of a */
+/* parameter buffer are saved, and a replay restores them without touching the  */
+/* parameter buffers of the other threads.                                      */
+typedef struct capture_seg {
+    size_t      handle;
+    uint64_t    id;
+    char        *src;       /* MemHeader of a parameter buffer, NULL for a data buffer */
+    uint32_t    offset;
+    uint32_t    length;
+} capture_seg;
+
+static uint32_t capture_buf_size(size_t handle)
+{
+#if defined(BUILDOS_LINUX)
+    off_t   size = lseek((int)handle, 0, SEEK_END);
+
+    return (size > 0 ? size : 0);
+#else
+    return (0);
+#endif
+}
+
+/* Parameter buffer with its data at data, offset bytes into its buffer object */
+static void capture_param_seg(capture_seg *seg, size_t handle, char *data, size_t offset)
+{
+    seg->handle = handle;
+    seg->id = capture_buf_id(handle);
+    seg->src = (char *)P2H(data);
+    seg->offset = offset - sizeof(MemHeader);
+    seg->length = GetSz(data);
+}
+
+/* Data buffer, saved as a whole */
+static void capture_data_seg(capture_seg *seg, size_t handle)
+{
+    seg->handle = handle;
+    seg->id = capture_buf_id(handle);
+    seg->src = NULL;
+    seg->offset = 0;
+    seg->length = 0;
+}
+
+/* Translation to a parameter buffer rather than to a data buffer. On Linux */
+/* data buffers are translated with their dma-buf fd as base.              */
+static inline int capture_xlt_param(MmRpc_Xlt *xlt)
+{
+#if defined(BUILDOS_LINUX)
+    return (xlt->base != xlt->handle && !dce_buf_imported((void *)xlt->base));
+#else
+    return (0);
+#endif
+}
+
+/* Append the descriptor of a segment followed by its contents. Data buffers */
+/* are saved when small or when contents is set.                             */
+static void capture_put_seg(capture_rec *rec, capture_seg *seg, int contents)
+{
+    dce_capture_buf     b = { seg->id, capture_buf_size(seg->handle), seg->offset, 0, 0 };
+#if defined(BUILDOS_LINUX)
+    void                *map;
+#endif
+
+    if( seg->src ) {
+        b.length = (b.size && seg->offset + seg->length > b.size) ? b.size - seg->offset : seg->length;
+        capture_put(rec, &b, sizeof(b));
+        capture_put(rec, seg->src, b.length);
+        return;
+    }
+#if defined(BUILDOS_LINUX)
+    if( b.size && (contents || b.size <= CAPTURE_INLINE_MAX) ) {
+        map = mmap(NULL, b.size, PROT_READ, MAP_SHARED, (int)seg->handle, 0);
+        if( map != MAP_FAILED ) {
+            b.length = b.size;
+            capture_put(rec, &b, sizeof(b));
+            capture_put(rec, map, b.size);
+            munmap(map, b.size);
+            return;
+        }
+    }
+#endif
+    capture_put(rec, &b, sizeof(b));
+}
+
+/* Start of the data of a Ptr or OffPtr parameter, NULL for a scalar */
+static char *capture_param_data(MmRpc_Param *p)
+{
+    if( p->type == MmRpc_ParamType_OffPtr ) {
+        return ((char *)p->param.offPtr.base + p->param.offPtr.offset);
+    }
+    if( p->type == MmRpc_ParamType_Ptr ) {
+        return ((char *)p->param.ptr.addr);
+    }
+    return (NULL);
+}
+
+/* Record a call about to be issued: parameters, translations and buffers */
+static void capture_begin(capture_rec *rec, int core, int conn, MmRpc_FxnCtx *ctx)
+{
+    dce_capture_call    call;
+    dce_capture_param   p;
+    dce_capture_xlt     x;
+    MmRpc_Param         *param;
+    MmRpc_Xlt           *xlt;
+    capture_seg         *seg;
+    char                *data, *value;
+    uint32_t            i, k, n = 0;
+
+    memset(&call, 0, sizeof(call));
+    call.thread = (uint64_t)pthread_self();
+    call.core = core;
+    call.conn = conn;
+    call.fxn_id = ctx->fxn_id;
+    call.num_params = ctx->num_params;
+    call.num_xlts = ctx->num_xlts;
+    capture_put(rec, &call, sizeof(call));
+
+    /* Every parameter and translation references at most one segment */
+    seg = malloc((ctx->num_params + ctx->num_xlts) * sizeof(capture_seg));
+    if( seg == NULL ) {
+        rec->failed = 1;
+        return;
+    }
+
+    for( i = 0; i < ctx->num_params; i++ ) {
+        param = &ctx->params[i];
+        memset(&p, 0, sizeof(p));
+        p.type = param->type;
+        if( param->type == MmRpc_ParamType_Scalar ) {
+            p.size = param->param.scalar.size;
+            p.data = param->param.scalar.data;
+        } else if( param->type == MmRpc_ParamType_OffPtr ) {
+            p.size = param->param.offPtr.size;
+            p.offset = param->param.offPtr.offset;
+            capture_param_seg(&seg[n], param->param.offPtr.handle, capture_param_data(param), p.offset);
+            p.buf_id = seg[n++].id;
+        } else {
+            p.size = param->param.ptr.size;
+            capture_data_seg(&seg[n], param->param.ptr.handle);
+            p.buf_id = seg[n++].id;
+        }
+        capture_put(rec, &p, sizeof(p));
+    }
+
+    for( i = 0; i < ctx->num_xlts; i++ ) {
+        xlt = &ctx->xltAry[i];
+        memset(&x, 0, sizeof(x));
+        x.index = xlt->index;
+        x.offset = xlt->offset;
+        data = xlt->index < ctx->num_params ? capture_param_data(&ctx->params[xlt->index]) : NULL;
+        value = data ? *(char **)(data + xlt->offset) : NULL;
+        x.delta = (int64_t)((size_t)value - xlt->base);
+        if( value && capture_xlt_param(xlt) ) {
+            capture_param_seg(&seg[n], xlt->handle, value, x.delta);
+        } else {
+            capture_data_seg(&seg[n], xlt->handle);
+        }
+        x.buf_id = seg[n++].id;
+        capture_put(rec, &x, sizeof(x));
+    }
+
+    /* Each segment once, data buffers only when small or asked */
+    for( i = 0; i < n; i++ ) {
+        for( k = 0; k < i && (seg[k].id != seg[i].id || seg[k].offset != seg[i].offset ||
+                              !seg[k].src != !seg[i].src); k++ ) {
+            ;
+        }
+        if( k == i ) {
+            capture_put_seg(rec, &seg[i], __CaptureFlags & DCE_CAPTURE_BUFFERS);
+            call.num_bufs++;
+        }
+    }
+    free(seg);
+
+    if( !rec->failed ) {
+        ((dce_capture_call *)rec->data)->num_bufs = call.num_bufs;
+        ((dce_capture_call *)rec->data)->start_us = now_us();
+    }
+}
+
+/* Complete the record with the result of the call and write it */
+static void capture_end(capture_rec *rec, int status, int32_t ret)
+{
+    dce_capture_call    *call = (dce_capture_call *)rec->data;
+
+    if( !rec->failed ) {
+        call->duration_us = now_us() - call->start_us;
+        call->status = status;
+        call->ret = ret;
+        pthread_mutex_lock(&capture_mutex);
+        if( __CaptureFile ) {
+            if( fwrite(rec->data, rec->len, 1, __CaptureFile) != 1 || fflush(__CaptureFile) ) {
+                ERROR("Failed to write the RPC capture, stopping it");
+                fclose(__CaptureFile);
+                __CaptureFile = NULL;
+                __CaptureEnabled = 0;
+            }
+        }
+        pthread_mutex_unlock(&capture_mutex);
+    } else {
+        ERROR("Out of memory, a call is missing from the RPC capture");
+    }
+    free(rec->data);
+}
+
+#if defined(BUILDOS_LINUX)
+/* Parameter buffer referenced by parameter i (translation i - num_params) of a */
+/* call, NULL for a scalar or a data buffer.                                     */
+static char *rpc_param_buf(MmRpc_FxnCtx *ctx, uint32_t i)
+{
+    MmRpc_Xlt   *xlt;
+    char        *data;
+
+    if( i < ctx->num_params ) {
+        return (ctx->params[i].type == MmRpc_ParamType_OffPtr ? capture_param_data(&ctx->params[i]) : NULL);
+    }
+    xlt = &ctx->xltAry[i - ctx->num_params];
+    if( !capture_xlt_param(xlt) || xlt->index >= ctx->num_params ||
+        (data = capture_param_data(&ctx->params[xlt->index])) == NULL ) {
+        return (NULL);
+    }
+    return (*(char **)(data + xlt->offset));
+}
+
+/* Hand the cached parameter buffers of a call to the remote core (device set) */
+/* before the call, and back to the CPU after it.                              */
+static void rpc_sync(MmRpc_FxnCtx *ctx, int device)
+{
+    char        *buf;
+    uint32_t    i;
+
+    for( i = 0; i < ctx->num_params + ctx->num_xlts; i++ ) {
+        if( (buf = rpc_param_buf(ctx, i)) != NULL ) {
+            memplugin_sync(buf, device);
+        }
+    }
+}
+#endif
+
+/* MmRpc_call() of every remote call, recorded while a capture is running.  */
+/* core is DCE_CAPTURE_CALLBACK for the calls to the row mode callback service. */
+static int dce_mmrpc_call(int core, int conn, MmRpc_Handle handle, MmRpc_FxnCtx *fxnCtx, int32_t *fxnRet)
+{
+    capture_rec     rec = { NULL, 0, 0, 0 };
+    int             eError, capture = __CaptureEnabled;
+#if defined(BUILDOS_LINUX)
+    int             cached = __atomic_load_n(&memplugin_cached, __ATOMIC_RELAXED);
+
+    if( cached ) {
+        rpc_sync(fxnCtx, 1);
+    }
+#endif
+    if( capture ) {
+        *fxnRet = 0;
+        capture_begin(&rec, core, conn, fxnCtx);
+    }
+    eError = MmRpc_call(handle, fxnCtx, fxnRet);
+    if( capture ) {
+        capture_end(&rec, eError, *fxnRet);
+    }
+#if defined(BUILDOS_LINUX)
+    if( cached ) {
+        rpc_sync(fxnCtx, 0);
+    }
+#endif
+
+    return (eError);
+}
+
+/* DCE_CAPTURE=<file> starts a capture with the first engine, DCE_CAPTURE_BUFFERS=1 */
+/* saves the contents of all the data buffers.                                      */
+static void capture_env_start(void)
+{
+    char    *path = getenv("DCE_CAPTURE");
+    char    *buffers = getenv("DCE_CAPTURE_BUFFERS");
+
+    if( path && *path ) {
+        dce_capture_start(path, (buffers && atoi(buffers)) ? DCE_CAPTURE_BUFFERS : 0);
+    }
+}
+
+/***************** Stuck call detection ****************/
+/* process() calls are tracked in rpc_calls from before they wait for a slot of   */
+/* the scheduler. While an instance has a call budget, the watchdog thread flags  */
+/* its calls running for longer. rpc_call_cancel() drops a call still waiting     */
+/* for a slot, and a call in flight gives back its slot at once, so a remote core */
+/* which never answers only blocks the thread issuing the call. The connection    */
+/* stays referenced until that call returns, see dce_ipc_put_abandoned().         */
+typedef struct rpc_call {
+    struct rpc_call     *next;
+    struct rpc_call     *prev;
+    void                *codec;
+    int                 core;
+    int                 conn;
+    struct timespec     start;
+    int                 flagged;    /* reported by the watchdog */
+    int                 abandoned;  /* cancelled by rpc_call_cancel() */
+    int                 watched;    /* listed for the watchdog and rpc_call_cancel() */
+    sched_ticket        ticket;
+    dce_stats           *stats;     /* histograms of the instance, NULL for none */
+    uint64_t            marshal_us; /* start of the marshalling, 0 if not measured */
+} rpc_call;
+
+#define DCE_WATCHDOG_PERIOD_US 10000
+
+static rpc_call         *rpc_calls = NULL;
+static pthread_mutex_t  rpc_calls_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int              __WatchdogRunning = 0;
+
+static void rpc_call_begin(rpc_call *call, void *codec, int core)
+{
+    call->codec = codec;
+    call->core = core;
+    call->conn = 0;
+    call->flagged = 0;
+    call->abandoned = 0;
+    call->watched = 1;
+    memset(&call->ticket, 0, sizeof(sched_ticket));
+    call->prev = NULL;
+    clock_gettime(CLOCK_MONOTONIC, &call->start);
+
+    pthread_mutex_lock(&rpc_calls_mutex);
+    call->next = rpc_calls;
+    if( rpc_calls ) {
+        rpc_calls->prev = call;
+    }
+    rpc_calls = call;
+    pthread_mutex_unlock(&rpc_calls_mutex);
+}
+
+/* Returns 1 if the call was cancelled while in flight */
+static int rpc_call_end(rpc_call *call)
+{
+    int     abandoned;
+
+    pthread_mutex_lock(&rpc_calls_mutex);
+    if( call->prev ) {
+        call->prev->next = call->next;
+    } else {
+        rpc_calls = call->next;
+    }
+    if( call->next ) {
+        call->next->prev = call->prev;
+    }
+    abandoned = call->abandoned;
+    pthread_mutex_unlock(&rpc_calls_mutex);
+
+    return (abandoned);
+}
+
+/* Cancel the call of a codec, if any: it is not issued if it still waits for */
+/* a slot, else its slot is given back and its connection is counted as       */
+/* abandoned until it returns, which dce_ipc_deinit() does not wait for.       */
+static void rpc_call_cancel(void *codec)
+{
+    rpc_call    *call;
+
+    pthread_mutex_lock(&rpc_calls_mutex);
+    for( call = rpc_calls; call != NULL; call = call->next ) {
+        if( call->codec == codec && !call->abandoned ) {
+            call->abandoned = 1;
+            if( sched_cancel(call->core, &call->ticket) ) {
+                pthread_mutex_lock(&__RpcIdleMutex);
+                __Conn[call->core][call->conn].abandoned++;
+                pthread_cond_broadcast(&__RpcIdleCond);
+                pthread_mutex_unlock(&__RpcIdleMutex);
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&rpc_calls_mutex);
+}
+
+/* The watchdog runs while at least one instance has a call budget */
+static void *watchdog_thread(void *arg)
+{
+    struct timespec period = { 0, DCE_WATCHDOG_PERIOD_US * 1000 };
+    struct timespec now;
+    rpc_call        *call;
+    dce_instance    *inst;
+    uint32_t        elapsed;
+
+    while( 1 ) {
+        nanosleep(&period, NULL);
+
+        pthread_mutex_lock(&rpc_calls_mutex);
+        pthread_mutex_lock(&ipc_mutex);
+        if( __BudgetCount == 0 ) {
+            pthread_mutex_unlock(&ipc_mutex);
+            __WatchdogRunning = 0;
+            pthread_mutex_unlock(&rpc_calls_mutex);
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        for( call = rpc_calls; call != NULL; call = call->next ) {
+            inst = (call->flagged || call->abandoned) ? NULL : get_instance(call->codec);
+            if( inst == NULL || inst->budget_us == 0 ) {
+                continue;
+            }
+            elapsed = time_us(&call->start, &now);
+            if( elapsed > inst->budget_us ) {
+                call->flagged = 1;
+                inst->overruns++;
+                ERROR("codec %p process call running for %u us, budget is %u us",
+                      call->codec, elapsed, inst->budget_us);
+            }
+        }
+        pthread_mutex_unlock(&ipc_mutex);
+        pthread_mutex_unlock(&rpc_calls_mutex);
+    }
+
+    return (NULL);
+}
+
+/* Start the watchdog unless it is running. ipc_mutex must not be held. */
+static void watchdog_start(void)
+{
+    pthread_t       thread;
+    pthread_attr_t  attr;
+
+    pthread_mutex_lock(&rpc_calls_mutex);
+    if( !__WatchdogRunning ) {
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if( pthread_create(&thread, &attr, watchdog_thread, NULL) == 0 ) {
+            __WatchdogRunning = 1;
+        } else {
+            ERROR("Failed to start the call watchdog");
+        }
+        pthread_attr_destroy(&attr);
+    }
+    pthread_mutex_unlock(&rpc_calls_mutex);
+}
+
+/*=====================================================================================*/
+/** dce_ipc_call_tracked    : Invoke a remote function on the given connection. ipc_mutex
+ *                            is only taken to reference the connection, so calls from
+ *                            different codec instances are in flight concurrently.
+ *
+ * @ param core    [in]     : Remote core index.
+ * @ param conn    [in]     : Connection index the caller is bound to.
+ * @ param prio    [in]     : Priority class of the caller, see sched_acquire().
+ * @ param call    [in]     : Record of the call. When listed with rpc_call_begin(), it is
+ *                            tracked by the watchdog and rpc_call_cancel() and removed
+ *                            on return. NULL for a call only counted in the global
+ *                            statistics.
+ * @ param fxnCtx  [in]     : Marshalled function context.
+ * @ param fxnRet  [out]    : Return value of the remote function.
+ * @ return                 : Error Status.
+ */
+static int dce_ipc_call_tracked(int core, int conn, dce_priority prio, rpc_call *call,
+                                MmRpc_FxnCtx *fxnCtx, int32_t *fxnRet)
+{
+    MmRpc_Handle    handle;
+    int             eError;
+    int             watched = (call != NULL && call->watched);
+    uint64_t        wait_us = 0, call_us = 0;
+
+    if( __StatsEnabled ) {
+        wait_us = now_us();
+    }
+    handle = dce_ipc_get(core, conn);
+    if( handle == NULL ) {
+        ERROR("No MmRpc connection %d on core %d", conn, core);
+        if( watched ) {
+            rpc_call_end(call);
+        }
+        return (DCE_EIPC_CALL_FAIL);
+    }
+
+    if( watched ) {
+        call->conn = conn;
+    }
+    if( sched_acquire(core, prio, watched ? &call->ticket : NULL) ) {
+        /* Cancelled while waiting for a slot, the call is not issued */
+        rpc_call_end(call);
+        dce_ipc_put(core, conn);
+        return (DCE_EIPC_CALL_FAIL);
+    }
+    if( wait_us ) {
+        call_us = now_us();
+    }
+    eError = dce_mmrpc_call(core, conn, handle, fxnCtx, fxnRet);
+    if( watched && rpc_call_end(call) ) {
+        /* Cancelled in flight: the slot was given back, the caller is gone */
+        dce_ipc_put_abandoned(core, conn, handle);
+        return (DCE_EIPC_CALL_FAIL);
+    }
+    sched_release(core);
+    dce_ipc_put(core, conn);
+
+    if( wait_us ) {
+        dce_stats   *stats = call ? call->stats : NULL;
+
+        if( call && call->marshal_us ) {
+            stats_record(stats, fxnCtx->fxn_id, DCE_STATS_MARSHAL, wait_us - call->marshal_us);
+        }
+        stats_record(stats, fxnCtx->fxn_id, DCE_STATS_LOCK_WAIT, call_us - wait_us);
+        stats_record(stats, fxnCtx->fxn_id, DCE_STATS_REMOTE, now_us() - call_us);
+    }
+
+    return (eError);
+}
+
+static inline int dce_ipc_call(int core, int conn, dce_priority prio, MmRpc_FxnCtx *fxnCtx, int32_t *fxnRet)
+{
+    return (dce_ipc_call_tracked(core, conn, prio, NULL, fxnCtx, fxnRet));
+}
+
+/*=====================================================================================*/
+/** dce_set_connection_pool : Configure the pool of MmRpc connections of a core.
+ *
+ * @ param core   [in]      : Remote core index (IPU or DSP).
+ * @ param size   [in]      : Number of connections, 1 to DCE_MAX_CONNECTIONS.
+ * @ param policy [in]      : How engines are bound to the connections.
+ * @ return                 : Error Status.
+ */
+int dce_set_connection_pool(int core, int size, dce_pool_policy policy)
+{
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(core >= 0 && core < MAX_REMOTEDEVICES, DCE_EINVALID_INPUT);
+    _ASSERT(size > 0 && size <= DCE_MAX_CONNECTIONS, DCE_EINVALID_INPUT);
+    _ASSERT(policy == DCE_POOL_ROUND_ROBIN || policy == DCE_POOL_LEAST_LOADED, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&ipc_mutex);
+    /* The pool of a core is created by its first client */
+    if( __ClientCount[core] > 0 ) {
+        eError = DCE_EXDM_UNSUPPORTED;
+    } else {
+        __PoolSize[core] = size;
+        __PoolPolicy[core] = policy;
+    }
+    pthread_mutex_unlock(&ipc_mutex);
+    _ASSERT(eError == DCE_EOK, DCE_EXDM_UNSUPPORTED);
+
+EXIT:
+    return (eError);
+}
+
+/***************** Asynchronous process dispatcher ****************/
+/* Every codec instance gets a dispatcher thread on its first *_processAsync() */
+/* call, which issues the process calls of that instance in submission order:  */
+/* calls of different instances, on the same core or not, run concurrently.    */
+/* Completed calls are kept in a completion queue until the application reaps */
+/* them with *_processWait(). A call is identified by its outArgs, which must  */
+/* be unique per call.                                                          */
+typedef struct async_call {
+    struct async_call   *next;
+    void                *codec;
+    dce_codec_type      codec_id;
+    void                *inBufs;
+    void                *outBufs;
+    void                *inArgs;
+    void                *outArgs;
+    XDAS_Int32          ret;
+} async_call;
+
+typedef struct async_dispatcher {
+    struct async_dispatcher *next;  /* list of the dispatchers being stopped */
+    pthread_t           thread;
+    int                 core;
+    int                 running;
+    pthread_cond_t      submit_cond;
+    pthread_cond_t      done_cond;
+    async_call          *pending_head;  /* head is the call being processed */
+    async_call          *pending_tail;
+    async_call          *done_head;
+    async_call          *done_tail;
+} async_dispatcher;
+
+static dce_map              async_map;  /* codec handle -> async_dispatcher */
+static pthread_mutex_t      async_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void *async_dispatch_thread(void *arg)
+{
+    async_dispatcher    *d = (async_dispatcher *) arg;
+    async_call          *call;
+
+    pthread_mutex_lock(&async_mutex);
+    while( 1 ) {
+        while( d->pending_head == NULL && d->running ) {
+            pthread_cond_wait(&d->submit_cond, &async_mutex);
+        }
+        if( d->pending_head == NULL ) {
+            /* Stop requested and every submitted call has been processed */
+            break;
+        }
+        call = d->pending_head;
+        pthread_mutex_unlock(&async_mutex);
+
+        if( call->codec_id == OMAP_DCE_VIDDEC3 ) {
+            call->ret = VIDDEC3_process(call->codec, call->inBufs, call->outBufs, call->inArgs, call->outArgs);
+        } else {
+            call->ret = VIDENC2_process(call->codec, call->inBufs, call->outBufs, call->inArgs, call->outArgs);
+        }
+
+        pthread_mutex_lock(&async_mutex);
+        d->pending_head = call->next;
+        if( d->pending_head == NULL ) {
+            d->pending_tail = NULL;
+        }
+        call->next = NULL;
+        if( d->done_tail ) {
+            d->done_tail->next = call;
+        } else {
+            d->done_head = call;
+        }
+        d->done_tail = call;
+        pthread_cond_broadcast(&d->done_cond);
+    }
+    pthread_mutex_unlock(&async_mutex);
+
+    return (NULL);
+}
+
+/* Dispatcher of a codec, NULL if it has none. Must be called with async_mutex held. */
+static inline async_dispatcher *async_dispatcher_of(void *codec)
+{
+    dce_map_entry   *e = dce_map_find(&async_map, codec);
+
+    return (e ? (async_dispatcher *)e->value : NULL);
+}
+
+/* Join a dispatcher removed from async_map and drop the completions nobody reaped */
+static void async_destroy(async_dispatcher *d)
+{
+    async_call  *call;
+
+    pthread_join(d->thread, NULL);
+    while( (call = d->done_head) != NULL ) {
+        d->done_head = call->next;
+        free(call);
+    }
+    pthread_cond_destroy(&d->submit_cond);
+    pthread_cond_destroy(&d->done_cond);
+    free(d);
+}
+
+/*===============================================================*/
+/** async_submit        : Queue a process call on the dispatcher of the codec,
+ *                        starting the dispatcher on first use.
+ *
+ * @ return : Error Status.
+ */
+static XDAS_Int32 async_submit(void *codec, void *inBufs, void *outBufs, void *inArgs,
+                               void *outArgs, dce_codec_type codec_id)
+{
+    async_dispatcher    *d;
+    async_call          *call = NULL;
+    dce_error_status    eError = DCE_EOK;
+    int                 coreIdx;
+
+    _ASSERT(codec != NULL, DCE_EINVALID_INPUT);
+    _ASSERT(outArgs != NULL, DCE_EINVALID_INPUT);
+
+    coreIdx = getCoreIndexFromCodec(codec_id);
     _ASSERT(coreIdx != INVALID_CORE, DCE_EINVALID_INPUT);
-    /* Initialize IPC. In case of Error Deinitialize them */
-    _ASSERT(dce_ipc_init(coreIdx) == DCE_EOK, DCE_EIPC_CREATE_FAIL);
 
-    INFO(">> Engine_open Params::name = %s size = %d\n", name, strlen(name));
-    /* Allocate Shared memory for the engine_open rpc msg structure*/
-    /* Tiler Memory preferred in QNX */
-    engine_open_msg = memplugin_alloc(sizeof(dce_engine_open), 1, DEFAULT_REGION, 0, coreIdx);
-    _ASSERT_AND_EXECUTE(engine_open_msg != NULL, DCE_EOUT_OF_MEMORY, engine_handle = NULL);
+    call = malloc(sizeof(async_call));
+    _ASSERT(call != NULL, DCE_EOUT_OF_MEMORY);
+
+    call->next = NULL;
+    call->codec = codec;
+    call->codec_id = codec_id;
+    call->inBufs = inBufs;
+    call->outBufs = outBufs;
+    call->inArgs = inArgs;
+    call->outArgs = outArgs;
+    call->ret = DCE_EXDM_FAIL;
+
+    pthread_mutex_lock(&async_mutex);
+    d = async_dispatcher_of(codec);
+    if( d == NULL ) {
+        d = calloc(1, sizeof(async_dispatcher));
+        if( d == NULL || dce_map_put(&async_map, codec, d) != DCE_EOK ) {
+            pthread_mutex_unlock(&async_mutex);
+            free(d);
+            free(call);
+            eError = DCE_EOUT_OF_MEMORY;
+            goto EXIT;
+        }
+        d->core = coreIdx;
+        d->running = 1;
+        pthread_cond_init(&d->submit_cond, NULL);
+        pthread_cond_init(&d->done_cond, NULL);
+        if( pthread_create(&d->thread, NULL, async_dispatch_thread, d) ) {
+            dce_map_remove(&async_map, codec);
+            pthread_mutex_unlock(&async_mutex);
+            pthread_cond_destroy(&d->submit_cond);
+            pthread_cond_destroy(&d->done_cond);
+            free(d);
+            free(call);
+            ERROR("Failed to start the process dispatcher of codec %p", codec);
+            eError = DCE_EXDM_FAIL;
+            goto EXIT;
+        }
+    }
+
+    if( d->pending_tail ) {
+        d->pending_tail->next = call;
+    } else {
+        d->pending_head = call;
+    }
+    d->pending_tail = call;
+    pthread_cond_signal(&d->submit_cond);
+    pthread_mutex_unlock(&async_mutex);
+
+    DEBUG("codec %p outArgs %p queued on core %d", codec, outArgs, coreIdx);
+
+EXIT:
+    return (eError);
+}
+
+/* Look for a call of codec (and outArgs unless NULL) in a queue. Returns the */
+/* entry and its predecessor, NULL if not present.                           */
+static async_call *async_find(async_call *head, void *codec, void *outArgs, async_call **prev)
+{
+    async_call  *call;
+
+    *prev = NULL;
+    for( call = head; call != NULL; *prev = call, call = call->next ) {
+        if( call->codec == codec && (outArgs == NULL || call->outArgs == outArgs) ) {
+            return (call);
+        }
+    }
+    return (NULL);
+}
+
+/*===============================================================*/
+/** async_wait          : Wait for a call submitted by async_submit() to complete and
+ *                        remove it from the completion queue.
+ *
+ * @ param outArgs [in]    : outArgs of the call to wait for, or NULL to reap the
+ *                           oldest completed call of the codec.
+ * @ param timeout [in]    : Timeout in microseconds or VISA_FOREVER.
+ * @ return : Return value of the process call, VISA_ETIMEOUT if it did not complete
+ *            in time, DCE_EINVALID_INPUT if no matching call is outstanding.
+ */
+static XDAS_Int32 async_wait(void *codec, dce_codec_type codec_id, void *outArgs, UInt timeout)
+{
+    async_dispatcher    *d;
+    async_call          *call = NULL, *prev, *unused;
+    struct timespec     abstime;
+    XDAS_Int32          ret = DCE_EOK;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(codec != NULL, DCE_EINVALID_INPUT);
+    _ASSERT(getCoreIndexFromCodec(codec_id) != INVALID_CORE, DCE_EINVALID_INPUT);
+
+    if( timeout != VISA_FOREVER ) {
+        deadline_us(&abstime, timeout);
+    }
+
+    pthread_mutex_lock(&async_mutex);
+    d = async_dispatcher_of(codec);
+    while( d != NULL ) {
+        call = async_find(d->done_head, codec, outArgs, &prev);
+        if( call ) {
+            if( prev ) {
+                prev->next = call->next;
+            } else {
+                d->done_head = call->next;
+            }
+            if( d->done_tail == call ) {
+                d->done_tail = prev;
+            }
+            break;
+        }
+        if( async_find(d->pending_head, codec, outArgs, &unused) == NULL ) {
+            break;
+        }
+        if( timeout == VISA_FOREVER ) {
+            pthread_cond_wait(&d->done_cond, &async_mutex);
+        } else if( pthread_cond_timedwait(&d->done_cond, &async_mutex, &abstime) == ETIMEDOUT ) {
+            pthread_mutex_unlock(&async_mutex);
+            return (VISA_ETIMEOUT);
+        }
+    }
+    pthread_mutex_unlock(&async_mutex);
+    /* Nothing outstanding that could satisfy the wait */
+    _ASSERT(d != NULL && call != NULL, DCE_EINVALID_INPUT);
+
+    ret = call->ret;
+    free(call);
+    return (ret);
+
+EXIT:
+    return (eError);
+}
+
+/* Wait for the outstanding asynchronous calls of a codec being deleted, then */
+/* stop its dispatcher and drop the completions the application did not reap. */
+static void async_flush(void *codec, dce_codec_type codec_id)
+{
+    async_dispatcher    *d;
+
+    (void) codec_id;
+    pthread_mutex_lock(&async_mutex);
+    d = async_dispatcher_of(codec);
+    if( d == NULL ) {
+        pthread_mutex_unlock(&async_mutex);
+        return;
+    }
+    while( d->pending_head != NULL ) {
+        pthread_cond_wait(&d->done_cond, &async_mutex);
+    }
+    dce_map_remove(&async_map, codec);
+    d->running = 0;
+    pthread_cond_signal(&d->submit_cond);
+    pthread_mutex_unlock(&async_mutex);
+
+    async_destroy(d);
+}
+
+/* Stop the dispatchers left on a core once its last engine is closed, */
+/* for codecs the application did not delete.                          */
+static void async_stop(int core)
+{
+    async_dispatcher    *d, *stopped = NULL;
+    dce_map_entry       *e;
+    unsigned int        i;
+
+    pthread_mutex_lock(&async_mutex);
+    do {
+        d = NULL;
+        for( i = 0; i < async_map.size && d == NULL; i++ ) {
+            for( e = async_map.bucket[i]; e != NULL; e = e->next ) {
+                if( ((async_dispatcher *)e->value)->core == core ) {
+                    d = e->value;
+                    break;
+                }
+            }
+        }
+        if( d ) {
+            dce_map_remove(&async_map, e->key);
+            d->running = 0;
+            pthread_cond_signal(&d->submit_cond);
+            d->next = stopped;
+            stopped = d;
+        }
+    } while( d != NULL );
+    pthread_mutex_unlock(&async_mutex);
+
+    while( (d = stopped) != NULL ) {
+        stopped = d->next;
+        async_destroy(d);
+    }
+}
+
+/*===============================================================*/
+/** Engine_open        : Open Codec Engine.
+ *
+ * @ param attrs  [in]      : Engine Attributes. This param is not passed to Remote core.
+ * @ param name [in]        : Name of Encoder or Decoder codec.
+ * @ param ec [out]         : Error returned by Codec Engine.
+ * @ return : Codec Engine Handle is returned to be used to create codec.
+ *                 In case of error, NULL is returned as Engine Handle.
+ */
+Engine_Handle Engine_open(String name, Engine_Attrs *attrs, Engine_Error *ec)
+{
+    MmRpc_FxnCtx        fxnCtx;
+    dce_error_status    eError = DCE_EOK;
+    dce_engine_open     *engine_open_msg = NULL;
+    Engine_Attrs        *engine_attrs = NULL;
+    Engine_Handle       engine_handle = NULL;
+    dce_engine          *engine_rec = NULL;
+    int                 coreIdx   = INVALID_CORE;
+
+    DEBUG("START Engine_open ipc_mutex 0x%x", (unsigned int) &ipc_mutex);
+
+    _ASSERT(name != '\0', DCE_EINVALID_INPUT);
+
+    coreIdx = getCoreIndexFromName(name);
+    _ASSERT(coreIdx != INVALID_CORE, DCE_EINVALID_INPUT);
+
+    engine_rec = malloc(sizeof(dce_engine));
+    _ASSERT(engine_rec != NULL, DCE_EOUT_OF_MEMORY);
+    engine_rec->core = coreIdx;
+    engine_rec->conn = -1;
+
+    /* Initialize IPC and bind the engine to a connection of the pool */
+    pthread_mutex_lock(&ipc_mutex);
+    eError = dce_ipc_init(coreIdx);
+    if( eError == DCE_EOK ) {
+        engine_rec->conn = dce_ipc_bind(coreIdx);
+    }
+    pthread_mutex_unlock(&ipc_mutex);
+    _ASSERT(eError == DCE_EOK, DCE_EIPC_CREATE_FAIL);
+
+    INFO(">> Engine_open Params::name = %s size = %zu\n", name, strlen(name));
+    /* Allocate Shared memory for the engine_open rpc msg structure*/
+    /* Tiler Memory preferred in QNX */
+    engine_open_msg = memplugin_alloc(sizeof(dce_engine_open), 1, DEFAULT_REGION, 0, coreIdx);
+    _ASSERT_AND_EXECUTE(engine_open_msg != NULL, DCE_EOUT_OF_MEMORY, engine_handle = NULL);
+
+    if( attrs ) {
+         engine_attrs = memplugin_alloc(sizeof(Engine_Attrs), 1, DEFAULT_REGION, 0, coreIdx);
+         _ASSERT_AND_EXECUTE(engine_attrs != NULL, DCE_EOUT_OF_MEMORY, engine_handle = NULL);
+         *engine_attrs = *attrs;
+    }
+    /* Populating the msg structure with all the params */
+    /* Populating all params into a struct avoid individual address translations of name, ec */
+    strncpy(engine_open_msg->name, name, strlen(name));
+    engine_open_msg->engine_attrs = engine_attrs;
+
+    /* Marshall function arguments into the send buffer */
+    Fill_MmRpc_fxnCtx(&fxnCtx, DCE_RPC_ENGINE_OPEN, 1, 0, NULL);
+    Fill_MmRpc_fxnCtx_OffPtr_Params(fxnCtx.params, GetSz(engine_open_msg), GetBase(engine_open_msg),
+                                    GetOffset(engine_open_msg), memplugin_share(engine_open_msg));
+
+    /* Invoke the Remote function through MmRpc */
+    eError = dce_ipc_call(coreIdx, engine_rec->conn, DCE_PRIORITY_INTERACTIVE, &fxnCtx, (int32_t *)(&engine_handle));
+
+    if( ec ) {
+         *ec = engine_open_msg->error_code;
+    }
+    /* In case of Error, the Application will get a NULL Engine Handle */
+    _ASSERT_AND_EXECUTE(eError == DCE_EOK, DCE_EIPC_CALL_FAIL, engine_handle = NULL);
+
+    /*Update table*/
+    pthread_mutex_lock(&ipc_mutex);
+    eError = update_clients_table(engine_handle, engine_rec);
+    pthread_mutex_unlock(&ipc_mutex);
+    _ASSERT(eError == DCE_EOK, DCE_EOUT_OF_MEMORY);
+    engine_rec = NULL;
+
+EXIT:
+    if( engine_rec ) {
+        if( engine_rec->conn >= 0 ) {
+            pthread_mutex_lock(&ipc_mutex);
+            dce_ipc_unbind(coreIdx, engine_rec->conn);
+            pthread_mutex_unlock(&ipc_mutex);
+        }
+        free(engine_rec);
+    }
+    memplugin_free(engine_open_msg);
+
+    if( engine_attrs ) {
+         memplugin_free(engine_attrs);
+    }
+    DEBUG("END Engine_open ipc_mutex 0x%x", (unsigned int) &ipc_mutex);
+
+    return ((Engine_Handle)engine_handle);
+}
+
+/*===============================================================*/
+/** Engine_close           : Close Engine.
+ *
+ * @ param engine  [in]    : Engine Handle obtained in Engine_open() call.
+ */
+Void Engine_close(Engine_Handle engine)
+{
+    MmRpc_FxnCtx        fxnCtx;
+    int32_t             fxnRet;
+    dce_error_status    eError = DCE_EOK;
+    int32_t             coreIdx = INVALID_CORE;
+    int                 conn = 0;
+    int                 lastClient = 0;
+
+    _ASSERT(engine != NULL, DCE_EINVALID_INPUT);
+
+    /* Marshall function arguments into the send buffer */
+    Fill_MmRpc_fxnCtx(&fxnCtx, DCE_RPC_ENGINE_CLOSE, 1, 0, NULL);
+    Fill_MmRpc_fxnCtx_Scalar_Params(fxnCtx.params, sizeof(Engine_Handle), (int32_t)engine);
 
-    if( attrs ) {
-         engine_attrs = memplugin_alloc(sizeof(Engine_Attrs), 1, DEFAULT_REGION, 0, coreIdx);
-         _ASSERT_AND_EXECUTE(engine_attrs != NULL, DCE_EOUT_OF_MEMORY, engine_handle = NULL);
-         *engine_attrs = *attrs;
+    pthread_mutex_lock(&ipc_mutex);
+    coreIdx = getCoreIndexFromEngine(engine, &conn);
+    pthread_mutex_unlock(&ipc_mutex);
+    _ASSERT(coreIdx != INVALID_CORE,DCE_EINVALID_INPUT);
+
+    /* Invoke the Remote function through MmRpc */
+    eError = dce_ipc_call(coreIdx, conn, DCE_PRIORITY_INTERACTIVE, &fxnCtx, &fxnRet);
+    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+
+EXIT:
+    if( coreIdx != INVALID_CORE ) {
+        pthread_mutex_lock(&ipc_mutex);
+        free(dce_map_remove(&engine_map, engine));
+        dce_ipc_unbind(coreIdx, conn);
+        dce_ipc_deinit(coreIdx, -1);
+        lastClient = (__ClientCount[coreIdx] == 0);
+        pthread_mutex_unlock(&ipc_mutex);
+
+        if( lastClient ) {
+            async_stop(coreIdx);
+        }
     }
-    /* Populating the msg structure with all the params */
-    /* Populating all params into a struct avoid individual address translations of name, ec */
-    strncpy(engine_open_msg->name, name, strlen(name));
-    engine_open_msg->engine_attrs = engine_attrs;
+
+    return;
+}
+
+ /*===============================================================*/
+/** rproc_info     : Query information of a remote core on one of its connections.
+ *
+ * @ param prio      [in]    : Priority class of the query.
+ * @ param info_type [in]    : Information type as defined in the rproc_info_type
+ * @ param value     [out]   : Returned information.
+ * @ return                  : Error Status.
+ */
+static int rproc_info(int core, int conn, dce_priority prio, rproc_info_type info_type, int32_t *value)
+{
+    MmRpc_FxnCtx        fxnCtx;
 
     /* Marshall function arguments into the send buffer */
-    Fill_MmRpc_fxnCtx(&fxnCtx, DCE_RPC_ENGINE_OPEN, 1, 0, NULL);
-    Fill_MmRpc_fxnCtx_OffPtr_Params(fxnCtx.params, GetSz(engine_open_msg), (void *)P2H(engine_open_msg),
-                                    sizeof(MemHeader), memplugin_share(engine_open_msg));
+    Fill_MmRpc_fxnCtx(&fxnCtx, DCE_RPC_GET_INFO, 1, 0, NULL);
+    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[0]), sizeof(rproc_info_type), (int32_t)info_type);
 
     /* Invoke the Remote function through MmRpc */
-    eError = MmRpc_call(MmRpcHandle[coreIdx], &fxnCtx, (int32_t *)(&engine_handle));
+    return (dce_ipc_call(core, conn, prio, &fxnCtx, value));
+}
 
-    if( ec ) {
-         *ec = engine_open_msg->error_code;
+ /*===============================================================*/
+/** get_rproc_info : Get Information from the Remote proc.
+ *
+ * @ param engine    [in]    : Engine Handle obtained in Engine_open() call.
+ * @ param info_type [in]    : Information type as defined in the rproc_info_type
++ */
+int32_t get_rproc_info(Engine_Handle engine, rproc_info_type info_type)
+{
+    int32_t             fxnRet = 0;
+    dce_error_status    eError = DCE_EOK;
+    int32_t             coreIdx = INVALID_CORE;
+    int                 conn = 0;
+
+    _ASSERT(engine != NULL, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&ipc_mutex);
+    coreIdx = getCoreIndexFromEngine(engine, &conn);
+    pthread_mutex_unlock(&ipc_mutex);
+    _ASSERT(coreIdx != INVALID_CORE,DCE_EINVALID_INPUT);
+
+    eError = rproc_info(coreIdx, conn, DCE_PRIORITY_INTERACTIVE, info_type, &fxnRet);
+    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+
+EXIT:
+    return fxnRet;
+}
+
+
+/* How the value of a translated descriptor field maps to the xlt base/handle */
+typedef enum xlt_type {
+    XLT_DATA_BUF = 0,   /* data buffer: the field is the buffer handle itself */
+    XLT_MEMHEADER,      /* data buffer described by a MemHeader (Android, Linux imports) */
+    XLT_PARAM_BUF       /* parameter buffer allocated with memplugin_alloc */
+} xlt_type;
+
+/* Pre-marshalled process() context of a codec instance. The params and the    */
+/* xlt index/offset only depend on the descriptor shape, so they are built     */
+/* once and only the base/handle of the buffers that changed are patched.      */
+typedef struct process_ctx {
+    int             valid;
+    /* Descriptor shape the context was built for */
+    void            *inBufs;
+    void            *outBufs;
+    void            *inArgs;
+    void            *outArgs;
+    void            *outBufPtrs;    /* VIDDEC2 outBufs->bufs */
+    int             numInBufs;
+    int             numOutBufs;
+    /* Marshalled call */
+    MmRpc_FxnCtx    fxnCtx;
+    MmRpc_Xlt       xltAry[MAX_TOTAL_BUF];
+    void            **field[MAX_TOTAL_BUF];
+    xlt_type        type[MAX_TOTAL_BUF];
+#if defined(BUILDOS_LINUX)
+    uint64_t        reg[MAX_TOTAL_BUF];     /* registration cache entries of the data buffers */
+    /* Data buffers the codec still uses after its process() call returned, */
+    /* by inputID until the codec lists it in freeBufID                     */
+    struct {
+        XDAS_Int32  id;                     /* 0 for a free slot */
+        int         num;
+        uint64_t    ref[MAX_OUTPUT_BUF];
+    } held[IVIDEO2_MAX_IO_BUFFERS];
+#endif
+} process_ctx;
+
+/* Connection (-1 once failed), priority class and statistics of a codec, and its process */
+/* context when pctx is not NULL                                                          */
+static int get_codec_conn(void *codec, process_ctx **pctx, dce_priority *prio, dce_stats **stats)
+{
+    dce_instance    *inst;
+    int             conn = 0;
+
+    pthread_mutex_lock(&ipc_mutex);
+    inst = get_instance(codec);
+    *prio = inst ? inst->priority : DCE_PRIORITY_INTERACTIVE;
+    *stats = inst ? inst->stats : NULL;
+    if( inst ) {
+        /* No remote call is issued for a failed instance */
+        conn = inst->failed ? -1 : inst->conn;
     }
-    /* In case of Error, the Application will get a NULL Engine Handle */
-    _ASSERT_AND_EXECUTE(eError == DCE_EOK, DCE_EIPC_CALL_FAIL, engine_handle = NULL);
+    if( pctx ) {
+        *pctx = inst ? inst->pctx : NULL;
+    }
+    pthread_mutex_unlock(&ipc_mutex);
 
-    /*Update table*/
-    tabIdx = update_clients_table(engine_handle, coreIdx);
-    _ASSERT((tabIdx != -1), DCE_EINVALID_INPUT);
+    return (conn);
+}
+
+/***************** Control cache ****************/
+/* XDM_GETBUFINFO and XDM_GETVERSION only change with the codec configuration.  */
+/* When enabled with dce_set_control_cache(), their last result is kept and    */
+/* returned without a remote call until a control command which is not a query */
+/* or a process() call reporting an error or a parameter change invalidates it. */
+typedef struct {
+    int             valid;
+    XDAS_Int32      ret;
+    size_t          size;       /* size of the status buffer */
+    void            *status;    /* copy of the status */
+    size_t          versionLen;
+    char            *version;   /* copy of status->data.buf for XDM_GETVERSION */
+} control_cache_entry;
+
+typedef struct control_cache {
+    int                 refs;       /* the instance and the calls using it, guarded by ipc_mutex */
+    pthread_mutex_t     lock;
+    unsigned int        generation; /* incremented by every invalidation */
+    control_cache_entry bufinfo;
+    control_cache_entry version;
+    XDAS_UInt32         hits;
+    XDAS_UInt32         misses;
+} control_cache;
+
+/* Buffer descriptor for data passing, common to the status of all codec classes */
+static XDM1_SingleBufDesc *status_data(void *status, dce_codec_type codec_id)
+{
+    if( codec_id == OMAP_DCE_VIDDEC3 ) {
+        return (&(((IVIDDEC3_Status *)status)->data));
+    } else if( codec_id == OMAP_DCE_VIDENC2 ) {
+        return (&(((IVIDENC2_Status *)status)->data));
+    } else if( codec_id == OMAP_DCE_VIDDEC2 ) {
+        return (&(((IVIDDEC2_Status *)status)->data));
+    }
+    return (NULL);
+}
+
+/* Control cache of a codec with a reference the caller drops with control_cache_put(), */
+/* NULL when disabled. It stays usable if the cache is disabled or the codec deleted.   */
+static control_cache *control_cache_of(void *codec)
+{
+    dce_instance    *inst;
+    control_cache   *cache = NULL;
+
+    pthread_mutex_lock(&ipc_mutex);
+    inst = get_instance(codec);
+    if( inst && inst->ccache ) {
+        cache = inst->ccache;
+        cache->refs++;
+    }
+    pthread_mutex_unlock(&ipc_mutex);
+
+    return (cache);
+}
+
+static control_cache_entry *control_cache_entry_of(control_cache *cache, int id)
+{
+    if( id == XDM_GETBUFINFO ) {
+        return (&cache->bufinfo);
+    } else if( id == XDM_GETVERSION ) {
+        return (&cache->version);
+    }
+    return (NULL);
+}
+
+static void control_cache_clear(control_cache_entry *entry)
+{
+    free(entry->status);
+    free(entry->version);
+    memset(entry, 0, sizeof(*entry));
+}
+
+static void control_cache_free(control_cache *cache)
+{
+    if( cache ) {
+        control_cache_clear(&cache->bufinfo);
+        control_cache_clear(&cache->version);
+        pthread_mutex_destroy(&cache->lock);
+        free(cache);
+    }
+}
+
+/* Answer a query from the cache. Returns 1 on a hit with *ret set, otherwise */
+/* the generation to pass to control_cache_fill() with the remote result.    */
+static int control_cache_lookup(control_cache *cache, int id, void *status,
+                                dce_codec_type codec_id, XDAS_Int32 *ret, unsigned int *generation)
+{
+    control_cache_entry *entry = control_cache_entry_of(cache, id);
+    XDM1_SingleBufDesc  *data = status_data(status, codec_id);
+    XDM1_SingleBufDesc  client_data;
+    int                 hit = 0;
+
+    if( entry == NULL ) {
+        return (0);
+    }
+    pthread_mutex_lock(&cache->lock);
+    *generation = cache->generation;
+    if( entry->valid && entry->size == GetSz(status) &&
+        (entry->version == NULL || (data->buf != NULL && (size_t)data->bufSize >= entry->versionLen)) ) {
+        /* The data descriptor belongs to the caller */
+        client_data = *data;
+        memcpy(status, entry->status, entry->size);
+        *data = client_data;
+        if( entry->version ) {
+            memcpy(data->buf, entry->version, entry->versionLen);
+        }
+        *ret = entry->ret;
+        hit = 1;
+        cache->hits++;
+    } else {
+        cache->misses++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return (hit);
+}
+
+/* Keep the result of a query unless the cache was invalidated since generation */
+static void control_cache_fill(control_cache *cache, unsigned int generation, int id,
+                               void *status, dce_codec_type codec_id, XDAS_Int32 ret)
+{
+    control_cache_entry *entry = control_cache_entry_of(cache, id);
+    XDM1_SingleBufDesc  *data = status_data(status, codec_id);
+    size_t              size = GetSz(status);
+    void                *copy;
+    char                *version = NULL;
+    size_t              versionLen = 0;
+
+    if( entry == NULL || ret != XDM_EOK ) {
+        return;
+    }
+    copy = malloc(size);
+    if( copy == NULL ) {
+        return;
+    }
+    memcpy(copy, status, size);
+    if( id == XDM_GETVERSION ) {
+        versionLen = strnlen((char *)data->buf, data->bufSize);
+        versionLen += (versionLen < (size_t)data->bufSize);  /* with the terminating 0 if it fits */
+        version = malloc(versionLen ? versionLen : 1);
+        if( version == NULL ) {
+            free(copy);
+            return;
+        }
+        memcpy(version, data->buf, versionLen);
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    if( cache->generation == generation ) {
+        control_cache_clear(entry);
+        entry->status = copy;
+        entry->size = size;
+        entry->version = version;
+        entry->versionLen = versionLen;
+        entry->ret = ret;
+        entry->valid = 1;
+        copy = NULL;
+        version = NULL;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    free(copy);
+    free(version);
+}
+
+/* Drop a reference taken by control_cache_of() or the one of the instance */
+static void control_cache_put(control_cache *cache)
+{
+    int     last;
+
+    if( cache == NULL ) {
+        return;
+    }
+    pthread_mutex_lock(&ipc_mutex);
+    last = (--cache->refs == 0);
+    pthread_mutex_unlock(&ipc_mutex);
+
+    if( last ) {
+        control_cache_free(cache);
+    }
+}
+
+static void control_cache_invalidate(control_cache *cache)
+{
+    pthread_mutex_lock(&cache->lock);
+    cache->generation++;
+    control_cache_clear(&cache->bufinfo);
+    control_cache_clear(&cache->version);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/* Invalidate the control cache of a codec, if enabled */
+static void control_cache_invalidate_codec(void *codec)
+{
+    dce_instance    *inst;
+
+    pthread_mutex_lock(&ipc_mutex);
+    inst = get_instance(codec);
+    if( inst && inst->ccache ) {
+        control_cache_invalidate(inst->ccache);
+    }
+    pthread_mutex_unlock(&ipc_mutex);
+}
+
+/* Commands which leave the codec configuration unchanged */
+static inline int control_is_query(int id)
+{
+    return (id == XDM_GETSTATUS || id == XDM_GETBUFINFO || id == XDM_GETVERSION ||
+            id == XDM_GETCONTEXTINFO || id == XDM_GETDYNPARAMSDEFAULT);
+}
+
+/*===============================================================*/
+/** dce_set_control_cache : Enable or disable the control cache of a codec instance.
+ *
+ * @ return : Error Status.
+ */
+int dce_set_control_cache(void *codec, int enable)
+{
+    dce_instance        *inst;
+    control_cache       *cache = NULL, *old = NULL;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(codec != NULL, DCE_EINVALID_INPUT);
+
+    if( enable ) {
+        cache = calloc(1, sizeof(control_cache));
+        _ASSERT(cache != NULL, DCE_EOUT_OF_MEMORY);
+        cache->refs = 1;
+        pthread_mutex_init(&cache->lock, NULL);
+    }
+
+    pthread_mutex_lock(&ipc_mutex);
+    inst = get_instance(codec);
+    if( inst == NULL ) {
+        pthread_mutex_unlock(&ipc_mutex);
+        control_cache_free(cache);
+        eError = DCE_EINVALID_INPUT;
+        goto EXIT;
+    }
+    if( enable && inst->ccache ) {
+        /* Already enabled, keep the counters */
+        old = cache;
+    } else {
+        old = inst->ccache;
+        inst->ccache = cache;
+    }
+    pthread_mutex_unlock(&ipc_mutex);
+
+    /* Calls in progress keep the old cache until they return */
+    control_cache_put(old);
 
 EXIT:
-    memplugin_free(engine_open_msg);
+    return (eError);
+}
 
-    if( engine_attrs ) {
-         memplugin_free(engine_attrs);
+/*===============================================================*/
+/** dce_get_control_cache_stats : Hit and miss counters of the control cache of a codec instance.
+ *
+ * @ return : Error Status.
+ */
+int dce_get_control_cache_stats(void *codec, XDAS_UInt32 *hits, XDAS_UInt32 *misses)
+{
+    control_cache       *cache;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(codec != NULL && hits != NULL && misses != NULL, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&ipc_mutex);
+    cache = get_instance(codec) ? get_instance(codec)->ccache : NULL;
+    _ASSERT_AND_EXECUTE(cache != NULL, DCE_EINVALID_INPUT, pthread_mutex_unlock(&ipc_mutex));
+    pthread_mutex_lock(&cache->lock);
+    *hits = cache->hits;
+    *misses = cache->misses;
+    pthread_mutex_unlock(&cache->lock);
+    pthread_mutex_unlock(&ipc_mutex);
+
+EXIT:
+    return (eError);
+}
+
+/*===============================================================*/
+/** dce_set_priority   : Set the priority class of the remote calls of a codec instance.
+ *
+ * @ return : Error Status.
+ */
+int dce_set_priority(void *codec, dce_priority priority)
+{
+    dce_instance        *inst;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(codec != NULL, DCE_EINVALID_INPUT);
+    _ASSERT(priority >= DCE_PRIORITY_REALTIME && priority < DCE_PRIORITY_MAX, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&ipc_mutex);
+    inst = get_instance(codec);
+    if( inst ) {
+        inst->priority = priority;
+    }
+    pthread_mutex_unlock(&ipc_mutex);
+    _ASSERT(inst != NULL, DCE_EINVALID_INPUT);
+
+EXIT:
+    return (eError);
+}
+
+/*===============================================================*/
+/** dce_set_call_budget : Set the process() duration above which the watchdog flags
+ *                        the calls of a codec instance.
+ *
+ * @ return : Error Status.
+ */
+int dce_set_call_budget(void *codec, unsigned int budget_us)
+{
+    dce_instance        *inst;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(codec != NULL, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&ipc_mutex);
+    inst = get_instance(codec);
+    _ASSERT_AND_EXECUTE(inst != NULL, DCE_EINVALID_INPUT, pthread_mutex_unlock(&ipc_mutex));
+    __BudgetCount += (budget_us != 0) - (inst->budget_us != 0);
+    inst->budget_us = budget_us;
+    pthread_mutex_unlock(&ipc_mutex);
+
+    /* The watchdog stops by itself once no instance has a budget */
+    if( budget_us ) {
+        watchdog_start();
+    }
+
+EXIT:
+    return (eError);
+}
+
+/*===============================================================*/
+/** dce_get_instance_health : Watchdog counter and failed state of a codec instance.
+ *
+ * @ return : Error Status.
+ */
+int dce_get_instance_health(void *codec, XDAS_UInt32 *overruns, int *failed)
+{
+    dce_instance        *inst;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(codec != NULL && overruns != NULL && failed != NULL, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&ipc_mutex);
+    inst = get_instance(codec);
+    _ASSERT_AND_EXECUTE(inst != NULL, DCE_EINVALID_INPUT, pthread_mutex_unlock(&ipc_mutex));
+    *overruns = inst->overruns;
+    *failed = inst->failed;
+    pthread_mutex_unlock(&ipc_mutex);
+
+EXIT:
+    return (eError);
+}
+
+/*===============================================================*/
+/** dce_get_stats      : Copy the latency histogram of a call type and phase.
+ *
+ * @ param codec [in]  : Codec instance, NULL for the calls of all instances and engines.
+ * @ return : Error Status.
+ */
+int dce_get_stats(void *codec, dce_stats_call call, dce_stats_phase phase, dce_histogram *hist)
+{
+    dce_instance        *inst;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(call >= 0 && call < DCE_STATS_CALLS, DCE_EINVALID_INPUT);
+    _ASSERT(phase >= 0 && phase < DCE_STATS_PHASES, DCE_EINVALID_INPUT);
+    _ASSERT(hist != NULL, DCE_EINVALID_INPUT);
+
+    if( codec == NULL ) {
+        stats_copy(hist, &__Stats.hist[call][phase]);
+        goto EXIT;
     }
-    /*Relinquish IPC*/
+
+    /* The instance can't be freed while it is in codec_map */
+    pthread_mutex_lock(&ipc_mutex);
+    inst = get_instance(codec);
+    _ASSERT_AND_EXECUTE(inst != NULL && inst->stats != NULL, DCE_EINVALID_INPUT,
+                        pthread_mutex_unlock(&ipc_mutex));
+    stats_copy(hist, &inst->stats->hist[call][phase]);
+    pthread_mutex_unlock(&ipc_mutex);
+
+EXIT:
+    return (eError);
+}
+
+/*===============================================================*/
+/** dce_get_callback_latency : Copy the row callback latency histogram of a low
+ *                             latency decoder.
+ *
+ * @ return : Error Status.
+ */
+int dce_get_callback_latency(void *codec, dce_histogram *hist)
+{
+    CallbackFlag        *cb;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(codec != NULL && hist != NULL, DCE_EINVALID_INPUT);
+
+    /* The row mode state is released after the codec left codec_map */
+    pthread_mutex_lock(&ipc_mutex);
+    cb = get_callback(codec);
+    _ASSERT_AND_EXECUTE(cb != NULL && cb->row_mode && cb->exchange == dce_callback_putDataFxn,
+                        DCE_EINVALID_INPUT, pthread_mutex_unlock(&ipc_mutex));
+    stats_copy(hist, &cb->latency);
     pthread_mutex_unlock(&ipc_mutex);
-    DEBUG("END Engine_open ipc_mutex 0x%x", (unsigned int) &ipc_mutex);
 
-    return ((Engine_Handle)engine_handle);
+EXIT:
+    return (eError);
 }
 
 /*===============================================================*/
-/** Engine_close           : Close Engine.
+/** dce_callback_data_ready : Queue a row mode encoder waiting for client data.
  *
- * @ param engine  [in]    : Engine Handle obtained in Engine_open() call.
+ * @ return : Error Status.
  */
-Void Engine_close(Engine_Handle engine)
+int dce_callback_data_ready(void *codec)
 {
-    MmRpc_FxnCtx        fxnCtx;
-    int32_t             fxnRet;
+    CallbackFlag        *cb;
     dce_error_status    eError = DCE_EOK;
-    int32_t             coreIdx = INVALID_CORE;
-    int                 tableIdx = -1;
 
+    _ASSERT(codec != NULL, DCE_EINVALID_INPUT);
 
-    /*Acquire permission to use IPC*/
+    /* The row mode state is released after the codec left codec_map */
     pthread_mutex_lock(&ipc_mutex);
+    cb = get_callback(codec);
+    _ASSERT_AND_EXECUTE(cb != NULL && cb->row_mode && cb->exchange == dce_callback_getDataFxn,
+                        DCE_EINVALID_INPUT, pthread_mutex_unlock(&ipc_mutex));
+    pthread_mutex_lock(&cb->lock);
+    callback_wake(cb);
+    pthread_mutex_unlock(&cb->lock);
+    pthread_mutex_unlock(&ipc_mutex);
 
-    _ASSERT(engine != NULL, DCE_EINVALID_INPUT);
-
-    /* Marshall function arguments into the send buffer */
-    Fill_MmRpc_fxnCtx(&fxnCtx, DCE_RPC_ENGINE_CLOSE, 1, 0, NULL);
-    Fill_MmRpc_fxnCtx_Scalar_Params(fxnCtx.params, sizeof(Engine_Handle), (int32_t)engine);
-
-    coreIdx = getCoreIndexFromEngine(engine, &tableIdx);
-    _ASSERT(coreIdx != INVALID_CORE,DCE_EINVALID_INPUT);
+EXIT:
+    return (eError);
+}
 
-    /* Invoke the Remote function through MmRpc */
-    eError = MmRpc_call(MmRpcHandle[coreIdx], &fxnCtx, &fxnRet);
-    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+/*===============================================================*/
+/** dce_stats_percentile : Duration below which a percentage of the recorded calls completed,
+ *                         rounded up to the end of its histogram bucket.
+ *
+ * @ return : Duration in microseconds, 0 for an empty histogram.
+ */
+uint32_t dce_stats_percentile(const dce_histogram *hist, int percent)
+{
+    uint64_t    rank, seen = 0;
+    uint32_t    value = 0;
+    int         i;
 
-EXIT:
-    if( coreIdx != INVALID_CORE )
-        dce_ipc_deinit(coreIdx, tableIdx);
+    if( hist == NULL || hist->count == 0 ) {
+        return (0);
+    }
+    percent = percent < 0 ? 0 : (percent > 100 ? 100 : percent);
+    rank = ((uint64_t)hist->count * percent + 99) / 100;
+    rank = rank ? rank : 1;
+
+    for( i = 0; i < DCE_STATS_BUCKETS; i++ ) {
+        seen += hist->bucket[i];
+        if( seen >= rank ) {
+            value = (i + 1 < DCE_STATS_BUCKETS) ? stats_bucket_floor(i + 1) - 1 : UINT32_MAX;
+            break;
+        }
+    }
 
-    /*Relinquish IPC*/
-    pthread_mutex_unlock(&ipc_mutex);
+    return (value < hist->max_us ? value : hist->max_us);
+}
 
-    return;
+/*===============================================================*/
+/** dce_enable_stats   : Turn the recording of call statistics on (default) or off.
+ */
+void dce_enable_stats(int enable)
+{
+    __StatsEnabled = enable ? 1 : 0;
 }
 
- /*===============================================================*/
-/** get_rproc_info : Get Information from the Remote proc.
+/*===============================================================*/
+/** dce_capture_start  : Write every remote call issued from now on to a file, for
+ *                       dce_replay. A capture already running is stopped first.
  *
- * @ param engine    [in]    : Engine Handle obtained in Engine_open() call.
- * @ param info_type [in]    : Information type as defined in the rproc_info_type
-+ */
-int32_t get_rproc_info(Engine_Handle engine, rproc_info_type info_type)
+ * @ param path   [in] : File to create.
+ * @ param flags  [in] : DCE_CAPTURE_BUFFERS to save the contents of all the data
+ *                       buffers, by default only buffers up to 64KB are saved.
+ * @ return            : Error Status.
+ */
+int dce_capture_start(const char *path, int flags)
 {
-    MmRpc_FxnCtx        fxnCtx;
-    int32_t             fxnRet;
+    dce_capture_header  hdr = { DCE_CAPTURE_MAGIC, DCE_CAPTURE_VERSION, sizeof(void *), 0 };
     dce_error_status    eError = DCE_EOK;
-    int32_t             coreIdx = INVALID_CORE;
-    int                 tableIdx = -1;
+    FILE                *file = NULL;
 
-    /*Acquire permission to use IPC*/
-    pthread_mutex_lock(&ipc_mutex);
+    _ASSERT(path != NULL, DCE_EINVALID_INPUT);
+    dce_capture_stop();
 
-    _ASSERT(engine != NULL, DCE_EINVALID_INPUT);
+    file = fopen(path, "wb");
+    _ASSERT(file != NULL, DCE_EINVALID_INPUT);
+    _ASSERT_AND_EXECUTE(fwrite(&hdr, sizeof(hdr), 1, file) == 1, DCE_EINVALID_INPUT, fclose(file));
 
-    /* Marshall function arguments into the send buffer */
-    Fill_MmRpc_fxnCtx(&fxnCtx, DCE_RPC_GET_INFO, 1, 0, NULL);
-    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[0]), sizeof(rproc_info_type), (int32_t)info_type);
+    pthread_mutex_lock(&capture_mutex);
+    __CaptureFile = file;
+    __CaptureFlags = flags;
+    __CaptureEnabled = 1;
+    pthread_mutex_unlock(&capture_mutex);
+    INFO("Capturing remote calls to %s", path);
 
-    coreIdx = getCoreIndexFromEngine(engine, &tableIdx);
-    _ASSERT(coreIdx != INVALID_CORE,DCE_EINVALID_INPUT);
+EXIT:
+    return (eError);
+}
 
-    /* Invoke the Remote function through MmRpc */
-    eError = MmRpc_call(MmRpcHandle[coreIdx], &fxnCtx, &fxnRet);
-    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+/*===============================================================*/
+/** dce_capture_stop   : Stop the capture started by dce_capture_start() and close its file.
+ */
+void dce_capture_stop(void)
+{
+    pthread_mutex_lock(&capture_mutex);
+    __CaptureEnabled = 0;
+    if( __CaptureFile ) {
+        fclose(__CaptureFile);
+        __CaptureFile = NULL;
+    }
+    pthread_mutex_unlock(&capture_mutex);
+}
 
-EXIT:
-    /*Relinquish IPC*/
+struct timed_worker;
+static int timed_worker_release(struct timed_worker *w, process_ctx *pctx, int remote_delete);
+static void process_ctx_free(process_ctx *ctx, int core);
+static void place_release(int core);
+
+/* Remove a deleted codec from codec_map and release its quota. Returns the      */
+/* connection to delete a failed instance on, -1 for any other instance or when  */
+/* its timed worker, still blocked in the cancelled call, deletes it afterwards. */
+static int unregister_instance(void *codec)
+{
+    dce_instance    *inst;
+    int             conn = -1;
+
+    pthread_mutex_lock(&ipc_mutex);
+    inst = dce_map_remove(&codec_map, codec);
+    if( inst ) {
+        __CodecCount[inst->core]--;
+        __BudgetCount -= (inst->budget_us != 0);
+        dce_ipc_unbind(inst->core, inst->conn);
+        if( inst->failed ) {
+            conn = inst->conn;
+        }
+    }
     pthread_mutex_unlock(&ipc_mutex);
 
-    return fxnRet;
+    if( inst ) {
+        control_cache_put(inst->ccache);
+        /* A worker still blocked in the remote call keeps the process context */
+        if( inst->timed && timed_worker_release(inst->timed, inst->pctx, inst->failed) ) {
+            inst->pctx = NULL;
+            conn = -1;
+        }
+        process_ctx_free(inst->pctx, inst->core);
+        if( inst->placed ) {
+            place_release(inst->core);
+        }
+        free(inst->stats);
+        free(inst);
+    }
+    return (conn);
 }
 
+static void delete(void *codec, dce_codec_type codec_id);
 
 /*===============================================================*/
 /** Functions create(), control(), get_version(), process(), delete() are common codec
@@ -623,7 +3225,10 @@ static void *create(Engine_Handle engine, String name, void *params, dce_codec_t
     dce_error_status    eError = DCE_EOK;
     void                *codec_handle = NULL;
     char                *codec_name = NULL;
+    dce_instance        *inst = NULL;
     int                 coreIdx = INVALID_CORE;
+    int                 reserved = 0;
+    rpc_call            call = { NULL };
 
     _ASSERT(name != '\0', DCE_EINVALID_INPUT);
     _ASSERT(engine != NULL, DCE_EINVALID_INPUT);
@@ -632,6 +3237,34 @@ static void *create(Engine_Handle engine, String name, void *params, dce_codec_t
     coreIdx = getCoreIndexFromCodec(codec_id);
     _ASSERT(coreIdx != INVALID_CORE, DCE_EINVALID_INPUT);
 
+    inst = calloc(1, sizeof(dce_instance));
+    _ASSERT(inst != NULL, DCE_EOUT_OF_MEMORY);
+    /* Without a process context every process() call is marshalled from scratch */
+    inst->pctx = calloc(1, sizeof(process_ctx));
+    /* Without statistics its calls are only counted globally */
+    inst->stats = calloc(1, sizeof(dce_stats));
+    inst->codec_id = codec_id;
+    inst->core = coreIdx;
+    inst->priority = DCE_PRIORITY_INTERACTIVE;
+
+    /* Reserve the instance against the quota of the core and bind it to the */
+    /* connection of its engine                                             */
+    pthread_mutex_lock(&ipc_mutex);
+    if( __InstanceQuota[coreIdx] == 0 || __CodecCount[coreIdx] < __InstanceQuota[coreIdx] ) {
+        __CodecCount[coreIdx]++;
+        getCoreIndexFromEngine(engine, &(inst->conn));
+        if( inst->conn < __PoolActive[coreIdx] ) {
+            __Conn[coreIdx][inst->conn].bound++;
+        }
+        reserved = 1;
+    }
+    pthread_mutex_unlock(&ipc_mutex);
+    if( !reserved ) {
+        ERROR("Too many codec instances on core %d, quota is %d. Use dce_set_instance_quota() to change it.",
+              coreIdx, __InstanceQuota[coreIdx]);
+    }
+    _ASSERT(reserved, DCE_EXDM_UNSUPPORTED);
+
     /* Allocate shared memory for translating codec name to IPU */
     codec_name = memplugin_alloc(MAX_NAME_LENGTH * sizeof(char), 1, DEFAULT_REGION, 0, coreIdx);
     _ASSERT_AND_EXECUTE(codec_name != NULL, DCE_EOUT_OF_MEMORY, codec_handle = NULL);
@@ -639,20 +3272,44 @@ static void *create(Engine_Handle engine, String name, void *params, dce_codec_t
     strncpy(codec_name, name, strlen(name));
 
     /* Marshall function arguments into the send buffer */
+    call.stats = inst->stats;
+    call.marshal_us = stats_start();
     Fill_MmRpc_fxnCtx(&fxnCtx, DCE_RPC_CODEC_CREATE, 4, 0, NULL);
     Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[0]), sizeof(int32_t), codec_id);
     Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[1]), sizeof(Engine_Handle), (int32_t)engine);
-    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[2]), GetSz(codec_name), P2H(codec_name),
-                                    sizeof(MemHeader), memplugin_share(codec_name));
-    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[3]), GetSz(params), P2H(params),
-                                    sizeof(MemHeader),  memplugin_share(params));
+    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[2]), GetSz(codec_name), GetBase(codec_name),
+                                    GetOffset(codec_name), memplugin_share(codec_name));
+    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[3]), GetSz(params), GetBase(params),
+                                    GetOffset(params), memplugin_share(params));
     /* Invoke the Remote function through MmRpc */
-    eError = MmRpc_call(MmRpcHandle[coreIdx], &fxnCtx, (int32_t *)(&codec_handle));
+    eError = dce_ipc_call_tracked(coreIdx, inst->conn, inst->priority, &call,
+                                  &fxnCtx, (int32_t *)(&codec_handle));
 
     /* In case of Error, the Application will get a NULL Codec Handle */
     _ASSERT_AND_EXECUTE(eError == DCE_EOK, DCE_EIPC_CALL_FAIL, codec_handle = NULL);
 
+    if( codec_handle ) {
+        inst->codec = codec_handle;
+        pthread_mutex_lock(&ipc_mutex);
+        eError = dce_map_put(&codec_map, codec_handle, inst);
+        pthread_mutex_unlock(&ipc_mutex);
+        /* The codec can't be tracked: delete it on the remote core */
+        _ASSERT_AND_EXECUTE(eError == DCE_EOK, DCE_EOUT_OF_MEMORY,
+                            delete(codec_handle, codec_id); codec_handle = NULL);
+    }
+
 EXIT:
+    if( codec_handle == NULL && inst != NULL ) {
+        if( reserved ) {
+            pthread_mutex_lock(&ipc_mutex);
+            __CodecCount[coreIdx]--;
+            dce_ipc_unbind(coreIdx, inst->conn);
+            pthread_mutex_unlock(&ipc_mutex);
+        }
+        free(inst->pctx);
+        free(inst->stats);
+        free(inst);
+    }
     memplugin_free(codec_name);
     return ((void *)codec_handle);
 }
@@ -678,6 +3335,11 @@ static XDAS_Int32 control(void *codec, int id, void *dynParams, void *status, dc
     int32_t             fxnRet = XDM_EFAIL;
     dce_error_status    eError = DCE_EOK;
     int                 coreIdx = INVALID_CORE;
+    control_cache       *cache = NULL;
+    unsigned int        generation = 0;
+    dce_priority        prio;
+    int                 conn;
+    rpc_call            call = { NULL };
 
     _ASSERT(codec != NULL, DCE_EINVALID_INPUT);
     _ASSERT(dynParams != NULL, DCE_EINVALID_INPUT);
@@ -686,101 +3348,510 @@ static XDAS_Int32 control(void *codec, int id, void *dynParams, void *status, dc
     coreIdx = getCoreIndexFromCodec(codec_id);
     _ASSERT(coreIdx != INVALID_CORE, DCE_EINVALID_INPUT);
 
+    cache = control_cache_of(codec);
+    if( cache && control_cache_lookup(cache, id, status, codec_id, &fxnRet, &generation) ) {
+        goto EXIT;
+    }
+
+    conn = get_codec_conn(codec, NULL, &prio, &call.stats);
+
     /* Marshall function arguments into the send buffer */
+    call.marshal_us = stats_start();
     Fill_MmRpc_fxnCtx(&fxnCtx, DCE_RPC_CODEC_CONTROL, 5, 0, NULL);
     Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[0]), sizeof(int32_t), codec_id);
     Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[1]), sizeof(int32_t), (int32_t)codec);
     Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[2]), sizeof(int32_t), (int32_t)id);
-    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[3]), GetSz(dynParams), P2H(dynParams),
-                                    sizeof(MemHeader), memplugin_share(dynParams));
-    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[4]), GetSz(status), P2H(status),
-                                    sizeof(MemHeader), memplugin_share(status));
+    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[3]), GetSz(dynParams), GetBase(dynParams),
+                                    GetOffset(dynParams), memplugin_share(dynParams));
+    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[4]), GetSz(status), GetBase(status),
+                                    GetOffset(status), memplugin_share(status));
+
+    /* Invoke the Remote function through MmRpc */
+    eError = dce_ipc_call_tracked(coreIdx, conn, prio, &call, &fxnCtx, &fxnRet);
+    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+
+    if( cache ) {
+        if( control_is_query(id) ) {
+            control_cache_fill(cache, generation, id, status, codec_id, fxnRet);
+        } else {
+            control_cache_invalidate(cache);
+        }
+    }
+
+EXIT:
+    control_cache_put(cache);
+    return (fxnRet);
+
+}
+
+/*===============================================================*/
+/** get_version        : Codec control call to get the codec version. This call has been made
+ *                       separate from control call because it involves an additional version
+ *                       buffer translation.
+ *
+ * @ param codec  [in]     : Codec Handle obtained in create() call.
+ * @ param id [in]            : Command id for XDM control operation.
+ * @ param dynParams [in] : Dynamic input parameters to Codec.
+ * @ param status [out]    : Codec returned status parameters.
+ * @ param codec_id [in]  : To differentiate between Encoder and Decoder codecs.
+ * @ return : Status of control() call is returned.
+ *                #XDM_EOK                  [0]   :  Success.
+ *                #XDM_EFAIL                [-1] :  Failure.
+ *                #IPC_FAIL                   [-2] : MmRpc Call failed.
+ *                #XDM_EUNSUPPORTED [-3] :  Unsupported request.
+ *                #OUT_OF_MEMORY       [-4] :  Out of Shared Memory.
+ */
+static XDAS_Int32 get_version(void *codec, void *dynParams, void *status, dce_codec_type codec_id)
+{
+    MmRpc_FxnCtx        fxnCtx;
+    MmRpc_Xlt           xltAry;
+    void             * *version_buf = NULL;
+    int32_t             fxnRet = XDM_EFAIL;
+    dce_error_status    eError = DCE_EOK;
+    int                 coreIdx = INVALID_CORE;
+    control_cache       *cache = NULL;
+    unsigned int        generation = 0;
+    dce_priority        prio;
+    int                 conn;
+    rpc_call            call = { NULL };
+
+    _ASSERT(codec != NULL, DCE_EINVALID_INPUT);
+    _ASSERT(dynParams != NULL, DCE_EINVALID_INPUT);
+    _ASSERT(status != NULL, DCE_EINVALID_INPUT);
+
+    coreIdx = getCoreIndexFromCodec(codec_id);
+    _ASSERT(coreIdx != INVALID_CORE, DCE_EINVALID_INPUT);
+
+    version_buf = (void * *)(&(status_data(status, codec_id)->buf));
+    _ASSERT(*version_buf != NULL, DCE_EINVALID_INPUT);
+
+    cache = control_cache_of(codec);
+    if( cache && control_cache_lookup(cache, XDM_GETVERSION, status, codec_id, &fxnRet, &generation) ) {
+        goto EXIT;
+    }
+
+    conn = get_codec_conn(codec, NULL, &prio, &call.stats);
+
+    /* Marshall function arguments into the send buffer */
+    call.marshal_us = stats_start();
+    Fill_MmRpc_fxnCtx(&fxnCtx, DCE_RPC_CODEC_GET_VERSION, 4, 1, &xltAry);
+    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[0]), sizeof(int32_t), codec_id);
+    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[1]), sizeof(int32_t), (int32_t)codec);
+    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[2]), GetSz(dynParams), GetBase(dynParams),
+                                    GetOffset(dynParams), memplugin_share(dynParams));
+    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[3]), GetSz(status), GetBase(status),
+                                    GetOffset(status), memplugin_share(status));
+
+    /* Address Translation needed for buffer for version Info */
+    Fill_MmRpc_fxnCtx_Xlt_Array(fxnCtx.xltAry, 3,
+         MmRpc_OFFSET((int32_t)status, (int32_t)version_buf),
+         (size_t)GetBase(*version_buf), memplugin_share(*version_buf));
+
+    /* Invoke the Remote function through MmRpc */
+    eError = dce_ipc_call_tracked(coreIdx, conn, prio, &call, &fxnCtx, &fxnRet);
+    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+
+    if( cache ) {
+        control_cache_fill(cache, generation, XDM_GETVERSION, status, codec_id, fxnRet);
+    }
+
+EXIT:
+    control_cache_put(cache);
+    return (fxnRet);
+}
+
+/*===============================================================*/
+/** control_batch      : Run several control commands on a codec in one remote call.
+ *                       The dynParams and status buffers of every command are
+ *                       translated through the xlt array of the batch message.
+ *
+ * @ param codec  [in]     : Codec Handle obtained in create() call.
+ * @ param cmds [in/out]   : Commands, ret of each one is filled on return.
+ * @ param count [in]      : Number of commands.
+ * @ param codec_id [in]   : To differentiate between Encoder and Decoder codecs.
+ * @ return : XDM_EOK if every command succeeded, XDM_EFAIL if one of them failed,
+ *            DCE error status if the batch could not be run.
+ */
+static XDAS_Int32 control_batch(void *codec, dce_control_cmd *cmds, int count, dce_codec_type codec_id)
+{
+    MmRpc_FxnCtx        fxnCtx;
+    MmRpc_Xlt           xltAry[2 * MAX_CONTROL_BATCH];
+    dce_control_batch   *batch_msg = NULL;
+    int32_t             fxnRet = XDM_EFAIL;
+    dce_error_status    eError = DCE_EOK;
+    int                 coreIdx = INVALID_CORE;
+    int                 i, invalidate = 0;
+    dce_priority        prio;
+    int                 conn;
+    rpc_call            call = { NULL };
+
+    _ASSERT(codec != NULL, DCE_EINVALID_INPUT);
+    _ASSERT(cmds != NULL, DCE_EINVALID_INPUT);
+    _ASSERT(count > 0 && count <= MAX_CONTROL_BATCH, DCE_EINVALID_INPUT);
+
+    coreIdx = getCoreIndexFromCodec(codec_id);
+    _ASSERT(coreIdx != INVALID_CORE, DCE_EINVALID_INPUT);
+
+    for( i = 0; i < count; i++ ) {
+        _ASSERT(cmds[i].dynParams != NULL, DCE_EINVALID_INPUT);
+        _ASSERT(cmds[i].status != NULL, DCE_EINVALID_INPUT);
+        /* The version buffer would need one more translation per command */
+        _ASSERT(cmds[i].cmd_id != XDM_GETVERSION, DCE_EINVALID_INPUT);
+        invalidate |= !control_is_query(cmds[i].cmd_id);
+    }
+
+    conn = get_codec_conn(codec, NULL, &prio, &call.stats);
+
+    /* Allocate shared memory for the batch rpc msg structure */
+    call.marshal_us = stats_start();
+    batch_msg = memplugin_alloc(sizeof(dce_control_batch), 1, DEFAULT_REGION, 0, coreIdx);
+    _ASSERT(batch_msg != NULL, DCE_EOUT_OF_MEMORY);
+
+    batch_msg->count = count;
+    for( i = 0; i < count; i++ ) {
+        batch_msg->cmd[i].cmd_id = cmds[i].cmd_id;
+        batch_msg->cmd[i].ret = XDM_EFAIL;
+        batch_msg->cmd[i].dynParams = cmds[i].dynParams;
+        batch_msg->cmd[i].status = cmds[i].status;
+    }
+
+    /* Marshall function arguments into the send buffer */
+    Fill_MmRpc_fxnCtx(&fxnCtx, DCE_RPC_CODEC_CONTROL_BATCH, 3, 2 * count, xltAry);
+    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[0]), sizeof(int32_t), codec_id);
+    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[1]), sizeof(int32_t), (int32_t)codec);
+    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[2]), GetSz(batch_msg), GetBase(batch_msg),
+                                    GetOffset(batch_msg), memplugin_share(batch_msg));
+
+    /* Address Translation needed for the dynParams and status of each command */
+    for( i = 0; i < count; i++ ) {
+        Fill_MmRpc_fxnCtx_Xlt_Array(&(fxnCtx.xltAry[2 * i]), 2,
+             MmRpc_OFFSET((int32_t)batch_msg, (int32_t)&(batch_msg->cmd[i].dynParams)),
+             (size_t)GetBase(cmds[i].dynParams), memplugin_share(cmds[i].dynParams));
+        Fill_MmRpc_fxnCtx_Xlt_Array(&(fxnCtx.xltAry[2 * i + 1]), 2,
+             MmRpc_OFFSET((int32_t)batch_msg, (int32_t)&(batch_msg->cmd[i].status)),
+             (size_t)GetBase(cmds[i].status), memplugin_share(cmds[i].status));
+    }
+
+    /* Invoke the Remote function through MmRpc */
+    eError = dce_ipc_call_tracked(coreIdx, conn, prio, &call, &fxnCtx, &fxnRet);
+    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+
+    fxnRet = XDM_EOK;
+    for( i = 0; i < count; i++ ) {
+        cmds[i].ret = batch_msg->cmd[i].ret;
+        if( cmds[i].ret != XDM_EOK ) {
+            fxnRet = XDM_EFAIL;
+        }
+    }
+
+    if( invalidate ) {
+        control_cache_invalidate_codec(codec);
+    }
+
+EXIT:
+    if( eError != DCE_EOK ) {
+        fxnRet = eError;
+    }
+    memplugin_free(batch_msg);
+    return (fxnRet);
+}
+
+/* Keep the data sync callback of a low latency instance from the first control */
+/* command, as *_control() does, in case the batch is the first control call.   */
+static void control_batch_first_control(void *codec, dce_control_cmd *cmds, dce_codec_type codec_id)
+{
+    CallbackFlag    *cb;
+
+    pthread_mutex_lock(&ipc_mutex);
+    cb = get_callback(codec);
+    pthread_mutex_unlock(&ipc_mutex);
+
+    if( cb == NULL || cmds == NULL || cmds[0].dynParams == NULL ) {
+        return;
+    }
+    pthread_mutex_lock(&cb->lock);
+    if( cb->row_mode && cb->first_control ) {
+        if( codec_id == OMAP_DCE_VIDDEC3 ) {
+            cb->local_put_DataFxn = (void*) ((VIDDEC3_DynamicParams *)cmds[0].dynParams)->putDataFxn;
+            cb->local_dataSyncHandle = ((VIDDEC3_DynamicParams *)cmds[0].dynParams)->putDataHandle;
+        } else {
+            cb->local_get_DataFxn = (void*) ((VIDENC2_DynamicParams *)cmds[0].dynParams)->getDataFxn;
+            cb->local_dataSyncHandle = ((VIDENC2_DynamicParams *)cmds[0].dynParams)->getDataHandle;
+        }
+        cb->first_control = FALSE;
+    }
+    pthread_mutex_unlock(&cb->lock);
+}
+
+typedef enum process_call_params {
+    CODEC_ID_INDEX = 0,
+    CODEC_HANDLE_INDEX,
+    INBUFS_INDEX,
+    OUTBUFS_INDEX,
+    INARGS_INDEX,
+    OUTARGS_INDEX,
+    OUTBUFS_PTR_INDEX
+} process_call_params;
+
+#define LUMA_BUF 0
+#define CHROMA_BUF 1
+
+static inline void process_ctx_set_xlt(process_ctx *ctx, int idx, int param_index, void *base, void **field, xlt_type type)
+{
+    ctx->xltAry[idx].index = param_index;
+    ctx->xltAry[idx].offset = MmRpc_OFFSET((int32_t)base, (int32_t)field);
+    /* Forces the first process_ctx_patch() to fill base and handle */
+    ctx->xltAry[idx].base = 0;
+    ctx->xltAry[idx].handle = 0;
+    ctx->field[idx] = field;
+    ctx->type[idx] = type;
+#if defined(BUILDOS_LINUX)
+    ctx->reg[idx] = (uint64_t)-1;
+#endif
+}
+
+#ifdef BUILDOS_ANDROID
+#define XLT_DATA_TYPE XLT_MEMHEADER
+#else
+#define XLT_DATA_TYPE XLT_DATA_BUF
+#endif
+
+/*===============================================================*/
+/** process_ctx_build      : Marshal the parts of a process() call that only depend
+ *                          on the descriptor shape.
+ */
+static void process_ctx_build(process_ctx *ctx, void *codec, void *inBufs, void *outBufs,
+                              void *inArgs, void *outArgs, int numInBufs, int numOutBufs,
+                              int numParams, int numXltAry, dce_codec_type codec_id)
+{
+    void    **buf_arry = NULL;
+    int     count, total_count;
+
+    ctx->inBufs = inBufs;
+    ctx->outBufs = outBufs;
+    ctx->inArgs = inArgs;
+    ctx->outArgs = outArgs;
+    ctx->numInBufs = numInBufs;
+    ctx->numOutBufs = numOutBufs;
+    ctx->outBufPtrs = NULL;
+
+    /* marshall function arguments into the send buffer                       */
+    /* Approach [2] as explained in "Notes" used for process               */
+    Fill_MmRpc_fxnCtx(&ctx->fxnCtx, DCE_RPC_CODEC_PROCESS, numParams, numXltAry, ctx->xltAry);
+    Fill_MmRpc_fxnCtx_Scalar_Params(&(ctx->fxnCtx.params[CODEC_ID_INDEX]), sizeof(int32_t), codec_id);
+    Fill_MmRpc_fxnCtx_Scalar_Params(&(ctx->fxnCtx.params[CODEC_HANDLE_INDEX]), sizeof(int32_t), (int32_t)codec);
+    /* The parameter buffers are filled by process_ctx_patch() */
+
+    /* InBufs, OutBufs, InArgs, OutArgs buffer need translation but since they have been */
+    /* individually mentioned as fxnCtx Params, they need not be mentioned below again */
+    /* Input and Output Buffers have to be mentioned for translation                               */
+    for( count = 0, total_count = 0; count < numInBufs; count++, total_count++ ) {
+         if( codec_id == OMAP_DCE_VIDDEC3 ) {
+              process_ctx_set_xlt(ctx, total_count, INBUFS_INDEX, inBufs,
+                                  (void * *)(&(((XDM2_BufDesc *)inBufs)->descs[count].buf)), XLT_DATA_TYPE);
+         } else if( codec_id == OMAP_DCE_VIDENC2 ) {
+              process_ctx_set_xlt(ctx, total_count, INBUFS_INDEX, inBufs,
+                                  (void * *)(&(((IVIDEO2_BufDesc *)inBufs)->planeDesc[count].buf)), XLT_DATA_TYPE);
+         } else if( codec_id == OMAP_DCE_VIDDEC2 ) {
+              process_ctx_set_xlt(ctx, total_count, INBUFS_INDEX, inBufs,
+                                  (void * *)(&(((XDM1_BufDesc *)inBufs)->descs[count].buf)), XLT_DATA_TYPE);
+         }
+    }
+
+    /* Output Buffers */
+    for( count = 0; count < numOutBufs; count++, total_count++ ) {
+        if( codec_id == OMAP_DCE_VIDENC2 || codec_id == OMAP_DCE_VIDDEC3 ) {
+            /* Encode usecase, MultiPlanar or SinglePlanar Buffers for Decode usecase */
+            process_ctx_set_xlt(ctx, total_count, OUTBUFS_INDEX, outBufs,
+                                (void * *)(&(((XDM2_BufDesc *)outBufs)->descs[count].buf)), XLT_DATA_TYPE);
+        } else if( codec_id == OMAP_DCE_VIDDEC2 ) {
+            if( count == LUMA_BUF ) {
+                buf_arry = (void * *)(&(((XDM_BufDesc *)outBufs)->bufs));
+                ctx->outBufPtrs = *buf_arry;
 
-    /* Invoke the Remote function through MmRpc */
-    eError = MmRpc_call(MmRpcHandle[coreIdx], &fxnCtx, &fxnRet);
-    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+                process_ctx_set_xlt(ctx, total_count, OUTBUFS_INDEX, outBufs, buf_arry, XLT_PARAM_BUF);
+                total_count++;
 
-EXIT:
-    return (fxnRet);
+                process_ctx_set_xlt(ctx, total_count, OUTBUFS_INDEX, outBufs,
+                                    (void * *)(&(((XDM_BufDesc *)outBufs)->bufSizes)), XLT_PARAM_BUF);
+                total_count++;
+            }
+
+            process_ctx_set_xlt(ctx, total_count, OUTBUFS_PTR_INDEX, *buf_arry,
+                                (void * *)(&(((XDM_BufDesc *)outBufs)->bufs[count])), XLT_DATA_BUF);
+        }
+    }
 
+    ctx->valid = 1;
 }
 
-/*===============================================================*/
-/** get_version        : Codec control call to get the codec version. This call has been made
- *                       separate from control call because it involves an additional version
- *                       buffer translation.
- *
- * @ param codec  [in]     : Codec Handle obtained in create() call.
- * @ param id [in]            : Command id for XDM control operation.
- * @ param dynParams [in] : Dynamic input parameters to Codec.
- * @ param status [out]    : Codec returned status parameters.
- * @ param codec_id [in]  : To differentiate between Encoder and Decoder codecs.
- * @ return : Status of control() call is returned.
- *                #XDM_EOK                  [0]   :  Success.
- *                #XDM_EFAIL                [-1] :  Failure.
- *                #IPC_FAIL                   [-2] : MmRpc Call failed.
- *                #XDM_EUNSUPPORTED [-3] :  Unsupported request.
- *                #OUT_OF_MEMORY       [-4] :  Out of Shared Memory.
- */
-static XDAS_Int32 get_version(void *codec, void *dynParams, void *status, dce_codec_type codec_id)
+/* Fill a parameter buffer of the call from its MemHeader */
+static inline void process_ctx_param(process_ctx *ctx, int index, void *buf)
 {
-    MmRpc_FxnCtx        fxnCtx;
-    MmRpc_Xlt           xltAry;
-    void             * *version_buf = NULL;
-    int32_t             fxnRet = XDM_EFAIL;
-    dce_error_status    eError = DCE_EOK;
-    int                 coreIdx = INVALID_CORE;
+    Fill_MmRpc_fxnCtx_OffPtr_Params(&(ctx->fxnCtx.params[index]), GetSz(buf), GetBase(buf),
+                                    GetOffset(buf), memplugin_share(buf));
+}
 
-    _ASSERT(codec != NULL, DCE_EINVALID_INPUT);
-    _ASSERT(dynParams != NULL, DCE_EINVALID_INPUT);
-    _ASSERT(status != NULL, DCE_EINVALID_INPUT);
+/* Refresh base/handle of the xlt entries whose buffer changed since the last call. */
+/* A parameter buffer freed and allocated again at the same address may be backed   */
+/* by another dma-buf, so the parameter buffers are read again on every call.       */
+/* On Linux the data buffers not seen before are registered with the core.          */
+static inline void process_ctx_patch(process_ctx *ctx, int core)
+{
+    int         i;
+    size_t      base;
+#if defined(BUILDOS_LINUX)
+    size_t      handle[MAX_TOTAL_BUF], fd[MAX_TOTAL_BUF];
+    int         slot[MAX_TOTAL_BUF], n = 0;
+    uint64_t    ref[MAX_TOTAL_BUF];
+#endif
 
-    coreIdx = getCoreIndexFromCodec(codec_id);
-    _ASSERT(coreIdx != INVALID_CORE, DCE_EINVALID_INPUT);
+    process_ctx_param(ctx, INBUFS_INDEX, ctx->inBufs);
+    process_ctx_param(ctx, OUTBUFS_INDEX, ctx->outBufs);
+    process_ctx_param(ctx, INARGS_INDEX, ctx->inArgs);
+    process_ctx_param(ctx, OUTARGS_INDEX, ctx->outArgs);
+    if( ctx->outBufPtrs ) {
+        process_ctx_param(ctx, OUTBUFS_PTR_INDEX, ctx->outBufPtrs);
+    }
 
-    if( codec_id == OMAP_DCE_VIDDEC3 ) {
-         version_buf = (void * *)(&(((IVIDDEC3_Status *)status)->data.buf));
-    } else if( codec_id == OMAP_DCE_VIDENC2 ) {
-         version_buf = (void * *)(&(((IVIDENC2_Status *)status)->data.buf));
-    } else if( codec_id == OMAP_DCE_VIDDEC2 ) {
-         version_buf = (void * *)(&(((IVIDDEC2_Status *)status)->data.buf));
+    for( i = 0; i < (int)ctx->fxnCtx.num_xlts; i++ ) {
+        if( ctx->type[i] == XLT_PARAM_BUF ) {
+            ctx->xltAry[i].base = (size_t)GetBase(*(ctx->field[i]));
+            ctx->xltAry[i].handle = (size_t)memplugin_share(*(ctx->field[i]));
+            continue;
+        }
+        base = (size_t)*(ctx->field[i]);
+        if( base == ctx->xltAry[i].base ) {
+            continue;
+        }
+        ctx->xltAry[i].base = base;
+#if defined(BUILDOS_LINUX)
+        /* A data buffer is a dma-buf fd or a plane imported with dce_buf_import() */
+        ctx->type[i] = dce_buf_imported((void *)base) ? XLT_MEMHEADER : XLT_DATA_BUF;
+        ctx->reg[i] = (uint64_t)-1;
+#endif
+        if( ctx->type[i] == XLT_MEMHEADER ) {
+            ctx->xltAry[i].handle = (size_t)(((MemHeader *)base)->dma_buf_fd);
+        } else {
+            ctx->xltAry[i].handle = base;
+        }
     }
-    _ASSERT(*version_buf != NULL, DCE_EINVALID_INPUT);
 
-    /* Marshall function arguments into the send buffer */
-    Fill_MmRpc_fxnCtx(&fxnCtx, DCE_RPC_CODEC_GET_VERSION, 4, 1, &xltAry);
-    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[0]), sizeof(int32_t), codec_id);
-    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[1]), sizeof(int32_t), (int32_t)codec);
-    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[2]), GetSz(dynParams), P2H(dynParams),
-                                    sizeof(MemHeader), memplugin_share(dynParams));
-    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[3]), GetSz(status), P2H(status),
-                                    sizeof(MemHeader), memplugin_share(status));
+#if defined(BUILDOS_LINUX)
+    /* Keep the buffers of the call at the head of the LRU, then register the */
+    /* new ones and those whose entry was evicted since the last call.        */
+    for( i = 0; i < (int)ctx->fxnCtx.num_xlts; i++ ) {
+        fd[i] = ctx->xltAry[i].handle;
+    }
+    dce_buf_cache_touch(core, ctx->fxnCtx.num_xlts, fd, ctx->reg);
+    for( i = 0; i < (int)ctx->fxnCtx.num_xlts; i++ ) {
+        if( ctx->type[i] == XLT_DATA_BUF && ctx->reg[i] == (uint64_t)-1 ) {
+            handle[n] = ctx->xltAry[i].handle;
+            slot[n++] = i;
+        }
+    }
+    if( n > 0 && dce_buf_cache_use(core, n, handle, ref) == DCE_EOK ) {
+        for( i = 0; i < n; i++ ) {
+            ctx->reg[slot[i]] = ref[i];
+        }
+    }
+#endif
+}
 
-    /* Address Translation needed for buffer for version Info */
-    Fill_MmRpc_fxnCtx_Xlt_Array(fxnCtx.xltAry, 3,
-         MmRpc_OFFSET((int32_t)status, (int32_t)version_buf),
-         (size_t)P2H(*version_buf), memplugin_share(*version_buf));
+#if defined(BUILDOS_LINUX)
+/* Single planar buffer: the chroma descriptor carries the luma buffer handle and */
+/* is advanced to the chroma plane once its xlt entry has been filled.            */
+static inline void single_planar_chroma(XDM2_SingleBufDesc *luma, XDM2_SingleBufDesc *chroma)
+{
+    if( chroma->memType == XDM_MEMTYPE_RAW || chroma->memType == XDM_MEMTYPE_TILEDPAGE ) {
+        chroma->buf += luma->bufSize.bytes;
+    } else {
+        chroma->buf += luma->bufSize.tileMem.width * luma->bufSize.tileMem.height;
+    }
+}
 
-    /* Invoke the Remote function through MmRpc */
-    eError = MmRpc_call(MmRpcHandle[coreIdx], &fxnCtx, &fxnRet);
-    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+/* Release the holds of a slot of the held buffers */
+static void process_ctx_unhold(process_ctx *ctx, int core, int slot)
+{
+    dce_buf_cache_hold(core, ctx->held[slot].num, ctx->held[slot].ref, -1);
+    ctx->held[slot].id = 0;
+    ctx->held[slot].num = 0;
+}
 
-EXIT:
-    return (fxnRet);
+/* The data buffers of a call are held while it is in flight. When it returned   */
+/* (done set), the holds of the buffers the codec keeps using are handed over to  */
+/* the inputID: the output buffers of a decoder reporting outBufsInUseFlag or the */
+/* input frame of an encoder. They are released once the codec lists the inputID */
+/* in freeBufID, the others at once. A context without the held table (track     */
+/* not set) releases them all.                                                    */
+static void process_ctx_hold(process_ctx *ctx, int core, uint64_t *ref, dce_codec_type codec_id,
+                             void *inArgs, void *outArgs, int done, int track)
+{
+    XDAS_Int32  id = 0, *freeBufID = NULL;
+    int         i, slot, free_slot = -1, index = -1, n = 0;
+
+    if( done && codec_id == OMAP_DCE_VIDDEC3 ) {
+        id = ((VIDDEC3_InArgs *)inArgs)->inputID;
+        freeBufID = ((VIDDEC3_OutArgs *)outArgs)->freeBufID;
+        index = ((VIDDEC3_OutArgs *)outArgs)->outBufsInUseFlag ? OUTBUFS_INDEX : -1;
+    } else if( done && codec_id == OMAP_DCE_VIDDEC2 ) {
+        id = ((VIDDEC2_InArgs *)inArgs)->inputID;
+        freeBufID = ((VIDDEC2_OutArgs *)outArgs)->freeBufID;
+        index = ((VIDDEC2_OutArgs *)outArgs)->outBufsInUseFlag ? OUTBUFS_PTR_INDEX : -1;
+    } else if( done && codec_id == OMAP_DCE_VIDENC2 ) {
+        id = ((VIDENC2_InArgs *)inArgs)->inputID;
+        freeBufID = ((VIDENC2_OutArgs *)outArgs)->freeBufID;
+        index = INBUFS_INDEX;
+    }
+
+    if( track && id != 0 ) {
+        for( slot = 0; slot < IVIDEO2_MAX_IO_BUFFERS; slot++ ) {
+            if( ctx->held[slot].id == id ) {
+                /* inputID reused before the codec freed it */
+                process_ctx_unhold(ctx, core, slot);
+            }
+            if( ctx->held[slot].id == 0 && free_slot < 0 ) {
+                free_slot = slot;
+            }
+        }
+        for( i = 0; free_slot >= 0 && i < (int)ctx->fxnCtx.num_xlts && n < MAX_OUTPUT_BUF; i++ ) {
+            if( (int)ctx->xltAry[i].index == index && ref[i] != (uint64_t)-1 ) {
+                ctx->held[free_slot].ref[n++] = ref[i];
+                ref[i] = (uint64_t)-1;
+            }
+        }
+        if( n > 0 ) {
+            ctx->held[free_slot].id = id;
+            ctx->held[free_slot].num = n;
+        }
+    }
+    dce_buf_cache_hold(core, ctx->fxnCtx.num_xlts, ref, -1);
+
+    for( i = 0; track && freeBufID && i < IVIDEO2_MAX_IO_BUFFERS && freeBufID[i] != 0; i++ ) {
+        for( slot = 0; slot < IVIDEO2_MAX_IO_BUFFERS; slot++ ) {
+            if( ctx->held[slot].id == freeBufID[i] ) {
+                process_ctx_unhold(ctx, core, slot);
+            }
+        }
+    }
 }
+#endif
 
-typedef enum process_call_params {
-    CODEC_ID_INDEX = 0,
-    CODEC_HANDLE_INDEX,
-    INBUFS_INDEX,
-    OUTBUFS_INDEX,
-    INARGS_INDEX,
-    OUTARGS_INDEX,
-    OUTBUFS_PTR_INDEX
-} process_call_params;
+/* Free the process context of a deleted instance */
+static void process_ctx_free(process_ctx *ctx, int core)
+{
+#if defined(BUILDOS_LINUX)
+    int     slot;
+
+    for( slot = 0; ctx && slot < IVIDEO2_MAX_IO_BUFFERS; slot++ ) {
+        if( ctx->held[slot].id != 0 ) {
+            process_ctx_unhold(ctx, core, slot);
+        }
+    }
+#endif
+    free(ctx);
+}
 
-#define LUMA_BUF 0
-#define CHROMA_BUF 1
 /*===============================================================*/
 /** process               : Encode/Decode process.
  *
@@ -799,19 +3870,22 @@ typedef enum process_call_params {
 static XDAS_Int32 process(void *codec, void *inBufs, void *outBufs,
                           void *inArgs, void *outArgs, dce_codec_type codec_id)
 {
-    MmRpc_FxnCtx        fxnCtx;
-    MmRpc_Xlt           xltAry[MAX_TOTAL_BUF];
-    int                 fxnRet, count, total_count, numInBufs = 0, numOutBufs = 0;
+    process_ctx         local_ctx;
+    process_ctx         *ctx;
+    int                 fxnRet, numInBufs = 0, numOutBufs = 0;
     dce_error_status    eError = DCE_EOK;
-    void                **data_buf = NULL;
-    void                **buf_arry = NULL;
-    void                **bufSize_arry = NULL;
     int                 numXltAry, numParams;
     int                 coreIdx = INVALID_CORE;
+    int                 conn;
+    dce_priority        prio;
+    rpc_call            call = { NULL };
 
-#ifdef BUILDOS_ANDROID
-    int32_t    inbuf_offset[MAX_INPUT_BUF];
-    int32_t    outbuf_offset[MAX_OUTPUT_BUF];
+#if defined(BUILDOS_ANDROID) || defined(BUILDOS_LINUX)
+    int                 count;
+    int32_t             buf_offset[MAX_TOTAL_BUF];
+#endif
+#if defined(BUILDOS_LINUX)
+    uint64_t            ref[MAX_TOTAL_BUF];
 #endif
 
     _ASSERT(codec != NULL, DCE_EINVALID_INPUT);
@@ -842,146 +3916,308 @@ static XDAS_Int32 process(void *codec, void *inBufs, void *outBufs,
          eError = DCE_EXDM_UNSUPPORTED;
          return eError;
     }
+    _ASSERT(numXltAry <= MAX_TOTAL_BUF, DCE_EINVALID_INPUT);
+
+    /* Listed before the failed state of the instance is read, so a timed call */
+    /* which is cancelled from now on is found by rpc_call_cancel()            */
+    rpc_call_begin(&call, codec, coreIdx);
+    conn = get_codec_conn(codec, &ctx, &prio, &call.stats);
+    /* The context of a failed instance may still be in use by its cancelled call */
+    _ASSERT_AND_EXECUTE(conn >= 0, DCE_EIPC_CALL_FAIL, rpc_call_end(&call));
+    call.marshal_us = stats_start();
+    if( ctx == NULL ) {
+        ctx = &local_ctx;
+        ctx->valid = 0;
+    }
 
-    /* marshall function arguments into the send buffer                       */
-    /* Approach [2] as explained in "Notes" used for process               */
-    Fill_MmRpc_fxnCtx(&fxnCtx, DCE_RPC_CODEC_PROCESS, numParams, numXltAry, xltAry);
-    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[CODEC_ID_INDEX]), sizeof(int32_t), codec_id);
-    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[CODEC_HANDLE_INDEX]), sizeof(int32_t), (int32_t)codec);
-
-    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[INBUFS_INDEX]), GetSz(inBufs), P2H(inBufs),
-                                    sizeof(MemHeader), memplugin_share(inBufs));
-    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[OUTBUFS_INDEX]), GetSz(outBufs), P2H(outBufs),
-                                    sizeof(MemHeader), memplugin_share(outBufs));
-    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[INARGS_INDEX]), GetSz(inArgs), P2H(inArgs),
-                                    sizeof(MemHeader), memplugin_share(inArgs));
-    Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[OUTARGS_INDEX]), GetSz(outArgs), P2H(outArgs),
-                                    sizeof(MemHeader), memplugin_share(outArgs));
+    /* Rebuild the marshalled context only when the descriptor shape changed */
+    if( !ctx->valid || ctx->inBufs != inBufs || ctx->outBufs != outBufs ||
+        ctx->inArgs != inArgs || ctx->outArgs != outArgs ||
+        ctx->numInBufs != numInBufs || ctx->numOutBufs != numOutBufs ||
+        (codec_id == OMAP_DCE_VIDDEC2 && ctx->outBufPtrs != ((XDM_BufDesc *)outBufs)->bufs) ) {
+        process_ctx_build(ctx, codec, inBufs, outBufs, inArgs, outArgs,
+                          numInBufs, numOutBufs, numParams, numXltAry, codec_id);
+    }
+    process_ctx_patch(ctx, coreIdx);
+#if defined(BUILDOS_LINUX)
+    /* Not evicted while the codec uses them, see process_ctx_hold() */
+    memcpy(ref, ctx->reg, numXltAry * sizeof(uint64_t));
+    dce_buf_cache_hold(coreIdx, numXltAry, ref, 1);
+#endif
 
-    /* InBufs, OutBufs, InArgs, OutArgs buffer need translation but since they have been */
-    /* individually mentioned as fxnCtx Params, they need not be mentioned below again */
-    /* Input and Output Buffers have to be mentioned for translation                               */
-    for( count = 0, total_count = 0; count < numInBufs; count++, total_count++ ) {
-         if( codec_id == OMAP_DCE_VIDDEC3 ) {
-              data_buf = (void * *)(&(((XDM2_BufDesc *)inBufs)->descs[count].buf));
-         } else if( codec_id == OMAP_DCE_VIDENC2 ) {
-              data_buf = (void * *)(&(((IVIDEO2_BufDesc *)inBufs)->planeDesc[count].buf));
-         } else if( codec_id == OMAP_DCE_VIDDEC2 ) {
-              data_buf = (void * *)(&(((XDM1_BufDesc *)inBufs)->descs[count].buf));
-         }
-#ifdef BUILDOS_ANDROID
-        inbuf_offset[count] = ((MemHeader*)(*data_buf))->offset;
-        Fill_MmRpc_fxnCtx_Xlt_Array(&(fxnCtx.xltAry[total_count]), INBUFS_INDEX, MmRpc_OFFSET((int32_t)inBufs,
-                                    (int32_t)data_buf), (size_t)(*data_buf),
-                                    (size_t)(((MemHeader*)(*data_buf))->dma_buf_fd));
-        *data_buf += inbuf_offset[count];
-#else
-        Fill_MmRpc_fxnCtx_Xlt_Array(&(fxnCtx.xltAry[total_count]), INBUFS_INDEX,
-                                    MmRpc_OFFSET((int32_t)inBufs, (int32_t)data_buf),
-                                    (size_t)*data_buf, (size_t)*data_buf);
-#ifdef BUILDOS_LINUX
-        /*Single planar input buffer for Encoder. No adjustments needed for Multiplanar case*/
-        if( count == CHROMA_BUF && codec_id == OMAP_DCE_VIDENC2 && ((IVIDEO2_BufDesc *)inBufs)->planeDesc[LUMA_BUF].buf == ((IVIDEO2_BufDesc *)inBufs)->planeDesc[CHROMA_BUF].buf ) {
-            if( ((IVIDEO2_BufDesc *)inBufs)->planeDesc[count].memType == XDM_MEMTYPE_RAW ||
-               ((IVIDEO2_BufDesc *)inBufs)->planeDesc[count].memType == XDM_MEMTYPE_TILEDPAGE )
-                *data_buf += ((IVIDEO2_BufDesc *)inBufs)->planeDesc[LUMA_BUF].bufSize.bytes;
-            else
-                *data_buf += ((IVIDEO2_BufDesc *)inBufs)->planeDesc[LUMA_BUF].bufSize.tileMem.width *
-                                ((IVIDEO2_BufDesc *)inBufs)->planeDesc[LUMA_BUF].bufSize.tileMem.height;
+#if defined(BUILDOS_ANDROID) || defined(BUILDOS_LINUX)
+    /* Point the data buffers to the actual data within the buffer */
+    for( count = 0; count < numXltAry; count++ ) {
+        buf_offset[count] = 0;
+        if( ctx->type[count] == XLT_MEMHEADER ) {
+            buf_offset[count] = ((MemHeader *)(*(ctx->field[count])))->offset;
+            *(ctx->field[count]) += buf_offset[count];
         }
-#endif //BUILDOS_LINUX
-#endif //BUILDOS_ANDROID
     }
+#endif
+#if defined(BUILDOS_LINUX)
+    /*Single planar input buffer for Encoder. No adjustments needed for Multiplanar case*/
+    if( codec_id == OMAP_DCE_VIDENC2 && numInBufs > CHROMA_BUF &&
+        ((IVIDEO2_BufDesc *)inBufs)->planeDesc[LUMA_BUF].buf == ((IVIDEO2_BufDesc *)inBufs)->planeDesc[CHROMA_BUF].buf ) {
+        single_planar_chroma(&(((IVIDEO2_BufDesc *)inBufs)->planeDesc[LUMA_BUF]),
+                             &(((IVIDEO2_BufDesc *)inBufs)->planeDesc[CHROMA_BUF]));
+    }
+    /* SinglePlanar Buffers for Decode usecase*/
+    if( (codec_id == OMAP_DCE_VIDENC2 || codec_id == OMAP_DCE_VIDDEC3) && numOutBufs > CHROMA_BUF &&
+        ((XDM2_BufDesc *)outBufs)->descs[LUMA_BUF].buf == ((XDM2_BufDesc *)outBufs)->descs[CHROMA_BUF].buf ) {
+        single_planar_chroma(&(((XDM2_BufDesc *)outBufs)->descs[LUMA_BUF]),
+                             &(((XDM2_BufDesc *)outBufs)->descs[CHROMA_BUF]));
+    }
+#endif
 
-    /* Output Buffers */
-    for( count = 0; count < numOutBufs; count++, total_count++ ) {
-        if( codec_id == OMAP_DCE_VIDENC2 || codec_id == OMAP_DCE_VIDDEC3 ) {
-            if( ((XDM2_BufDesc *)outBufs)->descs[LUMA_BUF].buf != ((XDM2_BufDesc *)outBufs)->descs[CHROMA_BUF].buf ) {
-                /* Either Encode usecase or MultiPlanar Buffers for Decode usecase */
-                data_buf = (void * *)(&(((XDM2_BufDesc *)outBufs)->descs[count].buf));
-#ifdef BUILDOS_ANDROID
-                outbuf_offset[count] = ((MemHeader*)(*data_buf))->offset;
-                Fill_MmRpc_fxnCtx_Xlt_Array(&(fxnCtx.xltAry[total_count]), OUTBUFS_INDEX, MmRpc_OFFSET((int32_t)outBufs,
-                                            (int32_t)data_buf), (size_t)(*data_buf),
-                                            (size_t)(((MemHeader*)(*data_buf))->dma_buf_fd));
-                *data_buf += outbuf_offset[count];
+    /* Invoke the Remote function through MmRpc */
+    eError = dce_ipc_call_tracked(coreIdx, conn, prio, &call, &ctx->fxnCtx, &fxnRet);
 
-#else
-                Fill_MmRpc_fxnCtx_Xlt_Array(&(fxnCtx.xltAry[total_count]), OUTBUFS_INDEX,
-                                            MmRpc_OFFSET((int32_t)outBufs, (int32_t)data_buf),
-                                            (size_t)*data_buf, (size_t)*data_buf);
+#if defined(BUILDOS_ANDROID) || defined(BUILDOS_LINUX)
+    /* restore the actual buf ptr before returing to the mmf */
+    for( count = 0; count < numXltAry; count++ ) {
+        *(ctx->field[count]) -= buf_offset[count];
+    }
 #endif
-              }
 #if defined(BUILDOS_LINUX)
-              else {
-                   /* SinglePlanar Buffers for Decode usecase*/
-                   data_buf = (void * *)(&(((XDM2_BufDesc *)outBufs)->descs[count].buf));
-                   Fill_MmRpc_fxnCtx_Xlt_Array(&(fxnCtx.xltAry[total_count]), OUTBUFS_INDEX,
-                        MmRpc_OFFSET((int32_t)outBufs, (int32_t)data_buf),
-                        (size_t)*data_buf, (size_t)*data_buf);
-
-                   if( count == CHROMA_BUF ) {
-                        if( ((XDM2_BufDesc *)outBufs)->descs[count].memType == XDM_MEMTYPE_RAW ||
-                           ((XDM2_BufDesc *)outBufs)->descs[count].memType == XDM_MEMTYPE_TILEDPAGE ) {
-                             *data_buf += ((XDM2_BufDesc *)outBufs)->descs[LUMA_BUF].bufSize.bytes;
-                        } else {
-                             *data_buf += ((XDM2_BufDesc *)outBufs)->descs[LUMA_BUF].bufSize.tileMem.width *
-                                  ((XDM2_BufDesc *)outBufs)->descs[LUMA_BUF].bufSize.tileMem.height;
-                        }
-                   }
-              }
+    process_ctx_hold(ctx, coreIdx, ref, codec_id, inArgs, outArgs, eError == DCE_EOK, ctx != &local_ctx);
 #endif
-         } else if( codec_id == OMAP_DCE_VIDDEC2 ) {
-              if( count == LUMA_BUF ) {
-                   buf_arry = (void * *)(&(((XDM_BufDesc *)outBufs)->bufs));
+    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+
+    eError = (dce_error_status)(fxnRet);
+
+    /* A failure or new sequence parameters may change the buffer requirements */
+    if( fxnRet != XDM_EOK ||
+        (codec_id == OMAP_DCE_VIDDEC3 && ((((VIDDEC3_OutArgs *)outArgs)->extendedError >> XDM_PARAMSCHANGE) & 0x1)) ||
+        (codec_id == OMAP_DCE_VIDENC2 && ((((VIDENC2_OutArgs *)outArgs)->extendedError >> XDM_PARAMSCHANGE) & 0x1)) ) {
+        control_cache_invalidate_codec(codec);
+    }
+
+EXIT:
+    return (eError);
+}
+
+/* DCE_RPC_CODEC_DELETE of a codec on a connection, call as dce_ipc_call_tracked() */
+static int remote_delete(void *codec, dce_codec_type codec_id, int core, int conn,
+                         dce_priority prio, rpc_call *call)
+{
+    MmRpc_FxnCtx    fxnCtx;
+    int32_t         fxnRet;
+
+    /* Marshall function arguments into the send buffer */
+    Fill_MmRpc_fxnCtx(&fxnCtx, DCE_RPC_CODEC_DELETE, 2, 0, NULL);
+    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[0]), sizeof(int32_t), codec_id);
+    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[1]), sizeof(int32_t), (int32_t)codec);
 
-                   Fill_MmRpc_fxnCtx_Xlt_Array(&(fxnCtx.xltAry[total_count]), OUTBUFS_INDEX,
-                        MmRpc_OFFSET((int32_t)outBufs, (int32_t)buf_arry),
-                        (size_t)P2H(*buf_arry), (size_t)memplugin_share(*buf_arry));
+    /* Invoke the Remote function through MmRpc */
+    return (dce_ipc_call_tracked(core, conn, prio, call, &fxnCtx, &fxnRet));
+}
+
+/***************** Timed process calls ****************/
+/* *_processTimed() hands the call to a worker thread of the instance and waits  */
+/* for it until the deadline. When the deadline expires the instance is marked  */
+/* failed, the remote call is cancelled with rpc_call_cancel() and the caller is */
+/* released. Later remote calls of a failed instance fail at once. The worker   */
+/* stays blocked until the remote core answers or the connection is closed. A   */
+/* failed instance deleted meanwhile is deleted remotely by the worker then.    */
+typedef enum timed_state {
+    TIMED_IDLE = 0,
+    TIMED_QUEUED,
+    TIMED_RUNNING,
+    TIMED_DONE,
+    TIMED_EXIT
+} timed_state;
+
+typedef struct timed_worker {
+    pthread_t           thread;
+    pthread_mutex_t     lock;
+    pthread_cond_t      cond;
+    timed_state         state;
+    int                 detached;   /* codec deleted during the call, the worker frees itself */
+    int                 delete_pending; /* detached worker deletes the remote instance */
+    void                *codec;
+    dce_codec_type      codec_id;
+    int                 core;
+    int                 conn;
+    dce_priority        priority;
+    int                 epoch;      /* of the connection pool the codec was created in */
+    void                *inBufs;
+    void                *outBufs;
+    void                *inArgs;
+    void                *outArgs;
+    XDAS_Int32          ret;
+    process_ctx         *pctx;      /* process context freed by a detached worker */
+} timed_worker;
+
+static void timed_worker_free(timed_worker *w)
+{
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->lock);
+    process_ctx_free(w->pctx, w->core);
+    free(w);
+}
 
-                   total_count++;
+static void *timed_worker_thread(void *arg)
+{
+    timed_worker    *w = (timed_worker *) arg;
+    XDAS_Int32      ret;
+    int             detached;
+
+    pthread_mutex_lock(&w->lock);
+    while( 1 ) {
+        while( w->state != TIMED_QUEUED && w->state != TIMED_EXIT ) {
+            pthread_cond_wait(&w->cond, &w->lock);
+        }
+        if( w->state == TIMED_EXIT ) {
+            break;
+        }
+        w->state = TIMED_RUNNING;
+        pthread_mutex_unlock(&w->lock);
 
-                   bufSize_arry = (void * *)(&(((XDM_BufDesc *)outBufs)->bufSizes));
+        ret = process(w->codec, w->inBufs, w->outBufs, w->inArgs, w->outArgs, w->codec_id);
 
-                   Fill_MmRpc_fxnCtx_Xlt_Array(&(fxnCtx.xltAry[total_count]), OUTBUFS_INDEX,
-                        MmRpc_OFFSET((int32_t)outBufs, (int32_t)bufSize_arry),
-                        (size_t)P2H(*bufSize_arry), (size_t)memplugin_share(*bufSize_arry));
+        pthread_mutex_lock(&w->lock);
+        w->ret = ret;
+        if( w->detached ) {
+            break;
+        }
+        w->state = TIMED_DONE;
+        pthread_cond_broadcast(&w->cond);
+    }
+    detached = w->detached;
+    pthread_mutex_unlock(&w->lock);
 
-                   total_count++;
-              }
+    if( detached ) {
+        /* A closed connection took the remote instance with it */
+        if( w->delete_pending && dce_ipc_epoch(w->core) == w->epoch ) {
+            remote_delete(w->codec, w->codec_id, w->core, w->conn, w->priority, NULL);
+        }
+        timed_worker_free(w);
+    }
+    return (NULL);
+}
 
-              Fill_MmRpc_fxnCtx_OffPtr_Params(&(fxnCtx.params[OUTBUFS_PTR_INDEX]), GetSz(*buf_arry), P2H(*buf_arry),
-                   sizeof(MemHeader), memplugin_share(*buf_arry));
+/* Worker of an instance, must be called with ipc_mutex held */
+static timed_worker *timed_worker_create(dce_instance *inst)
+{
+    timed_worker    *w = calloc(1, sizeof(timed_worker));
 
-              data_buf = (void * *)(&(((XDM_BufDesc *)outBufs)->bufs[count]));
+    if( w == NULL ) {
+        return (NULL);
+    }
+    w->codec = inst->codec;
+    w->codec_id = inst->codec_id;
+    w->core = inst->core;
+    w->conn = inst->conn;
+    w->priority = inst->priority;
+    w->epoch = dce_ipc_epoch(inst->core);
+    w->state = TIMED_IDLE;
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->cond, NULL);
+    if( pthread_create(&w->thread, NULL, timed_worker_thread, w) ) {
+        ERROR("Failed to start the timed process worker of codec %p", inst->codec);
+        timed_worker_free(w);
+        return (NULL);
+    }
+    return (w);
+}
 
-              Fill_MmRpc_fxnCtx_Xlt_Array(&(fxnCtx.xltAry[total_count]), OUTBUFS_PTR_INDEX,
-                   MmRpc_OFFSET((int32_t)*buf_arry, (int32_t)data_buf), (size_t)*data_buf, (size_t)*data_buf);
-         }
+/* Stop the worker of a deleted instance. A worker blocked in the remote call is */
+/* detached and frees itself with pctx when the call returns, after deleting the */
+/* remote instance if remote_delete is set: 1 is returned then.                  */
+static int timed_worker_release(timed_worker *w, process_ctx *pctx, int remote_delete)
+{
+    pthread_mutex_lock(&w->lock);
+    if( w->state == TIMED_RUNNING ) {
+        w->detached = 1;
+        w->delete_pending = remote_delete;
+        w->pctx = pctx;
+        pthread_mutex_unlock(&w->lock);
+        pthread_detach(w->thread);
+        return (1);
     }
+    /* A queued call was not issued yet, drop it */
+    w->state = TIMED_EXIT;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
 
-    /* Invoke the Remote function through MmRpc */
-    eError = MmRpc_call(MmRpcHandle[coreIdx], &fxnCtx, &fxnRet);
-    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+    pthread_join(w->thread, NULL);
+    timed_worker_free(w);
+    return (0);
+}
 
-#ifdef BUILDOS_ANDROID
-    for( count = 0; count < numInBufs; count++ ) {
-        if( codec_id == OMAP_DCE_VIDDEC3 ) {
-            /* restore the actual buf ptr before returing to the mmf */
-            data_buf = (void * *)(&(((XDM2_BufDesc *)inBufs)->descs[count].buf));
-        } else if( codec_id == OMAP_DCE_VIDDEC2 ) {
-            /* restore the actual buf ptr before returing to the mmf */
-            data_buf = (void * *)(&(((XDM1_BufDesc *)inBufs)->descs[count].buf));
+/*===============================================================*/
+/** timed_process      : process() with a deadline.
+ *
+ * @ param timeout [in]    : Timeout in microseconds or VISA_FOREVER.
+ * @ return : Return value of process(), VISA_ETIMEOUT if the call was cancelled,
+ *            DCE_EIPC_CALL_FAIL if the instance has failed.
+ */
+static XDAS_Int32 timed_process(void *codec, void *inBufs, void *outBufs, void *inArgs,
+                                void *outArgs, dce_codec_type codec_id, UInt timeout)
+{
+    dce_instance        *inst;
+    timed_worker        *w;
+    struct timespec     abstime;
+    XDAS_Int32          ret;
+    dce_error_status    eError = DCE_EOK;
+    int                 expired = 0;
+
+    _ASSERT(codec != NULL, DCE_EINVALID_INPUT);
+    _ASSERT(timeout > 0, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&ipc_mutex);
+    inst = get_instance(codec);
+    _ASSERT_AND_EXECUTE(inst != NULL, DCE_EINVALID_INPUT, pthread_mutex_unlock(&ipc_mutex));
+    _ASSERT_AND_EXECUTE(!inst->failed, DCE_EIPC_CALL_FAIL, pthread_mutex_unlock(&ipc_mutex));
+    /* The row mode exchange armed around the call can't be abandoned */
+    _ASSERT_AND_EXECUTE(inst->callback == NULL, DCE_EXDM_UNSUPPORTED, pthread_mutex_unlock(&ipc_mutex));
+    if( inst->timed == NULL ) {
+        inst->timed = timed_worker_create(inst);
+    }
+    w = inst->timed;
+    pthread_mutex_unlock(&ipc_mutex);
+    _ASSERT(w != NULL, DCE_EOUT_OF_MEMORY);
+
+    if( timeout != VISA_FOREVER ) {
+        deadline_us(&abstime, timeout);
+    }
+
+    pthread_mutex_lock(&w->lock);
+    /* One timed call at a time per instance */
+    _ASSERT_AND_EXECUTE(w->state == TIMED_IDLE, DCE_EINVALID_INPUT, pthread_mutex_unlock(&w->lock));
+    w->inBufs = inBufs;
+    w->outBufs = outBufs;
+    w->inArgs = inArgs;
+    w->outArgs = outArgs;
+    w->state = TIMED_QUEUED;
+    pthread_cond_broadcast(&w->cond);
+
+    while( w->state != TIMED_DONE && !expired ) {
+        if( timeout == VISA_FOREVER ) {
+            pthread_cond_wait(&w->cond, &w->lock);
+        } else if( pthread_cond_timedwait(&w->cond, &w->lock, &abstime) == ETIMEDOUT ) {
+            expired = (w->state != TIMED_DONE);
         }
-        *data_buf -= inbuf_offset[count];
     }
-    for (count = 0; count < numOutBufs; count++){
-        data_buf = (void * *)(&(((XDM2_BufDesc *)outBufs)->descs[count].buf));
-        *data_buf -= outbuf_offset[count];
+    if( !expired ) {
+        ret = w->ret;
+        w->state = TIMED_IDLE;
+        pthread_mutex_unlock(&w->lock);
+        return (ret);
     }
-#endif
+    pthread_mutex_unlock(&w->lock);
 
-    eError = (dce_error_status)(fxnRet);
+    ERROR("codec %p process call did not complete in %u us, the instance is failed", codec, timeout);
+    pthread_mutex_lock(&ipc_mutex);
+    inst = get_instance(codec);
+    if( inst ) {
+        inst->failed = 1;
+    }
+    pthread_mutex_unlock(&ipc_mutex);
+    rpc_call_cancel(codec);
+
+    return (VISA_ETIMEOUT);
 
 EXIT:
     return (eError);
@@ -996,93 +4232,177 @@ EXIT:
  */
 static void delete(void *codec, dce_codec_type codec_id)
 {
-    MmRpc_FxnCtx        fxnCtx;
-    int32_t             fxnRet;
     dce_error_status    eError = DCE_EOK;
     int                 coreIdx = INVALID_CORE;
+    dce_priority        prio;
+    int                 conn;
+    rpc_call            call = { NULL };
 
     _ASSERT(codec != NULL, DCE_EINVALID_INPUT);
     coreIdx = getCoreIndexFromCodec(codec_id);
     _ASSERT(coreIdx != INVALID_CORE, DCE_EINVALID_INPUT);
 
-    /* Marshall function arguments into the send buffer */
-    Fill_MmRpc_fxnCtx(&fxnCtx, DCE_RPC_CODEC_DELETE, 2, 0, NULL);
-    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[0]), sizeof(int32_t), codec_id);
-    Fill_MmRpc_fxnCtx_Scalar_Params(&(fxnCtx.params[1]), sizeof(int32_t), (int32_t)codec);
+    conn = get_codec_conn(codec, NULL, &prio, &call.stats);
+    if( conn < 0 ) {
+        /* Failed instance: deleted remotely now if its cancelled call returned, */
+        /* else by its timed worker when it does                                 */
+        conn = unregister_instance(codec);
+        if( conn >= 0 ) {
+            remote_delete(codec, codec_id, coreIdx, conn, prio, NULL);
+        }
+        return;
+    }
 
-    /* Invoke the Remote function through MmRpc */
-    eError = MmRpc_call(MmRpcHandle[coreIdx], &fxnCtx, &fxnRet);
+    call.marshal_us = stats_start();
+    eError = remote_delete(codec, codec_id, coreIdx, conn, prio, &call);
     _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
 
 EXIT:
+    if( codec != NULL ) {
+        unregister_instance(codec);
+    }
     return;
 }
 
+/*===============================================================*/
+/** setup_row_mode      : Prepare the row mode state of a low latency
+ *                        (IVIDEO_NUMROWS) codec instance.
+ *
+ * @ param cb [in]         : Row mode state obtained from reserve_callback().
+ * @ param maxHeight [in]  : maxHeight of the codec static params.
+ * @ param exchange [in]   : dce_callback_putDataFxn for a decoder, dce_callback_getDataFxn for an encoder.
+ * @ return : Error Status.
+ */
+static int setup_row_mode(CallbackFlag *cb, int maxHeight, void (*exchange)(CallbackFlag *cb))
+{
+    MmRpc_Params        args;
+    dce_error_status    eError = DCE_EOK;
+    int                 needed, workers;
+
+    pthread_mutex_lock(&ipc_mutex);
+    DEBUG("MmRpcCallbackHandle 0x%x MmRpcCallback_count %d", (int)MmRpcCallbackHandle, MmRpcCallback_count);
+    if( !MmRpcCallbackHandle ) {
+        /* Need to create another MmRpcHandle for codec callback */
+        MmRpc_Params_init(&args);
+        eError = MmRpc_create(DCE_CALLBACK_NAME, &args, &MmRpcCallbackHandle);
+        _ASSERT_AND_EXECUTE(eError == DCE_EOK, DCE_EIPC_CREATE_FAIL, MmRpcCallbackHandle = NULL; pthread_mutex_unlock(&ipc_mutex));
+        DEBUG("open(/dev/%s]) -> 0x%x\n", DCE_CALLBACK_NAME, (int)MmRpcCallbackHandle);
+    }
+    /* A streaming instance holds a worker for its whole exchange with the codec, */
+    /* so the pool grows up to one worker per low latency instance.              */
+    needed = MmRpcCallback_count + 1;
+    workers = needed > __CbPoolSize ? needed : __CbPoolSize;
+    if( needed > DCE_MAX_CALLBACK_WORKERS ) {
+        ERROR("%d low latency instances, the callback workers serve at most %d", needed, DCE_MAX_CALLBACK_WORKERS);
+        eError = DCE_EXDM_UNSUPPORTED;
+    } else if( __CbWorkerCount < workers ) {
+        eError = callback_pool_start(workers, needed);
+    }
+    _ASSERT_AND_EXECUTE(eError == DCE_EOK, eError,
+                        if( MmRpcCallback_count == 0 ) {
+                            callback_pool_stop();
+                            MmRpc_delete(&MmRpcCallbackHandle);
+                            MmRpcCallbackHandle = NULL;
+                        }
+                        pthread_mutex_unlock(&ipc_mutex));
+    MmRpcCallback_count++;
+    pthread_mutex_unlock(&ipc_mutex);
+
+    cb->row_mode = 1;
+    cb->first_control = TRUE;
+    cb->total_numBlocks = maxHeight / 16;
+    cb->exchange = exchange;
+    DEBUG("callback[%d]->total_numBlocks %d", cb->id, cb->total_numBlocks);
+
+    pthread_mutex_init(&cb->lock, NULL);
+    pthread_cond_init(&cb->cond, NULL);
+    cb->state = CB_IDLE;
+
+    cb->local_dataSyncDesc = memplugin_alloc(sizeof(XDM_DataSyncDesc), 1, DEFAULT_REGION, 0, IPU);
+    DEBUG("Checking local_dataSyncDesc %p", cb->local_dataSyncDesc);
+    _ASSERT(cb->local_dataSyncDesc != NULL, DCE_EOUT_OF_MEMORY);
+
+EXIT:
+    return (eError);
+}
+
+/*===============================================================*/
+/** release_callback    : Free the row mode state of a codec instance and the
+ *                        resources attached to it. The instance must already
+ *                        be retired with callback_retire().
+ *
+ * @ param cb [in]         : Row mode state obtained from reserve_callback().
+ */
+static void release_callback(CallbackFlag *cb)
+{
+    if( cb->row_mode ) {
+        if( cb->latency.count ) {
+            INFO("callback[%d] row callback latency avg %u us p99 %u us max %u us over %u callbacks", cb->id,
+                 (unsigned int)(cb->latency.total_us / cb->latency.count), dce_stats_percentile(&cb->latency, 99),
+                 cb->latency.max_us, cb->latency.count);
+        }
+
+        /* Clean up the allocation earlier. */
+        memplugin_free(cb->local_dataSyncDesc);
+
+        pthread_cond_destroy(&cb->cond);
+        pthread_mutex_destroy(&cb->lock);
+
+        pthread_mutex_lock(&ipc_mutex);
+        MmRpcCallback_count--;
+        DEBUG("Checking on MmRpcCallback_count %d MmRpcCallbackHandle 0x%x", MmRpcCallback_count, (unsigned int) MmRpcCallbackHandle);
+        if( MmRpcCallback_count == 0 && MmRpcCallbackHandle != NULL ) {
+            callback_pool_stop();
+            MmRpc_delete(&MmRpcCallbackHandle);
+            MmRpcCallbackHandle = NULL;
+        }
+        pthread_mutex_unlock(&ipc_mutex);
+    }
+
+    free(cb);
+}
+
 /***************** VIDDEC3 Decoder Codec Engine Functions ****************/
 VIDDEC3_Handle VIDDEC3_create(Engine_Handle engine, String name,
                               VIDDEC3_Params *params)
 {
     VIDDEC3_Handle codec = NULL;
-    MmRpc_Params args;
-    dce_error_status eError = DCE_EOK;
-    int id;
-
-    /*Acquire permission to use IPC*/
-    pthread_mutex_lock(&ipc_mutex);
-
-    id = get_callback(0);
-    if (id < 0) {
-        /* This is depended on the MAX_INSTANCE, by default it handles only 5 instances of codec instance (full frame or low latency) */
-        ERROR("Failed because too many codec clients, Max is %d. MAX_INSTANCES default needs to be changed if required.", MAX_INSTANCES);
-        goto EXIT;
-    } else { /* Found empty array to be populated */
-        if( params->outputDataMode == IVIDEO_NUMROWS ) {
-            (callbackmsg[id]).row_mode = 1;
-            (callbackmsg[id]).first_control = TRUE;
-            (callbackmsg[id]).total_numBlocks = params->maxHeight / 16;
-            DEBUG("callbackmsg[%d]->total_numBlocks %d", id, (callbackmsg[id]).total_numBlocks);
-
-            (callbackmsg[id]).local_dataSyncDesc = memplugin_alloc(sizeof(XDM_DataSyncDesc), 1, DEFAULT_REGION, 0, IPU);
-            DEBUG("Checking local_dataSyncDesc %p local_put_DataFxn %p local_dataSyncHandle %p",
-                (callbackmsg[id]).local_dataSyncDesc, (callbackmsg[id]).local_put_DataFxn, (callbackmsg[id]).local_dataSyncHandle);
-            if( (callbackmsg[id]).local_dataSyncDesc == NULL ) {
-                goto EXIT;
-            }
+    CallbackFlag *cb = NULL;
 
-            /* Create sem_dec_row_mode */
-            sem_init(&((callbackmsg[id]).sem_dec_row_mode), 0, 0);
-
-            DEBUG("MmRpcCallbackHandle 0x%x MmRpcCallback_count %d", (int)MmRpcCallbackHandle, MmRpcCallback_count);
-            if( !MmRpcCallbackHandle ) {
-                /* Need to create another MmRpcHandle for codec callback */
-                MmRpc_Params_init(&args);
-                eError = MmRpc_create(DCE_CALLBACK_NAME, &args, &MmRpcCallbackHandle);
-                _ASSERT_AND_EXECUTE(eError == DCE_EOK, DCE_EIPC_CREATE_FAIL, MmRpcCallbackHandle = NULL);
-                DEBUG("open(/dev/%s]) -> 0x%x\n", DCE_CALLBACK_NAME, (int)MmRpcCallbackHandle);
-            }
-            MmRpcCallback_count++;
-        } else if( params->outputDataMode == IVIDEO_ENTIREFRAME ) {
-            (callbackmsg[id]).row_mode = 0; /* full frame; the other parameters are not used in full frame mode */
-        } else {
-            ERROR("outputDataMode %d is not supported.", params->outputDataMode);
+    if( params->outputDataMode == IVIDEO_NUMROWS ) {
+        pthread_mutex_lock(&ipc_mutex);
+        cb = reserve_callback();
+        pthread_mutex_unlock(&ipc_mutex);
+        if( cb == NULL ) {
+            ERROR("Failed to allocate the row mode state");
+            goto EXIT;
+        }
+        if( setup_row_mode(cb, params->maxHeight, dce_callback_putDataFxn) != DCE_EOK ) {
             goto EXIT;
         }
         DEBUG("Checking row_mode %d first_control %d",
-            (callbackmsg[id]).row_mode, (callbackmsg[id]).first_control);
+            cb->row_mode, cb->first_control);
+    } else if( params->outputDataMode != IVIDEO_ENTIREFRAME ) {
+        ERROR("outputDataMode %d is not supported.", params->outputDataMode);
+        goto EXIT;
     }
 
     DEBUG(">> engine=%p, name=%s, params=%p", engine, name, params);
     codec = create(engine, name, params, OMAP_DCE_VIDDEC3);
     DEBUG("<< codec=%p", codec);
 
-    if( params->outputDataMode == IVIDEO_NUMROWS ) {
-        (callbackmsg[id]).codec_handle = (XDAS_UInt32) codec;
-        DEBUG("Saving the codec %p to (callbackmsg[%d]).codec_handle = 0x%x", codec, id, (unsigned int) (callbackmsg[id]).codec_handle);
+    if( cb != NULL && codec != NULL ) {
+        pthread_mutex_lock(&ipc_mutex);
+        cb->codec_handle = (XDAS_UInt32) codec;
+        attach_callback(codec, cb);
+        pthread_mutex_unlock(&ipc_mutex);
+        DEBUG("Saving the codec %p to callback[%d]->codec_handle = 0x%x", codec, cb->id, (unsigned int) cb->codec_handle);
     }
 
 EXIT:
-    /*Relinquish IPC*/
-    pthread_mutex_unlock(&ipc_mutex);
+    if( cb != NULL && codec == NULL ) {
+        release_callback(cb);
+    }
     return (codec);
 }
 
@@ -1090,25 +4410,27 @@ XDAS_Int32 VIDDEC3_control(VIDDEC3_Handle codec, VIDDEC3_Cmd cmd_id,
                            VIDDEC3_DynamicParams *dynParams, VIDDEC3_Status *status)
 {
     XDAS_Int32 ret;
-    int id;
+    CallbackFlag *cb;
 
-    /*Acquire permission to use IPC*/
     pthread_mutex_lock(&ipc_mutex);
+    cb = get_callback(codec);
+    pthread_mutex_unlock(&ipc_mutex);
 
-    id = get_callback((Uint32) codec);
-    if( id < 0 ) {
+    if( cb == NULL ) {
         DEBUG("Could not find the entry; control on full frame mode");
     } else {
+        pthread_mutex_lock(&cb->lock);
         DEBUG("Checking codec_handle 0x%x row_mode %d first_control %d",
-            (unsigned int) (callbackmsg[id]).codec_handle, (callbackmsg[id]).row_mode, (callbackmsg[id]).first_control);
-        if( (callbackmsg[id]).row_mode && (callbackmsg[id]).first_control ) {
+            (unsigned int) cb->codec_handle, cb->row_mode, cb->first_control);
+        if( cb->row_mode && cb->first_control ) {
             /* dynParams has the function callback; store the information as it will get overwritten by the M4 codec for their own callback Fxn. */
-            (callbackmsg[id]).local_put_DataFxn = (void*) dynParams->putDataFxn;
-            (callbackmsg[id]).local_dataSyncHandle = dynParams->putDataHandle;
-            (callbackmsg[id]).first_control = FALSE;
+            cb->local_put_DataFxn = (void*) dynParams->putDataFxn;
+            cb->local_dataSyncHandle = dynParams->putDataHandle;
+            cb->first_control = FALSE;
             DEBUG("Set callback pointer local_get_dataFxn %p local_dataSyncHandle %p",
-                (callbackmsg[id]).local_put_DataFxn, (callbackmsg[id]).local_dataSyncHandle);
+                cb->local_put_DataFxn, cb->local_dataSyncHandle);
         }
+        pthread_mutex_unlock(&cb->lock);
 
         if( cmd_id == XDM_FLUSH ) {
             DEBUG("FLUSH HAS BEEN ORDERED");
@@ -1124,8 +4446,6 @@ XDAS_Int32 VIDDEC3_control(VIDDEC3_Handle codec, VIDDEC3_Cmd cmd_id,
     }
     DEBUG("dynParams->putDataFxn %p", dynParams->putDataFxn);
     DEBUG("<< ret=%d", ret);
-    /*Relinquish IPC*/
-    pthread_mutex_unlock(&ipc_mutex);
     return (ret);
 }
 
@@ -1134,109 +4454,112 @@ XDAS_Int32 VIDDEC3_process(VIDDEC3_Handle codec,
                            VIDDEC3_InArgs *inArgs, VIDDEC3_OutArgs *outArgs)
 {
     XDAS_Int32 ret;
-    pthread_attr_t attr;
-    int id;
+    CallbackFlag *cb;
 
     DEBUG(">> codec=%p, inBufs=%p, outBufs=%p, inArgs=%p, outArgs=%p",
           codec, inBufs, outBufs, inArgs, outArgs);
 
-    /*Acquire permission to use IPC*/
     pthread_mutex_lock(&ipc_mutex);
-    id = get_callback((Uint32) codec);
-    if( id < 0 ) {
+    cb = get_callback(codec);
+    pthread_mutex_unlock(&ipc_mutex);
+
+    if( cb == NULL || !cb->row_mode ) {
         DEBUG("Received VIDDEC3_process for ENTIRE/FULL FRAME decoding.");
     } else {
-        pthread_mutex_lock(&dce_callback_mutex);
-        DEBUG("Checking row_mode %d SETTING (callbackmsg[id]).putDataFlag = 0", (callbackmsg[id]).row_mode);
-        if( (callbackmsg[id]).row_mode ) {
-            (callbackmsg[id]).putDataFlag = 0;
-            DEBUG("Checking callbackmsg[%d]->putDataFxn_thread %p", id, (void*) (callbackmsg[id]).putDataFxn_thread);
-            if( !(callbackmsg[id]).putDataFxn_thread ) {
-                /* Need to start a new thread for the callback handling to request for data - process call will be synchronous. */
-                pthread_attr_init(&attr);
-                pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-                if( pthread_create(&((callbackmsg[id]).putDataFxn_thread), &attr, (void*)dce_callback_putDataFxn, (void*) &codec) ) {
-                    pthread_mutex_unlock(&ipc_mutex);
-                    return DCE_EXDM_FAIL;
-                }
-            }
-            DEBUG("Checking thread callbackmsg[%d]->putDataFxn_thread %p", id, (void*) (callbackmsg[id]).putDataFxn_thread);
-
-            /* Start the callback to get putDataFxn from codec to client. */
-            (callbackmsg[id]).putDataFlag = 1;
-            sem_post(&((callbackmsg[id]).sem_dec_row_mode));
-
-            DEBUG("Start the callback to client callbackmsg[%d]->putDataFlag %d on callbackmsg[%d]->local_dataSyncHandle 0x%x",
-                id, (callbackmsg[id]).putDataFlag, id, (unsigned int) (callbackmsg[id]).local_dataSyncHandle);
-        }
-        pthread_mutex_unlock(&dce_callback_mutex);
+        /* Start the callback to get putDataFxn from codec to client. */
+        callback_arm(cb);
+        DEBUG("Start the callback to client callback[%d] on callback[%d]->local_dataSyncHandle 0x%x",
+            cb->id, cb->id, (unsigned int) cb->local_dataSyncHandle);
     }
 
     ret = process(codec, inBufs, outBufs, inArgs, outArgs, OMAP_DCE_VIDDEC3);
     DEBUG("<< ret=%d", ret);
 
-    if( (id >= 0) && ((callbackmsg[id]).row_mode) ) {
-        DEBUG("(callbackmsg[%d]).receive_numBlocks %d >= (callbackmsg[%d]).total_numBlocks %d",
-            id, (callbackmsg[id]).receive_numBlocks, id, (callbackmsg[id]).total_numBlocks);
-
-        if( (callbackmsg[id]).receive_numBlocks >= (callbackmsg[id]).total_numBlocks ) {
-            DEBUG("Stop the callback to client callbackmsg[%d]->putDataFlag %d reach full frame (callbackmsg[%d]).receive_numBlocks %d",
-                id, (callbackmsg[id]).putDataFlag, id, (callbackmsg[id]).receive_numBlocks);
-            (callbackmsg[id]).putDataFlag = 0;
-            if ((callbackmsg[id]).receive_numBlocks) {
-                DEBUG("Waiting for dce_callback_putDataFxn to be in waiting case.");
-                sem_wait(&((callbackmsg[id]).sem_dec_row_mode));
-            }
-        }
+    if( (cb != NULL) && (cb->row_mode) ) {
+        /* Every row the codec produced for this frame is delivered before returning */
+        callback_drain(cb);
+        DEBUG("Stop the callback to client callback[%d] callback[%d]->receive_numBlocks %d",
+            cb->id, cb->id, cb->receive_numBlocks);
     }
 
-    /*Relinquish IPC*/
-    pthread_mutex_unlock(&ipc_mutex);
+    return (ret);
+}
+
+XDAS_Int32 VIDDEC3_processAsync(VIDDEC3_Handle codec,
+                                XDM2_BufDesc *inBufs, XDM2_BufDesc *outBufs,
+                                VIDDEC3_InArgs *inArgs, VIDDEC3_OutArgs *outArgs)
+{
+    XDAS_Int32 ret;
+
+    DEBUG(">> codec=%p, inBufs=%p, outBufs=%p, inArgs=%p, outArgs=%p",
+          codec, inBufs, outBufs, inArgs, outArgs);
+    ret = async_submit(codec, inBufs, outBufs, inArgs, outArgs, OMAP_DCE_VIDDEC3);
+    DEBUG("<< ret=%d", ret);
+    return (ret);
+}
+
+XDAS_Int32 VIDDEC3_processWait(VIDDEC3_Handle codec,
+                               XDM2_BufDesc *inBufs, XDM2_BufDesc *outBufs,
+                               VIDDEC3_InArgs *inArgs, VIDDEC3_OutArgs *outArgs,
+                               UInt timeout)
+{
+    XDAS_Int32 ret;
+
+    DEBUG(">> codec=%p, outArgs=%p, timeout=%u", codec, outArgs, timeout);
+    ret = async_wait(codec, OMAP_DCE_VIDDEC3, outArgs, timeout);
+    DEBUG("<< ret=%d", ret);
+    return (ret);
+}
+
+XDAS_Int32 VIDDEC3_processTimed(VIDDEC3_Handle codec,
+                                XDM2_BufDesc *inBufs, XDM2_BufDesc *outBufs,
+                                VIDDEC3_InArgs *inArgs, VIDDEC3_OutArgs *outArgs,
+                                UInt timeout)
+{
+    XDAS_Int32 ret;
+
+    DEBUG(">> codec=%p, inBufs=%p, outBufs=%p, inArgs=%p, outArgs=%p, timeout=%u",
+          codec, inBufs, outBufs, inArgs, outArgs, timeout);
+    ret = timed_process(codec, inBufs, outBufs, inArgs, outArgs, OMAP_DCE_VIDDEC3, timeout);
+    DEBUG("<< ret=%d", ret);
+    return (ret);
+}
+
+XDAS_Int32 VIDDEC3_controlBatch(VIDDEC3_Handle codec, dce_control_cmd *cmds, Int count)
+{
+    XDAS_Int32 ret;
+
+    DEBUG(">> codec=%p, cmds=%p, count=%d", codec, cmds, count);
+    control_batch_first_control(codec, cmds, OMAP_DCE_VIDDEC3);
+    ret = control_batch(codec, cmds, count, OMAP_DCE_VIDDEC3);
+    DEBUG("<< ret=%d", ret);
     return (ret);
 }
 
 Void VIDDEC3_delete(VIDDEC3_Handle codec)
 {
-    void *res;
-    int id;
+    CallbackFlag *cb;
 
     DEBUG(">> codec=%p", codec);
 
-    /*Acquire permission to use IPC*/
+    async_flush(codec, OMAP_DCE_VIDDEC3);
+
     pthread_mutex_lock(&ipc_mutex);
+    cb = get_callback(codec);
+    pthread_mutex_unlock(&ipc_mutex);
 
-    id = get_callback((Uint32) codec);
-    if( id < 0 ) {
+    if( cb == NULL ) {
         DEBUG("Delete decode instance in full frame mode");
     } else {
-        if( (callbackmsg[id]).row_mode ) {
-            MmRpcCallback_count--;
-            /* Exit the callback thread to request to client */
-            (callbackmsg[id]).putDataFlag = 2;
-            DEBUG("Exit the callback to client callbackmsg[%d]->getDataFlag %d callbackmsg[%d]->getDataFxn_thread %p",
-                id, (callbackmsg[id]).putDataFlag, id, (void*) ((callbackmsg[id]).putDataFxn_thread));
-            sem_post(&((callbackmsg[id]).sem_dec_row_mode));
-
-            pthread_join((callbackmsg[id]).putDataFxn_thread, (void*) &res);
-            DEBUG("PTHREAD_JOIN res %d", (int) res);
-
-            /* Clean up the allocation earlier. */
-            memplugin_free((callbackmsg[id]).local_dataSyncDesc);
-
-            /* Destroy sem_dec_row_mode */
-            sem_destroy(&((callbackmsg[id]).sem_dec_row_mode));
-
-            DEBUG("Checking on MmRpcCallback_count %d MmRpcCallbackHandle 0x%x", MmRpcCallback_count, (unsigned int) MmRpcCallbackHandle);
-            if( MmRpcCallback_count == 0 && MmRpcCallbackHandle != NULL ) {
-                MmRpc_delete(&MmRpcCallbackHandle);
-                MmRpcCallbackHandle = NULL;
-            }
-        }
+        /* No worker may refer to the row mode state once the instance is deleted */
+        callback_retire(cb);
     }
 
     delete(codec, OMAP_DCE_VIDDEC3);
-    /*Relinquish IPC*/
-    pthread_mutex_unlock(&ipc_mutex);
+
+    if( cb != NULL ) {
+        release_callback(cb);
+    }
     DEBUG("<<");
 }
 
@@ -1245,63 +4568,40 @@ VIDENC2_Handle VIDENC2_create(Engine_Handle engine, String name,
                               VIDENC2_Params *params)
 {
     VIDENC2_Handle codec = NULL;
-    MmRpc_Params args;
-    dce_error_status eError = DCE_EOK;
-    int id;
-
-    /*Acquire permission to use IPC*/
-    pthread_mutex_lock(&ipc_mutex);
-
-    id = get_callback(0);
-    if( id < 0 ) {
-        /* This is depended on the MAX_INSTANCE, by default it handles only 5 instances of codec instance (full frame or low latency) */
-        ERROR("Failed because too many codec clients, Max is %d. MAX_INSTANCES default needs to be changed if required.", MAX_INSTANCES);
-        goto EXIT;
-    } else { /* Found empty array to be populated */
-        if( params->inputDataMode == IVIDEO_NUMROWS ) {
-            (callbackmsg[id]).row_mode = 1;
-            (callbackmsg[id]).first_control = TRUE;
-            (callbackmsg[id]).total_numBlocks = params->maxHeight / 16;
-            DEBUG("callbackmsg[%d]->total_numBlocks %d", id, (callbackmsg[id]).total_numBlocks);
-
-            /* Create sem_dec_row_mode */
-            sem_init(&((callbackmsg[id]).sem_enc_row_mode), 0, 0);
-
-            (callbackmsg[id]).local_dataSyncDesc = memplugin_alloc(sizeof(XDM_DataSyncDesc), 1, DEFAULT_REGION, 0, IPU);
-            DEBUG("Checking local_dataSyncDesc %p local_get_DataFxn %p local_dataSyncHandle %p",
-                (callbackmsg[id]).local_dataSyncDesc, (callbackmsg[id]).local_get_DataFxn, (callbackmsg[id]).local_dataSyncHandle);
-            if( (callbackmsg[id]).local_dataSyncDesc == NULL ) {
-                goto EXIT;
-            }
+    CallbackFlag *cb = NULL;
 
-            if( !MmRpcCallbackHandle ) {
-                /* Need to create another MmRpcHandle for codec callback */
-                MmRpc_Params_init(&args);
-                eError = MmRpc_create(DCE_CALLBACK_NAME, &args, &MmRpcCallbackHandle);
-                _ASSERT_AND_EXECUTE(eError == DCE_EOK, DCE_EIPC_CREATE_FAIL, MmRpcCallbackHandle = NULL);
-                DEBUG("open(/dev/%s]) -> 0x%x\n", DCE_CALLBACK_NAME, (int)MmRpcCallbackHandle);
-            }
-            MmRpcCallback_count++;
-        } else if( params->inputDataMode == IVIDEO_ENTIREFRAME ) {
-            (callbackmsg[id]).row_mode = 0; /* full frame; the other parameters are not used in full frame mode */
-        } else {
-            ERROR("inputDataMode %d is not supported.", params->inputDataMode);
+    if( params->inputDataMode == IVIDEO_NUMROWS ) {
+        pthread_mutex_lock(&ipc_mutex);
+        cb = reserve_callback();
+        pthread_mutex_unlock(&ipc_mutex);
+        if( cb == NULL ) {
+            ERROR("Failed to allocate the row mode state");
+            goto EXIT;
+        }
+        if( setup_row_mode(cb, params->maxHeight, dce_callback_getDataFxn) != DCE_EOK ) {
             goto EXIT;
         }
-        DEBUG("Checking row_mode %d first_control %d", (callbackmsg[id]).row_mode, (callbackmsg[id]).first_control);
+        DEBUG("Checking row_mode %d first_control %d", cb->row_mode, cb->first_control);
+    } else if( params->inputDataMode != IVIDEO_ENTIREFRAME ) {
+        ERROR("inputDataMode %d is not supported.", params->inputDataMode);
+        goto EXIT;
     }
 
     DEBUG(">> engine=%p, name=%s, params=%p", engine, name, params);
     codec = create(engine, name, params, OMAP_DCE_VIDENC2);
     DEBUG("<< codec=%p", codec);
 
-    if( params->inputDataMode == IVIDEO_NUMROWS ) {
-        (callbackmsg[id]).codec_handle = (XDAS_UInt32) codec;
+    if( cb != NULL && codec != NULL ) {
+        pthread_mutex_lock(&ipc_mutex);
+        cb->codec_handle = (XDAS_UInt32) codec;
+        attach_callback(codec, cb);
+        pthread_mutex_unlock(&ipc_mutex);
     }
 
 EXIT:
-    /*Relinquish IPC*/
-    pthread_mutex_unlock(&ipc_mutex);
+    if( cb != NULL && codec == NULL ) {
+        release_callback(cb);
+    }
     return (codec);
 }
 
@@ -1309,23 +4609,25 @@ XDAS_Int32 VIDENC2_control(VIDENC2_Handle codec, VIDENC2_Cmd cmd_id,
                            VIDENC2_DynamicParams *dynParams, VIDENC2_Status *status)
 {
     XDAS_Int32 ret;
-    int id;
+    CallbackFlag *cb;
 
-    /*Acquire permission to use IPC*/
     pthread_mutex_lock(&ipc_mutex);
+    cb = get_callback(codec);
+    pthread_mutex_unlock(&ipc_mutex);
 
-    id = get_callback((Uint32) codec);
-    if( id < 0 ) {
-        DEBUG("Could not find the entry in callbackmsg array; might not be rowmode; should be full frame mode");
+    if( cb == NULL ) {
+        DEBUG("No row mode state for this codec; should be full frame mode");
     } else {
-        DEBUG("Checking row_mode %d first_control %d", (callbackmsg[id]).row_mode, (callbackmsg[id]).first_control);
-        if( (callbackmsg[id]).row_mode && (callbackmsg[id]).first_control ) {
+        pthread_mutex_lock(&cb->lock);
+        DEBUG("Checking row_mode %d first_control %d", cb->row_mode, cb->first_control);
+        if( cb->row_mode && cb->first_control ) {
             /* dynParams has the function callback; store the information as it will get overwritten by the M4 codec for their own callback Fxn. */
-            (callbackmsg[id]).local_get_DataFxn = (void*) dynParams->getDataFxn;
-            (callbackmsg[id]).local_dataSyncHandle = dynParams->getDataHandle;
-            (callbackmsg[id]).first_control = FALSE;
-            DEBUG("Set callback pointer local_get_dataFxn %p local_dataSyncHandle %p", (callbackmsg[id]).local_get_DataFxn, (callbackmsg[id]).local_dataSyncHandle);
+            cb->local_get_DataFxn = (void*) dynParams->getDataFxn;
+            cb->local_dataSyncHandle = dynParams->getDataHandle;
+            cb->first_control = FALSE;
+            DEBUG("Set callback pointer local_get_dataFxn %p local_dataSyncHandle %p", cb->local_get_DataFxn, cb->local_dataSyncHandle);
         }
+        pthread_mutex_unlock(&cb->lock);
     }
 
     DEBUG(">> codec=%p, cmd_id=%d, dynParams=%p, status=%p",
@@ -1337,8 +4639,6 @@ XDAS_Int32 VIDENC2_control(VIDENC2_Handle codec, VIDENC2_Cmd cmd_id,
     }
 
     DEBUG("<< ret=%d", ret);
-    /*Relinquish IPC*/
-    pthread_mutex_unlock(&ipc_mutex);
     return (ret);
 }
 
@@ -1347,98 +4647,111 @@ XDAS_Int32 VIDENC2_process(VIDENC2_Handle codec,
                            VIDENC2_InArgs *inArgs, VIDENC2_OutArgs *outArgs)
 {
     XDAS_Int32 ret = 0;
-    pthread_attr_t attr;
-    int id;
+    CallbackFlag *cb;
 
     DEBUG(">> codec=%p, inBufs=%p, outBufs=%p, inArgs=%p, outArgs=%p",
           codec, inBufs, outBufs, inArgs, outArgs);
 
-    /*Acquire permission to use IPC*/
     pthread_mutex_lock(&ipc_mutex);
+    cb = get_callback(codec);
+    pthread_mutex_unlock(&ipc_mutex);
 
-    id = get_callback((Uint32) codec);
-    if( id < 0 ) {
-        DEBUG("Received VIDENC2_process for ENTIRE FRAME encoding because no entry found in callbackmsg");
+    if( cb == NULL || !cb->row_mode ) {
+        DEBUG("Received VIDENC2_process for ENTIRE FRAME encoding because no row mode state was found");
     } else {
-        DEBUG("Checking row_mode %d", (callbackmsg[id]).row_mode);
-        if( (callbackmsg[id]).row_mode ) {
-            (callbackmsg[id]).getDataFlag = 0;
-            DEBUG("Checking callbackmsg[%d]->getDataFxn_thread 0x%x", id, (callbackmsg[id]).getDataFxn_thread);
-            if( !(callbackmsg[id]).getDataFxn_thread ) {
-                /* Need to start a new thread for the callback handling to request for data - process call will be synchronous. */
-                pthread_attr_init(&attr);
-                pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-                if( pthread_create(&((callbackmsg[id]).getDataFxn_thread), &attr, (void*)dce_callback_getDataFxn, (void*) &codec) ) {
-                    pthread_mutex_unlock(&ipc_mutex);
-                    return DCE_EXDM_FAIL;
-                }
-            }
-            DEBUG("Create thread callbackmsg[%d]->getDataFxn_thread 0x%x", id, (unsigned int) (callbackmsg[id]).getDataFxn_thread);
-
-            /* Start the callback to request to client */
-            (callbackmsg[id]).getDataFlag = 1;
-            sem_post(&((callbackmsg[id]).sem_enc_row_mode));
-            DEBUG("Start the callback to client (callbackmsg[%d]).getDataFlag %d on (callbackmsg[%d]).local_dataSyncHandle 0x%x",
-                id, (callbackmsg[id]).getDataFlag, id, (unsigned int) (callbackmsg[id]).local_dataSyncHandle);
-        }
+        /* Start the callback to request to client */
+        callback_arm(cb);
+        DEBUG("Start the callback to client callback[%d] on callback[%d]->local_dataSyncHandle 0x%x",
+            cb->id, cb->id, (unsigned int) cb->local_dataSyncHandle);
     }
 
     ret = process(codec, inBufs, outBufs, inArgs, outArgs, OMAP_DCE_VIDENC2);
     DEBUG("<< ret=%d", ret);
 
-    if( (id >= 0) && ((callbackmsg[id]).row_mode) ) {
+    if( (cb != NULL) && (cb->row_mode) ) {
         /* Stop the callback to request to client */
-        DEBUG("Stop the callback to client callbackmsg[%d]->getDataFlag %d", id, (callbackmsg[id]).getDataFlag);
-        (callbackmsg[id]).getDataFlag = 0;
+        callback_drain(cb);
+        DEBUG("Stop the callback to client callback[%d]", cb->id);
     }
 
-    /*Relinquish IPC*/
-    pthread_mutex_unlock(&ipc_mutex);
+    return (ret);
+}
+
+XDAS_Int32 VIDENC2_processAsync(VIDENC2_Handle codec,
+                                IVIDEO2_BufDesc *inBufs, XDM2_BufDesc *outBufs,
+                                IVIDENC2_InArgs *inArgs, IVIDENC2_OutArgs *outArgs)
+{
+    XDAS_Int32 ret;
+
+    DEBUG(">> codec=%p, inBufs=%p, outBufs=%p, inArgs=%p, outArgs=%p",
+          codec, inBufs, outBufs, inArgs, outArgs);
+    ret = async_submit(codec, inBufs, outBufs, inArgs, outArgs, OMAP_DCE_VIDENC2);
+    DEBUG("<< ret=%d", ret);
+    return (ret);
+}
+
+XDAS_Int32 VIDENC2_processWait(VIDENC2_Handle codec,
+                               IVIDEO2_BufDesc *inBufs, XDM2_BufDesc *outBufs,
+                               IVIDENC2_InArgs *inArgs, IVIDENC2_OutArgs *outArgs,
+                               UInt timeout)
+{
+    XDAS_Int32 ret;
+
+    DEBUG(">> codec=%p, outArgs=%p, timeout=%u", codec, outArgs, timeout);
+    ret = async_wait(codec, OMAP_DCE_VIDENC2, outArgs, timeout);
+    DEBUG("<< ret=%d", ret);
+    return (ret);
+}
+
+XDAS_Int32 VIDENC2_processTimed(VIDENC2_Handle codec,
+                                IVIDEO2_BufDesc *inBufs, XDM2_BufDesc *outBufs,
+                                VIDENC2_InArgs *inArgs, VIDENC2_OutArgs *outArgs,
+                                UInt timeout)
+{
+    XDAS_Int32 ret;
+
+    DEBUG(">> codec=%p, inBufs=%p, outBufs=%p, inArgs=%p, outArgs=%p, timeout=%u",
+          codec, inBufs, outBufs, inArgs, outArgs, timeout);
+    ret = timed_process(codec, inBufs, outBufs, inArgs, outArgs, OMAP_DCE_VIDENC2, timeout);
+    DEBUG("<< ret=%d", ret);
+    return (ret);
+}
+
+XDAS_Int32 VIDENC2_controlBatch(VIDENC2_Handle codec, dce_control_cmd *cmds, Int count)
+{
+    XDAS_Int32 ret;
+
+    DEBUG(">> codec=%p, cmds=%p, count=%d", codec, cmds, count);
+    control_batch_first_control(codec, cmds, OMAP_DCE_VIDENC2);
+    ret = control_batch(codec, cmds, count, OMAP_DCE_VIDENC2);
+    DEBUG("<< ret=%d", ret);
     return (ret);
 }
 
 Void VIDENC2_delete(VIDENC2_Handle codec)
 {
-    void *res;
-    int id;
+    CallbackFlag *cb;
 
     DEBUG(">> codec=%p", codec);
 
-    /*Acquire permission to use IPC*/
+    async_flush(codec, OMAP_DCE_VIDENC2);
+
     pthread_mutex_lock(&ipc_mutex);
+    cb = get_callback(codec);
+    pthread_mutex_unlock(&ipc_mutex);
 
-    id = get_callback((Uint32) codec);
-    if( id < 0 ) {
+    if( cb == NULL ) {
         DEBUG("Delete encode instance in full frame mode");
     } else {
-        if( (callbackmsg[id]).row_mode ) {
-            MmRpcCallback_count--;
-            /* Exit the callback thread to request to client */
-            (callbackmsg[id]).getDataFlag = 2;
-            DEBUG("Exit the callback to client (callbackmsg[%d]).getDataFlag %d (callbackmsg[%d]).getDataFxn_thread 0x%x",
-                id, (callbackmsg[id]).getDataFlag, id, (unsigned int) (callbackmsg[id]).getDataFxn_thread);
-            sem_post(&((callbackmsg[id]).sem_enc_row_mode));
-
-            pthread_join((callbackmsg[id]).getDataFxn_thread, (void*) &res);
-            DEBUG("PTHREAD_JOIN res %d", (int) res);
-
-            /* Clean up the allocation earlier. */
-            memplugin_free((callbackmsg[id]).local_dataSyncDesc);
-
-            /* Destroy sem_dec_row_mode */
-            sem_destroy(&((callbackmsg[id]).sem_enc_row_mode));
-
-            DEBUG("Check on MmRpcCallback_count %d", MmRpcCallback_count);
-            if( MmRpcCallback_count == 0 && MmRpcCallbackHandle != NULL ) {
-                MmRpc_delete(&MmRpcCallbackHandle);
-                MmRpcCallbackHandle = NULL;
-            }
-        }
+        /* No worker may refer to the row mode state once the instance is deleted */
+        callback_retire(cb);
     }
 
     delete(codec, OMAP_DCE_VIDENC2);
-    /*Relinquish IPC*/
-    pthread_mutex_unlock(&ipc_mutex);
+
+    if( cb != NULL ) {
+        release_callback(cb);
+    }
     DEBUG("<<");
 }
 
@@ -1489,3 +4802,382 @@ Void VIDDEC2_delete(VIDDEC2_Handle codec)
     delete(codec, OMAP_DCE_VIDDEC2);
     DEBUG("<<");
 }
+
+/***************** Automatic placement ****************/
+/* dce_placement_create_decoder() opens one engine per core on demand and       */
+/* creates the decoder on the core with the most headroom. The headroom is the  */
+/* idle CPU share sampled with get_rproc_info(), minus an estimate for the      */
+/* instances placed since the sample as they may not be decoding yet. A core    */
+/* is skipped when its instance quota is reached or its available heap is below */
+/* the configured minimum. The engines are closed with the last placed codec.   */
+typedef struct {
+    Engine_Handle   engine;     /* engine opened by the placement layer */
+    int             refs;       /* placed codecs alive on the core */
+    uint64_t        sampled_us; /* time of the last sample, 0 for none */
+    int32_t         load;       /* RPROC_CPU_LOAD in percent */
+    int32_t         heap;       /* RPROC_AVAILABLE_HEAP_SIZE in bytes */
+    int             placed;     /* instances placed since the sample */
+} dce_placement;
+
+/* Load assumed for an instance placed since the last sample, in percent */
+#define DCE_PLACEMENT_INSTANCE_LOAD 10
+
+static dce_placement    __Place[MAX_REMOTEDEVICES];
+static pthread_mutex_t  place_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t         __PlaceSampleUs = DCE_PLACEMENT_SAMPLE_US;
+static int32_t          __PlaceMinHeap = 0;
+static const String     DCE_ENGINE_NAME[MAX_REMOTEDEVICES] = {"ivahd_vidsvr", "dsp_vidsvr"};
+
+/* Headroom of a core in percent, -1 if a new instance can't be placed on it. */
+/* place_mutex must be held.                                                 */
+static int place_headroom(int core)
+{
+    dce_placement           *p = &__Place[core];
+    dce_telemetry_sample    sample;
+    Engine_Error            ec;
+    uint64_t                now;
+    int                     full, headroom;
+
+    if( p->engine == NULL ) {
+        p->engine = Engine_open(DCE_ENGINE_NAME[core], NULL, &ec);
+        p->sampled_us = 0;
+        if( p->engine == NULL ) {
+            DEBUG("Core %d not available for placement, Engine_open error %d", core, ec);
+            return (-1);
+        }
+    }
+
+    pthread_mutex_lock(&ipc_mutex);
+    full = (__InstanceQuota[core] && __CodecCount[core] >= __InstanceQuota[core]);
+    pthread_mutex_unlock(&ipc_mutex);
+    if( full ) {
+        return (-1);
+    }
+
+    now = now_us();
+    if( p->sampled_us == 0 || now - p->sampled_us >= __PlaceSampleUs ) {
+        /* A recent enough sample of the telemetry sampler saves the queries */
+        if( dce_telemetry_latest(core, &sample) == DCE_EOK && now - sample.timestamp_us < __PlaceSampleUs ) {
+            p->load = sample.cpu_load;
+            p->heap = sample.available_heap;
+            p->sampled_us = sample.timestamp_us;
+        } else {
+            p->load = get_rproc_info(p->engine, RPROC_CPU_LOAD);
+            p->heap = get_rproc_info(p->engine, RPROC_AVAILABLE_HEAP_SIZE);
+            p->sampled_us = now;
+        }
+        p->placed = 0;
+        DEBUG("Core %d load %d%% available heap %d", core, p->load, p->heap);
+    }
+    if( p->heap < __PlaceMinHeap ) {
+        return (-1);
+    }
+
+    headroom = 100 - p->load - p->placed * DCE_PLACEMENT_INSTANCE_LOAD;
+    return (headroom < 0 ? 0 : headroom);
+}
+
+/* Close the placement engines once no placed codec is left. place_mutex must be held. */
+static void place_close_idle(void)
+{
+    int     i;
+
+    for( i = 0; i < MAX_REMOTEDEVICES; i++ ) {
+        if( __Place[i].refs ) {
+            return;
+        }
+    }
+    for( i = 0; i < MAX_REMOTEDEVICES; i++ ) {
+        if( __Place[i].engine ) {
+            Engine_close(__Place[i].engine);
+            __Place[i].engine = NULL;
+        }
+    }
+}
+
+/* Called when a placed codec is deleted */
+static void place_release(int core)
+{
+    pthread_mutex_lock(&place_mutex);
+    __Place[core].refs--;
+    place_close_idle();
+    pthread_mutex_unlock(&place_mutex);
+}
+
+/*===============================================================*/
+/** dce_placement_create_decoder : Create a decoder on the core with the most headroom.
+ *
+ * @ return : Codec handle, NULL on error.
+ */
+void *dce_placement_create_decoder(const dce_placement_decoder *dec, int *core)
+{
+    dce_instance        *inst;
+    void                *codec = NULL;
+    int                 headroom[MAX_REMOTEDEVICES] = { -1, -1 };
+    int                 tries, best, i;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(dec != NULL && core != NULL, DCE_EINVALID_INPUT);
+    _ASSERT((dec->viddec3_name && dec->viddec3_params) || (dec->viddec2_name && dec->viddec2_params),
+            DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&place_mutex);
+    if( dec->viddec3_name && dec->viddec3_params ) {
+        headroom[IPU] = place_headroom(IPU);
+    }
+    if( dec->viddec2_name && dec->viddec2_params ) {
+        headroom[DSP] = place_headroom(DSP);
+    }
+
+    /* Best core first, the other one if the creation fails there */
+    for( tries = 0; tries < MAX_REMOTEDEVICES && codec == NULL; tries++ ) {
+        best = INVALID_CORE;
+        for( i = 0; i < MAX_REMOTEDEVICES; i++ ) {
+            if( headroom[i] >= 0 && (best == INVALID_CORE || headroom[i] > headroom[best]) ) {
+                best = i;
+            }
+        }
+        if( best == INVALID_CORE ) {
+            break;
+        }
+        DEBUG("Placing decoder on core %d headroom %d%%", best, headroom[best]);
+        if( best == IPU ) {
+            codec = VIDDEC3_create(__Place[IPU].engine, dec->viddec3_name, dec->viddec3_params);
+        } else {
+            codec = VIDDEC2_create(__Place[DSP].engine, dec->viddec2_name, dec->viddec2_params);
+        }
+        headroom[best] = -1;
+    }
+
+    if( codec ) {
+        __Place[best].refs++;
+        __Place[best].placed++;
+        *core = best;
+        pthread_mutex_lock(&ipc_mutex);
+        inst = get_instance(codec);
+        if( inst ) {
+            inst->placed = 1;
+        }
+        pthread_mutex_unlock(&ipc_mutex);
+    } else {
+        ERROR("No core could host the decoder");
+        place_close_idle();
+    }
+    pthread_mutex_unlock(&place_mutex);
+
+EXIT:
+    DEBUG("<< codec=%p eError=%d", codec, eError);
+    return (codec);
+}
+
+/*===============================================================*/
+/** dce_set_placement  : Configure the placement of dce_placement_create_decoder().
+ *
+ * @ return : Error Status.
+ */
+int dce_set_placement(unsigned int sample_us, int min_heap)
+{
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(min_heap >= 0, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&place_mutex);
+    __PlaceSampleUs = sample_us;
+    __PlaceMinHeap = min_heap;
+    pthread_mutex_unlock(&place_mutex);
+
+EXIT:
+    return (eError);
+}
+
+/***************** Remote core telemetry ****************/
+/* The sampler thread started by dce_telemetry_start() queries every open core  */
+/* at a fixed period and stores the samples in a ring per core. The sampler is   */
+/* the only writer. Readers never lock: each slot carries a sequence number,     */
+/* odd while the slot is written, and a reader retries a slot whose sequence     */
+/* changed while it was copied.                                                  */
+typedef struct {
+    uint32_t                seq;
+    uint32_t                number;     /* index of the sample held in the slot */
+    dce_telemetry_sample    sample;
+} telemetry_slot;
+
+typedef struct {
+    telemetry_slot  slot[DCE_TELEMETRY_HISTORY];
+    uint32_t        count;              /* samples written so far */
+} telemetry_ring;
+
+static telemetry_ring   __Telemetry[MAX_REMOTEDEVICES];
+static pthread_t        __TelemetryThread;
+static int              __TelemetryRunning = 0;
+static uint32_t         __TelemetryPeriodUs = 0;
+static pthread_mutex_t  telemetry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   telemetry_cond = PTHREAD_COND_INITIALIZER;
+
+static void telemetry_write(telemetry_ring *ring, const dce_telemetry_sample *sample)
+{
+    uint32_t        count = ring->count;
+    telemetry_slot  *slot = &ring->slot[count % DCE_TELEMETRY_HISTORY];
+
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->number = count;
+    slot->sample = *sample;
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->count, count + 1, __ATOMIC_RELEASE);
+}
+
+/* Copy sample number of a ring. Returns 0 if the slot was overwritten by a newer sample. */
+static int telemetry_read(telemetry_ring *ring, uint32_t number, dce_telemetry_sample *sample)
+{
+    telemetry_slot  *slot = &ring->slot[number % DCE_TELEMETRY_HISTORY];
+    uint32_t        seq1, seq2, held;
+
+    do {
+        seq1 = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        held = slot->number;
+        *sample = slot->sample;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq2 = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    } while( (seq1 & 1) || seq1 != seq2 );
+
+    return (held == number);
+}
+
+static void *telemetry_thread(void *arg)
+{
+    dce_telemetry_sample    sample;
+    struct timespec         abstime;
+    int                     core, open;
+
+    pthread_mutex_lock(&telemetry_mutex);
+    while( __TelemetryRunning ) {
+        pthread_mutex_unlock(&telemetry_mutex);
+
+        for( core = 0; core < MAX_REMOTEDEVICES; core++ ) {
+            pthread_mutex_lock(&ipc_mutex);
+            open = (__PoolActive[core] > 0);
+            pthread_mutex_unlock(&ipc_mutex);
+            /* Batch class: the sampler never delays the codec calls of the core */
+            if( !open ||
+                rproc_info(core, 0, DCE_PRIORITY_BATCH, RPROC_CPU_LOAD, &sample.cpu_load) != DCE_EOK ||
+                rproc_info(core, 0, DCE_PRIORITY_BATCH, RPROC_TOTAL_HEAP_SIZE, &sample.total_heap) != DCE_EOK ||
+                rproc_info(core, 0, DCE_PRIORITY_BATCH, RPROC_AVAILABLE_HEAP_SIZE, &sample.available_heap) != DCE_EOK ) {
+                continue;
+            }
+            sample.timestamp_us = now_us();
+            telemetry_write(&__Telemetry[core], &sample);
+        }
+
+        pthread_mutex_lock(&telemetry_mutex);
+        deadline_us(&abstime, __TelemetryPeriodUs);
+        while( __TelemetryRunning &&
+               pthread_cond_timedwait(&telemetry_cond, &telemetry_mutex, &abstime) != ETIMEDOUT ) {
+        }
+    }
+    pthread_mutex_unlock(&telemetry_mutex);
+
+    return (NULL);
+}
+
+/*===============================================================*/
+/** dce_telemetry_start : Start the telemetry sampler.
+ *
+ * @ return : Error Status.
+ */
+int dce_telemetry_start(unsigned int period_us)
+{
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(period_us > 0, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&telemetry_mutex);
+    __TelemetryPeriodUs = period_us;
+    if( !__TelemetryRunning ) {
+        __TelemetryRunning = 1;
+        if( pthread_create(&__TelemetryThread, NULL, telemetry_thread, NULL) ) {
+            __TelemetryRunning = 0;
+            eError = DCE_EXDM_FAIL;
+        }
+    }
+    pthread_mutex_unlock(&telemetry_mutex);
+    _ASSERT(eError == DCE_EOK, DCE_EXDM_FAIL);
+
+EXIT:
+    return (eError);
+}
+
+/*===============================================================*/
+/** dce_telemetry_stop : Stop the telemetry sampler, the history is kept.
+ */
+void dce_telemetry_stop(void)
+{
+    int     running;
+
+    pthread_mutex_lock(&telemetry_mutex);
+    running = __TelemetryRunning;
+    __TelemetryRunning = 0;
+    pthread_cond_broadcast(&telemetry_cond);
+    pthread_mutex_unlock(&telemetry_mutex);
+
+    if( running ) {
+        pthread_join(__TelemetryThread, NULL);
+    }
+}
+
+/*===============================================================*/
+/** dce_telemetry_latest : Latest sample of a core.
+ *
+ * @ return : Error Status.
+ */
+int dce_telemetry_latest(int core, dce_telemetry_sample *sample)
+{
+    telemetry_ring      *ring;
+    uint32_t            count;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(core >= 0 && core < MAX_REMOTEDEVICES, DCE_EINVALID_INPUT);
+    _ASSERT(sample != NULL, DCE_EINVALID_INPUT);
+
+    ring = &__Telemetry[core];
+    count = __atomic_load_n(&ring->count, __ATOMIC_ACQUIRE);
+    _ASSERT(count > 0, DCE_EINVALID_INPUT);
+    /* The sampler can't lap the ring while one sample is copied */
+    telemetry_read(ring, count - 1, sample);
+
+EXIT:
+    return (eError);
+}
+
+/*===============================================================*/
+/** dce_telemetry_history : Samples of a core, oldest first.
+ *
+ * @ return : Number of samples copied, or error status.
+ */
+int dce_telemetry_history(int core, dce_telemetry_sample *samples, int max)
+{
+    telemetry_ring      *ring;
+    uint32_t            count, first, number;
+    int                 n = 0;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(core >= 0 && core < MAX_REMOTEDEVICES, DCE_EINVALID_INPUT);
+    _ASSERT(samples != NULL && max >= 0, DCE_EINVALID_INPUT);
+
+    ring = &__Telemetry[core];
+    count = __atomic_load_n(&ring->count, __ATOMIC_ACQUIRE);
+    if( max > DCE_TELEMETRY_HISTORY ) {
+        max = DCE_TELEMETRY_HISTORY;
+    }
+    first = (count > (uint32_t)max) ? count - max : 0;
+    for( number = first; number < count; number++ ) {
+        /* Samples overwritten while reading are skipped */
+        if( telemetry_read(ring, number, &samples[n]) ) {
+            n++;
+        }
+    }
+    return (n);
+
+EXIT:
+    return (eError);
+}
@@ -59,6 +59,100 @@ typedef enum dce_error_status {
 } dce_error_status;
 
 
+/* Maximum number of MmRpc connections in the pool of a remote core */
+#define DCE_MAX_CONNECTIONS 8
+
+/* Callback worker threads servicing the low latency (IVIDEO_NUMROWS) instances */
+#define DCE_MAX_CALLBACK_WORKERS        8
+#define DCE_DEFAULT_CALLBACK_WORKERS    4
+
+/* Delay before a getDataFxn which returned no rows is called again, see dce_callback_data_ready() */
+#define DCE_CALLBACK_RETRY_US           2000
+
+/* Maximum number of commands in one *_controlBatch() call */
+#define DCE_MAX_CONTROL_BATCH 8
+
+/* One command of a *_controlBatch() call */
+typedef struct dce_control_cmd {
+    XDAS_Int32  cmd_id;     /* XDM command, XDM_GETVERSION is not supported */
+    void        *dynParams; /* VIDDEC3_DynamicParams or VIDENC2_DynamicParams */
+    void        *status;    /* VIDDEC3_Status or VIDENC2_Status */
+    XDAS_Int32  ret;        /* (out) return value of the command */
+} dce_control_cmd;
+
+typedef enum dce_pool_policy {
+    DCE_POOL_ROUND_ROBIN = 0,   /* engines take the connections in turn */
+    DCE_POOL_LEAST_LOADED = 1   /* engines take the connection with the fewest bound instances */
+} dce_pool_policy;
+
+/* Priority class of the remote calls of a codec instance, see dce_set_scheduler() */
+typedef enum dce_priority {
+    DCE_PRIORITY_REALTIME = 0,      /* live low latency streams */
+    DCE_PRIORITY_INTERACTIVE = 1,   /* default class */
+    DCE_PRIORITY_BATCH = 2,         /* background transcodes */
+    DCE_PRIORITY_MAX
+} dce_priority;
+
+/* Wait after which a waiting lower class call is issued before the higher ones */
+#define DCE_DEFAULT_STARVATION_US 100000
+
+/* Interval between two load samples of a core used for the placement */
+#define DCE_PLACEMENT_SAMPLE_US 200000
+
+/* Decoder alternatives for dce_placement_create_decoder(). A VIDDEC3 codec runs on */
+/* the IPU (ivahd_vidsvr), a VIDDEC2 codec on the DSP (dsp_vidsvr).                 */
+typedef struct dce_placement_decoder {
+    String          viddec3_name;   /* NULL if the stream can't be decoded on the IPU */
+    VIDDEC3_Params  *viddec3_params;
+    String          viddec2_name;   /* NULL if the stream can't be decoded on the DSP */
+    VIDDEC2_Params  *viddec2_params;
+} dce_placement_decoder;
+
+/* Samples kept per core by the telemetry sampler */
+#define DCE_TELEMETRY_HISTORY 256
+
+/* One sample of the telemetry sampler */
+typedef struct dce_telemetry_sample {
+    uint64_t    timestamp_us;   /* CLOCK_MONOTONIC time of the sample */
+    int32_t     cpu_load;       /* RPROC_CPU_LOAD */
+    int32_t     total_heap;     /* RPROC_TOTAL_HEAP_SIZE */
+    int32_t     available_heap; /* RPROC_AVAILABLE_HEAP_SIZE */
+} dce_telemetry_sample;
+
+/* Remote call types counted by the call statistics, same order as the DCE RPC calls */
+typedef enum dce_stats_call {
+    DCE_STATS_ENGINE_OPEN = 0,
+    DCE_STATS_ENGINE_CLOSE,
+    DCE_STATS_CODEC_CREATE,
+    DCE_STATS_CODEC_CONTROL,
+    DCE_STATS_CODEC_GET_VERSION,
+    DCE_STATS_CODEC_PROCESS,
+    DCE_STATS_CODEC_DELETE,
+    DCE_STATS_GET_INFO,
+    DCE_STATS_CODEC_CONTROL_BATCH,
+    DCE_STATS_CALLS
+} dce_stats_call;
+
+/* Phases of a remote call timed by the call statistics */
+typedef enum dce_stats_phase {
+    DCE_STATS_LOCK_WAIT = 0,    /* wait for the connection and the scheduler slot */
+    DCE_STATS_MARSHAL,          /* marshalling of the arguments */
+    DCE_STATS_REMOTE,           /* MmRpc round trip */
+    DCE_STATS_PHASES
+} dce_stats_phase;
+
+/* Log-linear histogram of durations in microseconds: one bucket per value below */
+/* 4 us, then 4 buckets per power of two up to 2^32 us.                           */
+#define DCE_STATS_SUB_BITS  2
+#define DCE_STATS_BUCKETS   ((33 - DCE_STATS_SUB_BITS) << DCE_STATS_SUB_BITS)
+
+typedef struct dce_histogram {
+    uint32_t    count;
+    uint32_t    max_us;
+    uint64_t    total_us;
+    uint32_t    bucket[DCE_STATS_BUCKETS];
+} dce_histogram;
+
 typedef enum rproc_info_type {
     RPROC_CPU_LOAD = 0,
     RPROC_TOTAL_HEAP_SIZE = 1,
@@ -118,6 +212,276 @@ void *dce_init(void);
  */
 void dce_deinit(void *dev);
 
+/*===============================================================*/
+/** dce_alloc_cached    : Same as dce_alloc() with a cached CPU mapping instead of a
+ *                        write-combined one. Reading back outArgs or status fields is
+ *                        much cheaper; the cache is written back before every remote
+ *                        call using the buffer and invalidated after it. Free with
+ *                        dce_free(). Only for Linux.
+ *
+ * @ param sz    [in]   : Size of memory to be allocated.
+ * @ return             : Pointer to allocated memory.
+ */
+void *dce_alloc_cached(int sz);
+
+/* Output frame of a dce_frame_pool. A linear frame is one buffer object, the chroma */
+/* plane following luma. A tiled frame has a TILER 2D buffer object for each plane.  */
+typedef struct dce_frame {
+    int         fd;             /* dma-buf of the frame, or of its luma plane */
+    void        *ptr;           /* CPU mapping of luma */
+    int         size;           /* bytes */
+    int         chroma_fd;      /* dma-buf of the chroma plane, fd if linear */
+    void        *chroma_ptr;    /* CPU mapping of chroma */
+    int         chroma_offset;  /* offset of the chroma plane in chroma_fd */
+    XDAS_Int32  id;             /* inputID, outputID and freeBufID of the frame */
+} dce_frame;
+
+typedef struct dce_frame_pool   dce_frame_pool;
+
+/*===============================================================*/
+/** dce_frame_pool_create   : Create a pool of output frames for a VIDDEC3 decoder. The
+ *                            frames are sized from XDM_GETBUFINFO and registered with
+ *                            dce_buf_lock() once, when they are added to the pool.
+ *                            XDM_MEMTYPE_RAW and XDM_MEMTYPE_TILEDPAGE outputs get linear
+ *                            frames, XDM_MEMTYPE_TILED8 luma with XDM_MEMTYPE_TILED16
+ *                            chroma TILER 2D ones. Call after XDM_SETPARAMS. Only for Linux.
+ *
+ * @ param codec  [in]      : VIDDEC3_Handle.
+ * @ param count  [in]      : Number of frames, 0 for maxNumDisplayBufs of the codec plus
+ *                            two frames held by the application.
+ * @ return                 : Pool, NULL on error.
+ */
+dce_frame_pool *dce_frame_pool_create(void *codec, int count);
+
+/*===============================================================*/
+/** dce_frame_pool_delete   : Free a pool and all its frames, whether they are still
+ *                            referenced or not. Delete the codec first.
+ *
+ * @ param pool  [in]       : Pool obtained with dce_frame_pool_create().
+ */
+void dce_frame_pool_delete(dce_frame_pool *pool);
+
+/*===============================================================*/
+/** dce_frame_pool_prepare  : Fill outBufs and inArgs->inputID with a free frame before
+ *                            VIDDEC3_process(). The frame stays referenced by the codec
+ *                            until it is returned in outArgs->freeBufID. When the last
+ *                            call set outBufsInUseFlag the same frame is given again.
+ *                            Not needed for the calls flushing the codec.
+ *
+ * @ param pool    [in]     : Pool obtained with dce_frame_pool_create().
+ * @ param outBufs [out]    : Output buffers of the process call.
+ * @ param inArgs  [out]    : Input arguments of the process call.
+ * @ return                 : DCE_EOK, DCE_EINVALID_INPUT or DCE_EOUT_OF_MEMORY.
+ */
+int dce_frame_pool_prepare(dce_frame_pool *pool, XDM2_BufDesc *outBufs, VIDDEC3_InArgs *inArgs);
+
+/*===============================================================*/
+/** dce_frame_pool_complete : Account for the result of VIDDEC3_process(). The frames of
+ *                            outArgs->freeBufID are released by the codec and each frame
+ *                            of outArgs->outputID gets a reference, dropped with
+ *                            dce_frame_pool_release() once it has been displayed. A
+ *                            failure or XDM_PARAMSCHANGE reads the buffer requirements
+ *                            again: the frames too small are freed as they are released
+ *                            and new ones are added.
+ *
+ * @ param pool    [in]     : Pool obtained with dce_frame_pool_create().
+ * @ param ret     [in]     : Return value of VIDDEC3_process().
+ * @ param outArgs [in]     : Output arguments of the process call.
+ * @ return                 : Number of frames in outArgs->outputID, or a negative
+ *                            dce_error_status.
+ */
+int dce_frame_pool_complete(dce_frame_pool *pool, XDAS_Int32 ret, VIDDEC3_OutArgs *outArgs);
+
+/*===============================================================*/
+/** dce_frame_pool_get      : Look up a frame of a pool by id, e.g. outArgs->outputID[i].
+ *
+ * @ param pool  [in]       : Pool obtained with dce_frame_pool_create().
+ * @ param id    [in]       : Frame id.
+ * @ return                 : Frame, NULL if the id is unknown.
+ */
+dce_frame *dce_frame_pool_get(dce_frame_pool *pool, XDAS_Int32 id);
+
+/*===============================================================*/
+/** dce_frame_pool_release  : Drop the reference taken on a displayed frame by
+ *                            dce_frame_pool_complete(). May be called from any thread.
+ *
+ * @ param pool  [in]       : Pool obtained with dce_frame_pool_create().
+ * @ param frame [in]       : Frame obtained with dce_frame_pool_get().
+ */
+void dce_frame_pool_release(dce_frame_pool *pool, dce_frame *frame);
+
+/* Maximum number of planes of a buffer imported with dce_buf_import() */
+#define DCE_MAX_PLANES 3
+
+/* Plane of an imported dma-buf */
+typedef struct dce_plane {
+    int     offset;     /* bytes from the start of the dma-buf */
+    int     stride;     /* bytes per row */
+    int     height;     /* rows */
+} dce_plane;
+
+/*===============================================================*/
+/** dce_buf_import          : Use a dma-buf of another allocator (V4L2, GBM, ...) as
+ *                            codec buffer without copy. The dma-buf is registered with
+ *                            dce_buf_lock() once, and descs can then be copied to the
+ *                            XDM2_BufDesc or IVIDEO2_BufDesc of every process call. The
+ *                            codec gets the stride through its own parameters (imagePitch,
+ *                            displayWidth). Only for Linux.
+ *
+ * @ param fd         [in]  : dma-buf fd, it may be closed once imported.
+ * @ param num_planes [in]  : Number of planes, 1 to DCE_MAX_PLANES.
+ * @ param planes     [in]  : Layout of the planes in the dma-buf.
+ * @ param descs      [out] : One XDM_MEMTYPE_RAW descriptor per plane of stride * height
+ *                            bytes.
+ * @ return                 : Import to give to dce_buf_unimport(), NULL on error.
+ */
+void *dce_buf_import(int fd, int num_planes, const dce_plane *planes, XDM2_SingleBufDesc *descs);
+
+/*===============================================================*/
+/** dce_buf_unimport        : Unregister an imported dma-buf. Its descriptors must not be
+ *                            used any more.
+ *
+ * @ param import  [in]     : Import obtained with dce_buf_import().
+ */
+void dce_buf_unimport(void *import);
+
+/*===============================================================*/
+/** dce_buf_import_seek     : Point the descriptor of a plane of an imported dma-buf at
+ *                            a window of the plane, an access unit found in a bitstream
+ *                            buffer by dce_au_parser_next() for instance. Not while a
+ *                            process call using the plane is in flight. Only for Linux.
+ *
+ * @ param import [in]      : Import obtained with dce_buf_import().
+ * @ param plane  [in]      : Index of the plane.
+ * @ param offset [in]      : Bytes from the start of the plane.
+ * @ param size   [in]      : Bytes of the window.
+ * @ param desc   [out]     : Descriptor of the plane, its bufSize is set to size.
+ * @ return                 : DCE error status is returned.
+ */
+int dce_buf_import_seek(void *import, int plane, int offset, int size, XDM2_SingleBufDesc *desc);
+
+typedef struct dce_bitstream    dce_bitstream;
+
+/*===============================================================*/
+/** dce_bitstream_create    : Create a ring of bitstream for a VIDDEC3 decoder. A producer
+ *                            appends the stream to it while the decoder reads it from the
+ *                            offset advanced by bytesConsumed, so that the access units are
+ *                            neither copied nor allocated per process call. A guard after
+ *                            the end of the ring mirrors its start: the access unit at the
+ *                            read offset is contiguous as long as it is not larger than the
+ *                            guard, and at most guard bytes are copied per lap of the ring.
+ *                            Only for Linux.
+ *
+ * @ param size   [in]      : Bytes of the ring.
+ * @ param guard  [in]      : Bytes of the guard, at least the largest access unit, 0 for
+ *                            a quarter of size.
+ * @ return                 : Ring, NULL on error.
+ */
+dce_bitstream *dce_bitstream_create(int size, int guard);
+
+/*===============================================================*/
+/** dce_bitstream_delete    : Delete a ring of bitstream, not while a process call reads it.
+ *
+ * @ param bs     [in]      : Ring obtained with dce_bitstream_create().
+ */
+void dce_bitstream_delete(dce_bitstream *bs);
+
+/*===============================================================*/
+/** dce_bitstream_write_ptr : Where the producer appends the stream. May be called from
+ *                            another thread than the decoder.
+ *
+ * @ param bs     [in]      : Ring obtained with dce_bitstream_create().
+ * @ param avail  [out]     : Contiguous bytes which can be written, 0 when the ring is full.
+ * @ return                 : Write pointer.
+ */
+void *dce_bitstream_write_ptr(dce_bitstream *bs, int *avail);
+
+/*===============================================================*/
+/** dce_bitstream_commit    : Make the bytes written at dce_bitstream_write_ptr() visible
+ *                            to the decoder. Commit whole access units, the codec is given
+ *                            all the bytes committed.
+ *
+ * @ param bs     [in]      : Ring obtained with dce_bitstream_create().
+ * @ param bytes  [in]      : Bytes written, at most the avail of dce_bitstream_write_ptr().
+ * @ return                 : DCE error status is returned.
+ */
+int dce_bitstream_commit(dce_bitstream *bs, int bytes);
+
+/*===============================================================*/
+/** dce_bitstream_prepare   : Set the input of a process call to the stream at the read
+ *                            offset. Call before VIDDEC3_process().
+ *
+ * @ param bs      [in]     : Ring obtained with dce_bitstream_create().
+ * @ param inBufs  [out]    : descs[0] is set to the stream.
+ * @ param inArgs  [out]    : numBytes is set.
+ * @ return                 : Bytes given to the codec, 0 if the ring is empty, a DCE error
+ *                            status when negative.
+ */
+int dce_bitstream_prepare(dce_bitstream *bs, XDM2_BufDesc *inBufs, VIDDEC3_InArgs *inArgs);
+
+/*===============================================================*/
+/** dce_bitstream_complete  : Advance the read offset by the bytesConsumed of a process
+ *                            call prepared with dce_bitstream_prepare().
+ *
+ * @ param bs      [in]     : Ring obtained with dce_bitstream_create().
+ * @ param outArgs [in]     : OutArgs of the process call.
+ * @ return                 : Bytes consumed, a DCE error status when negative.
+ */
+int dce_bitstream_complete(dce_bitstream *bs, VIDDEC3_OutArgs *outArgs);
+
+/* Elementary stream formats split by the access unit parser */
+typedef enum dce_stream_format {
+    DCE_STREAM_H264,    /* Annex-B byte stream */
+    DCE_STREAM_MPEG2,
+    DCE_STREAM_MPEG4,   /* Part 2, not short header */
+    DCE_STREAM_VC1      /* advanced profile, start code delimited (SMPTE 421M Annex E) */
+} dce_stream_format;
+
+typedef struct dce_au_parser    dce_au_parser;
+
+/*===============================================================*/
+/** dce_au_parser_create    : Create a parser splitting an elementary stream into the access
+ *                            units given to VIDDEC3_process(), so that no frame size file
+ *                            is needed. Only the start codes are scanned, with NEON when
+ *                            built for it, and the stream is not copied: read it into the
+ *                            input buffer and give each access unit found to the codec
+ *                            where it lies.
+ *
+ * @ param format  [in]     : Elementary stream format.
+ * @ return                 : Parser, NULL on error.
+ */
+dce_au_parser *dce_au_parser_create(dce_stream_format format);
+
+/*===============================================================*/
+/** dce_au_parser_delete    : Delete an access unit parser.
+ *
+ * @ param parser [in]      : Parser obtained with dce_au_parser_create().
+ */
+void dce_au_parser_delete(dce_au_parser *parser);
+
+/*===============================================================*/
+/** dce_au_parser_reset     : Drop the state of the access unit being scanned, after a
+ *                            seek in the stream.
+ *
+ * @ param parser [in]      : Parser obtained with dce_au_parser_create().
+ */
+void dce_au_parser_reset(dce_au_parser *parser);
+
+/*===============================================================*/
+/** dce_au_parser_next      : Find the end of the access unit at the start of data. When
+ *                            0 is returned, call again with the same data once more stream
+ *                            follows it, the bytes already scanned are not scanned again.
+ *                            The next access unit starts at data plus the returned size.
+ *
+ * @ param parser [in]      : Parser obtained with dce_au_parser_create().
+ * @ param data   [in]      : Stream from the start of an access unit.
+ * @ param len    [in]      : Bytes of stream in data.
+ * @ param eos    [in]      : Set when no stream follows data, the last access unit
+ *                            then ends with it.
+ * @ return                 : Size of the access unit, 0 if more stream is needed.
+ */
+int dce_au_parser_next(dce_au_parser *parser, const void *data, int len, int eos);
+
 
 /** dce_ipc_init            : Initialize DCE IPC. this is required to setup mmRpc link.
  *
@@ -128,10 +492,229 @@ int dce_ipc_init(int core);
 /*===============================================================*/
 /** dce_ipc_deinit          : Deinitialize DCE IPC.
  *
- * @ param dev    [in]      : Core ID and engine Table Idx, or -1 if no engine exists
+ * @ param dev    [in]      : Core ID and engine Table Idx. The index is no longer
+ *                            used, engines are tracked by Engine_close().
  */
 void dce_ipc_deinit(int core, int tableIdx);
 
+/*===============================================================*/
+/** dce_set_instance_quota  : Set the maximum number of engines and of codec instances
+ *                            accepted on a remote core. The default is 6 (MAX_INSTANCES),
+ *                            it only needs to be raised when the remote firmware is
+ *                            built to host more instances.
+ *
+ * @ param core  [in]       : 0 for IPU (ivahd_vidsvr), 1 for DSP (dsp_vidsvr).
+ * @ param quota [in]       : New quota, 0 removes the limit.
+ * @ return                 : DCE_EOK or DCE_EINVALID_INPUT.
+ */
+int dce_set_instance_quota(int core, int quota);
+
+/*===============================================================*/
+/** dce_set_connection_pool : Configure the pool of MmRpc connections opened to a remote
+ *                            core. Each engine is bound to one connection when it is
+ *                            opened and the codecs created on it use the same one, so
+ *                            calls of different engines travel through independent
+ *                            rpmsg-dce endpoints. The default is a single connection.
+ *
+ * @ param core   [in]      : 0 for IPU (ivahd_vidsvr), 1 for DSP (dsp_vidsvr).
+ * @ param size   [in]      : Number of connections, 1 to DCE_MAX_CONNECTIONS.
+ * @ param policy [in]      : DCE_POOL_ROUND_ROBIN or DCE_POOL_LEAST_LOADED.
+ * @ return                 : DCE_EOK, DCE_EINVALID_INPUT, or DCE_EXDM_UNSUPPORTED
+ *                            if engines are already open on the core.
+ */
+int dce_set_connection_pool(int core, int size, dce_pool_policy policy);
+
+/*===============================================================*/
+/** dce_set_callback_pool   : Configure the worker threads which service the data sync
+ *                            callbacks (getDataFxn/putDataFxn) of all the low latency
+ *                            (IVIDEO_NUMROWS) instances. An instance is serviced by one
+ *                            worker at a time so its callbacks keep their order. A worker
+ *                            is busy for the whole blocking exchange with the codec, so
+ *                            the pool grows to one thread per low latency instance, and
+ *                            creating more than DCE_MAX_CALLBACK_WORKERS of them fails.
+ *                            The default is DCE_DEFAULT_CALLBACK_WORKERS threads with the
+ *                            default scheduling policy on any CPU.
+ *
+ * @ param threads  [in]    : Number of workers, 1 to DCE_MAX_CALLBACK_WORKERS.
+ * @ param priority [in]    : SCHED_FIFO priority of the workers, 0 for the default policy.
+ *                            Without the permission to use SCHED_FIFO the default policy
+ *                            is kept.
+ * @ param cpumask  [in]    : Bit n set to run the workers on CPU n, 0 for any CPU.
+ * @ return                 : DCE_EOK, DCE_EINVALID_INPUT, or DCE_EXDM_UNSUPPORTED
+ *                            if low latency instances already exist.
+ */
+int dce_set_callback_pool(int threads, int priority, unsigned long cpumask);
+
+/*===============================================================*/
+/** dce_set_control_cache   : Enable the control cache of a codec instance. The results
+ *                            of XDM_GETBUFINFO and XDM_GETVERSION are then answered
+ *                            locally until a control command other than a query
+ *                            (XDM_SETPARAMS, XDM_RESET, XDM_FLUSH, ...) or a process call
+ *                            failing or reporting XDM_PARAMSCHANGE invalidates them.
+ *                            Must not be called concurrently with other calls on the
+ *                            instance. Disabled by default.
+ *
+ * @ param codec  [in]      : VIDDEC3_Handle, VIDENC2_Handle or VIDDEC2_Handle.
+ * @ param enable [in]      : 1 to enable, 0 to disable and drop the cached results.
+ * @ return                 : DCE_EOK, DCE_EINVALID_INPUT or DCE_EOUT_OF_MEMORY.
+ */
+int dce_set_control_cache(void *codec, int enable);
+
+/*===============================================================*/
+/** dce_get_control_cache_stats : Read the hit and miss counters of the control cache
+ *                                of a codec instance. Only XDM_GETBUFINFO and
+ *                                XDM_GETVERSION calls are counted.
+ *
+ * @ param codec  [in]      : VIDDEC3_Handle, VIDENC2_Handle or VIDDEC2_Handle.
+ * @ param hits   [out]     : Queries answered from the cache.
+ * @ param misses [out]     : Queries sent to the remote core.
+ * @ return                 : DCE_EOK, or DCE_EINVALID_INPUT if the cache is not enabled.
+ */
+int dce_get_control_cache_stats(void *codec, XDAS_UInt32 *hits, XDAS_UInt32 *misses);
+
+/*===============================================================*/
+/** dce_set_scheduler       : Limit the number of remote calls in flight on a core. The
+ *                            calls waiting for a slot are then issued by the priority
+ *                            class of their codec instance (see dce_set_priority()) and
+ *                            in arrival order within a class. A call of a lower class
+ *                            which waited for longer than starvation_us is issued first.
+ *                            Engine calls use DCE_PRIORITY_INTERACTIVE. There is no limit
+ *                            by default, calls are then never delayed.
+ *
+ * @ param core          [in] : 0 for IPU (ivahd_vidsvr), 1 for DSP (dsp_vidsvr).
+ * @ param max_inflight  [in] : Maximum number of calls in flight, 0 for no limit. 1 lets
+ *                              a realtime call wait for at most one call of another class.
+ * @ param starvation_us [in] : Starvation limit in microseconds, DCE_DEFAULT_STARVATION_US
+ *                              by default.
+ * @ return                   : DCE_EOK or DCE_EINVALID_INPUT.
+ */
+int dce_set_scheduler(int core, int max_inflight, unsigned int starvation_us);
+
+/*===============================================================*/
+/** dce_set_priority        : Set the priority class of the remote calls of a codec
+ *                            instance. Call it right after *_create(), before the first
+ *                            control or process call. Instances are created with
+ *                            DCE_PRIORITY_INTERACTIVE.
+ *
+ * @ param codec    [in]    : VIDDEC3_Handle, VIDENC2_Handle or VIDDEC2_Handle.
+ * @ param priority [in]    : DCE_PRIORITY_REALTIME, DCE_PRIORITY_INTERACTIVE or DCE_PRIORITY_BATCH.
+ * @ return                 : DCE_EOK or DCE_EINVALID_INPUT.
+ */
+int dce_set_priority(void *codec, dce_priority priority);
+
+/*===============================================================*/
+/** dce_set_call_budget     : Set the expected maximum duration of the process calls of a
+ *                            codec instance. A watchdog thread, running while an instance
+ *                            has a budget, flags the calls which exceed it with an ERROR
+ *                            trace and counts them (see dce_get_instance_health()). The
+ *                            calls are not interrupted, use *_processTimed() for that.
+ *
+ * @ param codec     [in]   : VIDDEC3_Handle, VIDENC2_Handle or VIDDEC2_Handle.
+ * @ param budget_us [in]   : Budget in microseconds, 0 to disable.
+ * @ return                 : DCE_EOK or DCE_EINVALID_INPUT.
+ */
+int dce_set_call_budget(void *codec, unsigned int budget_us);
+
+/*===============================================================*/
+/** dce_get_instance_health : Read the number of process calls of a codec instance which
+ *                            exceeded the budget and whether the instance has failed.
+ *                            A failed instance had a *_processTimed() call cancelled:
+ *                            its remote calls fail with DCE_EIPC_CALL_FAIL and it can only
+ *                            be deleted.
+ *
+ * @ param codec    [in]    : VIDDEC3_Handle, VIDENC2_Handle or VIDDEC2_Handle.
+ * @ param overruns [out]   : Calls flagged by the watchdog.
+ * @ param failed   [out]   : 1 if the instance has failed, 0 otherwise.
+ * @ return                 : DCE_EOK or DCE_EINVALID_INPUT.
+ */
+int dce_get_instance_health(void *codec, XDAS_UInt32 *overruns, int *failed);
+
+/*===============================================================*/
+/** dce_get_stats           : Read the latency histogram of a type of remote call. Every
+ *                            call records its lock wait, marshalling and round trip time,
+ *                            globally and for its codec instance.
+ *
+ * @ param codec    [in]    : VIDDEC3_Handle, VIDENC2_Handle or VIDDEC2_Handle, NULL for
+ *                            the calls of all engines and instances.
+ * @ param call     [in]    : Type of remote call.
+ * @ param phase    [in]    : Phase of the call.
+ * @ param hist     [out]   : Copy of the histogram.
+ * @ return                 : DCE_EOK or DCE_EINVALID_INPUT.
+ */
+int dce_get_stats(void *codec, dce_stats_call call, dce_stats_phase phase, dce_histogram *hist);
+
+/*===============================================================*/
+/** dce_get_callback_latency : Read the latency histogram of the row callbacks of a low
+ *                            latency (IVIDEO_NUMROWS) decoder: time from the return of
+ *                            the putDataFxn callback RPC to the call of the putDataFxn
+ *                            of the client, for every callback carrying rows.
+ *
+ * @ param codec    [in]    : VIDDEC3_Handle created with outputDataMode IVIDEO_NUMROWS.
+ * @ param hist     [out]   : Copy of the histogram.
+ * @ return                 : DCE_EOK or DCE_EINVALID_INPUT.
+ */
+int dce_get_callback_latency(void *codec, dce_histogram *hist);
+
+/*===============================================================*/
+/** dce_callback_data_ready : Signal that new input rows are available to the getDataFxn
+ *                            of a low latency (IVIDEO_NUMROWS) encoder. Once getDataFxn
+ *                            returned no rows or an error, it is only called again after
+ *                            this call or DCE_CALLBACK_RETRY_US.
+ *
+ * @ param codec    [in]    : VIDENC2_Handle created with inputDataMode IVIDEO_NUMROWS.
+ * @ return                 : DCE_EOK or DCE_EINVALID_INPUT.
+ */
+int dce_callback_data_ready(void *codec);
+
+/*===============================================================*/
+/** dce_stats_percentile    : Duration below which a percentage of the calls of a
+ *                            histogram completed, with the precision of its buckets.
+ *
+ * @ param hist     [in]    : Histogram obtained with dce_get_stats().
+ * @ param percent  [in]    : 0 to 100, e.g. 99 for the 99th percentile.
+ * @ return                 : Duration in microseconds, 0 if the histogram is empty.
+ */
+uint32_t dce_stats_percentile(const dce_histogram *hist, int percent);
+
+/*===============================================================*/
+/** dce_enable_stats        : Turn the call statistics on or off. They are on by default,
+ *                            recording costs a few clock reads and atomic increments.
+ *
+ * @ param enable   [in]    : 0 to stop recording, 1 to record.
+ */
+void dce_enable_stats(int enable);
+
+/*===============================================================*/
+/** dce_trace_dump          : Write the DEBUG and INFO traces recorded by all threads
+ *                            (see dce_debug), oldest first. Each thread keeps its last
+ *                            255 traces.
+ *
+ * @ param fd       [in]    : File descriptor the formatted traces are written to.
+ * @ return                 : Number of traces written, -1 on error.
+ */
+int dce_trace_dump(int fd);
+
+/* dce_capture_start() flags */
+#define DCE_CAPTURE_BUFFERS 0x1     /* save the contents of all the data buffers */
+
+/*===============================================================*/
+/** dce_capture_start       : Write every remote call to a file (parameters, buffers,
+ *                            return values and timing) which dce_replay plays back.
+ *                            Setting DCE_CAPTURE=<file> in the environment starts a
+ *                            capture with the first Engine_open().
+ *
+ * @ param path     [in]    : File to create.
+ * @ param flags    [in]    : 0 or DCE_CAPTURE_BUFFERS. By default data buffers larger
+ *                            than 64KB are referenced without their contents.
+ * @ return                 : Error Status.
+ */
+int dce_capture_start(const char *path, int flags);
+
+/*===============================================================*/
+/** dce_capture_stop        : Stop the capture and close its file.
+ */
+void dce_capture_stop(void);
+
 /*===============================================================*/
 /** dce_ipc_recover         : Recover the DCE IPC in case of
  *                            remote core crash.
@@ -141,7 +724,9 @@ void dce_ipc_recover(void);
 /************************ Input/Output Buffer Lock/Unlock APIs ************************/
 /*=====================================================================================*/
 /** dce_buf_lock            : Pin or lock Tiler Buffers which would be used by the IVAHD codec
- *                            as reference buffers. API is specific to GLP.
+ *                            as reference buffers. API is specific to GLP. On Linux
+ *                            process() registers the buffers it is passed on its own, a
+ *                            locked buffer is only kept out of the eviction.
  *
  * @ param num    [in]      : Number of buffers to be locked.
  * @ param handle [in]      : Pointer to array of DMA Buf FDs of the buffers to be locked.
@@ -152,12 +737,34 @@ int dce_buf_lock(int num, size_t *handle);
 /*=====================================================================================*/
 /** dce_buf_unlock          : Unpin or unlock Tiler Buffers which were locked to be used
  *                            by the IVAHD codec as reference buffers. API is specific to GLP.
+ *                            On Linux the buffers stay registered, bounded by the capacity
+ *                            of dce_set_registration_cache(), until they are evicted.
  *
  * @ param num    [in]      : Number of buffers to be locked.
  * @ param handle [in]      : Pointer to array of DMA Buf FDs of the buffers to be locked.
  * @ return                 : DCE error status is returned.
  */
 int dce_buf_unlock(int num, size_t *handle);
+
+#if defined(BUILDOS_LINUX)
+/* Registrations kept per core by default, see dce_set_registration_cache() */
+#define DCE_DEFAULT_REGISTRATION_CACHE 32
+
+/*=====================================================================================*/
+/** dce_set_registration_cache : Set the number of data buffers kept registered with a core.
+ *                            process() registers the dma-bufs it is passed the first time
+ *                            it sees them, and they stay registered, holding their memory,
+ *                            until the least recently used ones are evicted. The buffers
+ *                            locked, in a process() call or not listed in freeBufID yet
+ *                            (decoder outputs reported by outBufsInUseFlag, encoder inputs)
+ *                            are not evicted and may exceed the capacity. Only for Linux.
+ *
+ * @ param core    [in]     : 0 for IPU, 1 for DSP.
+ * @ param entries [in]     : Capacity, 0 disables the cache and releases its entries.
+ * @ return                 : DCE error status is returned.
+ */
+int dce_set_registration_cache(int core, int entries);
+#endif
 /************************ Input/Output Buffer Lock/Unlock APIs ************************/
 /*=====================================================================================*/
 /** dsp_dce_buf_lock            : Pin or lock Tiler Buffers which would be used by the DSP codec
@@ -196,6 +803,171 @@ int dce_get_fd();
 void dce_set_fd(int fd);
 
 
+/************************** Asynchronous Process APIs **************************/
+/* VIDENC2_processAsync()/VIDENC2_processWait() follow the prototypes of      */
+/* ti/sdo/ce/video2/videnc2.h, VIDDEC3 ones are declared below as they are    */
+/* disabled in ti/sdo/ce/video3/viddec3.h. Submitted calls are issued by one  */
+/* dispatcher thread per codec in submission order, so an application thread  */
+/* can keep frames of several codecs in flight. Each call in flight on a codec*/
+/* must use its own outArgs, which identifies the call in *_processWait().    */
+/*=====================================================================================*/
+/** VIDDEC3_processAsync    : Submit a decode process call without waiting for the
+ *                            remote core. The buffers and arguments must stay
+ *                            untouched until the call is reaped by VIDDEC3_processWait().
+ *
+ * @ param codec   [in]     : Codec Handle obtained in VIDDEC3_create() call.
+ * @ param inBufs, outBufs, inArgs, outArgs : Same as VIDDEC3_process().
+ * @ return                 : DCE error status of the submission.
+ */
+XDAS_Int32 VIDDEC3_processAsync(VIDDEC3_Handle codec,
+                                XDM2_BufDesc *inBufs, XDM2_BufDesc *outBufs,
+                                VIDDEC3_InArgs *inArgs, VIDDEC3_OutArgs *outArgs);
+
+/*=====================================================================================*/
+/** VIDDEC3_processWait     : Wait for a call submitted by VIDDEC3_processAsync().
+ *
+ * @ param codec   [in]     : Codec Handle obtained in VIDDEC3_create() call.
+ * @ param outArgs [in]     : outArgs of the call to wait for. NULL takes the oldest
+ *                            completed call of the codec.
+ * @ param timeout [in]     : Timeout in microseconds, 0 to poll or VIDDEC3_FOREVER.
+ * @ return                 : Return value of VIDDEC3_process() for the call,
+ *                            VIDDEC3_ETIMEOUT if it did not complete in time, or
+ *                            DCE_EINVALID_INPUT if no matching call is outstanding.
+ */
+XDAS_Int32 VIDDEC3_processWait(VIDDEC3_Handle codec,
+                               XDM2_BufDesc *inBufs, XDM2_BufDesc *outBufs,
+                               VIDDEC3_InArgs *inArgs, VIDDEC3_OutArgs *outArgs,
+                               UInt timeout);
+
+/************************** Timed Process APIs **************************/
+/* A timed call which does not complete before its deadline is cancelled:    */
+/* the caller returns, the instance is marked failed and every later remote  */
+/* call of the instance fails, so a hung remote core does not block the other */
+/* instances. *_delete() of a failed instance returns at once, the remote    */
+/* instance is deleted when the cancelled call returns.                      */
+/*=====================================================================================*/
+/** VIDDEC3_processTimed    : Decode process call with a deadline. Not supported for
+ *                            low latency (IVIDEO_NUMROWS) instances.
+ *
+ * @ param codec   [in]     : Codec Handle obtained in VIDDEC3_create() call.
+ * @ param inBufs, outBufs, inArgs, outArgs : Same as VIDDEC3_process().
+ * @ param timeout [in]     : Timeout in microseconds, greater than 0, or VIDDEC3_FOREVER.
+ * @ return                 : Return value of VIDDEC3_process(), VIDDEC3_ETIMEOUT if the
+ *                            call was cancelled, DCE_EIPC_CALL_FAIL if the instance has
+ *                            failed.
+ */
+XDAS_Int32 VIDDEC3_processTimed(VIDDEC3_Handle codec,
+                                XDM2_BufDesc *inBufs, XDM2_BufDesc *outBufs,
+                                VIDDEC3_InArgs *inArgs, VIDDEC3_OutArgs *outArgs,
+                                UInt timeout);
+
+/*=====================================================================================*/
+/** VIDENC2_processTimed    : Encode process call with a deadline. Not supported for
+ *                            low latency (IVIDEO_NUMROWS) instances.
+ *
+ * @ param codec   [in]     : Codec Handle obtained in VIDENC2_create() call.
+ * @ param inBufs, outBufs, inArgs, outArgs : Same as VIDENC2_process().
+ * @ param timeout [in]     : Timeout in microseconds, greater than 0, or VIDENC2_FOREVER.
+ * @ return                 : Same as VIDDEC3_processTimed().
+ */
+XDAS_Int32 VIDENC2_processTimed(VIDENC2_Handle codec,
+                                IVIDEO2_BufDesc *inBufs, XDM2_BufDesc *outBufs,
+                                VIDENC2_InArgs *inArgs, VIDENC2_OutArgs *outArgs,
+                                UInt timeout);
+
+/************************** Batched Control APIs **************************/
+/* A batch runs several control commands on a codec in one round trip to the */
+/* remote core, e.g. XDM_SETPARAMS followed by XDM_GETSTATUS and XDM_GETBUFINFO. */
+/* The commands run in order, a failing command does not stop the next ones.  */
+/*=====================================================================================*/
+/** VIDDEC3_controlBatch    : Run a batch of control commands on a decoder.
+ *
+ * @ param codec   [in]     : Codec Handle obtained in VIDDEC3_create() call.
+ * @ param cmds    [in/out] : Commands, the return value of each one is stored in ret.
+ * @ param count   [in]     : Number of commands, 1 to DCE_MAX_CONTROL_BATCH.
+ * @ return                 : XDM_EOK if every command succeeded, XDM_EFAIL if one
+ *                            failed, or a DCE error status if the batch was not run.
+ */
+XDAS_Int32 VIDDEC3_controlBatch(VIDDEC3_Handle codec, dce_control_cmd *cmds, Int count);
+
+/*=====================================================================================*/
+/** VIDENC2_controlBatch    : Run a batch of control commands on an encoder.
+ *
+ * @ param codec   [in]     : Codec Handle obtained in VIDENC2_create() call.
+ * @ param cmds    [in/out] : Commands, the return value of each one is stored in ret.
+ * @ param count   [in]     : Number of commands, 1 to DCE_MAX_CONTROL_BATCH.
+ * @ return                 : Same as VIDDEC3_controlBatch().
+ */
+XDAS_Int32 VIDENC2_controlBatch(VIDENC2_Handle codec, dce_control_cmd *cmds, Int count);
+
+/****************************** Automatic Placement APIs ******************************/
+/*=====================================================================================*/
+/** dce_placement_create_decoder : Create a decoder on the remote core with the most
+ *                                 headroom. The engines of both cores are opened on
+ *                                 demand and closed when the last decoder created
+ *                                 this way is deleted. The headroom is the idle CPU
+ *                                 share reported by RPROC_CPU_LOAD, sampled at most
+ *                                 every DCE_PLACEMENT_SAMPLE_US. A core is skipped
+ *                                 when its instance quota is reached or its available
+ *                                 heap is below the minimum set with dce_set_placement().
+ *                                 If the creation fails on the best core the other one
+ *                                 is tried.
+ *
+ * @ param dec  [in]        : Codec name and params for each core that can decode the stream.
+ * @ param core [out]       : 0 if a VIDDEC3 handle was created on the IPU, use the
+ *                            VIDDEC3_* APIs with it. 1 if a VIDDEC2 handle was created
+ *                            on the DSP, use the VIDDEC2_* APIs with it.
+ * @ return                 : Codec handle, NULL on error.
+ */
+void *dce_placement_create_decoder(const dce_placement_decoder *dec, int *core);
+
+/*=====================================================================================*/
+/** dce_set_placement       : Configure dce_placement_create_decoder().
+ *
+ * @ param sample_us [in]   : Minimum interval between two load samples of a core.
+ * @ param min_heap  [in]   : Minimum RPROC_AVAILABLE_HEAP_SIZE in bytes to place a decoder on
+ *                            a core, 0 by default.
+ * @ return                 : DCE_EOK or DCE_EINVALID_INPUT.
+ */
+int dce_set_placement(unsigned int sample_us, int min_heap);
+
+/****************************** Telemetry APIs ******************************/
+/* The sampler queries the load and heap of every core with an open engine  */
+/* and keeps the last DCE_TELEMETRY_HISTORY samples of each core. Reading   */
+/* the samples never blocks and issues no remote call.                      */
+/*=====================================================================================*/
+/** dce_telemetry_start     : Start the sampler thread, or change its period if it runs.
+ *                            Its queries use DCE_PRIORITY_BATCH (see dce_set_scheduler()).
+ *
+ * @ param period_us [in]   : Sampling period in microseconds.
+ * @ return                 : DCE_EOK, DCE_EINVALID_INPUT or DCE_EXDM_FAIL.
+ */
+int dce_telemetry_start(unsigned int period_us);
+
+/*=====================================================================================*/
+/** dce_telemetry_stop      : Stop the sampler thread. The samples are kept.
+ */
+void dce_telemetry_stop(void);
+
+/*=====================================================================================*/
+/** dce_telemetry_latest    : Read the latest sample of a core.
+ *
+ * @ param core   [in]      : 0 for IPU, 1 for DSP.
+ * @ param sample [out]     : Latest sample.
+ * @ return                 : DCE_EOK, or DCE_EINVALID_INPUT if the core has no sample.
+ */
+int dce_telemetry_latest(int core, dce_telemetry_sample *sample);
+
+/*=====================================================================================*/
+/** dce_telemetry_history   : Read the last samples of a core, oldest first.
+ *
+ * @ param core    [in]     : 0 for IPU, 1 for DSP.
+ * @ param samples [out]    : Array of max samples.
+ * @ param max     [in]     : Number of samples wanted, at most DCE_TELEMETRY_HISTORY are returned.
+ * @ return                 : Number of samples copied, or DCE_EINVALID_INPUT.
+ */
+int dce_telemetry_history(int core, dce_telemetry_sample *samples, int max);
+
  /*===============================================================*/
 /** get_rproc_info : Get Information from the Remote proc.
  *
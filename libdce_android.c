@@ -42,14 +42,16 @@
 #include "memplugin.h"
 
 
-extern MmRpc_Handle    MmRpcHandle[];
 extern pthread_mutex_t    ipc_mutex;
+extern MmRpc_Handle    dce_ipc_get(int core, int conn);
+extern void            dce_ipc_put(int core, int conn);
 int is_ipc_ready = 0;
 
 int dce_buf_lock(int num, size_t *handle)
 {
-    int                 i;
+    int                 i, conn;
     MmRpc_BufDesc      *desc = NULL;
+    MmRpc_Handle        rpc = NULL;
     dce_error_status    eError = DCE_EOK;
 
     pthread_mutex_lock(&ipc_mutex);
@@ -62,6 +64,8 @@ int dce_buf_lock(int num, size_t *handle)
         is_ipc_ready = 0x1234;
     }
 
+    pthread_mutex_unlock(&ipc_mutex);
+
     _ASSERT(num > 0, DCE_EINVALID_INPUT);
 
     desc = malloc(num * sizeof(MmRpc_BufDesc));
@@ -71,28 +75,29 @@ int dce_buf_lock(int num, size_t *handle)
         desc[i].handle = handle[i];
     }
 
-    eError = MmRpc_use(MmRpcHandle[IPU], MmRpc_BufType_Handle, num, desc);
-
-    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+    /* A codec may be bound to any connection of the pool */
+    for( conn = 0; (rpc = dce_ipc_get(IPU, conn)) != NULL; conn++ ) {
+        eError = MmRpc_use(rpc, MmRpc_BufType_Handle, num, desc);
+        dce_ipc_put(IPU, conn);
+        _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+    }
+    _ASSERT(conn > 0, DCE_EIPC_CALL_FAIL);
 EXIT:
     if( desc ) {
         free(desc);
     }
-    pthread_mutex_unlock(&ipc_mutex);
 
     return (eError);
 }
 
 int dce_buf_unlock(int num, size_t *handle)
 {
-    int                 i;
+    int                 i, conn;
     MmRpc_BufDesc      *desc = NULL;
+    MmRpc_Handle        rpc = NULL;
     dce_error_status    eError = DCE_EOK;
 
-    pthread_mutex_lock(&ipc_mutex);
-
     if (!is_ipc_ready) {
-        pthread_mutex_unlock(&ipc_mutex);
         return DCE_EIPC_CALL_FAIL;
     }
 
@@ -105,23 +110,27 @@ int dce_buf_unlock(int num, size_t *handle)
         desc[i].handle = handle[i];
     }
 
-    eError = MmRpc_release(MmRpcHandle[IPU], MmRpc_BufType_Handle, num, desc);
-
-    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+    /* A codec may be bound to any connection of the pool */
+    for( conn = 0; (rpc = dce_ipc_get(IPU, conn)) != NULL; conn++ ) {
+        eError = MmRpc_release(rpc, MmRpc_BufType_Handle, num, desc);
+        dce_ipc_put(IPU, conn);
+        _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+    }
+    _ASSERT(conn > 0, DCE_EIPC_CALL_FAIL);
 EXIT:
     if( desc ) {
         free(desc);
     }
 
-    pthread_mutex_unlock(&ipc_mutex);
-
     return (eError);
 }
 
 void dce_ipc_recover(void)
 {
+    pthread_mutex_lock(&ipc_mutex);
     if (is_ipc_ready) {
         dce_ipc_deinit(IPU, -1);
         is_ipc_ready = 0;
     }
+    pthread_mutex_unlock(&ipc_mutex);
 }
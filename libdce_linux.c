@@ -33,7 +33,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <unistd.h>
 #include <pthread.h>
+#include <sys/stat.h>
 
 #include <xf86drm.h>
 #include <omap_drm.h>
@@ -50,8 +52,9 @@
 static int             OmapDrm_FD  = INVALID_DRM_FD;
 static int             dce_init_count = 0;
 struct omap_device    *OmapDev     = NULL;
-extern MmRpc_Handle    MmRpcHandle[];
 extern pthread_mutex_t    ipc_mutex;
+extern MmRpc_Handle    dce_ipc_get(int core, int conn);
+extern void            dce_ipc_put(int core, int conn);
 
 void *dce_init(void)
 {
@@ -93,66 +96,440 @@ void dce_deinit(void *dev)
     return;
 }
 
-int dce_buf_lock(int num, size_t *handle)
+/* Register (MmRpc_use) or unregister (MmRpc_release) buffers with every MmRpc */
+/* connection of a core, as a codec may be bound to any of them. ipc_mutex is   */
+/* only held to reference a connection.                                         */
+int dce_buf_register(int core, int num, size_t *handle, int use)
 {
-    int                 i;
-    MmRpc_BufDesc      *desc = NULL;
+    int                 i, conn;
+    MmRpc_BufDesc       local[MAX_TOTAL_BUF];
+    MmRpc_BufDesc      *desc = local;
+    MmRpc_Handle        rpc = NULL;
     dce_error_status    eError = DCE_EOK;
 
-    pthread_mutex_lock(&ipc_mutex);
-
     _ASSERT(num > 0, DCE_EINVALID_INPUT);
 
-    desc = malloc(num * sizeof(MmRpc_BufDesc));
-    _ASSERT(desc != NULL, DCE_EOUT_OF_MEMORY);
+    if( num > MAX_TOTAL_BUF ) {
+        desc = malloc(num * sizeof(MmRpc_BufDesc));
+        _ASSERT(desc != NULL, DCE_EOUT_OF_MEMORY);
+    }
 
     for( i = 0; i < num; i++ ) {
         desc[i].handle = handle[i];
     }
 
-    eError = MmRpc_use(MmRpcHandle[IPU], MmRpc_BufType_Handle, num, desc);
+    for( conn = 0; (rpc = dce_ipc_get(core, conn)) != NULL; conn++ ) {
+        if( use ) {
+            eError = MmRpc_use(rpc, MmRpc_BufType_Handle, num, desc);
+        } else {
+            eError = MmRpc_release(rpc, MmRpc_BufType_Handle, num, desc);
+        }
+        dce_ipc_put(core, conn);
+        _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
+    }
+    /* No connection open on the core */
+    _ASSERT(conn > 0, DCE_EIPC_CALL_FAIL);
 
-    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
 EXIT:
-    if( desc ) {
+    if( desc != local ) {
         free(desc);
     }
 
-    pthread_mutex_unlock(&ipc_mutex);
-
     return (eError);
 }
 
-int dce_buf_unlock(int num, size_t *handle)
+/***************** Registration cache ****************/
+/* dma-bufs registered with a core, keyed by inode so that any fd of a buffer   */
+/* finds its entry. process() registers the data buffers it has not seen yet    */
+/* and dce_buf_lock() pins buffers, several misses costing one MmRpc_use().     */
+/* The entry keeps a duplicate of the fd, so the buffer stays registered until  */
+/* its entry is evicted: the least recently used entry neither pinned nor held  */
+/* by a codec once the cache holds max entries, which bounds the buffers kept   */
+/* alive by the duplicates. References held by process contexts are            */
+/* (serial << 32 | index) and go stale when their entry is reused.              */
+typedef struct reg_entry {
+    dev_t       dev;
+    ino_t       ino;
+    int32_t     fd;         /* duplicate registered with the core, -1 if the entry is free */
+    int         pins;       /* dce_buf_lock() calls not unlocked yet */
+    int         holds;      /* process() calls in flight or not freed by the codec yet */
+    int         epoch;      /* dce_ipc_epoch() of the registration */
+    uint32_t    serial;     /* bumped whenever the entry is reused */
+    uint64_t    last_use;
+} reg_entry;
+
+typedef struct reg_cache {
+    reg_entry   *entry;
+    int         num;        /* entries allocated */
+    int         used;       /* entries holding a buffer */
+    int         max;        /* exceeded only by pinned or held entries, 0 disables the cache */
+    uint64_t    tick;
+} reg_cache;
+
+#define REG_NONE    ((uint64_t)-1)
+
+static reg_cache        __RegCache[MAX_REMOTEDEVICES] = {
+    { NULL, 0, 0, DCE_DEFAULT_REGISTRATION_CACHE, 0 },
+    { NULL, 0, 0, DCE_DEFAULT_REGISTRATION_CACHE, 0 }
+};
+static pthread_mutex_t  reg_mutex = PTHREAD_MUTEX_INITIALIZER;
+extern int              dce_ipc_epoch(int core);
+
+/* Free an entry. Its duplicate is queued in rel to be released when still */
+/* registered, closed at once otherwise. reg_mutex must be held.           */
+static void reg_drop(reg_cache *c, reg_entry *e, int epoch, size_t *rel, int *nrel)
 {
-    int                 i;
-    MmRpc_BufDesc      *desc = NULL;
-    dce_error_status    eError = DCE_EOK;
+    if( e->epoch == epoch ) {
+        rel[(*nrel)++] = e->fd;
+    } else {
+        close(e->fd);
+    }
+    e->fd = -1;
+    e->pins = 0;
+    e->holds = 0;
+    e->serial++;
+    c->used--;
+}
 
-    pthread_mutex_lock(&ipc_mutex);
+/* Entry for a new buffer: a free one, the least recently used one neither */
+/* pinned nor held and not used since the tick since, or a new one.         */
+/* reg_mutex must be held.                                                  */
+static reg_entry *reg_victim(reg_cache *c, uint64_t since, int epoch, size_t *rel, int *nrel)
+{
+    reg_entry   *e, *lru = NULL;
+    int         i;
+
+    for( i = 0; i < c->num; i++ ) {
+        e = &(c->entry[i]);
+        if( e->fd < 0 ) {
+            return (e);
+        }
+        if( c->used >= c->max && e->pins == 0 && e->holds == 0 && e->last_use < since &&
+            (lru == NULL || e->last_use < lru->last_use) ) {
+            lru = e;
+        }
+    }
+    if( lru ) {
+        reg_drop(c, lru, epoch, rel, nrel);
+        return (lru);
+    }
 
-    _ASSERT(num > 0, DCE_EINVALID_INPUT);
+    e = realloc(c->entry, (c->num + 8) * sizeof(reg_entry));
+    if( e == NULL ) {
+        return (NULL);
+    }
+    c->entry = e;
+    for( i = c->num; i < c->num + 8; i++ ) {
+        memset(&(c->entry[i]), 0, sizeof(reg_entry));
+        c->entry[i].fd = -1;
+    }
+    c->num += 8;
+    return (&(c->entry[i - 8]));
+}
+
+/* Evict entries neither pinned nor held beyond the capacity. reg_mutex must be held. */
+static void reg_trim(reg_cache *c, int epoch, size_t *rel, int *nrel, int room)
+{
+    reg_entry   *e, *lru;
+    int         i;
+
+    while( c->used > c->max && *nrel < room ) {
+        for( i = 0, lru = NULL; i < c->num; i++ ) {
+            e = &(c->entry[i]);
+            if( e->fd >= 0 && e->pins == 0 && e->holds == 0 &&
+                (lru == NULL || e->last_use < lru->last_use) ) {
+                lru = e;
+            }
+        }
+        if( lru == NULL ) {
+            break;
+        }
+        reg_drop(c, lru, epoch, rel, nrel);
+    }
+}
+
+/* Release the registrations queued by reg_drop() and close their duplicates */
+static void reg_release(int core, size_t *rel, int nrel)
+{
+    int     i;
 
-    desc = malloc(num * sizeof(MmRpc_BufDesc));
-    _ASSERT(desc != NULL, DCE_EOUT_OF_MEMORY);
+    if( nrel > 0 ) {
+        dce_buf_register(core, nrel, rel, 0);
+    }
+    for( i = 0; i < nrel; i++ ) {
+        close((int)rel[i]);
+    }
+}
 
+/* Look up or register num buffers, pinning them when pin is set. The references */
+/* of the entries are returned in ref when it is not NULL.                       */
+static int reg_get(int core, int num, size_t *handle, int pin, uint64_t *ref)
+{
+    reg_cache           *c = &__RegCache[core];
+    reg_entry           *e, *added[MAX_TOTAL_BUF];
+    struct stat         st;
+    size_t              use[MAX_TOTAL_BUF], rel[2 * MAX_TOTAL_BUF];
+    uint64_t            since;
+    int                 i, k, epoch, nuse = 0, nrel = 0;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(num > 0 && num <= MAX_TOTAL_BUF, DCE_EINVALID_INPUT);
+
+    pthread_mutex_lock(&reg_mutex);
+    epoch = dce_ipc_epoch(core);
+    since = c->tick + 1;
     for( i = 0; i < num; i++ ) {
-        desc[i].handle = handle[i];
+        if( ref ) {
+            ref[i] = REG_NONE;
+        }
+        if( fstat((int)handle[i], &st) < 0 ) {
+            ERROR("Invalid buffer handle %d", (int)handle[i]);
+            eError = DCE_EINVALID_INPUT;
+            continue;
+        }
+        for( k = 0, e = NULL; k < c->num && e == NULL; k++ ) {
+            if( c->entry[k].fd >= 0 && c->entry[k].ino == st.st_ino && c->entry[k].dev == st.st_dev ) {
+                e = &(c->entry[k]);
+            }
+        }
+        if( e && e->epoch != epoch ) {
+            /* Registered with connections closed since */
+            reg_drop(c, e, epoch, rel, &nrel);
+        }
+        if( e == NULL || e->fd < 0 ) {
+            e = e ? e : reg_victim(c, since, epoch, rel, &nrel);
+            if( e == NULL || (e->fd = dup((int)handle[i])) < 0 ) {
+                if( e ) {
+                    e->fd = -1;
+                }
+                eError = DCE_EOUT_OF_MEMORY;
+                continue;
+            }
+            e->dev = st.st_dev;
+            e->ino = st.st_ino;
+            e->pins = 0;
+            e->holds = 0;
+            e->epoch = epoch;
+            c->used++;
+            added[nuse] = e;
+            use[nuse++] = e->fd;
+        }
+        e->last_use = ++c->tick;
+        e->pins += pin;
+        if( ref ) {
+            ref[i] = ((uint64_t)e->serial << 32) | (uint32_t)(e - c->entry);
+        }
+    }
+
+    if( nuse > 0 && dce_buf_register(core, nuse, use, 1) != DCE_EOK ) {
+        ERROR("Failed to register %d buffers", nuse);
+        for( i = 0; i < nuse; i++ ) {
+            close(added[i]->fd);
+            added[i]->fd = -1;
+            added[i]->pins = 0;
+            added[i]->serial++;
+            c->used--;
+        }
+        eError = DCE_EIPC_CALL_FAIL;
     }
+    reg_trim(c, epoch, rel, &nrel, 2 * MAX_TOTAL_BUF);
+    pthread_mutex_unlock(&reg_mutex);
 
-    eError = MmRpc_release(MmRpcHandle[IPU], MmRpc_BufType_Handle, num, desc);
+    reg_release(core, rel, nrel);
 
-    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
 EXIT:
-    if( desc ) {
-        free(desc);
+    return (eError);
+}
+
+/* Unpin num buffers, dropping their entries at once when drop is set. The */
+/* buffers without an entry are returned in missing, with their number.   */
+static int reg_put(int core, int num, size_t *handle, int drop, size_t *missing)
+{
+    reg_cache           *c = &__RegCache[core];
+    reg_entry           *e;
+    struct stat         st;
+    size_t              rel[2 * MAX_TOTAL_BUF];
+    int                 i, k, epoch, nrel = 0, nmissing = 0;
+
+    pthread_mutex_lock(&reg_mutex);
+    epoch = dce_ipc_epoch(core);
+    for( i = 0; i < num; i++ ) {
+        if( fstat((int)handle[i], &st) < 0 ) {
+            continue;
+        }
+        for( k = 0, e = NULL; k < c->num && e == NULL; k++ ) {
+            if( c->entry[k].fd >= 0 && c->entry[k].ino == st.st_ino && c->entry[k].dev == st.st_dev ) {
+                e = &(c->entry[k]);
+            }
+        }
+        if( e == NULL ) {
+            missing[nmissing++] = handle[i];
+            continue;
+        }
+        if( e->pins > 0 ) {
+            e->pins--;
+        }
+        if( drop && e->pins == 0 ) {
+            reg_drop(c, e, epoch, rel, &nrel);
+        }
+    }
+    reg_trim(c, epoch, rel, &nrel, 2 * MAX_TOTAL_BUF);
+    pthread_mutex_unlock(&reg_mutex);
+
+    reg_release(core, rel, nrel);
+
+    return (nmissing);
+}
+
+/* Register the data buffers of a process() call not registered yet */
+int dce_buf_cache_use(int core, int num, size_t *handle, uint64_t *ref)
+{
+    if( __atomic_load_n(&__RegCache[core].max, __ATOMIC_RELAXED) == 0 ) {
+        return (DCE_EOK);
     }
+    return (reg_get(core, num, handle, 0, ref));
+}
 
-    pthread_mutex_unlock(&ipc_mutex);
+/* Entry of a reference, NULL when it went stale. reg_mutex must be held. */
+static reg_entry *reg_ref(reg_cache *c, uint64_t ref)
+{
+    uint32_t    index = (uint32_t)ref;
+
+    if( ref == REG_NONE || index >= (uint32_t)c->num ||
+        c->entry[index].fd < 0 || c->entry[index].serial != (uint32_t)(ref >> 32) ) {
+        return (NULL);
+    }
+    return (&(c->entry[index]));
+}
+
+/* Mark the entries of the data buffers of a process() call as just used. The  */
+/* references of the entries evicted since are reset, and so are those of the  */
+/* fds closed and reused for another buffer since, whose inode no longer match. */
+void dce_buf_cache_touch(int core, int num, size_t *handle, uint64_t *ref)
+{
+    reg_cache   *c = &__RegCache[core];
+    reg_entry   *e;
+    struct stat st;
+    int         i, epoch;
+
+    pthread_mutex_lock(&reg_mutex);
+    epoch = dce_ipc_epoch(core);
+    for( i = 0; i < num; i++ ) {
+        if( ref[i] == REG_NONE ) {
+            continue;
+        }
+        e = reg_ref(c, ref[i]);
+        if( e && e->epoch == epoch && fstat((int)handle[i], &st) == 0 &&
+            e->ino == st.st_ino && e->dev == st.st_dev ) {
+            e->last_use = ++c->tick;
+        } else {
+            ref[i] = REG_NONE;
+        }
+    }
+    pthread_mutex_unlock(&reg_mutex);
+}
 
+/* Hold (hold 1) or release (hold -1) the entries of the data buffers a codec */
+/* uses, so that they are not evicted meanwhile. Stale references are skipped. */
+void dce_buf_cache_hold(int core, int num, uint64_t *ref, int hold)
+{
+    reg_cache   *c = &__RegCache[core];
+    reg_entry   *e;
+    size_t      rel[2 * MAX_TOTAL_BUF];
+    int         i, nrel = 0;
+
+    for( i = 0; i < num && ref[i] == REG_NONE; i++ ) {
+        ;
+    }
+    if( i == num ) {
+        return;
+    }
+
+    pthread_mutex_lock(&reg_mutex);
+    for( ; i < num; i++ ) {
+        if((e = reg_ref(c, ref[i])) != NULL && e->holds + hold >= 0 ) {
+            e->holds += hold;
+        }
+    }
+    /* Entries released beyond the capacity */
+    if( hold < 0 ) {
+        reg_trim(c, dce_ipc_epoch(core), rel, &nrel, 2 * MAX_TOTAL_BUF);
+    }
+    pthread_mutex_unlock(&reg_mutex);
+
+    reg_release(core, rel, nrel);
+}
+
+/* Pin (pin set) or unpin buffers. Unpinned buffers stay registered until they */
+/* are evicted, unless drop is set.                                            */
+static int dce_buf_pin_core(int core, int num, size_t *handle, int pin, int drop)
+{
+    size_t  missing[MAX_TOTAL_BUF];
+    int     i, n, nmissing, eError = DCE_EOK;
+
+    for( i = 0; i < num && eError == DCE_EOK; i += n ) {
+        n = num - i < MAX_TOTAL_BUF ? num - i : MAX_TOTAL_BUF;
+        if( pin && __atomic_load_n(&__RegCache[core].max, __ATOMIC_RELAXED) == 0 ) {
+            eError = dce_buf_register(core, n, handle + i, 1);
+        } else if( pin ) {
+            eError = reg_get(core, n, handle + i, 1, NULL);
+        } else if((nmissing = reg_put(core, n, handle + i, drop, missing)) > 0 ) {
+            /* Registered while the cache was disabled */
+            eError = dce_buf_register(core, nmissing, missing, 0);
+        }
+    }
     return (eError);
 }
 
+/* Buffers of memplugin_alloc_noheader(): pinned in the cache, so that process() */
+/* finds them, and unregistered as soon as they are freed.                       */
+int dce_buf_pin(int core, int num, size_t *handle, int pin)
+{
+    return (dce_buf_pin_core(core, num, handle, pin, 1));
+}
+
+int dce_buf_lock(int num, size_t *handle)
+{
+    return (dce_buf_pin_core(IPU, num, handle, 1, 0));
+}
+
+int dce_buf_unlock(int num, size_t *handle)
+{
+    return (dce_buf_pin_core(IPU, num, handle, 0, 0));
+}
+
+int dce_set_registration_cache(int core, int entries)
+{
+    size_t      rel[MAX_TOTAL_BUF];
+    int         epoch, nrel;
+
+    if( core < IPU || core >= MAX_REMOTEDEVICES || entries < 0 ) {
+        return (DCE_EINVALID_INPUT);
+    }
+
+    pthread_mutex_lock(&reg_mutex);
+    __atomic_store_n(&__RegCache[core].max, entries, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&reg_mutex);
+
+    /* Evict the entries beyond the new capacity, a batch at a time */
+    do {
+        nrel = 0;
+        pthread_mutex_lock(&reg_mutex);
+        epoch = dce_ipc_epoch(core);
+        reg_trim(&__RegCache[core], epoch, rel, &nrel, MAX_TOTAL_BUF);
+        pthread_mutex_unlock(&reg_mutex);
+        reg_release(core, rel, nrel);
+    } while( nrel == MAX_TOTAL_BUF );
+
+    return (DCE_EOK);
+}
+
+/* Parameter buffer with a cached mapping, see memplugin_sync() */
+void *dce_alloc_cached(int sz)
+{
+    return (memplugin_alloc(sz, 1, DEFAULT_REGION, 0, IPU | MEM_CACHED));
+}
+
 /*Memory Management mirror APIs for DSP remoteproc targets*/
 void *dsp_dce_alloc(int sz)
 {
@@ -171,75 +548,159 @@ void dsp_dce_free(void *ptr)
 
 int dsp_dce_buf_lock(int num, size_t *handle)
 {
-    int                 i;
-    MmRpc_BufDesc      *desc = NULL;
-    dce_error_status    eError = DCE_EOK;
-
-    pthread_mutex_lock(&ipc_mutex);
-
-    _ASSERT(num > 0, DCE_EINVALID_INPUT);
+    return (dce_buf_pin_core(DSP, num, handle, 1, 0));
+}
 
-    desc = malloc(num * sizeof(MmRpc_BufDesc));
-    _ASSERT(desc != NULL, DCE_EOUT_OF_MEMORY);
+int dsp_dce_buf_unlock(int num, size_t *handle)
+{
+    return (dce_buf_pin_core(DSP, num, handle, 0, 0));
+}
 
-    for( i = 0; i < num; i++ ) {
-        desc[i].handle = handle[i];
+/* Incase of X11 or Wayland the fd can be shared to libdce using this call */
+void dce_set_fd(int dce_fd)
+{
+    if (OmapDrm_FD == INVALID_DRM_FD) {
+        OmapDrm_FD = dce_fd;
     }
+    else {
+        DEBUG("Cannot set the fd, omapdrm device fd is already set");
+    }
+}
 
-    eError = MmRpc_use(MmRpcHandle[DSP], MmRpc_BufType_Handle, num, desc);
+int dce_get_fd(void)
+{
+    return (OmapDrm_FD);
+}
 
-    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
-EXIT:
-    if( desc ) {
-        free(desc);
-    }
 
-    pthread_mutex_unlock(&ipc_mutex);
+/* dma-buf of another allocator (V4L2, GBM, ...) imported with dce_buf_import(). */
+/* The MemHeader of each plane is the buf of its XDM descriptor: process() sees  */
+/* it in dce_buf_imported() and translates it as the registered dma-buf plus the */
+/* offset of the plane, as memplugin_alloc_noheader() buffers on Android.        */
+typedef struct dce_import {
+    MemHeader           plane[DCE_MAX_PLANES];
+    dce_plane           layout[DCE_MAX_PLANES];     /* as imported, see dce_buf_import_seek() */
+    int                 num_planes;
+    int32_t             fd;     /* duplicate of the imported fd, registered with MmRpc */
+    struct dce_import   *next;
+} dce_import;
 
-    return (eError);
-}
+static dce_import       *__Imports = NULL;
+static pthread_mutex_t  import_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-int dsp_dce_buf_unlock(int num, size_t *handle)
+void *dce_buf_import(int fd, int num_planes, const dce_plane *planes, XDM2_SingleBufDesc *descs)
 {
+    dce_import          *imp = NULL;
+    size_t              handle;
+    off_t               size;
     int                 i;
-    MmRpc_BufDesc      *desc = NULL;
     dce_error_status    eError = DCE_EOK;
 
-    pthread_mutex_lock(&ipc_mutex);
-
-    _ASSERT(num > 0, DCE_EINVALID_INPUT);
+    _ASSERT(fd >= 0 && planes != NULL && descs != NULL, DCE_EINVALID_INPUT);
+    _ASSERT(num_planes > 0 && num_planes <= DCE_MAX_PLANES, DCE_EINVALID_INPUT);
 
-    desc = malloc(num * sizeof(MmRpc_BufDesc));
-    _ASSERT(desc != NULL, DCE_EOUT_OF_MEMORY);
+    /* dma-bufs report their size through lseek(), skip the check when they do not */
+    size = lseek(fd, 0, SEEK_END);
+    for( i = 0; i < num_planes; i++ ) {
+        _ASSERT(planes[i].offset >= 0 && planes[i].stride > 0 && planes[i].height > 0, DCE_EINVALID_INPUT);
+        _ASSERT(size <= 0 || planes[i].offset + (off_t)planes[i].stride * planes[i].height <= size,
+                DCE_EINVALID_INPUT);
+    }
 
-    for( i = 0; i < num; i++ ) {
-        desc[i].handle = handle[i];
+    imp = calloc(1, sizeof(dce_import));
+    _ASSERT(imp != NULL, DCE_EOUT_OF_MEMORY);
+    imp->fd = dup(fd);
+    _ASSERT_AND_EXECUTE(imp->fd >= 0, DCE_EOUT_OF_MEMORY, free(imp); imp = NULL);
+    /* Pinned in the registration cache, a dma-buf of memplugin_alloc_noheader() */
+    /* shares the registration of its allocation.                                */
+    handle = imp->fd;
+    eError = dce_buf_pin(IPU, 1, &handle, 1);
+    _ASSERT_AND_EXECUTE(eError == DCE_EOK, eError, close(imp->fd); free(imp); imp = NULL);
+
+    imp->num_planes = num_planes;
+    for( i = 0; i < num_planes; i++ ) {
+        imp->plane[i].size = planes[i].stride * planes[i].height;
+        imp->plane[i].dma_buf_fd = imp->fd;
+        imp->plane[i].offset = planes[i].offset;
+        imp->layout[i] = planes[i];
+        imp->plane[i].region = MEM_MAX;
+        imp->plane[i].handle = imp;
+        imp->plane[i].flags = IPU;
+
+        descs[i].buf = (XDAS_Int8 *)&(imp->plane[i]);
+        descs[i].memType = XDM_MEMTYPE_RAW;
+        descs[i].bufSize.bytes = imp->plane[i].size;
     }
 
-    eError = MmRpc_release(MmRpcHandle[DSP], MmRpc_BufType_Handle, num, desc);
+    pthread_mutex_lock(&import_mutex);
+    imp->next = __Imports;
+    __Imports = imp;
+    pthread_mutex_unlock(&import_mutex);
 
-    _ASSERT(eError == DCE_EOK, DCE_EIPC_CALL_FAIL);
 EXIT:
-    if( desc ) {
-        free(desc);
-    }
-
-    pthread_mutex_unlock(&ipc_mutex);
-    return (eError);
+    return (imp);
 }
-/* Incase of X11 or Wayland the fd can be shared to libdce using this call */
-void dce_set_fd(int dce_fd)
+
+void dce_buf_unimport(void *import)
 {
-    if (OmapDrm_FD == INVALID_DRM_FD) {
-        OmapDrm_FD = dce_fd;
+    dce_import      **p, *imp = NULL;
+    size_t          handle;
+
+    pthread_mutex_lock(&import_mutex);
+    for( p = &__Imports; *p != NULL; p = &((*p)->next) ) {
+        if( *p == import ) {
+            imp = *p;
+            *p = imp->next;
+            break;
+        }
     }
-    else {
-        DEBUG("Cannot set the fd, omapdrm device fd is already set");
+    pthread_mutex_unlock(&import_mutex);
+
+    if( imp ) {
+        handle = imp->fd;
+        dce_buf_pin(IPU, 1, &handle, 0);
+        close(imp->fd);
+        free(imp);
     }
 }
 
-int dce_get_fd(void)
+/* process() reads the offset of the MemHeader at every call, moving the window  */
+/* does not change the buffer seen by the registration of the call context.     */
+int dce_buf_import_seek(void *import, int plane, int offset, int size, XDM2_SingleBufDesc *desc)
 {
-    return (OmapDrm_FD);
+    dce_import          *imp = import;
+    dce_error_status    eError = DCE_EOK;
+
+    _ASSERT(imp != NULL && desc != NULL && plane >= 0 && plane < imp->num_planes, DCE_EINVALID_INPUT);
+    _ASSERT(offset >= 0 && size > 0 &&
+            offset + size <= imp->layout[plane].stride * imp->layout[plane].height, DCE_EINVALID_INPUT);
+
+    imp->plane[plane].offset = imp->layout[plane].offset + offset;
+    imp->plane[plane].size = size;
+    desc->buf = (XDAS_Int8 *)&(imp->plane[plane]);
+    desc->bufSize.bytes = size;
+
+EXIT:
+    return (eError);
 }
 
+/* Only called by process() for the buffers which changed since its last call */
+MemHeader *dce_buf_imported(void *buf)
+{
+    dce_import  *imp;
+    MemHeader   *h = NULL;
+
+    if( __atomic_load_n(&__Imports, __ATOMIC_RELAXED) == NULL ) {
+        return (NULL);
+    }
+    pthread_mutex_lock(&import_mutex);
+    for( imp = __Imports; imp != NULL && h == NULL; imp = imp->next ) {
+        if( (char *)buf >= (char *)imp->plane && (char *)buf < (char *)&(imp->plane[imp->num_planes]) &&
+            ((char *)buf - (char *)imp->plane) % sizeof(MemHeader) == 0 ) {
+            h = buf;
+        }
+    }
+    pthread_mutex_unlock(&import_mutex);
+
+    return (h);
+}
@@ -60,6 +60,17 @@
 
 #define GetSz(buf)           ((P2H(buf))->size + sizeof(MemHeader))
 
+/* Buffer object holding a parameter buffer and offset of the data in it, as  */
+/* passed to MmRpc. On Linux small parameter buffers share one buffer object, */
+/* see memplugin_alloc().                                                     */
+#if defined(BUILDOS_LINUX)
+#define GetBase(buf)         ((void *)((char *)P2H(buf) - (P2H(buf))->offset))
+#define GetOffset(buf)       ((P2H(buf))->offset + sizeof(MemHeader))
+#else
+#define GetBase(buf)         ((void *)P2H(buf))
+#define GetOffset(buf)       (sizeof(MemHeader))
+#endif
+
 /* MemHeader is important because it is necessary to know the           */
 /* size of the parameter buffers on IPU for Cache operations               */
 /* The size can't be assumed as codec supports different inputs           */
@@ -71,7 +82,8 @@ typedef struct MemHeader {
     int32_t dma_buf_fd; /* shared dma buf fd */
     uint32_t region;    /* mem region the buffer allocated from */
     /* internal meta data for the buffer */
-    uint32_t offset;    /* offset for the actual data with in the buffer */
+    uint32_t offset;    /* offset of the header in its buffer object (Linux arenas), */
+                        /* of the data of a noheader buffer (Android, Linux imports) */
     int32_t map_fd;     /* mmapped fd */
     void * handle;      /*custom handle for the HLOS memallocator*/
     int flags; /*memory attributes*/
@@ -94,6 +106,9 @@ typedef enum core_type {
     MAX_REMOTEDEVICES
 }core_type;
 
+/* memplugin_alloc() flags, above the core id in the last 4 bits */
+#define MEM_CACHED  (1 << 4)    /* cached mapping synchronized by memplugin_sync() (Linux) */
+
 /* DCE Error Types */
 typedef enum mem_error_status {
     MEM_EOK = 0,
@@ -108,6 +123,16 @@ void *memplugin_alloc(int sz, int height, MemRegion region, int align, int flags
 void memplugin_free(void *ptr);
 int32_t memplugin_share(void *ptr);
 
+#if defined(BUILDOS_LINUX)
+extern int memplugin_cached;    /* MEM_CACHED buffers allocated */
+void memplugin_sync(void *ptr, int device);
+#endif
+
+#if defined(BUILDOS_LINUX) || defined(BUILDOS_ANDROID)
+void *memplugin_alloc_noheader(MemHeader *memHdr, int sz, int height, MemRegion region, int align, int flags);
+void memplugin_free_noheader(MemHeader *memHdr);
+#endif
+
 #ifdef BUILDOS_ANDROID
 typedef enum BufAccessMode {
     MemAccess_8Bit,
@@ -122,9 +147,6 @@ typedef struct Mem_2DParams {
     BufAccessMode eAccessMode;
 }Mem_2DParams;
 
-void *memplugin_alloc_noheader(MemHeader *memHdr, int sz, int height, MemRegion region, int align, int flags);
-void memplugin_free_noheader(MemHeader *memHdr);
-
 int memplugin_open();
 int memplugin_close();
 #endif
@@ -30,28 +30,250 @@
  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <pthread.h>
+
 #include "memplugin.h"
 #include "dce_priv.h"
+#include "libdce.h"
 
 extern struct omap_device   *OmapDev;
 
+/* Small parameter buffers (params, dynParams, status, inArgs, outArgs and the  */
+/* RPC messages) are carved out of arenas: buffer objects of ARENA_SIZE mapped  */
+/* and registered with MmRpc once. A block is taken from the free list of its   */
+/* size class, or from the top of an arena, so allocating and freeing costs no  */
+/* system call. MmRpc gets the arena as base with the offset of the block.      */
+/* Blocks are multiples of ARENA_ALIGN so that the cache maintenance done by    */
+/* the remote core on a buffer never touches a line of another one.             */
+#define ARENA_SIZE          (64 * 1024)
+#define ARENA_ALIGN         128
+#define ARENA_CLASSES       6           /* 128 to 4096 bytes, header included */
+#define ARENA_MAX_BLOCK     (ARENA_ALIGN << (ARENA_CLASSES - 1))
+
+typedef struct mem_arena {
+    struct mem_arena    *next;
+    struct omap_bo      *bo;
+    char                *map;
+    int32_t             dma_buf_fd;
+    int                 core;
+    uint32_t            top;                    /* end of the blocks ever allocated */
+    uint32_t            used;                   /* blocks allocated */
+    MemHeader           *free[ARENA_CLASSES];   /* freed blocks, linked through their data */
+} mem_arena;
+
+static mem_arena        *__Arena[MAX_REMOTEDEVICES];
+int                     memplugin_cached = 0;
+static pthread_mutex_t  arena_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static inline int mem_core(int flags)
+{
+    /* Only the last 4 bits of flags are considered */
+    return (((flags & 0x0f) == DSP) ? DSP : IPU);
+}
+
+extern int dce_buf_register(int core, int num, size_t *handle, int use);
+extern int dce_buf_pin(int core, int num, size_t *handle, int pin);
+
+/* Parameter buffers are registered directly, they never go through process() */
+/* as data buffers and need no entry in the registration cache.                */
+static void mem_buf_lock(int core, int32_t *fd, int lock)
+{
+    size_t  handle = *fd;
+
+    dce_buf_register(core, 1, &handle, lock);
+}
+
+/* Size class of a block of len bytes, header included */
+static inline int arena_class(uint32_t len)
+{
+    int     c = 0;
+
+    while( (uint32_t)(ARENA_ALIGN << c) < len ) {
+        c++;
+    }
+    return (c);
+}
+
+/* Create and register an arena. Called without arena_mutex: registering   */
+/* takes ipc_mutex, which may be held by the caller of memplugin_alloc().   */
+static mem_arena *arena_new(int core)
+{
+    mem_arena   *a = calloc(1, sizeof(mem_arena));
+
+    if( a == NULL ) {
+        return (NULL);
+    }
+    a->bo = omap_bo_new(OmapDev, ARENA_SIZE, OMAP_BO_WC);
+    if( a->bo == NULL || (a->map = omap_bo_map(a->bo)) == NULL ) {
+        ERROR("Failed to allocate a parameter buffer arena");
+        if( a->bo ) {
+            omap_bo_del(a->bo);
+        }
+        free(a);
+        return (NULL);
+    }
+    a->dma_buf_fd = omap_bo_dmabuf(a->bo);
+    a->core = core;
+    mem_buf_lock(core, &(a->dma_buf_fd), 1);
+    return (a);
+}
+
+static void arena_del(mem_arena *a)
+{
+    mem_buf_lock(a->core, &(a->dma_buf_fd), 0);
+    close(a->dma_buf_fd);
+    omap_bo_del(a->bo);
+    free(a);
+}
+
+/* Take a block of class c from an arena of the core, NULL if they are all full */
+static MemHeader *arena_take(int core, int c)
+{
+    mem_arena   *a;
+    MemHeader   *h = NULL;
+
+    for( a = __Arena[core]; a && h == NULL; a = a->next ) {
+        if( a->free[c] ) {
+            h = a->free[c];
+            a->free[c] = *(MemHeader **)H2P(h);
+        } else if( a->top + (ARENA_ALIGN << c) <= ARENA_SIZE ) {
+            h = (MemHeader *)(a->map + a->top);
+            a->top += ARENA_ALIGN << c;
+        } else {
+            continue;
+        }
+        a->used++;
+        h->ptr = a->bo;
+        h->handle = a;
+        h->dma_buf_fd = a->dma_buf_fd;
+        h->offset = (char *)h - a->map;
+    }
+    return (h);
+}
+
+static void *arena_alloc(int sz, MemRegion region, int flags)
+{
+    int         core = mem_core(flags);
+    int         c = arena_class(sz + sizeof(MemHeader));
+    mem_arena   *a = NULL;
+    MemHeader   *h;
+
+    pthread_mutex_lock(&arena_mutex);
+    h = arena_take(core, c);
+    pthread_mutex_unlock(&arena_mutex);
+
+    if( h == NULL ) {
+        a = arena_new(core);
+        if( a == NULL ) {
+            return (NULL);
+        }
+        pthread_mutex_lock(&arena_mutex);
+        a->next = __Arena[core];
+        __Arena[core] = a;
+        h = arena_take(core, c);
+        pthread_mutex_unlock(&arena_mutex);
+    }
+
+    memset(H2P(h), 0, sz);
+    h->size = sz;
+    h->region = region;
+    h->flags = flags;
+    return (H2P(h));
+}
+
+/* Give a block back to its arena. An arena left empty is deleted unless it is */
+/* the only empty one of its core, which is kept for the next allocations.     */
+static void arena_free(MemHeader *h)
+{
+    mem_arena   *a = h->handle, **p, *o;
+    int         empty = 0;
+
+    pthread_mutex_lock(&arena_mutex);
+    *(MemHeader **)H2P(h) = a->free[arena_class(h->size + sizeof(MemHeader))];
+    a->free[arena_class(h->size + sizeof(MemHeader))] = h;
+    if( --a->used == 0 ) {
+        memset(a->free, 0, sizeof(a->free));
+        a->top = 0;
+        for( o = __Arena[a->core]; o; o = o->next ) {
+            empty += (o->used == 0);
+        }
+        if( empty > 1 ) {
+            for( p = &__Arena[a->core]; *p != a; p = &((*p)->next) ) {
+                ;
+            }
+            *p = a->next;
+        } else {
+            a = NULL;
+        }
+    } else {
+        a = NULL;
+    }
+    pthread_mutex_unlock(&arena_mutex);
+
+    if( a ) {
+        arena_del(a);
+    }
+}
+
+/* Cached buffer: its own omap_bo, an arena would share its cache maintenance */
+/* with the buffers of other threads. The CPU owns it until memplugin_sync().  */
+static void *cached_alloc(int sz, MemRegion region, int flags)
+{
+    MemHeader        *h;
+    struct omap_bo   *bo = omap_bo_new(OmapDev, sz + sizeof(MemHeader), OMAP_BO_CACHED);
+
+    if( !bo ) {
+        return (NULL);
+    }
+
+    h = omap_bo_map(bo);
+    omap_bo_cpu_prep(bo, OMAP_GEM_READ | OMAP_GEM_WRITE);
+    memset(H2P(h), 0, sz);
+    h->size = sz;
+    h->ptr = (void *)bo;
+    h->handle = NULL;
+    h->offset = 0;
+    h->dma_buf_fd = omap_bo_dmabuf(bo);
+    h->region = region;
+    h->flags = flags;
+    mem_buf_lock(mem_core(flags), &(h->dma_buf_fd), 1);
+    __atomic_fetch_add(&memplugin_cached, 1, __ATOMIC_RELAXED);
+
+    return (H2P(h));
+}
 
 /*  memplugin_alloc - allocates omap_bo buffer with a header above it.
  *  @sz: Size of the buffer requsted
  *  @height: this parameter is currently not used
  *  @region :Used to specify the region from where the memory is allocated->Not used.
+ *          TILER 2D buffers have no room for a header, they are allocated with
+ *          memplugin_alloc_noheader().
  *  @align:Alignment. Not used
  *  @flags: Bit field. As of now, only the least significant 4 bits are considered
  *          to identify the core for which this allocation is needed. This information
  *          is needed to use the right tiler pin/unpin APIs (DSP or IPU).
  *          For future extensibility, many more attributes can be added as bit fields.
+ *          MEM_CACHED selects a cached mapping, see memplugin_sync().
+ *  Buffers up to ARENA_MAX_BLOCK with their header are taken from an arena.
  *  Returns a virtual address pointer to omap_bo buffer or the param buffer
  */
 void *memplugin_alloc(int sz, int height, MemRegion region, int align, int flags)
 {
     MemHeader        *h;
-    struct omap_bo   *bo = omap_bo_new(OmapDev, sz + sizeof(MemHeader), OMAP_BO_WC);
+    struct omap_bo   *bo;
+
+    if( region == MEM_TILER8_2D || region == MEM_TILER16_2D ) {
+        ERROR("TILER 2D buffers are allocated with memplugin_alloc_noheader");
+        return (NULL);
+    }
+    if( flags & MEM_CACHED ) {
+        return (cached_alloc(sz, region, flags));
+    }
+    if( sz >= 0 && sz + sizeof(MemHeader) <= ARENA_MAX_BLOCK ) {
+        return (arena_alloc(sz, region, flags));
+    }
 
+    bo = omap_bo_new(OmapDev, sz + sizeof(MemHeader), OMAP_BO_WC);
     if( !bo ) {
         return (NULL);
     }
@@ -60,15 +282,14 @@ void *memplugin_alloc(int sz, int height, MemRegion region, int align, int flags
     memset(H2P(h), 0, sz);
     h->size = sz;
     h->ptr = (void *)bo;
+    h->handle = NULL;
+    h->offset = 0;
     /* get the fd from drm which needs to be closed by memplugin_free */
     h->dma_buf_fd = omap_bo_dmabuf(bo);
     h->region = region;
     h->flags = flags;/*Beware: This is a bit field.*/
     /* lock the file descriptor */
-    if((flags & 0x0f) == DSP) /*Only the last 4 bits are considered*/
-        dsp_dce_buf_lock(1, &(h->dma_buf_fd));
-    else
-        dce_buf_lock(1, &(h->dma_buf_fd));
+    mem_buf_lock(mem_core(flags), &(h->dma_buf_fd), 1);
 
     return (H2P(h));
 }
@@ -81,16 +302,21 @@ void memplugin_free(void *ptr)
 {
     if( ptr ) {
         MemHeader   *h = P2H(ptr);
+        if( h->handle ) {
+            /* Block of an arena */
+            arena_free(h);
+            return;
+        }
+        if( h->flags & MEM_CACHED ) {
+            __atomic_fetch_sub(&memplugin_cached, 1, __ATOMIC_RELAXED);
+        }
         if( h->dma_buf_fd ) {
             /*
             Identify the core for which this memory was allocated and
             use the appropriate API. Last 4 bits of flags are assumed
             to be containing core Id information.
             */
-            if((h->flags & 0x0f) == DSP)
-                dsp_dce_buf_unlock(1, &(h->dma_buf_fd));
-            else
-                dce_buf_unlock(1, &(h->dma_buf_fd));
+            mem_buf_lock(mem_core(h->flags), &(h->dma_buf_fd), 0);
             /* close the file descriptor */
             close(h->dma_buf_fd);
         }
@@ -99,6 +325,25 @@ void memplugin_free(void *ptr)
     }
 }
 
+/* memplugin_sync - hands a MEM_CACHED buffer over between CPU and remote core
+ * @ptr : parameter buffer, nothing is done if it is not cached
+ * @device : 1 before a remote call (writes back the CPU cache), 0 after it
+ *           (the CPU gets it back and sees what the remote core wrote)
+ */
+void memplugin_sync(void *ptr, int device)
+{
+    MemHeader   *h = P2H(ptr);
+
+    if( !(h->flags & MEM_CACHED) ) {
+        return;
+    }
+    if( device ) {
+        omap_bo_cpu_fini((struct omap_bo *)h->ptr, OMAP_GEM_READ | OMAP_GEM_WRITE);
+    } else {
+        omap_bo_cpu_prep((struct omap_bo *)h->ptr, OMAP_GEM_READ | OMAP_GEM_WRITE);
+    }
+}
+
 /* memplugin_share - converts the omap_bo buffer into dmabuf
  * @ptr : pointer of omap_bo buffer, to be converted to fd
  * Returns a file discriptor for the omap_bo buffer
@@ -112,3 +357,73 @@ int32_t memplugin_share(void *ptr)
     }
     return (-1);
 }
+
+/*  memplugin_alloc_noheader - allocates a data buffer described by a header of
+ *  the caller, e.g. an output frame (see framepool_linux.c)
+ *  @memHdr: header filled with the buffer details
+ *  @sz: size in bytes, or width in pixels of a MEM_TILER8_2D (8 bit) or
+ *       MEM_TILER16_2D (16 bit) buffer. NV12 uses an 8 bit container for luma and a
+ *       16 bit one of half the width for the interleaved chroma.
+ *  @height: rows of a TILER 2D buffer, not used otherwise
+ *  @region: MEM_TILER8_2D, MEM_TILER16_2D, or any other region for a linear buffer
+ *  @align: Alignment. Not used
+ *  @flags: core in the last 4 bits, the buffer is registered with it
+ *  Returns the CPU mapping of the buffer. The mapping of a 2D buffer follows the
+ *  TILER container layout, its rows are not contiguous.
+ */
+void *memplugin_alloc_noheader(MemHeader *memHdr, int sz, int height, MemRegion region, int align, int flags)
+{
+    MemHeader        *h = memHdr;
+    struct omap_bo   *bo;
+    size_t           handle;
+
+    if( !h || sz <= 0 ) {
+        return (NULL);
+    }
+
+    if( region == MEM_TILER8_2D || region == MEM_TILER16_2D ) {
+        if( height <= 0 ) {
+            return (NULL);
+        }
+        bo = omap_bo_new_tiled(OmapDev, sz, height, OMAP_BO_WC |
+                               (region == MEM_TILER8_2D ? OMAP_BO_TILED_8 : OMAP_BO_TILED_16));
+    } else {
+        bo = omap_bo_new(OmapDev, sz, OMAP_BO_WC);
+    }
+    if( !bo ) {
+        return (NULL);
+    }
+
+    h->ptr = omap_bo_map(bo);
+    if( !h->ptr ) {
+        omap_bo_del(bo);
+        return (NULL);
+    }
+    h->size = omap_bo_size(bo);
+    h->handle = (void *)bo;
+    h->offset = 0;
+    h->dma_buf_fd = omap_bo_dmabuf(bo);
+    h->region = region;
+    h->flags = flags;
+    handle = h->dma_buf_fd;
+    dce_buf_pin(mem_core(flags), 1, &handle, 1);
+
+    return (h->ptr);
+}
+
+void memplugin_free_noheader(MemHeader *memHdr)
+{
+    MemHeader   *h = memHdr;
+    size_t      handle;
+
+    if( !h || !h->handle ) {
+        return;
+    }
+    if( h->dma_buf_fd ) {
+        handle = h->dma_buf_fd;
+        dce_buf_pin(mem_core(h->flags), 1, &handle, 0);
+        close(h->dma_buf_fd);
+    }
+    omap_bo_del((struct omap_bo *)h->handle);
+    h->handle = NULL;
+}
@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2013, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * dce_bench: libdce overhead benchmark run by "make bench" on a build
+ * configured with --enable-simulator. Every channel decodes frames with its
+ * own VIDDEC3 instance on the simulated IVA-HD; the client side duration of
+ * the process calls is reported with the libdce call statistics of each
+ * phase. DCE_SIM_CALL_US and DCE_SIM_PROCESS_US model the remote side.
+ *
+ * usage: dce_bench [-c channels] [-n frames] [-w width] [-h height] [-s bytes]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <omap_drmif.h>
+#include <libdce.h>
+
+#define BENCH_MAX_CHANNELS 16
+
+typedef struct {
+    int             id;
+    int             frames;
+    int             width;
+    int             height;
+    int             bytes;
+    uint32_t        *duration_us;   /* of each process call */
+    int             failed;
+} bench_channel;
+
+static struct omap_device   *dev;
+
+static inline uint64_t now_us(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000);
+}
+
+/* Data buffer shared with the codec: a dma-buf fd locked for the IVA-HD */
+static struct omap_bo *bench_buf(int size, XDM2_SingleBufDesc *desc, size_t *fd)
+{
+    struct omap_bo  *bo = omap_bo_new(dev, size, OMAP_BO_WC);
+
+    if( bo == NULL ) {
+        return (NULL);
+    }
+    memset(omap_bo_map(bo), 0x80, size);
+    *fd = omap_bo_dmabuf(bo);
+    dce_buf_lock(1, fd);
+    desc->buf = (XDAS_Int8 *)*fd;
+    desc->memType = XDM_MEMTYPE_RAW;
+    desc->bufSize.bytes = size;
+    return (bo);
+}
+
+static void *bench_thread(void *arg)
+{
+    bench_channel           *ch = arg;
+    Engine_Handle           engine = NULL;
+    Engine_Error            ec;
+    VIDDEC3_Handle          codec = NULL;
+    VIDDEC3_Params          *params = NULL;
+    VIDDEC3_DynamicParams   *dynParams = NULL;
+    VIDDEC3_Status          *status = NULL;
+    VIDDEC3_InArgs          *inArgs = NULL;
+    VIDDEC3_OutArgs         *outArgs = NULL;
+    XDM2_BufDesc            *inBufs = NULL, *outBufs = NULL;
+    dce_frame_pool          *pool = NULL;
+    struct omap_bo          *bo = NULL;
+    size_t                  fd;
+    uint64_t                t;
+    XDAS_Int32              ret;
+    int                     i, j, n;
+
+    ch->failed = 1;
+    engine = Engine_open("ivahd_vidsvr", NULL, &ec);
+    if( engine == NULL ) {
+        fprintf(stderr, "channel %d: Engine_open failed %d\n", ch->id, ec);
+        return (NULL);
+    }
+
+    params = dce_alloc(sizeof(VIDDEC3_Params));
+    dynParams = dce_alloc(sizeof(VIDDEC3_DynamicParams));
+    status = dce_alloc(sizeof(VIDDEC3_Status));
+    inArgs = dce_alloc(sizeof(VIDDEC3_InArgs));
+    outArgs = dce_alloc(sizeof(VIDDEC3_OutArgs));
+    inBufs = dce_alloc(sizeof(XDM2_BufDesc));
+    outBufs = dce_alloc(sizeof(XDM2_BufDesc));
+    if( !params || !dynParams || !status || !inArgs || !outArgs || !inBufs || !outBufs ) {
+        fprintf(stderr, "channel %d: dce_alloc failed\n", ch->id);
+        goto EXIT;
+    }
+
+    params->size = sizeof(VIDDEC3_Params);
+    params->maxWidth = ch->width;
+    params->maxHeight = ch->height;
+    params->maxFrameRate = 30000;
+    params->maxBitRate = 10000000;
+    params->dataEndianness = XDM_BYTE;
+    params->forceChromaFormat = XDM_YUV_420SP;
+    params->operatingMode = IVIDEO_DECODE_ONLY;
+    params->displayDelay = IVIDDEC3_DISPLAY_DELAY_AUTO;
+    params->displayBufsMode = IVIDDEC3_DISPLAYBUFS_EMBEDDED;
+    params->inputDataMode = IVIDEO_ENTIREFRAME;
+    params->outputDataMode = IVIDEO_ENTIREFRAME;
+    params->errorInfoMode = IVIDEO_ERRORINFO_OFF;
+    params->metadataType[0] = IVIDEO_METADATAPLANE_NONE;
+    params->metadataType[1] = IVIDEO_METADATAPLANE_NONE;
+    params->metadataType[2] = IVIDEO_METADATAPLANE_NONE;
+
+    codec = VIDDEC3_create(engine, "ivahd_h264dec", params);
+    if( codec == NULL ) {
+        fprintf(stderr, "channel %d: VIDDEC3_create failed\n", ch->id);
+        goto EXIT;
+    }
+
+    dynParams->size = sizeof(VIDDEC3_DynamicParams);
+    dynParams->decodeHeader = XDM_DECODE_AU;
+    dynParams->displayWidth = 0;
+    dynParams->frameSkipMode = IVIDEO_NO_SKIP;
+    dynParams->newFrameFlag = XDAS_TRUE;
+    status->size = sizeof(VIDDEC3_Status);
+    if( VIDDEC3_control(codec, XDM_SETPARAMS, dynParams, status) != VIDDEC3_EOK ||
+        VIDDEC3_control(codec, XDM_GETBUFINFO, dynParams, status) != VIDDEC3_EOK ) {
+        fprintf(stderr, "channel %d: VIDDEC3_control failed\n", ch->id);
+        goto EXIT;
+    }
+
+    inBufs->numBufs = 1;
+    bo = bench_buf(ch->bytes, &inBufs->descs[0], &fd);
+    pool = dce_frame_pool_create(codec, 0);
+    if( !bo || !pool ) {
+        fprintf(stderr, "channel %d: buffer allocation failed\n", ch->id);
+        goto EXIT;
+    }
+
+    inArgs->size = sizeof(VIDDEC3_InArgs);
+    outArgs->size = sizeof(VIDDEC3_OutArgs);
+    for( i = 0; i < ch->frames; i++ ) {
+        inArgs->numBytes = ch->bytes;
+        t = now_us();
+        if( dce_frame_pool_prepare(pool, outBufs, inArgs) != DCE_EOK ||
+            (ret = VIDDEC3_process(codec, inBufs, outBufs, inArgs, outArgs)) != VIDDEC3_EOK ||
+            (n = dce_frame_pool_complete(pool, ret, outArgs)) < 0 ) {
+            fprintf(stderr, "channel %d: VIDDEC3_process failed at frame %d\n", ch->id, i);
+            goto EXIT;
+        }
+        ch->duration_us[i] = (uint32_t)(now_us() - t);
+        /* Frames are "displayed" at once */
+        for( j = 0; j < n; j++ ) {
+            dce_frame_pool_release(pool, dce_frame_pool_get(pool, outArgs->outputID[j]));
+        }
+    }
+    ch->failed = 0;
+
+EXIT:
+    if( bo ) {
+        dce_buf_unlock(1, &fd);
+        close(fd);
+        omap_bo_del(bo);
+    }
+    if( codec ) {
+        VIDDEC3_delete(codec);
+    }
+    dce_frame_pool_delete(pool);
+    dce_free(params);
+    dce_free(dynParams);
+    dce_free(status);
+    dce_free(inArgs);
+    dce_free(outArgs);
+    dce_free(inBufs);
+    dce_free(outBufs);
+    Engine_close(engine);
+    return (NULL);
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t    x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return ((x > y) - (x < y));
+}
+
+static void print_phase(const char *name, dce_stats_call call, dce_stats_phase phase)
+{
+    dce_histogram   h;
+
+    if( dce_get_stats(NULL, call, phase, &h) != DCE_EOK || h.count == 0 ) {
+        return;
+    }
+    printf("  %-10s mean %6.1f us  p50 %6u us  p99 %6u us  max %6u us\n", name,
+           (double)h.total_us / h.count, dce_stats_percentile(&h, 50),
+           dce_stats_percentile(&h, 99), h.max_us);
+}
+
+int main(int argc, char **argv)
+{
+    bench_channel   ch[BENCH_MAX_CHANNELS];
+    pthread_t       thread[BENCH_MAX_CHANNELS];
+    uint32_t        *all;
+    uint64_t        start, elapsed, total = 0;
+    int             channels = 1, frames = 1000, width = 640, height = 480, bytes = 16384;
+    int             opt, i, n = 0, failed = 0;
+
+    while( (opt = getopt(argc, argv, "c:n:w:h:s:")) != -1 ) {
+        switch( opt ) {
+            case 'c' : channels = atoi(optarg); break;
+            case 'n' : frames = atoi(optarg); break;
+            case 'w' : width = atoi(optarg); break;
+            case 'h' : height = atoi(optarg); break;
+            case 's' : bytes = atoi(optarg); break;
+            default :
+                fprintf(stderr, "usage: %s [-c channels] [-n frames] [-w width] [-h height] [-s bytes]\n", argv[0]);
+                return (1);
+        }
+    }
+    if( channels < 1 || channels > BENCH_MAX_CHANNELS || frames < 1 || width < 16 || height < 16 || bytes < 1 ) {
+        fprintf(stderr, "invalid arguments\n");
+        return (1);
+    }
+
+    dev = dce_init();
+    if( dev == NULL ) {
+        fprintf(stderr, "dce_init failed\n");
+        return (1);
+    }
+    all = calloc(channels * frames, sizeof(uint32_t));
+    if( all == NULL ) {
+        return (1);
+    }
+
+    start = now_us();
+    for( i = 0; i < channels; i++ ) {
+        ch[i].id = i;
+        ch[i].frames = frames;
+        ch[i].width = width;
+        ch[i].height = height;
+        ch[i].bytes = bytes;
+        ch[i].duration_us = &all[i * frames];
+        pthread_create(&thread[i], NULL, bench_thread, &ch[i]);
+    }
+    for( i = 0; i < channels; i++ ) {
+        pthread_join(thread[i], NULL);
+        failed |= ch[i].failed;
+    }
+    elapsed = now_us() - start;
+
+    if( !failed ) {
+        n = channels * frames;
+        for( i = 0; i < n; i++ ) {
+            total += all[i];
+        }
+        qsort(all, n, sizeof(uint32_t), cmp_u32);
+        printf("%d channel(s) x %d frames %dx%d, %d bytes per frame: %.0f frames/s\n",
+               channels, frames, width, height, bytes, n * 1000000.0 / elapsed);
+        printf("VIDDEC3_process\n");
+        printf("  %-10s mean %6.1f us  p50 %6u us  p99 %6u us  max %6u us\n", "client",
+               (double)total / n, all[n / 2], all[(n * 99) / 100], all[n - 1]);
+        print_phase("lock wait", DCE_STATS_CODEC_PROCESS, DCE_STATS_LOCK_WAIT);
+        print_phase("marshal", DCE_STATS_CODEC_PROCESS, DCE_STATS_MARSHAL);
+        print_phase("remote", DCE_STATS_CODEC_PROCESS, DCE_STATS_REMOTE);
+    }
+
+    free(all);
+    dce_deinit(dev);
+    return (failed);
+}
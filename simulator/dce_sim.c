@@ -0,0 +1,1121 @@
+/*
+ * Copyright (c) 2013, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ ********************************************************************************
+ * DCE simulator                                                                *
+ * In-process replacement of MmRpc and libdrm_omap for hosts without the        *
+ * rpmsg-dce and omapdrm drivers, selected with ./configure --enable-simulator. *
+ * MmRpc_call() runs the DCE server protocol of dce_rpc.h on the calling        *
+ * thread: the address translations are applied in place as the rpmsg-rpc      *
+ * driver does, and VIDDEC3/VIDENC2/VIDDEC2 instances are software codecs       *
+ * copying the first input buffer to the first output buffer. Low latency      *
+ * (IVIDEO_NUMROWS) decoders deliver their rows through the dce-callback       *
+ * service while the process call runs.                                         *
+ *                                                                              *
+ * Environment:                                                                 *
+ *   DCE_SIM_CALL_US    : latency added to every call (default 0)               *
+ *   DCE_SIM_PROCESS_US : duration of a process call, during which the core is  *
+ *                        busy (default 0)                                      *
+ *   DCE_SIM_CPU_LOAD   : load reported by DCE_RPC_GET_INFO instead of the       *
+ *                        measured busy time                                     *
+ * The tests of tools/ steer and observe it through the hooks of dce_sim.h.     *
+ ********************************************************************************
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <xf86drm.h>
+#include <omap_drm.h>
+#include <omap_drmif.h>
+#include <ti/ipc/mm/MmRpc.h>
+
+#include "libdce.h"
+#include "dce_rpc.h"
+#include "dce_priv.h"
+#include "memplugin.h"
+#include "dce_sim.h"
+
+#define SIM_CORES           2
+#define SIM_MAX_XLT         64
+#define SIM_FD_CACHE        1024    /* dma-buf fds looked up without fstat() */
+#define SIM_HEAP_SIZE       (64 * 1024 * 1024)
+#define SIM_INSTANCE_HEAP   (4 * 1024 * 1024)
+#define SIM_HANDLE_BASE     0x1000
+
+static const char  *SIM_SERVICE[SIM_CORES] = {"rpmsg-dce", "rpmsg-dce-dsp"};
+static const char  *SIM_ENGINE[SIM_CORES] = {"ivahd_vidsvr", "dsp_vidsvr"};
+static const char  *SIM_CALLBACK_SERVICE = "dce-callback";
+
+/***************** Configuration ****************/
+static uint32_t         sim_call_us = 0;
+static uint32_t         sim_process_us = 0;
+static int32_t          sim_cpu_load = -1;
+static pthread_once_t   sim_once = PTHREAD_ONCE_INIT;
+
+static void sim_config(void)
+{
+    char    *env;
+
+    if( (env = getenv("DCE_SIM_CALL_US")) != NULL ) {
+        sim_call_us = strtoul(env, NULL, 0);
+    }
+    if( (env = getenv("DCE_SIM_PROCESS_US")) != NULL ) {
+        sim_process_us = strtoul(env, NULL, 0);
+    }
+    if( (env = getenv("DCE_SIM_CPU_LOAD")) != NULL ) {
+        sim_cpu_load = strtol(env, NULL, 0);
+    }
+}
+
+static inline uint64_t sim_now_us(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000);
+}
+
+/* Short delays are spun, the scheduler granularity would distort them */
+static void sim_delay(uint32_t us)
+{
+    struct timespec t;
+    uint64_t        end;
+
+    if( us == 0 ) {
+        return;
+    }
+    if( us >= 200 ) {
+        t.tv_sec = us / 1000000;
+        t.tv_nsec = (us % 1000000) * 1000;
+        nanosleep(&t, NULL);
+        return;
+    }
+    for( end = sim_now_us() + us; sim_now_us() < end; ) {
+        ;
+    }
+}
+
+/***************** libdrm / libdrm_omap ****************/
+struct omap_device {
+    int     fd;
+};
+
+struct omap_bo {
+    struct omap_bo  *next;
+    int             fd;     /* memfd backing the buffer */
+    dev_t           dev;
+    ino_t           ino;
+    void            *map;
+    uint32_t        size;
+    int             refs;
+    int             external;   /* wrapped by MmRpc_use() */
+};
+
+static struct omap_bo   *sim_bos = NULL;
+static struct omap_bo   *sim_fd_bo[SIM_FD_CACHE];
+static pthread_mutex_t  sim_bo_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+int drmOpenWithType(const char *name, const char *busid, int type)
+{
+    return (open("/dev/null", O_RDWR | O_CLOEXEC));
+}
+
+struct omap_device *omap_device_new(int fd)
+{
+    struct omap_device  *dev = calloc(1, sizeof(struct omap_device));
+
+    if( dev ) {
+        dev->fd = fd;
+    }
+    return (dev);
+}
+
+void omap_device_del(struct omap_device *dev)
+{
+    free(dev);
+}
+
+/* Wrap a memfd or an imported dma-buf fd, which the buffer object takes over */
+static struct omap_bo *sim_bo_wrap(int fd, uint32_t size)
+{
+    struct omap_bo  *bo;
+    struct stat     st;
+
+    bo = calloc(1, sizeof(struct omap_bo));
+    if( bo == NULL || fstat(fd, &st) < 0 ) {
+        goto FAIL;
+    }
+    bo->map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if( bo->map == MAP_FAILED ) {
+        goto FAIL;
+    }
+    bo->fd = fd;
+    bo->dev = st.st_dev;
+    bo->ino = st.st_ino;
+    bo->size = size;
+    bo->refs = 1;
+
+    pthread_mutex_lock(&sim_bo_mutex);
+    bo->next = sim_bos;
+    sim_bos = bo;
+    pthread_mutex_unlock(&sim_bo_mutex);
+    return (bo);
+
+FAIL:
+    free(bo);
+    close(fd);
+    return (NULL);
+}
+
+struct omap_bo *omap_bo_new(struct omap_device *dev, uint32_t size, uint32_t flags)
+{
+    int     fd;
+
+    if( size == 0 ) {
+        return (NULL);
+    }
+    fd = memfd_create("omap_bo", MFD_CLOEXEC);
+    if( fd < 0 ) {
+        return (NULL);
+    }
+    if( ftruncate(fd, size) < 0 ) {
+        close(fd);
+        return (NULL);
+    }
+    return (sim_bo_wrap(fd, size));
+}
+
+struct omap_bo *omap_bo_new_tiled(struct omap_device *dev, uint32_t width, uint32_t height, uint32_t flags)
+{
+    uint32_t    bpp = 1;
+
+    if( (flags & OMAP_BO_TILED_MASK) == OMAP_BO_TILED_16 ) {
+        bpp = 2;
+    } else if( (flags & OMAP_BO_TILED_MASK) == OMAP_BO_TILED_32 ) {
+        bpp = 4;
+    }
+    return (omap_bo_new(dev, width * height * bpp, flags));
+}
+
+/* Buffer object of a dma-buf fd, NULL if it is not one. sim_bo_mutex must be held. */
+static struct omap_bo *sim_bo_find(int fd)
+{
+    struct omap_bo  *bo;
+    struct stat     st;
+
+    if( fd >= 0 && fd < SIM_FD_CACHE && sim_fd_bo[fd] ) {
+        return (sim_fd_bo[fd]);
+    }
+    if( fd < 0 || fstat(fd, &st) < 0 ) {
+        return (NULL);
+    }
+    for( bo = sim_bos; bo != NULL; bo = bo->next ) {
+        if( bo->dev == st.st_dev && bo->ino == st.st_ino ) {
+            if( fd < SIM_FD_CACHE ) {
+                sim_fd_bo[fd] = bo;
+            }
+            return (bo);
+        }
+    }
+    return (NULL);
+}
+
+struct omap_bo *omap_bo_from_dmabuf(struct omap_device *dev, int fd)
+{
+    struct omap_bo  *bo;
+    off_t           size;
+    int             own;
+
+    pthread_mutex_lock(&sim_bo_mutex);
+    bo = sim_bo_find(fd);
+    if( bo ) {
+        bo->refs++;
+    }
+    pthread_mutex_unlock(&sim_bo_mutex);
+    if( bo ) {
+        return (bo);
+    }
+
+    /* A buffer exported by another allocator */
+    size = lseek(fd, 0, SEEK_END);
+    if( size <= 0 || (own = dup(fd)) < 0 ) {
+        return (NULL);
+    }
+    return (sim_bo_wrap(own, (uint32_t)size));
+}
+
+void omap_bo_del(struct omap_bo *bo)
+{
+    struct omap_bo  **p;
+    int             i;
+
+    if( bo == NULL ) {
+        return;
+    }
+    pthread_mutex_lock(&sim_bo_mutex);
+    if( --bo->refs > 0 ) {
+        pthread_mutex_unlock(&sim_bo_mutex);
+        return;
+    }
+    for( p = &sim_bos; *p != NULL; p = &(*p)->next ) {
+        if( *p == bo ) {
+            *p = bo->next;
+            break;
+        }
+    }
+    for( i = 0; i < SIM_FD_CACHE; i++ ) {
+        if( sim_fd_bo[i] == bo ) {
+            sim_fd_bo[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&sim_bo_mutex);
+
+    munmap(bo->map, bo->size);
+    close(bo->fd);
+    free(bo);
+}
+
+int omap_bo_dmabuf(struct omap_bo *bo)
+{
+    int     fd = dup(bo->fd);
+
+    if( fd >= 0 && fd < SIM_FD_CACHE ) {
+        pthread_mutex_lock(&sim_bo_mutex);
+        sim_fd_bo[fd] = bo;
+        pthread_mutex_unlock(&sim_bo_mutex);
+    }
+    return (fd);
+}
+
+uint32_t omap_bo_size(struct omap_bo *bo)
+{
+    return (bo->size);
+}
+
+void *omap_bo_map(struct omap_bo *bo)
+{
+    return (bo->map);
+}
+
+/* The simulated cores share the mapping of the client: nothing to flush */
+int omap_bo_cpu_prep(struct omap_bo *bo, enum omap_gem_op op)
+{
+    return (0);
+}
+
+int omap_bo_cpu_fini(struct omap_bo *bo, enum omap_gem_op op)
+{
+    return (0);
+}
+
+/***************** Simulated servers ****************/
+struct MmRpc_Object {
+    struct MmRpc_Object *next;      /* sim_conns, in creation order */
+    int                 core;       /* -1 for the callback service */
+    uint32_t            calls;
+    int                 active;     /* calls running in MmRpc_call() */
+};
+
+typedef struct sim_codec {
+    struct sim_codec    *next;
+    int32_t             handle;
+    dce_codec_type      codec_id;
+    int                 core;
+    int32_t             width;
+    int32_t             height;
+    char                name[MAX_NAME_LENGTH];
+    int                 row_mode;   /* VIDDEC3 outputDataMode or VIDENC2 inputDataMode IVIDEO_NUMROWS */
+    int                 blocks;     /* rows not delivered (decoder) or not encoded (encoder) yet, sim_row_mutex */
+    int                 ended;      /* end of frame not delivered yet, sim_row_mutex */
+} sim_codec;
+
+typedef struct {
+    pthread_mutex_t     hw_lock;    /* one process call runs at a time on a core */
+    int                 engines;
+    int                 codecs;
+    uint64_t            busy_us;    /* time spent in process calls since window_us */
+    uint64_t            window_us;
+} sim_core;
+
+static sim_codec        *sim_codecs = NULL;
+static sim_core         sim_cores[SIM_CORES] = {
+    { PTHREAD_MUTEX_INITIALIZER, 0, 0, 0, 0 },
+    { PTHREAD_MUTEX_INITIALIZER, 0, 0, 0, 0 }
+};
+static int32_t          sim_next_handle = SIM_HANDLE_BASE;
+static struct MmRpc_Object *sim_conns = NULL;
+static int              sim_unsafe_deletes = 0; /* MmRpc_delete() with calls running */
+static pthread_mutex_t  sim_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Process calls block before reaching the codec while dce_sim_stall() is set, */
+/* as with a remote core which stopped answering                               */
+static pthread_mutex_t  sim_stall_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   sim_stall_cond = PTHREAD_COND_INITIALIZER;
+static int              sim_stall = 0;
+static int              sim_stalled = 0;    /* calls blocked by the stall */
+
+static inline void *sim_param_ptr(MmRpc_Param *p)
+{
+    if( p->type == MmRpc_ParamType_OffPtr ) {
+        return ((void *)(p->param.offPtr.base + p->param.offPtr.offset));
+    } else if( p->type == MmRpc_ParamType_Ptr ) {
+        return ((void *)p->param.ptr.addr);
+    }
+    return (NULL);
+}
+
+static inline int32_t sim_param_scalar(MmRpc_Param *p)
+{
+    return ((int32_t)p->param.scalar.data);
+}
+
+static sim_codec *sim_codec_get(int32_t handle)
+{
+    sim_codec   *c;
+
+    pthread_mutex_lock(&sim_mutex);
+    for( c = sim_codecs; c != NULL && c->handle != handle; c = c->next ) {
+        ;
+    }
+    pthread_mutex_unlock(&sim_mutex);
+    return (c);
+}
+
+/* Pointers saved by sim_translate() */
+typedef struct {
+    void    **field;
+    void    *value;
+} sim_xlt;
+
+/* Replace the pointers listed in the xlt array by addresses in the buffers of */
+/* their handles, as the rpmsg-rpc driver does for the remote core.          */
+static int sim_translate(MmRpc_FxnCtx *ctx, sim_xlt *saved)
+{
+    MmRpc_Xlt       *x;
+    struct omap_bo  *bo;
+    char            *start;
+    uint32_t        i;
+
+    if( ctx->num_xlts > SIM_MAX_XLT ) {
+        return (MmRpc_E_INVALIDPARAM);
+    }
+    for( i = 0; i < ctx->num_xlts; i++ ) {
+        x = &ctx->xltAry[i];
+        start = x->index < ctx->num_params ? sim_param_ptr(&ctx->params[x->index]) : NULL;
+        pthread_mutex_lock(&sim_bo_mutex);
+        bo = sim_bo_find((int)x->handle);
+        pthread_mutex_unlock(&sim_bo_mutex);
+        if( start == NULL || bo == NULL ) {
+            ERROR("sim: can't translate entry %u (param %u handle %d)", i, x->index, (int)x->handle);
+            break;
+        }
+        saved[i].field = (void **)(start + x->offset);
+        saved[i].value = *saved[i].field;
+        *saved[i].field = (char *)bo->map + ((size_t)saved[i].value - x->base);
+    }
+    if( i < ctx->num_xlts ) {
+        while( i-- > 0 ) {
+            *saved[i].field = saved[i].value;
+        }
+        return (MmRpc_E_INVALIDPARAM);
+    }
+    return (MmRpc_S_SUCCESS);
+}
+
+static void sim_untranslate(MmRpc_FxnCtx *ctx, sim_xlt *saved)
+{
+    uint32_t    i;
+
+    for( i = 0; i < ctx->num_xlts; i++ ) {
+        *saved[i].field = saved[i].value;
+    }
+}
+
+static int32_t sim_engine_open(int core, dce_engine_open *msg)
+{
+    int32_t     handle = 0;
+
+    if( msg == NULL ) {
+        return (0);
+    }
+    if( strncmp(msg->name, SIM_ENGINE[core], MAX_NAME_LENGTH) ) {
+        msg->error_code = Engine_ENOTFOUND;
+        return (0);
+    }
+    pthread_mutex_lock(&sim_mutex);
+    sim_cores[core].engines++;
+    handle = sim_next_handle++;
+    pthread_mutex_unlock(&sim_mutex);
+    msg->error_code = Engine_EOK;
+
+    return (handle);
+}
+
+static int32_t sim_codec_create(int core, dce_codec_type codec_id, char *name, void *params)
+{
+    sim_codec   *c;
+
+    if( name == NULL || params == NULL ||
+        (codec_id == OMAP_DCE_VIDDEC2) != (core == DSP) ) {
+        return (0);
+    }
+    c = calloc(1, sizeof(sim_codec));
+    if( c == NULL ) {
+        return (0);
+    }
+    c->codec_id = codec_id;
+    c->core = core;
+    strncpy(c->name, name, MAX_NAME_LENGTH - 1);
+    if( codec_id == OMAP_DCE_VIDDEC3 ) {
+        c->width = ((VIDDEC3_Params *)params)->maxWidth;
+        c->height = ((VIDDEC3_Params *)params)->maxHeight;
+        c->row_mode = ((VIDDEC3_Params *)params)->outputDataMode == IVIDEO_NUMROWS;
+    } else if( codec_id == OMAP_DCE_VIDENC2 ) {
+        c->width = ((VIDENC2_Params *)params)->maxWidth;
+        c->height = ((VIDENC2_Params *)params)->maxHeight;
+        c->row_mode = ((VIDENC2_Params *)params)->inputDataMode == IVIDEO_NUMROWS;
+    } else {
+        c->width = ((VIDDEC2_Params *)params)->maxWidth;
+        c->height = ((VIDDEC2_Params *)params)->maxHeight;
+    }
+
+    pthread_mutex_lock(&sim_mutex);
+    c->handle = sim_next_handle++;
+    c->next = sim_codecs;
+    sim_codecs = c;
+    sim_cores[core].codecs++;
+    pthread_mutex_unlock(&sim_mutex);
+
+    return (c->handle);
+}
+
+static int32_t sim_codec_delete(int32_t handle)
+{
+    sim_codec   **p, *c = NULL;
+
+    pthread_mutex_lock(&sim_mutex);
+    for( p = &sim_codecs; *p != NULL; p = &(*p)->next ) {
+        if( (*p)->handle == handle ) {
+            c = *p;
+            *p = c->next;
+            sim_cores[c->core].codecs--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sim_mutex);
+    free(c);
+
+    return (c ? XDM_EOK : XDM_EFAIL);
+}
+
+static int32_t sim_codec_control(sim_codec *c, int32_t cmd, void *status)
+{
+    int32_t     luma, chroma;
+
+    if( c == NULL || status == NULL ) {
+        return (XDM_EFAIL);
+    }
+    /* The Status structures of the three classes start alike */
+    ((VIDDEC3_Status *)status)->extendedError = 0;
+    luma = c->width * c->height;
+    chroma = luma / 2;
+
+    if( c->codec_id == OMAP_DCE_VIDDEC3 ) {
+        VIDDEC3_Status  *s = status;
+
+        s->outputWidth = c->width;
+        s->outputHeight = c->height;
+        if( cmd == XDM_GETBUFINFO ) {
+            s->bufInfo.minNumInBufs = 1;
+            s->bufInfo.minNumOutBufs = 2;
+            s->bufInfo.minInBufSize[0].bytes = luma;
+            s->bufInfo.minOutBufSize[0].bytes = luma;
+            s->bufInfo.minOutBufSize[1].bytes = chroma;
+            s->bufInfo.outBufMemoryType[0] = XDM_MEMTYPE_RAW;
+            s->bufInfo.outBufMemoryType[1] = XDM_MEMTYPE_RAW;
+        }
+    } else if( c->codec_id == OMAP_DCE_VIDENC2 ) {
+        VIDENC2_Status  *s = status;
+
+        if( cmd == XDM_GETBUFINFO ) {
+            s->bufInfo.minNumInBufs = 2;
+            s->bufInfo.minNumOutBufs = 1;
+            s->bufInfo.minInBufSize[0].bytes = luma;
+            s->bufInfo.minInBufSize[1].bytes = chroma;
+            s->bufInfo.minOutBufSize[0].bytes = luma;
+            s->bufInfo.inBufMemoryType[0] = XDM_MEMTYPE_RAW;
+            s->bufInfo.inBufMemoryType[1] = XDM_MEMTYPE_RAW;
+        }
+    } else {
+        VIDDEC2_Status  *s = status;
+
+        s->outputWidth = c->width;
+        s->outputHeight = c->height;
+        if( cmd == XDM_GETBUFINFO ) {
+            s->bufInfo.minNumInBufs = 1;
+            s->bufInfo.minNumOutBufs = 2;
+            s->bufInfo.minInBufSize[0] = luma;
+            s->bufInfo.minOutBufSize[0] = luma;
+            s->bufInfo.minOutBufSize[1] = chroma;
+        }
+    }
+
+    return (XDM_EOK);
+}
+
+static int32_t sim_get_version(sim_codec *c, void *status)
+{
+    XDM1_SingleBufDesc  *data;
+
+    if( c == NULL || status == NULL ) {
+        return (XDM_EFAIL);
+    }
+    data = &((VIDDEC3_Status *)status)->data;
+    if( data->buf && data->bufSize > 0 ) {
+        snprintf((char *)data->buf, data->bufSize, "DCE simulator %s", c->name);
+    }
+    return (XDM_EOK);
+}
+
+static int32_t sim_control_batch(sim_codec *c, dce_control_batch *batch)
+{
+    int32_t     ret = XDM_EOK;
+    int         i;
+
+    if( batch == NULL || batch->count > MAX_CONTROL_BATCH ) {
+        return (XDM_EFAIL);
+    }
+    for( i = 0; i < batch->count; i++ ) {
+        batch->cmd[i].ret = sim_codec_control(c, batch->cmd[i].cmd_id, batch->cmd[i].status);
+        if( batch->cmd[i].ret != XDM_EOK ) {
+            ret = XDM_EFAIL;
+        }
+    }
+    return (ret);
+}
+
+static inline int32_t sim_buf_size(XDM2_SingleBufDesc *desc)
+{
+    if( desc->memType == XDM_MEMTYPE_RAW || desc->memType == XDM_MEMTYPE_TILEDPAGE ) {
+        return (desc->bufSize.bytes);
+    }
+    return (desc->bufSize.tileMem.width * desc->bufSize.tileMem.height);
+}
+
+/* Rows of the low latency decoders: a process call makes one block of 16 rows   */
+/* available at a time over its duration, and every putDataFxn callback RPC     */
+/* waits for the next block. The end of the frame is delivered as a callback    */
+/* without blocks, which the process call waits for before returning.          */
+#define SIM_ROW_TIMEOUT_US  1000000
+
+static pthread_mutex_t  sim_row_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   sim_row_cond = PTHREAD_COND_INITIALIZER;
+static uint64_t         sim_row_time_us = 0;
+
+static void sim_row_deadline(struct timespec *abstime)
+{
+    clock_gettime(CLOCK_REALTIME, abstime);
+    abstime->tv_sec += SIM_ROW_TIMEOUT_US / 1000000;
+}
+
+static void sim_rows_produce(sim_codec *c)
+{
+    struct timespec abstime;
+    int             i, n = c->height / 16;
+
+    for( i = 0; i < n; i++ ) {
+        sim_delay(sim_process_us / n);
+        pthread_mutex_lock(&sim_row_mutex);
+        c->blocks++;
+        sim_row_time_us = sim_now_us();
+        pthread_cond_broadcast(&sim_row_cond);
+        pthread_mutex_unlock(&sim_row_mutex);
+    }
+
+    sim_row_deadline(&abstime);
+    pthread_mutex_lock(&sim_row_mutex);
+    c->ended = 1;
+    pthread_cond_broadcast(&sim_row_cond);
+    while( (c->blocks || c->ended) &&
+           pthread_cond_timedwait(&sim_row_cond, &sim_row_mutex, &abstime) == 0 ) {
+        ;
+    }
+    if( c->blocks || c->ended ) {
+        ERROR("sim: codec 0x%x: %d blocks of the frame not delivered", c->handle, c->blocks);
+        c->blocks = 0;
+        c->ended = 0;
+    }
+    pthread_mutex_unlock(&sim_row_mutex);
+}
+
+/* Blocks delivered by one putDataFxn callback RPC, 0 at the end of the frame */
+static int32_t sim_rows_consume(sim_codec *c)
+{
+    struct timespec abstime;
+    int32_t         n = 0;
+
+    sim_row_deadline(&abstime);
+    pthread_mutex_lock(&sim_row_mutex);
+    while( !c->blocks && !c->ended &&
+           pthread_cond_timedwait(&sim_row_cond, &sim_row_mutex, &abstime) == 0 ) {
+        ;
+    }
+    if( c->blocks ) {
+        c->blocks--;
+        n = 1;
+    } else {
+        c->ended = 0;
+    }
+    pthread_cond_broadcast(&sim_row_cond);
+    pthread_mutex_unlock(&sim_row_mutex);
+
+    return (n);
+}
+
+/* Blocks given by one getDataFxn callback RPC to a low latency encoder */
+static void sim_rows_receive(sim_codec *c, int32_t n)
+{
+    pthread_mutex_lock(&sim_row_mutex);
+    c->blocks += n;
+    pthread_cond_broadcast(&sim_row_cond);
+    pthread_mutex_unlock(&sim_row_mutex);
+}
+
+/* A low latency encoder waits for the rows of the frame before returning */
+static void sim_rows_wait(sim_codec *c)
+{
+    struct timespec abstime;
+    int             n = c->height / 16;
+
+    sim_row_deadline(&abstime);
+    pthread_mutex_lock(&sim_row_mutex);
+    while( c->blocks < n &&
+           pthread_cond_timedwait(&sim_row_cond, &sim_row_mutex, &abstime) == 0 ) {
+        ;
+    }
+    if( c->blocks < n ) {
+        ERROR("sim: codec 0x%x: %d blocks of the frame not received", c->handle, n - c->blocks);
+    }
+    c->blocks = c->blocks > n ? c->blocks - n : 0;
+    pthread_mutex_unlock(&sim_row_mutex);
+}
+
+/* Software codecs: the first input buffer is copied to the first output buffer */
+static int32_t sim_codec_process(sim_codec *c, void *inBufs, void *outBufs, void *inArgs, void *outArgs)
+{
+    int32_t     n, id, ret = XDM_EOK;
+    uint64_t    start;
+
+    if( c == NULL || inBufs == NULL || outBufs == NULL || inArgs == NULL || outArgs == NULL ) {
+        return (XDM_EFAIL);
+    }
+
+    pthread_mutex_lock(&sim_stall_mutex);
+    if( sim_stall ) {
+        sim_stalled++;
+        while( sim_stall ) {
+            pthread_cond_wait(&sim_stall_cond, &sim_stall_mutex);
+        }
+        sim_stalled--;
+    }
+    pthread_mutex_unlock(&sim_stall_mutex);
+
+    pthread_mutex_lock(&sim_cores[c->core].hw_lock);
+    start = sim_now_us();
+
+    if( c->codec_id == OMAP_DCE_VIDDEC3 ) {
+        XDM2_BufDesc        *in = inBufs, *out = outBufs;
+        VIDDEC3_InArgs      *args = inArgs;
+        VIDDEC3_OutArgs     *oargs = outArgs;
+
+        id = args->numBytes > 0 ? args->inputID : 0;
+        n = in->numBufs > 0 && out->numBufs > 0 ? args->numBytes : 0;
+        n = n < sim_buf_size(&out->descs[0]) ? n : sim_buf_size(&out->descs[0]);
+        if( n > 0 ) {
+            memcpy(out->descs[0].buf, in->descs[0].buf, n);
+        }
+        oargs->extendedError = 0;
+        oargs->bytesConsumed = args->numBytes;
+        oargs->outputID[0] = id;
+        oargs->outputID[1] = 0;
+        oargs->freeBufID[0] = id;
+        oargs->freeBufID[1] = 0;
+        oargs->outBufsInUseFlag = 0;
+        /* Nothing left to output once flushed */
+        ret = id ? XDM_EOK : XDM_EFAIL;
+    } else if( c->codec_id == OMAP_DCE_VIDENC2 ) {
+        IVIDEO2_BufDesc     *in = inBufs;
+        XDM2_BufDesc        *out = outBufs;
+        VIDENC2_InArgs      *args = inArgs;
+        VIDENC2_OutArgs     *oargs = outArgs;
+
+        n = in->numPlanes > 0 && out->numBufs > 0 ? sim_buf_size(&in->planeDesc[0]) : 0;
+        n = n < sim_buf_size(&out->descs[0]) ? n : sim_buf_size(&out->descs[0]);
+        if( n > 0 ) {
+            memcpy(out->descs[0].buf, in->planeDesc[0].buf, n);
+        }
+        oargs->extendedError = 0;
+        oargs->bytesGenerated = n;
+        oargs->encodedFrameType = IVIDEO_I_FRAME;
+        oargs->inputFrameSkip = IVIDEO_FRAME_ENCODED;
+        oargs->freeBufID[0] = args->inputID;
+        oargs->freeBufID[1] = 0;
+    } else {
+        XDM1_BufDesc        *in = inBufs;
+        XDM_BufDesc         *out = outBufs;
+        VIDDEC2_InArgs      *args = inArgs;
+        VIDDEC2_OutArgs     *oargs = outArgs;
+
+        id = args->numBytes > 0 ? args->inputID : 0;
+        n = in->numBufs > 0 && out->numBufs > 0 ? args->numBytes : 0;
+        n = n < out->bufSizes[0] ? n : out->bufSizes[0];
+        if( n > 0 ) {
+            memcpy(out->bufs[0], in->descs[0].buf, n);
+        }
+        oargs->bytesConsumed = args->numBytes;
+        oargs->outputID[0] = id;
+        oargs->outputID[1] = 0;
+        oargs->freeBufID[0] = id;
+        oargs->freeBufID[1] = 0;
+        oargs->outBufsInUseFlag = 0;
+        ret = id ? XDM_EOK : XDM_EFAIL;
+    }
+
+    if( c->row_mode && c->codec_id == OMAP_DCE_VIDENC2 ) {
+        sim_rows_wait(c);
+    } else if( c->row_mode ) {
+        sim_rows_produce(c);
+    } else {
+        sim_delay(sim_process_us);
+    }
+    sim_cores[c->core].busy_us += sim_now_us() - start;
+    pthread_mutex_unlock(&sim_cores[c->core].hw_lock);
+
+    return (ret);
+}
+
+static int32_t sim_get_info(int core, rproc_info_type type)
+{
+    sim_core    *sc = &sim_cores[core];
+    uint64_t    now, busy;
+    int32_t     value = 0, used;
+
+    if( type == RPROC_CPU_LOAD ) {
+        if( sim_cpu_load >= 0 ) {
+            return (sim_cpu_load);
+        }
+        /* Busy time since the previous query */
+        pthread_mutex_lock(&sc->hw_lock);
+        now = sim_now_us();
+        busy = sc->busy_us;
+        value = (sc->window_us && now > sc->window_us) ? (int32_t)(busy * 100 / (now - sc->window_us)) : 0;
+        sc->busy_us = 0;
+        sc->window_us = now;
+        pthread_mutex_unlock(&sc->hw_lock);
+        value = value > 100 ? 100 : value;
+    } else if( type == RPROC_TOTAL_HEAP_SIZE ) {
+        value = SIM_HEAP_SIZE;
+    } else if( type == RPROC_AVAILABLE_HEAP_SIZE ) {
+        pthread_mutex_lock(&sim_mutex);
+        used = sc->codecs * SIM_INSTANCE_HEAP;
+        pthread_mutex_unlock(&sim_mutex);
+        value = used < SIM_HEAP_SIZE ? SIM_HEAP_SIZE - used : 0;
+    }
+    return (value);
+}
+
+/* Row mode exchanges: the software codecs produce and consume whole frames */
+static int32_t sim_callback(MmRpc_FxnCtx *ctx)
+{
+    XDM_DataSyncDesc    *desc = ctx->num_params > 1 ? sim_param_ptr(&ctx->params[1]) : NULL;
+    sim_codec           *c;
+
+    if( ctx->fxn_id == DCE_CALLBACK_RPC_PUT_DATAFXN && desc ) {
+        c = sim_codec_get(sim_param_scalar(&ctx->params[0]));
+        desc->numBlocks = (c && c->row_mode) ? sim_rows_consume(c) : 0;
+    } else if( ctx->fxn_id == DCE_CALLBACK_RPC_GET_DATAFXN && desc ) {
+        c = sim_codec_get(sim_param_scalar(&ctx->params[0]));
+        if( c && c->row_mode ) {
+            sim_rows_receive(c, desc->numBlocks);
+        }
+    }
+    return (0);
+}
+
+static int32_t sim_dispatch(int core, MmRpc_FxnCtx *ctx)
+{
+    MmRpc_Param     *p = ctx->params;
+
+    switch( ctx->fxn_id ) {
+        case DCE_RPC_ENGINE_OPEN :
+            return (sim_engine_open(core, sim_param_ptr(&p[0])));
+        case DCE_RPC_ENGINE_CLOSE :
+            pthread_mutex_lock(&sim_mutex);
+            sim_cores[core].engines--;
+            pthread_mutex_unlock(&sim_mutex);
+            return (0);
+        case DCE_RPC_CODEC_CREATE :
+            return (sim_codec_create(core, sim_param_scalar(&p[0]), sim_param_ptr(&p[2]), sim_param_ptr(&p[3])));
+        case DCE_RPC_CODEC_CONTROL :
+            return (sim_codec_control(sim_codec_get(sim_param_scalar(&p[1])), sim_param_scalar(&p[2]),
+                                      sim_param_ptr(&p[4])));
+        case DCE_RPC_CODEC_GET_VERSION :
+            return (sim_get_version(sim_codec_get(sim_param_scalar(&p[1])), sim_param_ptr(&p[3])));
+        case DCE_RPC_CODEC_PROCESS :
+            return (sim_codec_process(sim_codec_get(sim_param_scalar(&p[1])), sim_param_ptr(&p[2]),
+                                      sim_param_ptr(&p[3]), sim_param_ptr(&p[4]), sim_param_ptr(&p[5])));
+        case DCE_RPC_CODEC_DELETE :
+            return (sim_codec_delete(sim_param_scalar(&p[1])));
+        case DCE_RPC_GET_INFO :
+            return (sim_get_info(core, sim_param_scalar(&p[0])));
+        case DCE_RPC_CODEC_CONTROL_BATCH :
+            return (sim_control_batch(sim_codec_get(sim_param_scalar(&p[1])), sim_param_ptr(&p[2])));
+        default :
+            ERROR("sim: unknown function %u", ctx->fxn_id);
+            return (XDM_EFAIL);
+    }
+}
+
+/***************** MmRpc ****************/
+void MmRpc_Params_init(MmRpc_Params *params)
+{
+    params->reserved = 0;
+}
+
+int MmRpc_create(const char *service, const MmRpc_Params *params, MmRpc_Handle *handlePtr)
+{
+    struct MmRpc_Object *obj, **p;
+    int                 core;
+
+    pthread_once(&sim_once, sim_config);
+
+    for( core = 0; core < SIM_CORES && strcmp(service, SIM_SERVICE[core]); core++ ) {
+        ;
+    }
+    if( core == SIM_CORES ) {
+        if( strcmp(service, SIM_CALLBACK_SERVICE) ) {
+            return (MmRpc_E_FAIL);
+        }
+        core = -1;
+    }
+    obj = calloc(1, sizeof(struct MmRpc_Object));
+    if( obj == NULL ) {
+        return (MmRpc_E_NOMEM);
+    }
+    obj->core = core;
+    pthread_mutex_lock(&sim_mutex);
+    for( p = &sim_conns; *p != NULL; p = &(*p)->next ) {
+        ;
+    }
+    *p = obj;
+    pthread_mutex_unlock(&sim_mutex);
+    *handlePtr = obj;
+
+    return (MmRpc_S_SUCCESS);
+}
+
+int MmRpc_delete(MmRpc_Handle *handlePtr)
+{
+    struct MmRpc_Object **p;
+    int                 active;
+
+    pthread_mutex_lock(&sim_mutex);
+    for( p = &sim_conns; *p != NULL; p = &(*p)->next ) {
+        if( *p == *handlePtr ) {
+            *p = (*p)->next;
+            break;
+        }
+    }
+    /* The driver would free the connection under the calls: keep it for them */
+    active = __atomic_load_n(&(*handlePtr)->active, __ATOMIC_ACQUIRE);
+    if( active > 0 ) {
+        sim_unsafe_deletes++;
+    }
+    pthread_mutex_unlock(&sim_mutex);
+    if( active > 0 ) {
+        fprintf(stderr, "DCE simulator: MmRpc_delete() of a connection with %d call(s) running\n", active);
+    } else {
+        free(*handlePtr);
+    }
+    *handlePtr = NULL;
+    return (MmRpc_S_SUCCESS);
+}
+
+int MmRpc_call(MmRpc_Handle handle, MmRpc_FxnCtx *ctx, int32_t *ret)
+{
+    sim_xlt     saved[SIM_MAX_XLT];
+    int         status;
+
+    if( handle == NULL || ctx == NULL || ret == NULL || ctx->num_params > MmRpc_MAXPARAMS ) {
+        return (MmRpc_E_INVALIDPARAM);
+    }
+    __atomic_add_fetch(&handle->calls, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&handle->active, 1, __ATOMIC_ACQ_REL);
+    sim_delay(sim_call_us);
+
+    if( handle->core < 0 ) {
+        *ret = sim_callback(ctx);
+        status = MmRpc_S_SUCCESS;
+    } else {
+        status = sim_translate(ctx, saved);
+        if( status == MmRpc_S_SUCCESS ) {
+            *ret = sim_dispatch(handle->core, ctx);
+            sim_untranslate(ctx, saved);
+        }
+    }
+    __atomic_sub_fetch(&handle->active, 1, __ATOMIC_ACQ_REL);
+    return (status);
+}
+
+/* Buffers are shared with the simulated cores through the fds: nothing to map */
+/* dma-bufs of other allocators are wrapped while registered, as the driver */
+/* attaches them, so that sim_translate() finds them.                        */
+int MmRpc_use(MmRpc_Handle handle, MmRpc_BufType type, int num, MmRpc_BufDesc *desc)
+{
+    struct omap_bo  *bo;
+    int             i;
+
+    if( !handle || num <= 0 || !desc ) {
+        return (MmRpc_E_INVALIDPARAM);
+    }
+    for( i = 0; i < num; i++ ) {
+        pthread_mutex_lock(&sim_bo_mutex);
+        bo = sim_bo_find((int)desc[i].handle);
+        pthread_mutex_unlock(&sim_bo_mutex);
+        if( bo == NULL && (bo = omap_bo_from_dmabuf(NULL, (int)desc[i].handle)) != NULL ) {
+            bo->external = 1;
+        }
+    }
+    return (MmRpc_S_SUCCESS);
+}
+
+int MmRpc_release(MmRpc_Handle handle, MmRpc_BufType type, int num, MmRpc_BufDesc *desc)
+{
+    struct omap_bo  *bo;
+    int             i;
+
+    if( !handle || num <= 0 || !desc ) {
+        return (MmRpc_E_INVALIDPARAM);
+    }
+    for( i = 0; i < num; i++ ) {
+        pthread_mutex_lock(&sim_bo_mutex);
+        bo = sim_bo_find((int)desc[i].handle);
+        pthread_mutex_unlock(&sim_bo_mutex);
+        if( bo && bo->external ) {
+            omap_bo_del(bo);
+        }
+    }
+    return (MmRpc_S_SUCCESS);
+}
+
+/***************** Hooks ****************/
+int dce_sim_connection_calls(int core, uint32_t *calls, int max)
+{
+    struct MmRpc_Object *obj;
+    int                 n = 0;
+
+    pthread_mutex_lock(&sim_mutex);
+    for( obj = sim_conns; obj != NULL; obj = obj->next ) {
+        if( obj->core == core ) {
+            if( n < max ) {
+                calls[n] = __atomic_load_n(&obj->calls, __ATOMIC_RELAXED);
+            }
+            n++;
+        }
+    }
+    pthread_mutex_unlock(&sim_mutex);
+
+    return (n);
+}
+
+uint64_t dce_sim_row_time_us(void)
+{
+    uint64_t    t;
+
+    pthread_mutex_lock(&sim_row_mutex);
+    t = sim_row_time_us;
+    pthread_mutex_unlock(&sim_row_mutex);
+
+    return (t);
+}
+
+void dce_sim_stall(int stall)
+{
+    pthread_mutex_lock(&sim_stall_mutex);
+    sim_stall = stall;
+    pthread_cond_broadcast(&sim_stall_cond);
+    pthread_mutex_unlock(&sim_stall_mutex);
+}
+
+int dce_sim_stalled_calls(void)
+{
+    int     n;
+
+    pthread_mutex_lock(&sim_stall_mutex);
+    n = sim_stalled;
+    pthread_mutex_unlock(&sim_stall_mutex);
+
+    return (n);
+}
+
+int dce_sim_codec_count(int core)
+{
+    int     n;
+
+    pthread_mutex_lock(&sim_mutex);
+    n = sim_cores[core].codecs;
+    pthread_mutex_unlock(&sim_mutex);
+
+    return (n);
+}
+
+int dce_sim_unsafe_deletes(void)
+{
+    int     n;
+
+    pthread_mutex_lock(&sim_mutex);
+    n = sim_unsafe_deletes;
+    pthread_mutex_unlock(&sim_mutex);
+
+    return (n);
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2013, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Hooks of the DCE simulator (see simulator/dce_sim.c) for the tests and
+ * benchmarks of tools/, which observe and steer the simulated servers.
+ */
+
+#ifndef __DCE_SIM_H__
+#define __DCE_SIM_H__
+
+#include <stdint.h>
+
+/* Read the calls received by the open connections of a core, oldest connection */
+/* first, into calls[0..max). Returns the number of open connections.          */
+int dce_sim_connection_calls(int core, uint32_t *calls, int max);
+
+/* CLOCK_MONOTONIC time in microseconds at which a low latency decoder last made */
+/* a block of rows available to its putDataFxn callback RPC.                     */
+uint64_t dce_sim_row_time_us(void);
+
+/* While stall is set, process calls block before reaching the codec, as with a */
+/* remote core which stopped answering. Clearing it lets them run.             */
+void dce_sim_stall(int stall);
+
+/* Number of process calls currently blocked by dce_sim_stall() */
+int dce_sim_stalled_calls(void);
+
+/* Number of codec instances alive on a core */
+int dce_sim_codec_count(int core);
+
+/* Number of connections deleted while calls were running on them. The real */
+/* driver would free them under the calls, the simulator keeps them.         */
+int dce_sim_unsafe_deletes(void);
+
+#endif /* __DCE_SIM_H__ */
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2013, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * omapdrm buffer flags of the DCE simulator (see simulator/dce_sim.c).
+ */
+
+#ifndef __DCE_SIM_OMAP_DRM_H__
+#define __DCE_SIM_OMAP_DRM_H__
+
+#define OMAP_BO_SCANOUT     0x00000001
+#define OMAP_BO_CACHE_MASK  0x00000006
+#define OMAP_BO_CACHED      0x00000000
+#define OMAP_BO_WC          0x00000002
+#define OMAP_BO_UNCACHED    0x00000004
+#define OMAP_BO_TILED_MASK  0x00000f00
+#define OMAP_BO_TILED_8     0x00000100
+#define OMAP_BO_TILED_16    0x00000200
+#define OMAP_BO_TILED_32    0x00000300
+#define OMAP_BO_TILED       (OMAP_BO_TILED_8 | OMAP_BO_TILED_16 | OMAP_BO_TILED_32)
+
+enum omap_gem_op {
+    OMAP_GEM_READ = 0x01,
+    OMAP_GEM_WRITE = 0x02
+};
+
+#endif /* __DCE_SIM_OMAP_DRM_H__ */
@@ -153,6 +153,11 @@ int out_cnt = 0;
 unsigned int    frameSize[64000]; /* Buffer for keeping frame sizes */
 static int      input_offset = 0;
 
+/* framefile "-": access units split by the libdce parser instead of frameSize */
+static dce_au_parser   *au_parser = NULL;
+static int              input_size = 0;
+static int              au_flushed = 0;
+
 /*! Padding for width as per  Codec Requirement */
 #define PADX_H264   32
 #define PADX_MPEG4  32
@@ -497,7 +502,21 @@ int read_input(const char *pattern, int cnt, char *input)
         return (0);
     }
 
-    if( frameSize[cnt] && (frameSize[cnt] != -1)) {
+    if( au_parser ) {
+        lseek(fd, input_offset, SEEK_SET);
+        n = read(fd, input, input_size);
+        if( n > 0 ) {
+            sz = dce_au_parser_next(au_parser, input, n, n < input_size);
+            if( sz == 0 ) {
+                ERROR("access unit larger than the input buffer (%d bytes)", input_size);
+            }
+            input_offset += sz;
+        } else if( !au_flushed ) {
+            // End of stream, flush once
+            au_flushed = 1;
+            sz = -1;
+        }
+    } else if( frameSize[cnt] && (frameSize[cnt] != -1)) {
         lseek(fd, input_offset, SEEK_SET);
         n = read(fd, input, frameSize[cnt]);
         //DEBUG("reading input frameSize[%d] = n =%d", cnt, n);
@@ -808,7 +827,7 @@ int main(int argc, char * *argv)
     int              in_cnt = 0;
     int              oned, stride;
     unsigned int     frameCount = 0;
-    FILE            *frameFile;
+    FILE            *frameFile = NULL;
     unsigned char    frameinput[10] = { "\0" };
     int              eof = 0;
     int              ivahd_decode_type;
@@ -852,6 +871,8 @@ int main(int argc, char * *argv)
         printf("example: %s 320 240 30 frame.txt in.vc1 out.yuv vc1smp nontiler full\n", argv[0]);
         printf("example: %s 1280 720 30 frame.txt in.bin out.yuv mjpeg tiler full\n", argv[0]);
         printf("example: %s 1920 1088 30 frame.txt in.bin out.yuv mpeg2 nontiler full\n", argv[0]);
+        printf("example: %s 1920 1088 30 - in.h264 out.yuv h264 tiler full\n", argv[0]);
+        printf("framefile - splits the stream into access units, for h264, mpeg4, vc1ap and mpeg2\n");
         printf("Currently supported codecs: h264, mpeg4, vc1ap, vc1smp, mjpeg, mpeg2\n");
         return (1);
     }
@@ -940,24 +961,50 @@ int main(int argc, char * *argv)
         goto shutdown;
     }
 
-    DEBUG("Storing frame size data");
-    frameFile = fopen(frameData, "rb");
-    DEBUG("frameFile open %p errno %d", frameFile, errno);
-    if( frameFile == NULL ) {
-        DEBUG("Opening framesize file FAILED");
-        return (1);
-    }
+    if( !strcmp(frameData, "-")) {
+        dce_stream_format    format;
 
-    /* Read the frame Size from the frame size file */
-    while( NULL != fgets((char *)frameinput, 10, frameFile)) {
-        frameSize[frameCount] = atoi((char *)frameinput);
-        //DEBUG("frameSize[%d] = %d \n", frameCount, frameSize[frameCount]);
+        switch( codec_switch ) {
+            case DCE_TEST_H264 :
+                format = DCE_STREAM_H264;
+                break;
+            case DCE_TEST_MPEG4 :
+                format = DCE_STREAM_MPEG4;
+                break;
+            case DCE_TEST_VC1AP :
+                format = DCE_STREAM_VC1;
+                break;
+            case DCE_TEST_MPEG2 :
+                format = DCE_STREAM_MPEG2;
+                break;
+            default :
+                ERROR("framefile - is not supported for %s", vid_codec);
+                return (1);
+        }
+        au_parser = dce_au_parser_create(format);
+        if( au_parser == NULL ) {
+            return (1);
+        }
+    } else {
+        DEBUG("Storing frame size data");
+        frameFile = fopen(frameData, "rb");
+        DEBUG("frameFile open %p errno %d", frameFile, errno);
+        if( frameFile == NULL ) {
+            DEBUG("Opening framesize file FAILED");
+            return (1);
+        }
+
+        /* Read the frame Size from the frame size file */
+        while( NULL != fgets((char *)frameinput, 10, frameFile)) {
+            frameSize[frameCount] = atoi((char *)frameinput);
+            //DEBUG("frameSize[%d] = %d \n", frameCount, frameSize[frameCount]);
 
-        frameCount++;
+            frameCount++;
 
-        if( frameCount >= 64000 ) {
-            ERROR("DCE_TEST_FAIL: Num Frames %d exceeded MAX limit %d \n", frameCount, 64000);
-            goto out;
+            if( frameCount >= 64000 ) {
+                ERROR("DCE_TEST_FAIL: Num Frames %d exceeded MAX limit %d \n", frameCount, 64000);
+                goto out;
+            }
         }
     }
 
@@ -1409,7 +1456,8 @@ int main(int argc, char * *argv)
 
     inBufs = dce_alloc(sizeof(XDM2_BufDesc));
     inBufs->numBufs = 1;
-    input = dce_alloc(orig_width * orig_height);
+    input_size = orig_width * orig_height;
+    input = dce_alloc(input_size);
     inBufs->descs[0].buf = (XDAS_Int8 *)input;
     inBufs->descs[0].memType = XDM_MEMTYPE_RAW;
 
@@ -1826,7 +1874,12 @@ out:
 
     output_free();
 
-    fclose(frameFile);
+    if( frameFile ) {
+        fclose(frameFile);
+    }
+    if( au_parser ) {
+        dce_au_parser_delete(au_parser);
+    }
 
     printf("DCE test completed...\n");
 
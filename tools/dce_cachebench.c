@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2013, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * dce_cachebench: cost of reading back parameter buffers allocated with
+ * dce_alloc() (write-combined) and dce_alloc_cached() (cached, synchronized
+ * around every remote call). An H.264 decoder instance fills an
+ * IH264VDEC_Status with XDM_GETSTATUS, then every field of the structure is
+ * read as the client of a row mode or status polling loop would. The
+ * duration of the control call includes the cache maintenance.
+ *
+ * usage: dce_cachebench [-n iterations] [-r reads per iteration]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <libdce.h>
+#include <ti/sdo/codecs/h264vdec/ih264vdec.h>
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t)t.tv_sec * 1000000000 + t.tv_nsec);
+}
+
+/* Read every 32 bit field of the status, volatile so that no load is skipped */
+static void read_fields(const volatile uint32_t *s, int words)
+{
+    int     i;
+
+    for( i = 0; i < words; i++ ) {
+        (void)s[i];
+    }
+}
+
+static int run(VIDDEC3_Handle codec, const char *name, int cached, int iterations, int reads)
+{
+    VIDDEC3_DynamicParams   *dynParams;
+    IH264VDEC_Status        *status;
+    uint64_t                t, control_ns = 0, read_ns = 0;
+    int                     i, j, words = sizeof(IH264VDEC_Status) / sizeof(uint32_t);
+
+    dynParams = dce_alloc(sizeof(VIDDEC3_DynamicParams));
+    status = cached ? dce_alloc_cached(sizeof(IH264VDEC_Status)) : dce_alloc(sizeof(IH264VDEC_Status));
+    if( dynParams == NULL || status == NULL ) {
+        fprintf(stderr, "%s: allocation failed\n", name);
+        return (-1);
+    }
+    dynParams->size = sizeof(VIDDEC3_DynamicParams);
+    status->viddec3Status.size = sizeof(IH264VDEC_Status);
+
+    for( i = 0; i < iterations; i++ ) {
+        t = now_ns();
+        if( VIDDEC3_control(codec, XDM_GETSTATUS, dynParams, (VIDDEC3_Status *)status) != VIDDEC3_EOK ) {
+            fprintf(stderr, "%s: XDM_GETSTATUS failed\n", name);
+            break;
+        }
+        control_ns += now_ns() - t;
+
+        t = now_ns();
+        for( j = 0; j < reads; j++ ) {
+            read_fields((volatile uint32_t *)status, words);
+        }
+        read_ns += now_ns() - t;
+    }
+
+    if( i > 0 ) {
+        printf("%-8s control %8.1f us   read %7.2f us per status (%d fields, %.1f ns per field)\n",
+               name, control_ns / 1000.0 / i, read_ns / 1000.0 / i / reads, words,
+               (double)read_ns / i / reads / words);
+    }
+    dce_free(status);
+    dce_free(dynParams);
+    return (i == iterations ? 0 : -1);
+}
+
+int main(int argc, char **argv)
+{
+    Engine_Handle           engine = NULL;
+    Engine_Error            ec;
+    VIDDEC3_Handle          codec = NULL;
+    VIDDEC3_Params          *params = NULL;
+    void                    *dev;
+    int                     iterations = 1000, reads = 1, opt, ret = 1;
+
+    while( (opt = getopt(argc, argv, "n:r:")) != -1 ) {
+        switch( opt ) {
+            case 'n' :
+                iterations = atoi(optarg);
+                break;
+            case 'r' :
+                reads = atoi(optarg);
+                break;
+            default :
+                fprintf(stderr, "usage: %s [-n iterations] [-r reads per iteration]\n", argv[0]);
+                return (1);
+        }
+    }
+    if( iterations < 1 || reads < 1 ) {
+        fprintf(stderr, "usage: %s [-n iterations] [-r reads per iteration]\n", argv[0]);
+        return (1);
+    }
+
+    dev = dce_init();
+    if( dev == NULL ) {
+        fprintf(stderr, "dce_init failed\n");
+        return (1);
+    }
+    engine = Engine_open("ivahd_vidsvr", NULL, &ec);
+    if( engine == NULL ) {
+        fprintf(stderr, "Engine_open failed %d\n", ec);
+        goto EXIT;
+    }
+
+    params = dce_alloc(sizeof(VIDDEC3_Params));
+    if( params == NULL ) {
+        goto EXIT;
+    }
+    params->size = sizeof(VIDDEC3_Params);
+    params->maxWidth = 1920;
+    params->maxHeight = 1088;
+    params->maxFrameRate = 30000;
+    params->maxBitRate = 10000000;
+    params->dataEndianness = XDM_BYTE;
+    params->forceChromaFormat = XDM_YUV_420SP;
+    params->operatingMode = IVIDEO_DECODE_ONLY;
+    params->displayDelay = IVIDDEC3_DISPLAY_DELAY_AUTO;
+    params->displayBufsMode = IVIDDEC3_DISPLAYBUFS_EMBEDDED;
+    params->inputDataMode = IVIDEO_ENTIREFRAME;
+    params->outputDataMode = IVIDEO_ENTIREFRAME;
+    params->numInputDataUnits = 0;
+    params->numOutputDataUnits = 0;
+    params->errorInfoMode = IVIDEO_ERRORINFO_OFF;
+    params->metadataType[0] = IVIDEO_METADATAPLANE_NONE;
+    params->metadataType[1] = IVIDEO_METADATAPLANE_NONE;
+    params->metadataType[2] = IVIDEO_METADATAPLANE_NONE;
+
+    codec = VIDDEC3_create(engine, "ivahd_h264dec", params);
+    if( codec == NULL ) {
+        fprintf(stderr, "VIDDEC3_create failed\n");
+        goto EXIT;
+    }
+
+    printf("IH264VDEC_Status, %d iterations\n", iterations);
+    if( run(codec, "wc", 0, iterations, reads) == 0 && run(codec, "cached", 1, iterations, reads) == 0 ) {
+        ret = 0;
+    }
+
+EXIT:
+    if( codec ) {
+        VIDDEC3_delete(codec);
+    }
+    if( params ) {
+        dce_free(params);
+    }
+    if( engine ) {
+        Engine_close(engine);
+    }
+    dce_deinit(dev);
+    return (ret);
+}
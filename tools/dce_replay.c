@@ -0,0 +1,569 @@
+/*
+ * Copyright (c) 2013, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * dce_replay: play back a capture of the remote calls of libdce (see
+ * dce_capture_start() and dce_capture.h) against the remote cores, or the
+ * simulator on a build configured with --enable-simulator. Every captured
+ * thread is replayed by its own thread, the buffers are recreated with their
+ * captured contents and the engine and codec handles returned by the remote
+ * cores are substituted. Calls whose result differs from the capture are
+ * reported along with the duration of each call type.
+ *
+ * usage: dce_replay [-t] [-v] file
+ *   -t : keep the timing of the capture between calls
+ *   -v : print every call
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <omap_drm.h>
+#include <omap_drmif.h>
+#include <ti/ipc/mm/MmRpc.h>
+#include <libdce.h>
+
+#include "dce_rpc.h"
+#include "dce_capture.h"
+#include "memplugin.h"
+
+#define REPLAY_MAX_THREADS      64
+#define REPLAY_MAX_FXN          16
+#define REPLAY_HANDLE_WAIT_MS   5000    /* for a handle created by another thread */
+
+static const char *DEVICE_NAME[MAX_REMOTEDEVICES] = { "rpmsg-dce", "rpmsg-dce-dsp" };
+static const char *CALLBACK_NAME = "dce-callback";
+
+typedef struct {
+    dce_capture_buf     desc;
+    char                *data;      /* captured contents, desc.length bytes */
+} replay_buf_ref;
+
+typedef struct replay_call {
+    struct replay_call  *next;      /* next call of the same thread */
+    dce_capture_call    call;
+    dce_capture_param   *params;
+    dce_capture_xlt     *xlts;
+    replay_buf_ref      *bufs;
+} replay_call;
+
+typedef struct {
+    uint64_t            thread;     /* captured thread */
+    replay_call         *head, *tail;
+    pthread_t           id;
+} replay_thread;
+
+typedef struct replay_buf {
+    struct replay_buf   *next;
+    uint64_t            id;
+    struct omap_bo      *bo;
+    int                 fd;
+    char                *map;
+} replay_buf;
+
+typedef struct replay_handle {
+    struct replay_handle *next;
+    size_t              captured;
+    size_t              replayed;
+} replay_handle;
+
+typedef struct {
+    uint32_t            count;
+    uint32_t            mismatch;
+    uint64_t            captured_us;
+    uint64_t            replayed_us;
+} replay_stats;
+
+static replay_thread        threads[REPLAY_MAX_THREADS];
+static int                  num_threads;
+static replay_buf           *bufs;
+static replay_handle        *handles;
+static replay_stats         stats[2][REPLAY_MAX_FXN];   /* codec calls, callbacks */
+static pthread_mutex_t      mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t       handle_cond = PTHREAD_COND_INITIALIZER;
+static struct omap_device   *dev;
+static MmRpc_Handle         conn[MAX_REMOTEDEVICES][DCE_MAX_CONNECTIONS];
+static MmRpc_Handle         callback;
+static uint64_t             capture_start_us = UINT64_MAX;
+static uint64_t             replay_start_us;
+static int                  paced, verbose;
+
+static inline uint64_t now_us(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000);
+}
+
+static int read_all(FILE *f, void *data, size_t len)
+{
+    return (len == 0 || fread(data, len, 1, f) == 1);
+}
+
+/* Read the next call of the capture, NULL at the end of the file */
+static replay_call *read_call(FILE *f)
+{
+    replay_call     *rc = calloc(1, sizeof(replay_call));
+    uint32_t        i;
+
+    if( rc == NULL || !read_all(f, &rc->call, sizeof(rc->call)) ) {
+        free(rc);
+        return (NULL);
+    }
+    if( rc->call.num_params > MmRpc_MAXPARAMS || rc->call.num_xlts > MmRpc_MAXTRANSLATIONS ||
+        (rc->call.core != DCE_CAPTURE_CALLBACK && (rc->call.core < 0 || rc->call.core >= MAX_REMOTEDEVICES ||
+                                                   rc->call.conn < 0 || rc->call.conn >= DCE_MAX_CONNECTIONS)) ) {
+        fprintf(stderr, "corrupted capture\n");
+        exit(1);
+    }
+    rc->params = calloc(rc->call.num_params + 1, sizeof(dce_capture_param));
+    rc->xlts = calloc(rc->call.num_xlts + 1, sizeof(dce_capture_xlt));
+    rc->bufs = calloc(rc->call.num_bufs + 1, sizeof(replay_buf_ref));
+    if( !rc->params || !rc->xlts || !rc->bufs ||
+        !read_all(f, rc->params, rc->call.num_params * sizeof(dce_capture_param)) ||
+        !read_all(f, rc->xlts, rc->call.num_xlts * sizeof(dce_capture_xlt)) ) {
+        fprintf(stderr, "truncated capture\n");
+        exit(1);
+    }
+    for( i = 0; i < rc->call.num_bufs; i++ ) {
+        if( !read_all(f, &rc->bufs[i].desc, sizeof(dce_capture_buf)) ||
+            (rc->bufs[i].desc.length && (rc->bufs[i].data = malloc(rc->bufs[i].desc.length)) == NULL) ||
+            !read_all(f, rc->bufs[i].data, rc->bufs[i].desc.length) ) {
+            fprintf(stderr, "truncated capture\n");
+            exit(1);
+        }
+    }
+    return (rc);
+}
+
+/* Buffer replacing a captured buffer, allocated and registered on first use */
+static replay_buf *get_buf(uint64_t id, uint32_t size)
+{
+    MmRpc_BufDesc   desc;
+    replay_buf      *b;
+    int             core, i;
+
+    pthread_mutex_lock(&mutex);
+    for( b = bufs; b && b->id != id; b = b->next ) {
+        ;
+    }
+    if( b == NULL && size && (b = calloc(1, sizeof(replay_buf))) != NULL ) {
+        b->id = id;
+        b->bo = omap_bo_new(dev, size, OMAP_BO_WC);
+        if( b->bo == NULL || (b->map = omap_bo_map(b->bo)) == NULL ) {
+            fprintf(stderr, "can't allocate a buffer of %u bytes\n", size);
+            exit(1);
+        }
+        memset(b->map, 0, size);
+        b->fd = omap_bo_dmabuf(b->bo);
+        desc.handle = b->fd;
+        for( core = 0; core < MAX_REMOTEDEVICES; core++ ) {
+            for( i = 0; i < DCE_MAX_CONNECTIONS; i++ ) {
+                if( conn[core][i] ) {
+                    MmRpc_use(conn[core][i], MmRpc_BufType_Handle, 1, &desc);
+                }
+            }
+        }
+        b->next = bufs;
+        bufs = b;
+    }
+    pthread_mutex_unlock(&mutex);
+    return (b);
+}
+
+/* Handle returned by the remote core for a captured engine or codec handle */
+static size_t get_handle(size_t captured)
+{
+    replay_handle   *h;
+    struct timespec abstime;
+    int             ret = 0;
+
+    if( captured == 0 ) {
+        return (0);
+    }
+    clock_gettime(CLOCK_REALTIME, &abstime);
+    abstime.tv_sec += REPLAY_HANDLE_WAIT_MS / 1000;
+
+    pthread_mutex_lock(&mutex);
+    for( ;; ) {
+        for( h = handles; h && h->captured != captured; h = h->next ) {
+            ;
+        }
+        if( h || ret == ETIMEDOUT ) {
+            break;
+        }
+        /* Not created yet by the thread opening the engine or codec */
+        ret = pthread_cond_timedwait(&handle_cond, &mutex, &abstime);
+    }
+    pthread_mutex_unlock(&mutex);
+
+    if( h == NULL ) {
+        fprintf(stderr, "no replayed handle for 0x%zx\n", captured);
+        return (captured);
+    }
+    return (h->replayed);
+}
+
+static void put_handle(size_t captured, size_t replayed)
+{
+    replay_handle   *h;
+
+    if( captured == 0 || replayed == 0 ) {
+        return;
+    }
+    pthread_mutex_lock(&mutex);
+    for( h = handles; h && h->captured != captured; h = h->next ) {
+        ;
+    }
+    if( h == NULL && (h = calloc(1, sizeof(replay_handle))) != NULL ) {
+        h->captured = captured;
+        h->next = handles;
+        handles = h;
+    }
+    if( h ) {
+        h->replayed = replayed;
+    }
+    pthread_cond_broadcast(&handle_cond);
+    pthread_mutex_unlock(&mutex);
+}
+
+/* Scalar parameter holding the engine or codec handle of a call, -1 for none */
+static int handle_param(replay_call *rc)
+{
+    if( rc->call.core == DCE_CAPTURE_CALLBACK ) {
+        return (-1);
+    }
+    switch( rc->call.fxn_id ) {
+        case DCE_RPC_ENGINE_CLOSE :
+            return (0);
+        case DCE_RPC_CODEC_CREATE :
+        case DCE_RPC_CODEC_CONTROL :
+        case DCE_RPC_CODEC_GET_VERSION :
+        case DCE_RPC_CODEC_PROCESS :
+        case DCE_RPC_CODEC_DELETE :
+        case DCE_RPC_CODEC_CONTROL_BATCH :
+            return (1);
+        default :
+            return (-1);
+    }
+}
+
+static replay_buf *call_buf(replay_call *rc, uint64_t id)
+{
+    uint32_t    i;
+
+    for( i = 0; i < rc->call.num_bufs && rc->bufs[i].desc.buf_id != id; i++ ) {
+        ;
+    }
+    return (get_buf(id, i < rc->call.num_bufs ? rc->bufs[i].desc.size : 0));
+}
+
+static void replay(replay_call *rc)
+{
+    MmRpc_FxnCtx        ctx;
+    MmRpc_Xlt           *xlt = NULL;
+    MmRpc_Param         *p;
+    MmRpc_Handle        handle;
+    replay_buf          *b;
+    replay_stats        *s;
+    dce_capture_param   *cp;
+    char                *data;
+    uint64_t            start, wait;
+    int32_t             ret = 0;
+    int                 status, mismatch, hidx = handle_param(rc);
+    uint32_t            i;
+
+    handle = rc->call.core == DCE_CAPTURE_CALLBACK ? callback : conn[rc->call.core][rc->call.conn];
+
+    /* Contents of the buffers as the remote core got them */
+    for( i = 0; i < rc->call.num_bufs; i++ ) {
+        b = get_buf(rc->bufs[i].desc.buf_id, rc->bufs[i].desc.size);
+        if( b == NULL ) {
+            fprintf(stderr, "buffer 0x%llx has no size in the capture\n", (unsigned long long)rc->bufs[i].desc.buf_id);
+            exit(1);
+        }
+        if( (uint64_t)rc->bufs[i].desc.offset + rc->bufs[i].desc.length > rc->bufs[i].desc.size ) {
+            fprintf(stderr, "corrupted capture\n");
+            exit(1);
+        }
+        memcpy(b->map + rc->bufs[i].desc.offset, rc->bufs[i].data, rc->bufs[i].desc.length);
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.fxn_id = rc->call.fxn_id;
+    ctx.num_params = rc->call.num_params;
+    for( i = 0; i < rc->call.num_params; i++ ) {
+        cp = &rc->params[i];
+        p = &ctx.params[i];
+        p->type = cp->type;
+        if( cp->type == MmRpc_ParamType_Scalar ) {
+            p->param.scalar.size = cp->size;
+            p->param.scalar.data = (int)i == hidx ? get_handle(cp->data) : cp->data;
+            continue;
+        }
+        b = call_buf(rc, cp->buf_id);
+        if( cp->type == MmRpc_ParamType_OffPtr ) {
+            p->param.offPtr.size = cp->size;
+            p->param.offPtr.base = (size_t)b->map;
+            p->param.offPtr.offset = cp->offset;
+            p->param.offPtr.handle = b->fd;
+        } else {
+            p->param.ptr.size = cp->size;
+            p->param.ptr.addr = (size_t)b->map;
+            p->param.ptr.handle = b->fd;
+        }
+    }
+
+    if( rc->call.num_xlts ) {
+        xlt = calloc(rc->call.num_xlts, sizeof(MmRpc_Xlt));
+        if( xlt == NULL ) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    ctx.num_xlts = rc->call.num_xlts;
+    ctx.xltAry = xlt;
+    for( i = 0; i < rc->call.num_xlts; i++ ) {
+        b = call_buf(rc, rc->xlts[i].buf_id);
+        cp = &rc->params[rc->xlts[i].index];
+        data = cp->type == MmRpc_ParamType_OffPtr ? call_buf(rc, cp->buf_id)->map + cp->offset
+                                                 : call_buf(rc, cp->buf_id)->map;
+        /* Pointer into the replayed buffer, translated by the MmRpc driver */
+        *(void **)(data + rc->xlts[i].offset) = b->map + rc->xlts[i].delta;
+        xlt[i].index = rc->xlts[i].index;
+        xlt[i].offset = rc->xlts[i].offset;
+        xlt[i].base = (size_t)b->map;
+        xlt[i].handle = b->fd;
+    }
+
+    if( paced ) {
+        wait = replay_start_us + (rc->call.start_us - capture_start_us);
+        start = now_us();
+        if( wait > start ) {
+            usleep(wait - start);
+        }
+    }
+    start = now_us();
+    status = MmRpc_call(handle, &ctx, &ret);
+    start = now_us() - start;
+    free(xlt);
+
+    if( rc->call.core != DCE_CAPTURE_CALLBACK &&
+        (rc->call.fxn_id == DCE_RPC_ENGINE_OPEN || rc->call.fxn_id == DCE_RPC_CODEC_CREATE) ) {
+        /* Handles differ from run to run, only their validity has to match */
+        put_handle((size_t)(uint32_t)rc->call.ret, (size_t)(uint32_t)ret);
+        mismatch = status != rc->call.status || !ret != !rc->call.ret;
+    } else {
+        mismatch = status != rc->call.status || ret != rc->call.ret;
+    }
+    if( verbose || mismatch ) {
+        printf("%s core %d conn %d fxn %u: status %d ret %d, captured status %d ret %d, %llu us (captured %u us)\n",
+               mismatch ? "MISMATCH" : "call", rc->call.core, rc->call.conn, rc->call.fxn_id, status, ret,
+               rc->call.status, rc->call.ret, (unsigned long long)start, rc->call.duration_us);
+    }
+
+    if( rc->call.fxn_id < REPLAY_MAX_FXN ) {
+        s = &stats[rc->call.core == DCE_CAPTURE_CALLBACK][rc->call.fxn_id];
+        pthread_mutex_lock(&mutex);
+        s->count++;
+        s->mismatch += mismatch;
+        s->captured_us += rc->call.duration_us;
+        s->replayed_us += start;
+        pthread_mutex_unlock(&mutex);
+    }
+}
+
+static void *replay_thread_main(void *arg)
+{
+    replay_thread   *t = arg;
+    replay_call     *rc;
+
+    for( rc = t->head; rc; rc = rc->next ) {
+        replay(rc);
+    }
+    return (NULL);
+}
+
+static const char *fxn_name(int cb, int fxn)
+{
+    static const char   *names[] = {
+        "ENGINE_OPEN", "ENGINE_CLOSE", "CODEC_CREATE", "CODEC_CONTROL", "CODEC_GET_VERSION",
+        "CODEC_PROCESS", "CODEC_DELETE", "GET_INFO", "CODEC_CONTROL_BATCH"
+    };
+    static const char   *cb_names[] = { "CALLBACK_GET_DATA", "CALLBACK_PUT_DATA", "CALLBACK_GET_BUFFER" };
+
+    if( cb ) {
+        return (fxn < 3 ? cb_names[fxn] : "CALLBACK_?");
+    }
+    return (fxn < 9 ? names[fxn] : "?");
+}
+
+int main(int argc, char **argv)
+{
+    dce_capture_header  hdr;
+    MmRpc_Params        args;
+    replay_call         *rc;
+    replay_thread       *t;
+    FILE                *f;
+    uint64_t            total_us, captured_end_us = 0;
+    uint32_t            mismatch = 0;
+    int                 opt, i, j;
+
+    while( (opt = getopt(argc, argv, "tv")) != -1 ) {
+        switch( opt ) {
+            case 't' :
+                paced = 1;
+                break;
+            case 'v' :
+                verbose = 1;
+                break;
+            default :
+                fprintf(stderr, "usage: %s [-t] [-v] file\n", argv[0]);
+                return (1);
+        }
+    }
+    if( optind != argc - 1 ) {
+        fprintf(stderr, "usage: %s [-t] [-v] file\n", argv[0]);
+        return (1);
+    }
+
+    f = fopen(argv[optind], "rb");
+    if( f == NULL || !read_all(f, &hdr, sizeof(hdr)) ) {
+        fprintf(stderr, "can't read %s\n", argv[optind]);
+        return (1);
+    }
+    if( hdr.magic != DCE_CAPTURE_MAGIC || hdr.version != DCE_CAPTURE_VERSION ) {
+        fprintf(stderr, "%s is not a libdce capture\n", argv[optind]);
+        return (1);
+    }
+    if( hdr.ptr_size != sizeof(void *) ) {
+        fprintf(stderr, "capture of a %u bit process, can't be replayed by a %u bit one\n",
+                hdr.ptr_size * 8, (unsigned)sizeof(void *) * 8);
+        return (1);
+    }
+
+    MmRpc_Params_init(&args);
+    while( (rc = read_call(f)) != NULL ) {
+        for( t = threads; t < threads + num_threads && t->thread != rc->call.thread; t++ ) {
+            ;
+        }
+        if( t == threads + num_threads ) {
+            if( num_threads == REPLAY_MAX_THREADS ) {
+                fprintf(stderr, "more than %d threads in the capture\n", REPLAY_MAX_THREADS);
+                return (1);
+            }
+            num_threads++;
+            t->thread = rc->call.thread;
+        }
+        if( t->tail ) {
+            t->tail->next = rc;
+        } else {
+            t->head = rc;
+        }
+        t->tail = rc;
+
+        if( rc->call.core == DCE_CAPTURE_CALLBACK ) {
+            if( callback == NULL && MmRpc_create(CALLBACK_NAME, &args, &callback) < 0 ) {
+                fprintf(stderr, "can't connect to %s\n", CALLBACK_NAME);
+                return (1);
+            }
+        } else if( conn[rc->call.core][rc->call.conn] == NULL &&
+                   MmRpc_create(DEVICE_NAME[rc->call.core], &args, &conn[rc->call.core][rc->call.conn]) < 0 ) {
+            fprintf(stderr, "can't connect to %s\n", DEVICE_NAME[rc->call.core]);
+            return (1);
+        }
+        if( rc->call.start_us < capture_start_us ) {
+            capture_start_us = rc->call.start_us;
+        }
+        if( rc->call.start_us + rc->call.duration_us > captured_end_us ) {
+            captured_end_us = rc->call.start_us + rc->call.duration_us;
+        }
+    }
+    fclose(f);
+    if( num_threads == 0 ) {
+        fprintf(stderr, "empty capture\n");
+        return (1);
+    }
+
+    dev = dce_init();
+    if( dev == NULL ) {
+        fprintf(stderr, "dce_init failed\n");
+        return (1);
+    }
+
+    replay_start_us = now_us();
+    for( i = 0; i < num_threads; i++ ) {
+        if( pthread_create(&threads[i].id, NULL, replay_thread_main, &threads[i]) ) {
+            fprintf(stderr, "can't create thread %d\n", i);
+            return (1);
+        }
+    }
+    for( i = 0; i < num_threads; i++ ) {
+        pthread_join(threads[i].id, NULL);
+    }
+    total_us = now_us() - replay_start_us;
+
+    printf("%-20s %8s %8s %12s %12s\n", "call", "count", "mismatch", "captured us", "replayed us");
+    for( i = 0; i < 2; i++ ) {
+        for( j = 0; j < REPLAY_MAX_FXN; j++ ) {
+            if( stats[i][j].count ) {
+                printf("%-20s %8u %8u %12llu %12llu\n", fxn_name(i, j), stats[i][j].count, stats[i][j].mismatch,
+                       (unsigned long long)(stats[i][j].captured_us / stats[i][j].count),
+                       (unsigned long long)(stats[i][j].replayed_us / stats[i][j].count));
+                mismatch += stats[i][j].mismatch;
+            }
+        }
+    }
+    printf("%d threads, %llu ms replayed (captured %llu ms), %u mismatches\n", num_threads,
+           (unsigned long long)total_us / 1000, (unsigned long long)(captured_end_us - capture_start_us) / 1000, mismatch);
+
+    for( i = 0; i < MAX_REMOTEDEVICES; i++ ) {
+        for( j = 0; j < DCE_MAX_CONNECTIONS; j++ ) {
+            if( conn[i][j] ) {
+                MmRpc_delete(&conn[i][j]);
+            }
+        }
+    }
+    if( callback ) {
+        MmRpc_delete(&callback);
+    }
+    dce_deinit(dev);
+
+    return (mismatch != 0);
+}
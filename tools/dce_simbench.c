@@ -0,0 +1,1514 @@
+/*
+ * Copyright (c) 2013, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * dce_simbench: measurements of the libdce client paths against the simulator
+ * of a build configured with --enable-simulator, run by "make simbench". Each
+ * mode creates its own VIDDEC3 instances on the simulated IVA-HD:
+ *
+ *   throughput : process calls per second of 1 up to -t threads, each thread
+ *                with its own decoder of one engine. The remote latency of
+ *                DCE_SIM_CALL_US (default 200 us) is spent outside the lock of
+ *                the simulated core, so calls of different threads overlap.
+ *   async      : VIDDEC3_processAsync() of -t decoders from a single thread,
+ *                against the same decoders one at a time. Calls of different
+ *                decoders have their own dispatchers and must overlap.
+ *   marshal    : client cost of a process call of VIDDEC3, VIDENC2 and VIDDEC2
+ *                without remote latency, with the marshalled context of the
+ *                instance reused ("cached") and rebuilt on every call by
+ *                alternating between two copies of the descriptors ("rebuilt").
+ *   pool       : calls of -t threads, each with its own engine, on a pool of
+ *                connections of the IPU for both policies. Every connection
+ *                must carry its share of the calls.
+ *   callback   : latency of the row callbacks of a low latency decoder, from
+ *                the simulated codec making a block of rows available, and
+ *                from the return of the putDataFxn callback RPC, to the
+ *                putDataFxn of the client. The rows of a frame are produced
+ *                over DCE_SIM_PROCESS_US (default 400 us). A low latency encoder
+ *                is then given rows by a thread producing a block every
+ *                GETDATA_PERIOD_US and signalling it with
+ *                dce_callback_data_ready(). Its getDataFxn must not be called
+ *                again and again while it has no rows. Last, DCE_MAX_CALLBACK_WORKERS
+ *                low latency decoders stream at the same time, each of them with
+ *                a worker, and one more is refused.
+ *   priority   : latency of the process calls of a DCE_PRIORITY_REALTIME decoder,
+ *                one every millisecond, while -t - 1 DCE_PRIORITY_BATCH decoders
+ *                keep the simulated IVA-HD busy, without a scheduler and with
+ *                dce_set_scheduler() allowing one call in flight. The realtime
+ *                p99 must be lower with the scheduler. The process calls take
+ *                DCE_SIM_PROCESS_US (default 300 us) on the core.
+ *   timeout    : VIDDEC3_processTimed() against a remote core which stopped
+ *                answering (dce_sim_stall()). The call cancelled in flight must
+ *                fail its instance and the remote instance must be deleted once
+ *                the call returns. A call cancelled while waiting for a slot of
+ *                the scheduler must never be issued. Engine_close() must not
+ *                delete a connection a cancelled call is still running on.
+ *   batch      : VIDDEC3_controlBatch() of DCE_MAX_CONTROL_BATCH commands. The
+ *                status of every command must be filled, a larger batch and
+ *                XDM_GETVERSION must be rejected. The batch is timed against
+ *                the same commands issued with VIDDEC3_control().
+ *
+ * DCE_SIM_CALL_US is 0 by default for marshal and callback, which measure the
+ * client side alone.
+ *
+ * usage: dce_simbench -m mode [-t threads] [-n calls]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <omap_drmif.h>
+#include <libdce.h>
+
+#include "dce_sim.h"
+
+#define SIMBENCH_MAX_THREADS    16
+#define SIMBENCH_WIDTH          64
+#define SIMBENCH_HEIGHT         64
+
+/* A decoder of the simulator with one input and one single planar output buffer */
+typedef struct {
+    VIDDEC3_Handle      codec;
+    VIDDEC3_InArgs      *inArgs;
+    VIDDEC3_OutArgs     *outArgs;
+    XDM2_BufDesc        *inBufs;
+    XDM2_BufDesc        *outBufs;
+    struct omap_bo      *in;
+    struct omap_bo      *out;
+    size_t              fd[2];      /* locked dma-buf fds of in and out */
+} sim_decoder;
+
+static struct omap_device   *dev;
+static int                  calls = 2000;
+
+static inline uint64_t now_us(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000);
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t    x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return ((x > y) - (x < y));
+}
+
+static struct omap_bo *decoder_buf(int size, XDM2_SingleBufDesc *desc, size_t *fd)
+{
+    struct omap_bo  *bo = omap_bo_new(dev, size, OMAP_BO_WC);
+
+    if( bo == NULL ) {
+        return (NULL);
+    }
+    memset(omap_bo_map(bo), 0x80, size);
+    *fd = omap_bo_dmabuf(bo);
+    dce_buf_lock(1, fd);
+    desc->buf = (XDAS_Int8 *)(intptr_t)*fd;
+    desc->memType = XDM_MEMTYPE_RAW;
+    desc->bufSize.bytes = size;
+    return (bo);
+}
+
+static void decoder_close(sim_decoder *d)
+{
+    if( d->codec ) {
+        VIDDEC3_delete(d->codec);
+    }
+    if( d->in ) {
+        dce_buf_unlock(1, &d->fd[0]);
+        close(d->fd[0]);
+        omap_bo_del(d->in);
+    }
+    if( d->out ) {
+        dce_buf_unlock(1, &d->fd[1]);
+        close(d->fd[1]);
+        omap_bo_del(d->out);
+    }
+    dce_free(d->inArgs);
+    dce_free(d->outArgs);
+    dce_free(d->inBufs);
+    dce_free(d->outBufs);
+    memset(d, 0, sizeof(sim_decoder));
+}
+
+static int decoder_open(sim_decoder *d, Engine_Handle engine, int row_mode)
+{
+    VIDDEC3_Params  *params;
+    int             luma = SIMBENCH_WIDTH * SIMBENCH_HEIGHT;
+
+    memset(d, 0, sizeof(sim_decoder));
+    params = dce_alloc(sizeof(VIDDEC3_Params));
+    d->inArgs = dce_alloc(sizeof(VIDDEC3_InArgs));
+    d->outArgs = dce_alloc(sizeof(VIDDEC3_OutArgs));
+    d->inBufs = dce_alloc(sizeof(XDM2_BufDesc));
+    d->outBufs = dce_alloc(sizeof(XDM2_BufDesc));
+    if( !params || !d->inArgs || !d->outArgs || !d->inBufs || !d->outBufs ) {
+        fprintf(stderr, "dce_alloc failed\n");
+        goto FAIL;
+    }
+
+    memset(params, 0, sizeof(VIDDEC3_Params));
+    params->size = sizeof(VIDDEC3_Params);
+    params->maxWidth = SIMBENCH_WIDTH;
+    params->maxHeight = SIMBENCH_HEIGHT;
+    params->maxFrameRate = 30000;
+    params->maxBitRate = 10000000;
+    params->dataEndianness = XDM_BYTE;
+    params->forceChromaFormat = XDM_YUV_420SP;
+    params->operatingMode = IVIDEO_DECODE_ONLY;
+    params->displayDelay = IVIDDEC3_DISPLAY_DELAY_AUTO;
+    params->displayBufsMode = IVIDDEC3_DISPLAYBUFS_EMBEDDED;
+    params->inputDataMode = IVIDEO_ENTIREFRAME;
+    params->outputDataMode = row_mode ? IVIDEO_NUMROWS : IVIDEO_ENTIREFRAME;
+    params->errorInfoMode = IVIDEO_ERRORINFO_OFF;
+    d->codec = VIDDEC3_create(engine, "ivahd_h264dec", params);
+    dce_free(params);
+    params = NULL;
+    if( d->codec == NULL ) {
+        fprintf(stderr, "VIDDEC3_create failed\n");
+        goto FAIL;
+    }
+
+    d->inBufs->numBufs = 1;
+    d->in = decoder_buf(luma, &d->inBufs->descs[0], &d->fd[0]);
+    /* Luma and chroma in one buffer, see process() */
+    d->outBufs->numBufs = 2;
+    d->out = decoder_buf(luma * 3 / 2, &d->outBufs->descs[0], &d->fd[1]);
+    if( !d->in || !d->out ) {
+        fprintf(stderr, "buffer allocation failed\n");
+        goto FAIL;
+    }
+    d->outBufs->descs[1] = d->outBufs->descs[0];
+    d->outBufs->descs[0].bufSize.bytes = luma;
+    d->outBufs->descs[1].bufSize.bytes = luma / 2;
+    d->inArgs->size = sizeof(VIDDEC3_InArgs);
+    d->outArgs->size = sizeof(VIDDEC3_OutArgs);
+    d->inArgs->numBytes = luma;
+    d->inArgs->inputID = 1;
+    return (0);
+
+FAIL:
+    dce_free(params);
+    decoder_close(d);
+    return (-1);
+}
+
+static int decoder_process(sim_decoder *d)
+{
+    /* process() advances the chroma descriptor of a single planar buffer */
+    d->outBufs->descs[1].buf = d->outBufs->descs[0].buf;
+    return (VIDDEC3_process(d->codec, d->inBufs, d->outBufs, d->inArgs, d->outArgs) == VIDDEC3_EOK ? 0 : -1);
+}
+
+/***************** throughput ****************/
+/* A thread issuing process calls on its own decoder */
+typedef struct {
+    sim_decoder         dec;
+    pthread_barrier_t   *start;
+    int                 failed;
+} bench_thread;
+
+static void *bench_thread_run(void *arg)
+{
+    bench_thread    *t = arg;
+    int             i;
+
+    pthread_barrier_wait(t->start);
+    for( i = 0; i < calls && !t->failed; i++ ) {
+        t->failed = decoder_process(&t->dec);
+    }
+    return (NULL);
+}
+
+/* Run n threads with open decoders concurrently, calls per second of all of them */
+static double bench_threads(bench_thread *t, int n, int *failed)
+{
+    pthread_t           thread[SIMBENCH_MAX_THREADS];
+    pthread_barrier_t   start;
+    uint64_t            begin;
+    int                 i;
+
+    pthread_barrier_init(&start, NULL, n + 1);
+    for( i = 0; i < n; i++ ) {
+        t[i].start = &start;
+        pthread_create(&thread[i], NULL, bench_thread_run, &t[i]);
+    }
+    pthread_barrier_wait(&start);
+    begin = now_us();
+    for( i = 0; i < n; i++ ) {
+        pthread_join(thread[i], NULL);
+        *failed |= t[i].failed;
+    }
+    pthread_barrier_destroy(&start);
+    return ((double)n * calls * 1000000.0 / (now_us() - begin));
+}
+
+static int throughput(int max_threads)
+{
+    bench_thread    t[SIMBENCH_MAX_THREADS];
+    Engine_Handle   engine;
+    Engine_Error    ec;
+    double          rate;
+    int             n, i, failed = 0;
+
+    /* One engine: the clients of a core are limited by its quota */
+    engine = Engine_open("ivahd_vidsvr", NULL, &ec);
+    if( engine == NULL ) {
+        fprintf(stderr, "Engine_open failed\n");
+        return (1);
+    }
+    printf("throughput: %d process calls per thread\n", calls);
+    memset(t, 0, sizeof(t));
+    for( n = 1; n <= max_threads && !failed; n *= 2 ) {
+        for( i = 0; i < n; i++ ) {
+            t[i].failed = decoder_open(&t[i].dec, engine, 0);
+            failed |= t[i].failed;
+        }
+        if( !failed ) {
+            rate = bench_threads(t, n, &failed);
+            printf("  %2d thread(s): %8.0f calls/s\n", n, rate);
+        }
+        for( i = 0; i < n; i++ ) {
+            decoder_close(&t[i].dec);
+        }
+    }
+    Engine_close(engine);
+    return (failed);
+}
+
+/***************** pool ****************/
+#define POOL_SIZE   4
+
+/* n threads with an engine each on a pool of POOL_SIZE connections of the IPU */
+static int pool_run(const char *title, dce_pool_policy policy, int n)
+{
+    bench_thread    t[SIMBENCH_MAX_THREADS];
+    Engine_Handle   engine[SIMBENCH_MAX_THREADS];
+    Engine_Error    ec;
+    uint32_t        before[DCE_MAX_CONNECTIONS], after[DCE_MAX_CONNECTIONS];
+    double          rate;
+    int             i, conns = 0, failed = 0;
+
+    if( dce_set_connection_pool(0, POOL_SIZE, policy) != DCE_EOK ) {
+        fprintf(stderr, "dce_set_connection_pool failed\n");
+        return (1);
+    }
+    memset(t, 0, sizeof(t));
+    memset(engine, 0, sizeof(engine));
+    for( i = 0; i < n && !failed; i++ ) {
+        engine[i] = Engine_open("ivahd_vidsvr", NULL, &ec);
+        failed = engine[i] == NULL || decoder_open(&t[i].dec, engine[i], 0);
+    }
+    if( !failed ) {
+        conns = dce_sim_connection_calls(0, before, DCE_MAX_CONNECTIONS);
+        rate = bench_threads(t, n, &failed);
+        dce_sim_connection_calls(0, after, DCE_MAX_CONNECTIONS);
+        printf("  %-12s %8.0f calls/s, per connection:", title, rate);
+        for( i = 0; i < conns && i < DCE_MAX_CONNECTIONS; i++ ) {
+            printf(" %u", after[i] - before[i]);
+            /* Each connection has n / POOL_SIZE engines bound */
+            if( after[i] - before[i] < (uint32_t)calls ) {
+                failed = 1;
+            }
+        }
+        printf("\n");
+        if( conns != POOL_SIZE || failed ) {
+            fprintf(stderr, "%s: calls are not distributed over the %d connections\n", title, POOL_SIZE);
+            failed = 1;
+        }
+    }
+    for( i = 0; i < n; i++ ) {
+        decoder_close(&t[i].dec);
+        if( engine[i] ) {
+            Engine_close(engine[i]);
+        }
+    }
+    return (failed);
+}
+
+static int pool(int n)
+{
+    int     failed;
+
+    if( n < POOL_SIZE ) {
+        fprintf(stderr, "pool needs at least %d threads\n", POOL_SIZE);
+        return (1);
+    }
+    printf("pool: %d threads, %d process calls per thread, %d connections\n", n, calls, POOL_SIZE);
+    failed = pool_run("round-robin", DCE_POOL_ROUND_ROBIN, n);
+    failed |= pool_run("least-loaded", DCE_POOL_LEAST_LOADED, n);
+    dce_set_connection_pool(0, 1, DCE_POOL_ROUND_ROBIN);
+    return (failed);
+}
+
+/***************** async ****************/
+/* Rounds of one asynchronous call on each of n decoders, calls per second */
+static double async_rounds(sim_decoder *dec, int n, int *failed)
+{
+    uint64_t    begin = now_us();
+    int         i, j;
+
+    for( i = 0; i < calls && !*failed; i++ ) {
+        for( j = 0; j < n; j++ ) {
+            dec[j].outBufs->descs[1].buf = dec[j].outBufs->descs[0].buf;
+            *failed |= VIDDEC3_processAsync(dec[j].codec, dec[j].inBufs, dec[j].outBufs,
+                                            dec[j].inArgs, dec[j].outArgs) != VIDDEC3_EOK;
+        }
+        for( j = 0; j < n; j++ ) {
+            *failed |= VIDDEC3_processWait(dec[j].codec, dec[j].inBufs, dec[j].outBufs,
+                                           dec[j].inArgs, dec[j].outArgs, VISA_FOREVER) != VIDDEC3_EOK;
+        }
+    }
+    return ((double)n * calls * 1000000.0 / (now_us() - begin));
+}
+
+static int async(int n)
+{
+    sim_decoder     dec[SIMBENCH_MAX_THREADS];
+    Engine_Handle   engine;
+    Engine_Error    ec;
+    double          one, all;
+    int             i, failed = 0;
+
+    engine = Engine_open("ivahd_vidsvr", NULL, &ec);
+    if( engine == NULL ) {
+        fprintf(stderr, "Engine_open failed\n");
+        return (1);
+    }
+    memset(dec, 0, sizeof(dec));
+    for( i = 0; i < n; i++ ) {
+        failed |= decoder_open(&dec[i], engine, 0);
+    }
+    if( !failed ) {
+        one = async_rounds(dec, 1, &failed);
+        all = async_rounds(dec, n, &failed);
+        printf("async: %d process calls per decoder\n", calls);
+        printf("   1 decoder   : %8.0f calls/s\n", one);
+        printf("  %2d decoders  : %8.0f calls/s (%.1fx)\n", n, all, all / one);
+        /* Serialized calls would not be faster than a single decoder */
+        if( !failed && n > 1 && all < one * 1.5 ) {
+            fprintf(stderr, "async calls of different decoders do not overlap\n");
+            failed = 1;
+        }
+    }
+    for( i = 0; i < n; i++ ) {
+        decoder_close(&dec[i]);
+    }
+    Engine_close(engine);
+    return (failed);
+}
+
+/***************** marshal ****************/
+#define MARSHAL_BUFS    3
+#define MARSHAL_SIZE    4096
+
+typedef enum {
+    MARSHAL_VIDDEC3,
+    MARSHAL_VIDENC2,
+    MARSHAL_VIDDEC2     /* on the DSP */
+} marshal_kind;
+
+/* A codec with two copies of its descriptors referring to the same buffers */
+typedef struct {
+    const char      *title;
+    marshal_kind    kind;
+    void            *codec;
+    void            *inBufs[2];
+    void            *outBufs[2];
+    void            *inArgs;
+    void            *outArgs;
+    XDAS_Int8       **bufs[2];      /* VIDDEC2 output buffer pointers */
+    XDAS_Int32      *bufSizes[2];
+    struct omap_bo  *bo[MARSHAL_BUFS];
+    size_t          fd[MARSHAL_BUFS];
+} marshal_codec;
+
+static int marshal_bufs(marshal_codec *m)
+{
+    int     i;
+
+    for( i = 0; i < MARSHAL_BUFS; i++ ) {
+        m->bo[i] = omap_bo_new(dev, MARSHAL_SIZE, OMAP_BO_WC);
+        if( m->bo[i] == NULL ) {
+            return (-1);
+        }
+        memset(omap_bo_map(m->bo[i]), 0x80, MARSHAL_SIZE);
+        m->fd[i] = omap_bo_dmabuf(m->bo[i]);
+        if( m->kind == MARSHAL_VIDDEC2 ) {
+            dsp_dce_buf_lock(1, &m->fd[i]);
+        } else {
+            dce_buf_lock(1, &m->fd[i]);
+        }
+    }
+    return (0);
+}
+
+static inline void marshal_desc(XDM2_SingleBufDesc *desc, size_t fd)
+{
+    desc->buf = (XDAS_Int8 *)(intptr_t)fd;
+    desc->memType = XDM_MEMTYPE_RAW;
+    desc->bufSize.bytes = MARSHAL_SIZE;
+}
+
+/* One input buffer, luma and chroma output buffers */
+static int marshal_viddec3(marshal_codec *m, Engine_Handle engine)
+{
+    VIDDEC3_Params  *params = dce_alloc(sizeof(VIDDEC3_Params));
+    XDM2_BufDesc    *in, *out;
+    int             i;
+
+    if( params == NULL ) {
+        return (-1);
+    }
+    memset(params, 0, sizeof(VIDDEC3_Params));
+    params->size = sizeof(VIDDEC3_Params);
+    params->maxWidth = SIMBENCH_WIDTH;
+    params->maxHeight = SIMBENCH_HEIGHT;
+    params->maxFrameRate = 30000;
+    params->maxBitRate = 10000000;
+    params->dataEndianness = XDM_BYTE;
+    params->forceChromaFormat = XDM_YUV_420SP;
+    params->operatingMode = IVIDEO_DECODE_ONLY;
+    params->displayDelay = IVIDDEC3_DISPLAY_DELAY_AUTO;
+    params->displayBufsMode = IVIDDEC3_DISPLAYBUFS_EMBEDDED;
+    params->inputDataMode = IVIDEO_ENTIREFRAME;
+    params->outputDataMode = IVIDEO_ENTIREFRAME;
+    m->codec = VIDDEC3_create(engine, "ivahd_h264dec", params);
+    dce_free(params);
+
+    m->inArgs = dce_alloc(sizeof(VIDDEC3_InArgs));
+    m->outArgs = dce_alloc(sizeof(VIDDEC3_OutArgs));
+    if( !m->codec || !m->inArgs || !m->outArgs ) {
+        return (-1);
+    }
+    ((VIDDEC3_InArgs *)m->inArgs)->size = sizeof(VIDDEC3_InArgs);
+    ((VIDDEC3_InArgs *)m->inArgs)->numBytes = MARSHAL_SIZE;
+    ((VIDDEC3_InArgs *)m->inArgs)->inputID = 1;
+    ((VIDDEC3_OutArgs *)m->outArgs)->size = sizeof(VIDDEC3_OutArgs);
+    for( i = 0; i < 2; i++ ) {
+        m->inBufs[i] = in = dce_alloc(sizeof(XDM2_BufDesc));
+        m->outBufs[i] = out = dce_alloc(sizeof(XDM2_BufDesc));
+        if( !in || !out ) {
+            return (-1);
+        }
+        in->numBufs = 1;
+        marshal_desc(&in->descs[0], m->fd[0]);
+        out->numBufs = 2;
+        marshal_desc(&out->descs[0], m->fd[1]);
+        marshal_desc(&out->descs[1], m->fd[2]);
+    }
+    return (0);
+}
+
+/* Luma and chroma input planes, one output buffer */
+static int marshal_videnc2(marshal_codec *m, Engine_Handle engine)
+{
+    VIDENC2_Params  *params = dce_alloc(sizeof(VIDENC2_Params));
+    IVIDEO2_BufDesc *in;
+    XDM2_BufDesc    *out;
+    int             i;
+
+    if( params == NULL ) {
+        return (-1);
+    }
+    memset(params, 0, sizeof(VIDENC2_Params));
+    params->size = sizeof(VIDENC2_Params);
+    params->encodingPreset = XDM_USER_DEFINED;
+    params->rateControlPreset = IVIDEO_USER_DEFINED;
+    params->maxHeight = SIMBENCH_HEIGHT;
+    params->maxWidth = SIMBENCH_WIDTH;
+    params->dataEndianness = XDM_BYTE;
+    params->maxBitRate = -1;
+    params->minBitRate = 0;
+    params->inputChromaFormat = XDM_YUV_420SP;
+    params->inputContentType = IVIDEO_PROGRESSIVE;
+    params->operatingMode = IVIDEO_ENCODE_ONLY;
+    params->inputDataMode = IVIDEO_ENTIREFRAME;
+    params->outputDataMode = IVIDEO_ENTIREFRAME;
+    params->numInputDataUnits = 1;
+    params->numOutputDataUnits = 1;
+    m->codec = VIDENC2_create(engine, "ivahd_h264enc", params);
+    dce_free(params);
+
+    m->inArgs = dce_alloc(sizeof(VIDENC2_InArgs));
+    m->outArgs = dce_alloc(sizeof(VIDENC2_OutArgs));
+    if( !m->codec || !m->inArgs || !m->outArgs ) {
+        return (-1);
+    }
+    ((VIDENC2_InArgs *)m->inArgs)->size = sizeof(VIDENC2_InArgs);
+    ((VIDENC2_InArgs *)m->inArgs)->inputID = 1;
+    ((VIDENC2_OutArgs *)m->outArgs)->size = sizeof(VIDENC2_OutArgs);
+    for( i = 0; i < 2; i++ ) {
+        m->inBufs[i] = in = dce_alloc(sizeof(IVIDEO2_BufDesc));
+        m->outBufs[i] = out = dce_alloc(sizeof(XDM2_BufDesc));
+        if( !in || !out ) {
+            return (-1);
+        }
+        memset(in, 0, sizeof(IVIDEO2_BufDesc));
+        in->numPlanes = 2;
+        marshal_desc(&in->planeDesc[0], m->fd[0]);
+        marshal_desc(&in->planeDesc[1], m->fd[1]);
+        out->numBufs = 1;
+        marshal_desc(&out->descs[0], m->fd[2]);
+    }
+    return (0);
+}
+
+/* One input buffer, luma and chroma output buffers through pointer arrays */
+static int marshal_viddec2(marshal_codec *m, Engine_Handle engine)
+{
+    VIDDEC2_Params  *params = dce_alloc(sizeof(VIDDEC2_Params));
+    XDM1_BufDesc    *in;
+    XDM_BufDesc     *out;
+    int             i;
+
+    if( params == NULL ) {
+        return (-1);
+    }
+    memset(params, 0, sizeof(VIDDEC2_Params));
+    params->size = sizeof(VIDDEC2_Params);
+    params->maxWidth = SIMBENCH_WIDTH;
+    params->maxHeight = SIMBENCH_HEIGHT;
+    params->maxFrameRate = 30000;
+    params->maxBitRate = 10000000;
+    params->dataEndianness = XDM_BYTE;
+    params->forceChromaFormat = XDM_YUV_420SP;
+    m->codec = VIDDEC2_create(engine, "dsp_universalCopy", params);
+    dce_free(params);
+
+    m->inArgs = dce_alloc(sizeof(VIDDEC2_InArgs));
+    m->outArgs = dce_alloc(sizeof(VIDDEC2_OutArgs));
+    if( !m->codec || !m->inArgs || !m->outArgs ) {
+        return (-1);
+    }
+    ((VIDDEC2_InArgs *)m->inArgs)->size = sizeof(VIDDEC2_InArgs);
+    ((VIDDEC2_InArgs *)m->inArgs)->numBytes = MARSHAL_SIZE;
+    ((VIDDEC2_InArgs *)m->inArgs)->inputID = 1;
+    ((VIDDEC2_OutArgs *)m->outArgs)->size = sizeof(VIDDEC2_OutArgs);
+    for( i = 0; i < 2; i++ ) {
+        m->inBufs[i] = in = dce_alloc(sizeof(XDM1_BufDesc));
+        m->outBufs[i] = out = dce_alloc(sizeof(XDM_BufDesc));
+        m->bufs[i] = dce_alloc(2 * sizeof(XDAS_Int8 *));
+        m->bufSizes[i] = dce_alloc(2 * sizeof(XDAS_Int32));
+        if( !in || !out || !m->bufs[i] || !m->bufSizes[i] ) {
+            return (-1);
+        }
+        memset(in, 0, sizeof(XDM1_BufDesc));
+        in->numBufs = 1;
+        in->descs[0].buf = (XDAS_Int8 *)(intptr_t)m->fd[0];
+        in->descs[0].bufSize = MARSHAL_SIZE;
+        m->bufs[i][0] = (XDAS_Int8 *)(intptr_t)m->fd[1];
+        m->bufs[i][1] = (XDAS_Int8 *)(intptr_t)m->fd[2];
+        m->bufSizes[i][0] = m->bufSizes[i][1] = MARSHAL_SIZE;
+        out->numBufs = 2;
+        out->bufs = m->bufs[i];
+        out->bufSizes = m->bufSizes[i];
+    }
+    return (0);
+}
+
+static int marshal_call(marshal_codec *m, int set)
+{
+    XDAS_Int32  ret;
+
+    if( m->kind == MARSHAL_VIDDEC3 ) {
+        ret = VIDDEC3_process(m->codec, m->inBufs[set], m->outBufs[set], m->inArgs, m->outArgs);
+    } else if( m->kind == MARSHAL_VIDENC2 ) {
+        ret = VIDENC2_process(m->codec, m->inBufs[set], m->outBufs[set], m->inArgs, m->outArgs);
+    } else {
+        ret = VIDDEC2_process(m->codec, m->inBufs[set], m->outBufs[set], m->inArgs, m->outArgs);
+    }
+    return (ret == XDM_EOK ? 0 : -1);
+}
+
+/* Mean duration of a call in ns, the descriptors alternate between both copies if rebuild */
+static double marshal_run(marshal_codec *m, int rebuild, int *failed)
+{
+    uint64_t    begin;
+    int         i;
+
+    /* Warm up the context and the buffer registrations */
+    *failed |= marshal_call(m, 0) | marshal_call(m, 1) | marshal_call(m, 0);
+    begin = now_us();
+    for( i = 0; i < calls && !*failed; i++ ) {
+        *failed |= marshal_call(m, rebuild ? (i & 1) : 0);
+    }
+    return ((double)(now_us() - begin) * 1000.0 / calls);
+}
+
+static void marshal_close(marshal_codec *m)
+{
+    int     i;
+
+    if( m->codec && m->kind == MARSHAL_VIDDEC3 ) {
+        VIDDEC3_delete(m->codec);
+    } else if( m->codec && m->kind == MARSHAL_VIDENC2 ) {
+        VIDENC2_delete(m->codec);
+    } else if( m->codec ) {
+        VIDDEC2_delete(m->codec);
+    }
+    for( i = 0; i < 2; i++ ) {
+        dce_free(m->inBufs[i]);
+        dce_free(m->outBufs[i]);
+        dce_free(m->bufs[i]);
+        dce_free(m->bufSizes[i]);
+    }
+    dce_free(m->inArgs);
+    dce_free(m->outArgs);
+    for( i = 0; i < MARSHAL_BUFS && m->bo[i]; i++ ) {
+        if( m->kind == MARSHAL_VIDDEC2 ) {
+            dsp_dce_buf_unlock(1, &m->fd[i]);
+        } else {
+            dce_buf_unlock(1, &m->fd[i]);
+        }
+        close(m->fd[i]);
+        omap_bo_del(m->bo[i]);
+    }
+}
+
+static int marshal(void)
+{
+    static const struct {
+        const char  *title;
+        const char  *engine;
+        int         (*create)(marshal_codec *m, Engine_Handle engine);
+    } codecs[] = {     /* in marshal_kind order */
+        { "VIDDEC3", "ivahd_vidsvr", marshal_viddec3 },
+        { "VIDENC2", "ivahd_vidsvr", marshal_videnc2 },
+        { "VIDDEC2", "dsp_vidsvr", marshal_viddec2 },
+    };
+    marshal_codec   m;
+    Engine_Handle   engine;
+    Engine_Error    ec;
+    double          cached, rebuilt;
+    int             i, failed = 0;
+
+    printf("marshal: %d process calls, ns per call\n", calls);
+    for( i = 0; i < (int)(sizeof(codecs) / sizeof(codecs[0])) && !failed; i++ ) {
+        memset(&m, 0, sizeof(m));
+        m.title = codecs[i].title;
+        m.kind = (marshal_kind)i;
+        engine = Engine_open((String)codecs[i].engine, NULL, &ec);
+        if( engine == NULL || marshal_bufs(&m) || codecs[i].create(&m, engine) ) {
+            fprintf(stderr, "%s: setup failed\n", m.title);
+            failed = 1;
+        } else {
+            cached = marshal_run(&m, 0, &failed);
+            rebuilt = marshal_run(&m, 1, &failed);
+            printf("  %s  cached %8.0f  rebuilt %8.0f  saved %6.0f\n", m.title, cached, rebuilt, rebuilt - cached);
+        }
+        marshal_close(&m);
+        if( engine ) {
+            Engine_close(engine);
+        }
+    }
+    return (failed);
+}
+
+/***************** callback ****************/
+static int          callback_blocks = 0;
+static uint32_t     *callback_latency;  /* from the block to the client, one per block */
+
+/* Runs on a callback worker, one block at a time */
+static Void callback_put(XDM_DataSyncHandle handle, XDM_DataSyncDesc *desc)
+{
+    uint64_t    ready = dce_sim_row_time_us();
+
+    if( callback_blocks < calls * SIMBENCH_HEIGHT / 16 ) {
+        callback_latency[callback_blocks] = (uint32_t)(now_us() - ready);
+    }
+    callback_blocks += desc->numBlocks;
+}
+
+/* Give a low latency decoder the putDataFxn of the client */
+static int callback_control(sim_decoder *d, XDM_DataSyncPutFxn put)
+{
+    VIDDEC3_DynamicParams   *dynParams = dce_alloc(sizeof(VIDDEC3_DynamicParams));
+    VIDDEC3_Status          *status = dce_alloc(sizeof(VIDDEC3_Status));
+    int                     failed = 1;
+
+    if( dynParams && status ) {
+        memset(dynParams, 0, sizeof(VIDDEC3_DynamicParams));
+        memset(status, 0, sizeof(VIDDEC3_Status));
+        dynParams->size = sizeof(VIDDEC3_DynamicParams);
+        dynParams->decodeHeader = XDM_DECODE_AU;
+        dynParams->frameSkipMode = IVIDEO_NO_SKIP;
+        dynParams->newFrameFlag = XDAS_TRUE;
+        dynParams->putDataFxn = put;
+        dynParams->putDataHandle = NULL;
+        status->size = sizeof(VIDDEC3_Status);
+        failed = VIDDEC3_control(d->codec, XDM_SETPARAMS, dynParams, status) != VIDDEC3_EOK;
+    }
+    dce_free(dynParams);
+    dce_free(status);
+    return (failed);
+}
+
+/* Low latency decoders streaming at the same time, each of them needs a worker */
+static int          callback_many_blocks = 0;
+static int          callback_many_frames;
+
+/* Runs on the callback workers of all the decoders */
+static Void callback_count(XDM_DataSyncHandle handle, XDM_DataSyncDesc *desc)
+{
+    __atomic_add_fetch(&callback_many_blocks, desc->numBlocks, __ATOMIC_RELAXED);
+}
+
+static void *callback_many_run(void *arg)
+{
+    bench_thread    *t = arg;
+    int             i;
+
+    pthread_barrier_wait(t->start);
+    for( i = 0; i < callback_many_frames && !t->failed; i++ ) {
+        t->failed = decoder_process(&t->dec);
+    }
+    return (NULL);
+}
+
+static int callback_many(Engine_Handle engine)
+{
+    bench_thread        t[DCE_MAX_CALLBACK_WORKERS];
+    pthread_t           thread[DCE_MAX_CALLBACK_WORKERS];
+    pthread_barrier_t   start;
+    sim_decoder         extra;
+    uint64_t            begin;
+    int                 i, n = 0, expected, failed = 0;
+
+    callback_many_frames = calls / 10 > 0 ? calls / 10 : 1;
+    expected = DCE_MAX_CALLBACK_WORKERS * callback_many_frames * SIMBENCH_HEIGHT / 16;
+    memset(t, 0, sizeof(t));
+    for( ; n < DCE_MAX_CALLBACK_WORKERS && !failed; n++ ) {
+        failed = decoder_open(&t[n].dec, engine, 1) || callback_control(&t[n].dec, callback_count);
+    }
+    /* One more would wait for a worker until its rows time out */
+    if( !failed && decoder_open(&extra, engine, 1) == 0 ) {
+        fprintf(stderr, "callback: low latency decoder %d was not refused\n", n + 1);
+        decoder_close(&extra);
+        failed = 1;
+    }
+
+    if( !failed ) {
+        pthread_barrier_init(&start, NULL, n + 1);
+        for( i = 0; i < n; i++ ) {
+            t[i].start = &start;
+            pthread_create(&thread[i], NULL, callback_many_run, &t[i]);
+        }
+        pthread_barrier_wait(&start);
+        begin = now_us();
+        for( i = 0; i < n; i++ ) {
+            pthread_join(thread[i], NULL);
+            failed |= t[i].failed;
+        }
+        pthread_barrier_destroy(&start);
+        printf("  %d decoders %d blocks delivered in %u us\n", n, callback_many_blocks,
+               (unsigned int)(now_us() - begin));
+        if( failed || callback_many_blocks != expected ) {
+            fprintf(stderr, "callback: %d blocks expected from %d decoders, %d delivered\n",
+                    expected, n, callback_many_blocks);
+            failed = 1;
+        }
+    }
+
+    for( i = 0; i < n; i++ ) {
+        decoder_close(&t[i].dec);
+    }
+    return (failed);
+}
+
+/* Encoder rows, handed out by getdata_get() as getdata_produce() makes them */
+#define GETDATA_PERIOD_US   200
+
+static pthread_mutex_t  getdata_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int              getdata_ready;  /* blocks produced and not handed out */
+static int              getdata_calls;
+static int              getdata_empty;  /* getDataFxn calls without rows */
+static VIDENC2_Handle   getdata_codec;
+
+/* Runs on a callback worker */
+static XDAS_Int32 getdata_get(XDM_DataSyncHandle handle, XDM_DataSyncDesc *desc)
+{
+    pthread_mutex_lock(&getdata_mutex);
+    getdata_calls++;
+    getdata_empty += (getdata_ready == 0);
+    desc->numBlocks = getdata_ready;
+    getdata_ready = 0;
+    pthread_mutex_unlock(&getdata_mutex);
+    return (0);
+}
+
+static void *getdata_produce(void *arg)
+{
+    int     i, n = *(int *)arg;
+
+    for( i = 0; i < n; i++ ) {
+        usleep(GETDATA_PERIOD_US);
+        pthread_mutex_lock(&getdata_mutex);
+        getdata_ready++;
+        pthread_mutex_unlock(&getdata_mutex);
+        dce_callback_data_ready(getdata_codec);
+    }
+    return (NULL);
+}
+
+static int callback_encoder(Engine_Handle engine)
+{
+    VIDENC2_Params          *params = dce_alloc(sizeof(VIDENC2_Params));
+    VIDENC2_DynamicParams   *dynParams = dce_alloc(sizeof(VIDENC2_DynamicParams));
+    VIDENC2_Status          *status = dce_alloc(sizeof(VIDENC2_Status));
+    VIDENC2_InArgs          *inArgs = dce_alloc(sizeof(VIDENC2_InArgs));
+    VIDENC2_OutArgs         *outArgs = dce_alloc(sizeof(VIDENC2_OutArgs));
+    IVIDEO2_BufDesc         *inBufs = dce_alloc(sizeof(IVIDEO2_BufDesc));
+    XDM2_BufDesc            *outBufs = dce_alloc(sizeof(XDM2_BufDesc));
+    struct omap_bo          *in = NULL, *out = NULL;
+    size_t                  fd[2];
+    pthread_t               producer;
+    uint64_t                start;
+    int                     i, blocks = calls * SIMBENCH_HEIGHT / 16, failed = 1;
+
+    if( !params || !dynParams || !status || !inArgs || !outArgs || !inBufs || !outBufs ) {
+        fprintf(stderr, "dce_alloc failed\n");
+        goto EXIT;
+    }
+    memset(params, 0, sizeof(VIDENC2_Params));
+    params->size = sizeof(VIDENC2_Params);
+    params->encodingPreset = XDM_USER_DEFINED;
+    params->rateControlPreset = IVIDEO_USER_DEFINED;
+    params->maxHeight = SIMBENCH_HEIGHT;
+    params->maxWidth = SIMBENCH_WIDTH;
+    params->dataEndianness = XDM_BYTE;
+    params->maxBitRate = -1;
+    params->inputChromaFormat = XDM_YUV_420SP;
+    params->inputContentType = IVIDEO_PROGRESSIVE;
+    params->operatingMode = IVIDEO_ENCODE_ONLY;
+    params->inputDataMode = IVIDEO_NUMROWS;
+    params->outputDataMode = IVIDEO_ENTIREFRAME;
+    params->numInputDataUnits = 1;
+    params->numOutputDataUnits = 1;
+    getdata_codec = VIDENC2_create(engine, "ivahd_h264enc", params);
+    if( getdata_codec == NULL ) {
+        fprintf(stderr, "VIDENC2_create failed\n");
+        goto EXIT;
+    }
+
+    memset(dynParams, 0, sizeof(VIDENC2_DynamicParams));
+    memset(status, 0, sizeof(VIDENC2_Status));
+    dynParams->size = sizeof(VIDENC2_DynamicParams);
+    dynParams->getDataFxn = getdata_get;
+    dynParams->getDataHandle = NULL;
+    status->size = sizeof(VIDENC2_Status);
+    if( VIDENC2_control(getdata_codec, XDM_SETPARAMS, dynParams, status) != VIDENC2_EOK ) {
+        fprintf(stderr, "VIDENC2_control failed\n");
+        goto EXIT;
+    }
+
+    memset(inBufs, 0, sizeof(IVIDEO2_BufDesc));
+    memset(outBufs, 0, sizeof(XDM2_BufDesc));
+    inBufs->numPlanes = 1;
+    in = decoder_buf(SIMBENCH_WIDTH * SIMBENCH_HEIGHT, &inBufs->planeDesc[0], &fd[0]);
+    outBufs->numBufs = 1;
+    out = decoder_buf(SIMBENCH_WIDTH * SIMBENCH_HEIGHT, &outBufs->descs[0], &fd[1]);
+    if( !in || !out ) {
+        fprintf(stderr, "buffer allocation failed\n");
+        goto EXIT;
+    }
+    inArgs->size = sizeof(VIDENC2_InArgs);
+    inArgs->inputID = 1;
+    outArgs->size = sizeof(VIDENC2_OutArgs);
+
+    failed = 0;
+    start = now_us();
+    pthread_create(&producer, NULL, getdata_produce, &blocks);
+    for( i = 0; i < calls && !failed; i++ ) {
+        failed = VIDENC2_process(getdata_codec, inBufs, outBufs, inArgs, outArgs) != VIDENC2_EOK;
+    }
+    pthread_join(producer, NULL);
+
+    printf("  encoder    %d blocks in %u us, %d getDataFxn calls, %d without rows\n", blocks,
+           (unsigned int)(now_us() - start), getdata_calls, getdata_empty);
+    /* Every block may find the rows already handed out, the retries are rare */
+    if( failed || getdata_empty > blocks + (int)((now_us() - start) / DCE_CALLBACK_RETRY_US) + 1 ) {
+        fprintf(stderr, "callback: getDataFxn called %d times without rows for %d blocks\n",
+                getdata_empty, blocks);
+        failed = 1;
+    }
+
+EXIT:
+    if( getdata_codec ) {
+        VIDENC2_delete(getdata_codec);
+    }
+    if( in ) {
+        dce_buf_unlock(1, &fd[0]);
+        close(fd[0]);
+        omap_bo_del(in);
+    }
+    if( out ) {
+        dce_buf_unlock(1, &fd[1]);
+        close(fd[1]);
+        omap_bo_del(out);
+    }
+    dce_free(params);
+    dce_free(dynParams);
+    dce_free(status);
+    dce_free(inArgs);
+    dce_free(outArgs);
+    dce_free(inBufs);
+    dce_free(outBufs);
+    return (failed);
+}
+
+static int callback(void)
+{
+    sim_decoder             dec;
+    Engine_Handle           engine;
+    Engine_Error            ec;
+    dce_histogram           h;
+    int                     i, expected, failed;
+
+    expected = calls * SIMBENCH_HEIGHT / 16;
+    callback_latency = calloc(expected, sizeof(uint32_t));
+    engine = Engine_open("ivahd_vidsvr", NULL, &ec);
+    if( engine == NULL || callback_latency == NULL ) {
+        fprintf(stderr, "Engine_open failed\n");
+        free(callback_latency);
+        return (1);
+    }
+    failed = decoder_open(&dec, engine, 1) || callback_control(&dec, callback_put);
+
+    for( i = 0; i < calls && !failed; i++ ) {
+        failed = decoder_process(&dec);
+    }
+    if( !failed && dce_get_callback_latency(dec.codec, &h) == DCE_EOK ) {
+        printf("callback: %d frames of %d blocks, %d blocks delivered\n", calls, SIMBENCH_HEIGHT / 16, callback_blocks);
+        qsort(callback_latency, expected, sizeof(uint32_t), cmp_u32);
+        printf("  from block p50 %6u us  p99 %6u us  max %6u us\n", callback_latency[expected / 2],
+               callback_latency[expected * 99 / 100], callback_latency[expected - 1]);
+        printf("  from RPC   p50 %6u us  p99 %6u us  max %6u us\n", dce_stats_percentile(&h, 50),
+               dce_stats_percentile(&h, 99), h.max_us);
+        if( callback_blocks != expected || h.count != (uint32_t)expected ) {
+            fprintf(stderr, "%d blocks expected, %d delivered in %u callbacks\n", expected, callback_blocks, h.count);
+            failed = 1;
+        }
+    } else {
+        fprintf(stderr, "callback: row mode decoding failed\n");
+        failed = 1;
+    }
+    if( !failed ) {
+        failed = callback_encoder(engine);
+    }
+    decoder_close(&dec);
+    if( !failed ) {
+        failed = callback_many(engine);
+    }
+    Engine_close(engine);
+    free(callback_latency);
+    return (failed);
+}
+
+/***************** priority ****************/
+#define PRIORITY_PERIOD_US  1000
+
+static volatile int     priority_stop;
+
+/* A batch decoder issuing process calls until priority_stop */
+static void *priority_batch_run(void *arg)
+{
+    bench_thread    *t = arg;
+
+    pthread_barrier_wait(t->start);
+    while( !priority_stop && !t->failed ) {
+        t->failed = decoder_process(&t->dec);
+    }
+    return (NULL);
+}
+
+/* Latency of the realtime calls of rt under the load of n batch decoders, sorted into lat */
+static int priority_run(const char *title, sim_decoder *rt, bench_thread *t, int n, uint32_t *lat)
+{
+    pthread_t           thread[SIMBENCH_MAX_THREADS];
+    pthread_barrier_t   start;
+    uint64_t            begin;
+    int                 i, failed = 0;
+
+    priority_stop = 0;
+    pthread_barrier_init(&start, NULL, n + 1);
+    for( i = 0; i < n; i++ ) {
+        t[i].start = &start;
+        t[i].failed = 0;
+        pthread_create(&thread[i], NULL, priority_batch_run, &t[i]);
+    }
+    pthread_barrier_wait(&start);
+    for( i = 0; i < calls && !failed; i++ ) {
+        usleep(PRIORITY_PERIOD_US);
+        begin = now_us();
+        failed = decoder_process(rt);
+        lat[i] = (uint32_t)(now_us() - begin);
+    }
+    priority_stop = 1;
+    for( i = 0; i < n; i++ ) {
+        pthread_join(thread[i], NULL);
+        failed |= t[i].failed;
+    }
+    pthread_barrier_destroy(&start);
+
+    qsort(lat, calls, sizeof(uint32_t), cmp_u32);
+    printf("  %-12s p50 %6u us  p99 %6u us  max %6u us\n", title, lat[calls / 2],
+           lat[calls * 99 / 100], lat[calls - 1]);
+    return (failed);
+}
+
+static int priority(int threads)
+{
+    bench_thread    t[SIMBENCH_MAX_THREADS];
+    sim_decoder     rt;
+    Engine_Handle   engine;
+    Engine_Error    ec;
+    uint32_t        *lat, free_p99;
+    int             i, n = threads - 1, failed;
+
+    if( n < 1 ) {
+        fprintf(stderr, "priority needs at least 2 threads\n");
+        return (1);
+    }
+    lat = calloc(calls, sizeof(uint32_t));
+    engine = Engine_open("ivahd_vidsvr", NULL, &ec);
+    if( engine == NULL || lat == NULL ) {
+        fprintf(stderr, "Engine_open failed\n");
+        free(lat);
+        return (1);
+    }
+    memset(t, 0, sizeof(t));
+    failed = decoder_open(&rt, engine, 0) || dce_set_priority(rt.codec, DCE_PRIORITY_REALTIME) != DCE_EOK;
+    for( i = 0; i < n; i++ ) {
+        failed |= decoder_open(&t[i].dec, engine, 0) ||
+                  dce_set_priority(t[i].dec.codec, DCE_PRIORITY_BATCH) != DCE_EOK;
+    }
+
+    if( !failed ) {
+        printf("priority: %d realtime process calls against %d batch decoder(s)\n", calls, n);
+        failed = priority_run("unscheduled", &rt, t, n, lat);
+        free_p99 = lat[calls * 99 / 100];
+        dce_set_scheduler(0, 1, DCE_DEFAULT_STARVATION_US);
+        failed |= priority_run("scheduled", &rt, t, n, lat);
+        dce_set_scheduler(0, 0, DCE_DEFAULT_STARVATION_US);
+        if( !failed && lat[calls * 99 / 100] >= free_p99 ) {
+            fprintf(stderr, "priority: the scheduler does not lower the realtime p99\n");
+            failed = 1;
+        }
+    } else {
+        fprintf(stderr, "priority: setup failed\n");
+    }
+
+    decoder_close(&rt);
+    for( i = 0; i < n; i++ ) {
+        decoder_close(&t[i].dec);
+    }
+    Engine_close(engine);
+    free(lat);
+    return (failed);
+}
+
+/***************** timeout ****************/
+#define TIMEOUT_US          20000
+#define TIMEOUT_WAIT_US     1000000
+
+/* Wait for cond() to become true, 0 if it does within TIMEOUT_WAIT_US */
+static int timeout_wait(int (*cond)(int arg), int arg)
+{
+    uint64_t    end = now_us() + TIMEOUT_WAIT_US;
+
+    while( !cond(arg) ) {
+        if( now_us() > end ) {
+            return (-1);
+        }
+        usleep(1000);
+    }
+    return (0);
+}
+
+static int stalled(int n)
+{
+    return (dce_sim_stalled_calls() >= n);
+}
+
+static int codecs_below(int n)
+{
+    return (dce_sim_codec_count(0) < n);
+}
+
+static int connections_closed(int core)
+{
+    uint32_t    calls[DCE_MAX_CONNECTIONS];
+
+    return (dce_sim_connection_calls(core, calls, DCE_MAX_CONNECTIONS) == 0);
+}
+
+/* A timed call of d against the stalled core, which must be cancelled */
+static int timeout_expire(const char *title, sim_decoder *d)
+{
+    XDAS_UInt32 overruns;
+    uint64_t    begin = now_us();
+    int         failed = 0;
+
+    d->outBufs->descs[1].buf = d->outBufs->descs[0].buf;
+    if( VIDDEC3_processTimed(d->codec, d->inBufs, d->outBufs, d->inArgs, d->outArgs,
+                             TIMEOUT_US) != VIDDEC3_ETIMEOUT || now_us() - begin > TIMEOUT_WAIT_US ) {
+        fprintf(stderr, "%s: the timed call was not cancelled\n", title);
+        return (1);
+    }
+    if( dce_get_instance_health(d->codec, &overruns, &failed) != DCE_EOK || !failed ||
+        decoder_process(d) == 0 ) {
+        fprintf(stderr, "%s: the instance did not fail\n", title);
+        return (1);
+    }
+    return (0);
+}
+
+/* Cancelled in flight: the instance is deleted remotely when the call returns */
+static int timeout_in_flight(Engine_Handle engine)
+{
+    sim_decoder     d;
+    int             codecs, failed;
+
+    if( decoder_open(&d, engine, 0) ) {
+        return (1);
+    }
+    codecs = dce_sim_codec_count(0);
+    dce_sim_stall(1);
+    failed = timeout_expire("in flight", &d);
+    VIDDEC3_delete(d.codec);
+    d.codec = NULL;
+    if( !failed && dce_sim_codec_count(0) != codecs ) {
+        fprintf(stderr, "in flight: remote instance deleted under its call\n");
+        failed = 1;
+    }
+    dce_sim_stall(0);
+    if( !failed && timeout_wait(codecs_below, codecs) ) {
+        fprintf(stderr, "in flight: remote instance not deleted once the call returned\n");
+        failed = 1;
+    }
+    decoder_close(&d);
+    printf("  cancelled in flight      : %s\n", failed ? "FAIL" : "ok");
+    return (failed);
+}
+
+static void *timeout_blocker(void *arg)
+{
+    return (decoder_process(arg) ? arg : NULL);
+}
+
+/* Cancelled while waiting for the only slot of the scheduler: never issued */
+static int timeout_queued(Engine_Handle engine)
+{
+    sim_decoder     blocker, d;
+    pthread_t       thread;
+    uint32_t        before[DCE_MAX_CONNECTIONS], after[DCE_MAX_CONNECTIONS];
+    void            *res = NULL;
+    int             n, i, codecs, failed = 0;
+
+    if( decoder_open(&blocker, engine, 0) ) {
+        return (1);
+    }
+    if( decoder_open(&d, engine, 0) ) {
+        decoder_close(&blocker);
+        return (1);
+    }
+    dce_set_scheduler(0, 1, DCE_DEFAULT_STARVATION_US);
+    dce_sim_stall(1);
+    pthread_create(&thread, NULL, timeout_blocker, &blocker);
+    if( timeout_wait(stalled, 1) ) {
+        fprintf(stderr, "queued: the blocking call did not reach the core\n");
+        failed = 1;
+    }
+    n = dce_sim_connection_calls(0, before, DCE_MAX_CONNECTIONS);
+    failed |= timeout_expire("queued", &d);
+    dce_sim_stall(0);
+    pthread_join(thread, &res);
+    failed |= (res != NULL);
+
+    /* A slot freed by the blocker would have issued a call left in the queue */
+    usleep(50000);
+    dce_sim_connection_calls(0, after, DCE_MAX_CONNECTIONS);
+    for( i = 0; i < n && i < DCE_MAX_CONNECTIONS; i++ ) {
+        if( after[i] != before[i] ) {
+            fprintf(stderr, "queued: the cancelled call was issued\n");
+            failed = 1;
+        }
+    }
+    if( decoder_process(&blocker) ) {
+        fprintf(stderr, "queued: the scheduler slot was not given back\n");
+        failed = 1;
+    }
+
+    /* The cancelled call is over: the remote instance is deleted at once */
+    codecs = dce_sim_codec_count(0);
+    VIDDEC3_delete(d.codec);
+    d.codec = NULL;
+    if( dce_sim_codec_count(0) != codecs - 1 ) {
+        fprintf(stderr, "queued: remote instance not deleted\n");
+        failed = 1;
+    }
+    dce_set_scheduler(0, 0, DCE_DEFAULT_STARVATION_US);
+    decoder_close(&d);
+    decoder_close(&blocker);
+    printf("  cancelled while queued   : %s\n", failed ? "FAIL" : "ok");
+    return (failed);
+}
+
+/* Engine_close() with a cancelled call in flight: the connection outlives it */
+static int timeout_close(Engine_Handle engine)
+{
+    sim_decoder     d;
+    uint64_t        begin;
+    int             failed;
+
+    if( decoder_open(&d, engine, 0) ) {
+        Engine_close(engine);
+        return (1);
+    }
+    dce_sim_stall(1);
+    failed = timeout_expire("close", &d);
+    VIDDEC3_delete(d.codec);
+    d.codec = NULL;
+    begin = now_us();
+    Engine_close(engine);
+    if( now_us() - begin > TIMEOUT_WAIT_US ) {
+        fprintf(stderr, "close: Engine_close() waited for the cancelled call\n");
+        failed = 1;
+    }
+    if( dce_sim_unsafe_deletes() ) {
+        fprintf(stderr, "close: connection deleted under the cancelled call\n");
+        failed = 1;
+    }
+    dce_sim_stall(0);
+    if( timeout_wait(connections_closed, 0) ) {
+        fprintf(stderr, "close: connection not deleted once the call returned\n");
+        failed = 1;
+    }
+    decoder_close(&d);
+    printf("  Engine_close() in flight : %s\n", failed ? "FAIL" : "ok");
+    return (failed);
+}
+
+static int timeout(void)
+{
+    Engine_Handle   engine;
+    Engine_Error    ec;
+    int             failed;
+
+    engine = Engine_open("ivahd_vidsvr", NULL, &ec);
+    if( engine == NULL ) {
+        fprintf(stderr, "Engine_open failed\n");
+        return (1);
+    }
+    printf("timeout: timed calls cancelled after %d us\n", TIMEOUT_US);
+    failed = timeout_in_flight(engine);
+    failed |= timeout_queued(engine);
+    /* Last, it closes the engine */
+    failed |= timeout_close(engine);
+    return (failed);
+}
+
+/***************** batch ****************/
+/* Round trips of DCE_MAX_CONTROL_BATCH commands, batched or one VIDDEC3_control() each, us per round */
+static double batch_run(sim_decoder *d, dce_control_cmd *cmds, int batched, int *failed)
+{
+    uint64_t    begin = now_us();
+    int         i, j;
+
+    for( i = 0; i < calls && !*failed; i++ ) {
+        if( batched ) {
+            *failed |= VIDDEC3_controlBatch(d->codec, cmds, DCE_MAX_CONTROL_BATCH) != VIDDEC3_EOK;
+            continue;
+        }
+        for( j = 0; j < DCE_MAX_CONTROL_BATCH; j++ ) {
+            *failed |= VIDDEC3_control(d->codec, cmds[j].cmd_id, cmds[j].dynParams, cmds[j].status) != VIDDEC3_EOK;
+        }
+    }
+    return ((double)(now_us() - begin) / calls);
+}
+
+static int batch(void)
+{
+    /* One more than the batch size, to check that it is rejected */
+    dce_control_cmd         cmds[DCE_MAX_CONTROL_BATCH + 1];
+    VIDDEC3_Status          *status[DCE_MAX_CONTROL_BATCH + 1];
+    VIDDEC3_DynamicParams   *dynParams;
+    sim_decoder             dec;
+    Engine_Handle           engine;
+    Engine_Error            ec;
+    XDAS_Int32              ret;
+    double                  single, batched;
+    int                     i, failed;
+
+    engine = Engine_open("ivahd_vidsvr", NULL, &ec);
+    if( engine == NULL ) {
+        fprintf(stderr, "Engine_open failed\n");
+        return (1);
+    }
+    memset(status, 0, sizeof(status));
+    failed = decoder_open(&dec, engine, 0);
+    dynParams = dce_alloc(sizeof(VIDDEC3_DynamicParams));
+    for( i = 0; i <= DCE_MAX_CONTROL_BATCH; i++ ) {
+        status[i] = dce_alloc(sizeof(VIDDEC3_Status));
+        failed |= status[i] == NULL;
+    }
+    if( failed || dynParams == NULL ) {
+        fprintf(stderr, "batch: setup failed\n");
+        failed = 1;
+        goto EXIT;
+    }
+    memset(dynParams, 0, sizeof(VIDDEC3_DynamicParams));
+    dynParams->size = sizeof(VIDDEC3_DynamicParams);
+    dynParams->decodeHeader = XDM_DECODE_AU;
+    dynParams->frameSkipMode = IVIDEO_NO_SKIP;
+    dynParams->newFrameFlag = XDAS_TRUE;
+    for( i = 0; i <= DCE_MAX_CONTROL_BATCH; i++ ) {
+        memset(status[i], 0, sizeof(VIDDEC3_Status));
+        status[i]->size = sizeof(VIDDEC3_Status);
+        /* The usual reconfiguration: new params, then the status and buffer needs */
+        cmds[i].cmd_id = (i % 3 == 0) ? XDM_SETPARAMS : (i % 3 == 1) ? XDM_GETSTATUS : XDM_GETBUFINFO;
+        cmds[i].dynParams = dynParams;
+        cmds[i].status = status[i];
+        cmds[i].ret = XDM_EFAIL;
+    }
+
+    ret = VIDDEC3_controlBatch(dec.codec, cmds, DCE_MAX_CONTROL_BATCH);
+    for( i = 0; i < DCE_MAX_CONTROL_BATCH && ret == VIDDEC3_EOK; i++ ) {
+        if( cmds[i].ret != XDM_EOK || status[i]->outputWidth != SIMBENCH_WIDTH ||
+            status[i]->outputHeight != SIMBENCH_HEIGHT ) {
+            break;
+        }
+        if( cmds[i].cmd_id == XDM_GETBUFINFO && (status[i]->bufInfo.minNumOutBufs != 2 ||
+            status[i]->bufInfo.minOutBufSize[0].bytes != SIMBENCH_WIDTH * SIMBENCH_HEIGHT) ) {
+            break;
+        }
+    }
+    if( ret != VIDDEC3_EOK || i < DCE_MAX_CONTROL_BATCH ) {
+        fprintf(stderr, "batch: returned %d, status of command %d not filled\n", ret, i);
+        failed = 1;
+        goto EXIT;
+    }
+    if( VIDDEC3_controlBatch(dec.codec, cmds, DCE_MAX_CONTROL_BATCH + 1) == VIDDEC3_EOK ) {
+        fprintf(stderr, "batch: %d commands accepted\n", DCE_MAX_CONTROL_BATCH + 1);
+        failed = 1;
+    }
+    cmds[0].cmd_id = XDM_GETVERSION;
+    if( VIDDEC3_controlBatch(dec.codec, cmds, 1) == VIDDEC3_EOK ) {
+        fprintf(stderr, "batch: XDM_GETVERSION accepted\n");
+        failed = 1;
+    }
+    cmds[0].cmd_id = XDM_SETPARAMS;
+
+    if( !failed ) {
+        single = batch_run(&dec, cmds, 0, &failed);
+        batched = batch_run(&dec, cmds, 1, &failed);
+        printf("batch: %d rounds of %d commands, us per round\n", calls, DCE_MAX_CONTROL_BATCH);
+        printf("  VIDDEC3_control      %8.1f\n", single);
+        printf("  VIDDEC3_controlBatch %8.1f (%.1fx)\n", batched, single / batched);
+    }
+
+EXIT:
+    for( i = 0; i <= DCE_MAX_CONTROL_BATCH; i++ ) {
+        dce_free(status[i]);
+    }
+    dce_free(dynParams);
+    decoder_close(&dec);
+    Engine_close(engine);
+    return (failed);
+}
+
+int main(int argc, char **argv)
+{
+    const char  *mode = NULL;
+    int         opt, threads = 0, ret = 1;
+
+    while( (opt = getopt(argc, argv, "m:t:n:")) != -1 ) {
+        switch( opt ) {
+            case 'm' : mode = optarg; break;
+            case 't' : threads = atoi(optarg); break;
+            case 'n' : calls = atoi(optarg); break;
+            default : mode = NULL; optind = argc; break;
+        }
+    }
+    if( mode == NULL || threads < 0 || threads > SIMBENCH_MAX_THREADS || calls < 1 ) {
+        fprintf(stderr, "usage: %s -m throughput|async|marshal|pool|callback|priority|timeout|batch [-t threads] [-n calls]\n", argv[0]);
+        return (1);
+    }
+
+    /* Remote latency the client paths are measured against, unless set by the caller. */
+    /* marshal and callback measure the client side alone.                             */
+    setenv("DCE_SIM_CALL_US", strcmp(mode, "marshal") && strcmp(mode, "callback") ? "200" : "0", 0);
+    if( !strcmp(mode, "callback") ) {
+        setenv("DCE_SIM_PROCESS_US", "400", 0);
+    } else if( !strcmp(mode, "priority") ) {
+        setenv("DCE_SIM_PROCESS_US", "300", 0);
+    }
+    dev = dce_init();
+    if( dev == NULL ) {
+        fprintf(stderr, "dce_init failed\n");
+        return (1);
+    }
+    /* The simulated IVA-HD hosts as many decoders as there are threads */
+    dce_set_instance_quota(0, SIMBENCH_MAX_THREADS);
+
+    if( !strcmp(mode, "throughput") ) {
+        ret = throughput(threads ? threads : 8);
+    } else if( !strcmp(mode, "callback") ) {
+        ret = callback();
+    } else if( !strcmp(mode, "pool") ) {
+        ret = pool(threads ? threads : 8);
+    } else if( !strcmp(mode, "marshal") ) {
+        ret = marshal();
+    } else if( !strcmp(mode, "async") ) {
+        ret = async(threads ? threads : 4);
+    } else if( !strcmp(mode, "priority") ) {
+        ret = priority(threads ? threads : 8);
+    } else if( !strcmp(mode, "timeout") ) {
+        ret = timeout();
+    } else if( !strcmp(mode, "batch") ) {
+        ret = batch();
+    } else {
+        fprintf(stderr, "unknown mode %s\n", mode);
+    }
+
+    dce_deinit(dev);
+    return (ret);
+}